@@ -212,6 +212,10 @@ Aerolab::Aerolab(
   eoffset   = 0.0;
   constantAlt = false;
 
+  termsRide = NULL;
+  termsPoints = 0;
+  termsConstantAlt = termsMetric = false;
+
   insertLegend(new QwtLegend(), QwtPlot::BottomLegend);
   setCanvasBackground(Qt::white);
   static_cast<QwtPlotCanvas*>(canvas())->setFrameStyle(QFrame::NoFrame);
@@ -279,130 +283,165 @@ Aerolab::configChanged(qint32)
 void
 Aerolab::setData(RideItem *_rideItem, bool new_zoom) {
 
-  // HARD-CODED DATA: p1->kph
-  double vfactor = 3.600;
-  double m       =  totalMass;
-  double small_number = 0.00001;
-
   rideItem = _rideItem;
   RideFile *ride = rideItem->ride();
 
-  veArray.clear();
-  altArray.clear();
-  distanceArray.clear();
-  timeArray.clear();
-
   if( ride ) {
 
-    const RideFileDataPresent *dataPresent = ride->areDataPresent();
-    //setTitle(ride->startTime().toString(GC_DATETIME_FORMAT));
+    if( ride->areDataPresent()->watts ) {
+
+      // the energy terms only change with the ride, so when the
+      // parameters change we just need to re-evaluate them
+      if (new_zoom || ride != termsRide || ride->dataPoints().size() != termsPoints ||
+          constantAlt != termsConstantAlt || context->athlete->useMetricUnits != termsMetric)
+        prepare(ride);
 
-    if( dataPresent->watts ) {
+      recalcVE();
 
-      // If watts are present, then we can fill the veArray data:
-      const RideFileDataPresent *dataPresent = ride->areDataPresent();
-      int npoints = ride->dataPoints().size();
-      double dt = ride->recIntSecs();
-      veArray.resize(dataPresent->watts ? npoints : 0);
-      altArray.resize(dataPresent->alt || constantAlt ? npoints : 0);
-      timeArray.resize(dataPresent->watts ? npoints : 0);
-      distanceArray.resize(dataPresent->watts ? npoints : 0);
+    } else {
+      veArray.clear();
+      altArray.clear();
+      distanceArray.clear();
+      timeArray.clear();
+      termsRide = NULL;
 
-      // quickly erase old data
       veCurve->setVisible(false);
       altCurve->setVisible(false);
+    }
+    recalc(new_zoom);
+    adjustEoffset();
+  } else {
+    //setTitle("no data");
 
-      // detach and re-attach the ve curve:
-      veCurve->detach();
-      if (!veArray.empty()) {
-        veCurve->attach(this);
-        veCurve->setVisible(dataPresent->watts);
-      }
-
-      // detach and re-attach the ve curve:
-      bool have_recorded_alt_curve = false;
-      altCurve->detach();
-      if (!altArray.empty()) {
-        have_recorded_alt_curve = true;
-        altCurve->attach(this);
-        altCurve->setVisible(dataPresent->alt || constantAlt );
-      }
-
-      // Fill the virtual elevation profile with data from the ride data:
-      double t = 0.0;
-      double vlast = 0.0;
-      double e     = 0.0;
-      arrayLength = 0;
-      foreach(const RideFilePoint *p1, ride->dataPoints()) {
-      if ( arrayLength == 0 )
-        e = eoffset;
-
-      timeArray[arrayLength]  = p1->secs / 60.0;
-      if ( have_recorded_alt_curve ) {
-          if ( constantAlt && arrayLength > 0) {
-              altArray[arrayLength] = altArray[arrayLength-1];
-          }
-          else  {
-              if ( constantAlt && !dataPresent->alt)
-                  altArray[arrayLength] = 0;
-              else
-                altArray[arrayLength] = (context->athlete->useMetricUnits
-                   ? p1->alt
-                   : p1->alt * FEET_PER_METER);
-          }
-      }
+  }
+}
 
-      // Unpack:
-      double power = max(0, p1->watts);
-      double v     = p1->kph/vfactor;
-      double headwind = v;
-      if( dataPresent->headwind ) {
-        headwind   = p1->headwind/vfactor;
-      }
-      double f     = 0.0;
-      double a     = 0.0;
+void
+Aerolab::prepare(RideFile *ride) {
 
-      // Use km data instead of formula for file with a stop (gap).
-      //d += v * dt;
-      //distanceArray[arrayLength] = d/1000;
+  // HARD-CODED DATA: p1->kph
+  double vfactor = 3.600;
+  double small_number = 0.00001;
+  double g = KG_FORCE_PER_METER;
 
-      distanceArray[arrayLength] = p1->km;
+  // If watts are present, then we can fill the veArray data:
+  const RideFileDataPresent *dataPresent = ride->areDataPresent();
+  int npoints = ride->dataPoints().size();
+  double dt = ride->recIntSecs();
+  double units = context->athlete->useMetricUnits ? 1 : FEET_PER_METER;
+
+  veArray.resize(npoints);
+  altArray.resize(dataPresent->alt || constantAlt ? npoints : 0);
+  timeArray.resize(npoints);
+  distanceArray.resize(npoints);
+  powerTerm.resize(npoints);
+  distanceTerm.resize(npoints);
+  aeroTerm.resize(npoints);
+  accelTerm.resize(npoints);
+
+  termsRide = ride;
+  termsPoints = npoints;
+  termsConstantAlt = constantAlt;
+  termsMetric = context->athlete->useMetricUnits;
+
+  // quickly erase old data
+  veCurve->setVisible(false);
+  altCurve->setVisible(false);
+
+  // detach and re-attach the ve curve:
+  veCurve->detach();
+  if (!veArray.empty()) {
+    veCurve->attach(this);
+    veCurve->setVisible(dataPresent->watts);
+  }
 
+  // detach and re-attach the ve curve:
+  bool have_recorded_alt_curve = false;
+  altCurve->detach();
+  if (!altArray.empty()) {
+    have_recorded_alt_curve = true;
+    altCurve->attach(this);
+    altCurve->setVisible(dataPresent->alt || constantAlt );
+  }
 
+  // Fill the energy terms with data from the ride data:
+  double vlast = 0.0;
+  double power_total = 0, distance_total = 0, aero_total = 0, accel_total = 0;
+  arrayLength = 0;
+  foreach(const RideFilePoint *p1, ride->dataPoints()) {
 
-      if( v > small_number ) {
-        f  = power/v;
-        a  = ( v*v - vlast*vlast ) / ( 2.0 * dt * v );
-      } else {
-        a = ( v - vlast ) / dt;
-      }
+    timeArray[arrayLength]  = p1->secs / 60.0;
+    if ( have_recorded_alt_curve ) {
+        if ( constantAlt && arrayLength > 0) {
+            altArray[arrayLength] = altArray[arrayLength-1];
+        }
+        else  {
+            if ( constantAlt && !dataPresent->alt)
+                altArray[arrayLength] = 0;
+            else
+              altArray[arrayLength] = (context->athlete->useMetricUnits
+                 ? p1->alt
+                 : p1->alt * FEET_PER_METER);
+        }
+    }
 
-      f *= eta; // adjust for drivetrain efficiency if using a crank-based meter
-      double s   = slope( f, a, m, crr, cda, rho, headwind );
-      double de  = s * v * dt * (context->athlete->useMetricUnits ? 1 : FEET_PER_METER);
+    // Unpack:
+    double power = max(0, p1->watts);
+    double v     = p1->kph/vfactor;
+    double headwind = v;
+    if( dataPresent->headwind ) {
+      headwind   = p1->headwind/vfactor;
+    }
+    double f     = 0.0;
+    double a     = 0.0;
 
-      e += de;
-      t += dt;
+    // Use km data instead of formula for file with a stop (gap).
+    distanceArray[arrayLength] = p1->km;
 
-      veArray[arrayLength] = e;
+    if( v > small_number ) {
+      f  = power/v;
+      a  = ( v*v - vlast*vlast ) / ( 2.0 * dt * v );
+    } else {
+      a = ( v - vlast ) / dt;
+    }
 
-      vlast = v;
+    // the change in elevation is the slope (see slope() below) times
+    // the distance travelled, split into the parts each parameter scales
+    double ds = v * dt * units;
+    power_total += ds * f / g;
+    distance_total += ds;
+    aero_total += ds * headwind * headwind / (2.0 * g);
+    accel_total += ds * a / g;
 
-      ++arrayLength;
-    }
+    powerTerm[arrayLength] = power_total;
+    distanceTerm[arrayLength] = distance_total;
+    aeroTerm[arrayLength] = aero_total;
+    accelTerm[arrayLength] = accel_total;
 
-  } else {
-      veCurve->setVisible(false);
-      altCurve->setVisible(false);
-  }
-    recalc(new_zoom);
-    adjustEoffset();
-  } else {
-    //setTitle("no data");
+    vlast = v;
 
+    ++arrayLength;
   }
 }
 
+void
+Aerolab::recalcVE() {
+
+  // see the terms in Aerolab.h, this is slope() summed
+  const double m = totalMass;
+  const double kpower = eta / m;
+  const double kaero = cda * rho / m;
+
+  const double *pt = powerTerm.constData();
+  const double *dt = distanceTerm.constData();
+  const double *at = aeroTerm.constData();
+  const double *ct = accelTerm.constData();
+  double *ve = veArray.data();
+
+  for (int i=0; i<arrayLength; i++)
+    ve[i] = eoffset + kpower * pt[i] - crr * dt[i] - kaero * at[i] - ct[i];
+}
+
 void
 Aerolab::setAxisTitle(int axis, QString label)
 {
@@ -627,7 +666,6 @@ Aerolab::setIntCrr(
 
   crr = (double) value / 1000000.0;
 
-  recalc(false);
 }
 
 // At slider 1000, we want to get max CdA=1.000
@@ -637,7 +675,6 @@ Aerolab::setIntCda(
            int value
             )  {
   cda = (double) value / 10000.0;
-  recalc(false);
 }
 
 // At slider 1000, we want to get max CdA=1.000
@@ -648,7 +685,6 @@ Aerolab::setIntTotalMass(
               ) {
 
   totalMass = (double) value / 100.0;
-  recalc(false);
 }
 
 
@@ -660,7 +696,6 @@ Aerolab::setIntRho(
             ) {
 
   rho = (double) value / 10000.0;
-  recalc(false);
 }
 
 
@@ -672,7 +707,6 @@ Aerolab::setIntEta(
                      ) {
 
   eta = (double) value / 10000.0;
-  recalc(false);
 }
 
 
@@ -684,7 +718,6 @@ Aerolab::setIntEoffset(
                      ) {
 
   eoffset = (double) value / 100.0;
-  recalc(false);
 }
 
 
@@ -766,132 +799,208 @@ void Aerolab::refreshIntervalMarkers()
  * Date: 23-aug-2012
  */
 QString Aerolab::estimateCdACrr(RideItem *rideItem)
+{
+    return applyFit(fitCdACrr(fitData(rideItem)));
+}
+
+/*
+ * Copy what the estimate needs from the ride. When intervals are selected
+ * each one is a lap and segments never span laps, so separate runs up and
+ * down the same hill can be used without the descent between them.
+ */
+AerolabFit Aerolab::fitData(RideItem *rideItem) const
 {
     // HARD-CODED DATA: p1->kph
     const double vfactor = 3.600;
-    const double g = KG_FORCE_PER_METER;
-    RideFile *ride = rideItem->ride();
-    QString errMsg;
-
-    if(ride) {
-        const RideFileDataPresent *dataPresent = ride->areDataPresent();
-        if(( dataPresent->alt || constantAlt )  && dataPresent->watts) {
-            double dt = ride->recIntSecs();
-            int npoints = ride->dataPoints().size();
-#ifdef Q_CC_MSVC
-            double* X1 = new double[npoints];
-            double* X2 = new double[npoints];
-            double* Egain = new double[npoints];
-#else
-            double X1[npoints], X2[npoints], Egain[npoints];
-#endif
-            int nSeg = -1;
-            double altInit = 0, vInit = 0;
-            /* For each segment, defined between points with alt != 0,
-             * this loop computes X1, X2 and Egain to verify:
-             * Aero-Loss + RR-Loss = Egain
-             * where
-             *      Aero-Loss = X1[nSgeg] * CdA
-             *      RR-Loss = X2[nSgeg] * Crr
-             * are the aero and rr components of the energy loss with
-             *      X1[nSeg] = sum(0.5 * rho * headwind*headwind * distance)
-             *      X2[nSeg] = sum(totalMass * g * distance)
-             * and the energy gain sums power in the segment with
-             * potential and kinetic variations:
-             *      Egain = sum(eta * power * dt) +
-             *              totalMass * (g * (altInit - alt) +
-             *              0.5 * (vInit*vInit - v*v))
-             */
-            foreach(const RideFilePoint *p1, ride->dataPoints()) {
-                // Unpack:
-                double power = max(0, p1->watts);
-                double v     = p1->kph/vfactor;
-                double distance = v * dt;
-                double headwind = v;
-                if( dataPresent->headwind ) {
-                    headwind   = p1->headwind/vfactor;
-                }
-                double alt = p1->alt;
-                // start initial segment
-                if (nSeg < 0 && alt != 0) {
-                    nSeg = 0;
-                    X1[nSeg] = X2[nSeg] = Egain[nSeg] = 0.0;
-                    altInit = alt;
-                    vInit = v;
-                }
-                // accumulate segment data
-                if (nSeg >= 0) {
-                    // X1[nSgeg] * CdA == Aero-Loss
-                    X1[nSeg] += 0.5 * rho * headwind*headwind * distance;
-                    // X2[nSgeg] * Crr == RR-Loss
-                    X2[nSeg] += totalMass * g * distance;
-                    // Energy supplied
-                    Egain[nSeg] += eta * power * dt;
-                }
-                // close current segment and start a new one
-                if (nSeg >= 0 && alt != 0) {
-                    // Add change in potential and kinetic energy
-                    Egain[nSeg] += totalMass * (g * (altInit - alt) + 0.5 * (vInit*vInit - v*v));
-                    // Start a new segment
-                    nSeg++;
-                    X1[nSeg] = X2[nSeg] = Egain[nSeg] = 0.0;
-                    altInit = alt;
-                    vInit = v;
-                }
+    AerolabFit fit;
+    fit.dt = fit.rho = fit.eta = fit.totalMass = 0;
+    fit.cda = cda;
+    fit.crr = crr;
+
+    RideFile *ride = rideItem ? rideItem->ride() : NULL;
+    if (!ride) {
+        fit.errMsg = tr("No activity selected");
+        return fit;
+    }
+
+    const RideFileDataPresent *dataPresent = ride->areDataPresent();
+    if (!(dataPresent->alt || constantAlt) || !dataPresent->watts) {
+        fit.errMsg = tr("Altitude and Power data must be present");
+        return fit;
+    }
+
+    fit.dt = ride->recIntSecs();
+    fit.rho = rho;
+    fit.eta = eta;
+    fit.totalMass = totalMass;
+
+    QList<IntervalItem*> laps = rideItem->intervalsSelected();
+    int npoints = ride->dataPoints().size();
+    fit.power.reserve(npoints);
+    fit.v.reserve(npoints);
+    fit.headwind.reserve(npoints);
+    fit.alt.reserve(npoints);
+    fit.lap.reserve(npoints);
+
+    foreach(const RideFilePoint *p1, ride->dataPoints()) {
+
+        // which lap, the whole ride when none are selected
+        int lap = laps.count() ? -1 : 0;
+        for (int i=0; i<laps.count(); i++) {
+            if (p1->secs >= laps[i]->start && p1->secs <= laps[i]->stop) {
+                lap = i;
+                break;
             }
-            /* At least two segmentes needed to approximate:
-             *     X1 * CdA + X2 * Crr = Egain
-             * which, in matrix form, is:
-             *    X * [ CdA ; Crr ] = Egain
-             * and pre-multiplying by X transpose (X'):
-             *    X'* X [ CdA ; Crr ] = X' * Egain
-             * which is a system with two equations and two unknowns
-             *    A * [ CdA ; Crr ] = B
-             */
-            if (nSeg >= 2) {
-                // compute the normal equation: A * [ CdA ; Crr ] = B
-                // A = X'*X
-                // B = X'*Egain
-                double A11 = 0, A12 = 0, A21 = 0, A22 = 0, B1 = 0, B2 = 0;
-                for (int i = 0; i < nSeg; i++) {
-                    A11 += X1[i] * X1[i];
-                    A12 += X1[i] * X2[i];
-                    A21 += X2[i] * X1[i];
-                    A22 += X2[i] * X2[i];
-                    B1  += X1[i] * Egain[i];
-                    B2  += X2[i] * Egain[i];
-                }
-                // Solve the normal equation
-                // A11 * CdA + A12 * Crr = B1
-                // A21 * CdA + A22 * Crr = B2
-                double det = A11 * A22 - A12 * A21;
-                if (fabs(det) > 0.00) {
-                    // round and update if the values are in Aerolab's range
-                    double cda = floor(10000 * (A22 * B1 - A12 * B2) / det + 0.5) / 10000;
-                    double crr = floor(1000000 * (A11 * B2 - A21 * B1) / det + 0.5) / 1000000;
-                    if (cda >= 0.001 && cda <= 1.0 && crr >= 0.0001 && crr <= 0.1) {
-                        this->cda = cda;
-                        this->crr = crr;
-                        errMsg = ""; // No error
-                    } else {
-                        errMsg = tr("Estimates out-of-range");
-                    }
-                } else {
-                    errMsg = tr("At least two segments must be independent");
-                }
+        }
+
+        fit.power << max(0, p1->watts);
+        fit.v << p1->kph/vfactor;
+        fit.headwind << (dataPresent->headwind ? p1->headwind/vfactor : p1->kph/vfactor);
+        fit.alt << p1->alt;
+        fit.lap << lap;
+    }
+    return fit;
+}
+
+/*
+ * Estimate CdA and Crr usign energy balance in segments defined by
+ * non-zero altitude. This only uses the copied data so it can be
+ * run in a background thread.
+ * Sets errMsg if it fails to do the estimation, otherwise it sets
+ * cda and crr and leaves errMsg empty.
+ */
+AerolabFit Aerolab::fitCdACrr(AerolabFit fit)
+{
+    if (!fit.errMsg.isEmpty()) return fit;
+
+    const double g = KG_FORCE_PER_METER;
+    const double dt = fit.dt, rho = fit.rho, eta = fit.eta, totalMass = fit.totalMass;
+
+    // one entry per closed segment
+    QVector<double> X1, X2, Egain;
+
+    bool open = false;
+    int lastLap = -1;
+    double x1 = 0, x2 = 0, egain = 0;
+    double altInit = 0, vInit = 0;
+
+    /* For each segment, defined between points with alt != 0,
+     * this loop computes X1, X2 and Egain to verify:
+     * Aero-Loss + RR-Loss = Egain
+     * where
+     *      Aero-Loss = X1[nSgeg] * CdA
+     *      RR-Loss = X2[nSgeg] * Crr
+     * are the aero and rr components of the energy loss with
+     *      X1[nSeg] = sum(0.5 * rho * headwind*headwind * distance)
+     *      X2[nSeg] = sum(totalMass * g * distance)
+     * and the energy gain sums power in the segment with
+     * potential and kinetic variations:
+     *      Egain = sum(eta * power * dt) +
+     *              totalMass * (g * (altInit - alt) +
+     *              0.5 * (vInit*vInit - v*v))
+     */
+    for (int i=0; i<fit.lap.count(); i++) {
+
+        // a new lap, anything left open is dropped
+        if (fit.lap[i] != lastLap) {
+            open = false;
+            lastLap = fit.lap[i];
+        }
+        if (fit.lap[i] < 0) continue;
+
+        // Unpack:
+        double power = fit.power[i];
+        double v = fit.v[i];
+        double distance = v * dt;
+        double headwind = fit.headwind[i];
+        double alt = fit.alt[i];
+
+        // start initial segment
+        if (!open && alt != 0) {
+            open = true;
+            x1 = x2 = egain = 0.0;
+            altInit = alt;
+            vInit = v;
+        }
+        // accumulate segment data
+        if (open) {
+            // X1[nSgeg] * CdA == Aero-Loss
+            x1 += 0.5 * rho * headwind*headwind * distance;
+            // X2[nSgeg] * Crr == RR-Loss
+            x2 += totalMass * g * distance;
+            // Energy supplied
+            egain += eta * power * dt;
+        }
+        // close current segment and start a new one
+        if (open && alt != 0) {
+            // Add change in potential and kinetic energy
+            egain += totalMass * (g * (altInit - alt) + 0.5 * (vInit*vInit - v*v));
+            X1 << x1;
+            X2 << x2;
+            Egain << egain;
+            // Start a new segment
+            x1 = x2 = egain = 0.0;
+            altInit = alt;
+            vInit = v;
+        }
+    }
+
+    /* At least two segmentes needed to approximate:
+     *     X1 * CdA + X2 * Crr = Egain
+     * which, in matrix form, is:
+     *    X * [ CdA ; Crr ] = Egain
+     * and pre-multiplying by X transpose (X'):
+     *    X'* X [ CdA ; Crr ] = X' * Egain
+     * which is a system with two equations and two unknowns
+     *    A * [ CdA ; Crr ] = B
+     */
+    int nSeg = X1.count();
+    if (nSeg >= 2) {
+        // compute the normal equation: A * [ CdA ; Crr ] = B
+        // A = X'*X
+        // B = X'*Egain
+        double A11 = 0, A12 = 0, A21 = 0, A22 = 0, B1 = 0, B2 = 0;
+        for (int i = 0; i < nSeg; i++) {
+            A11 += X1[i] * X1[i];
+            A12 += X1[i] * X2[i];
+            A21 += X2[i] * X1[i];
+            A22 += X2[i] * X2[i];
+            B1  += X1[i] * Egain[i];
+            B2  += X2[i] * Egain[i];
+        }
+        // Solve the normal equation
+        // A11 * CdA + A12 * Crr = B1
+        // A21 * CdA + A22 * Crr = B2
+        double det = A11 * A22 - A12 * A21;
+        if (fabs(det) > 0.00) {
+            // round and update if the values are in Aerolab's range
+            double cda = floor(10000 * (A22 * B1 - A12 * B2) / det + 0.5) / 10000;
+            double crr = floor(1000000 * (A11 * B2 - A21 * B1) / det + 0.5) / 1000000;
+            if (cda >= 0.001 && cda <= 1.0 && crr >= 0.0001 && crr <= 0.1) {
+                fit.cda = cda;
+                fit.crr = crr;
+                fit.errMsg = ""; // No error
             } else {
-                errMsg = tr("At least two segments must be defined");
+                fit.errMsg = tr("Estimates out-of-range");
             }
-#ifdef Q_CC_MSVC
-            delete[] X1;
-            delete[] X2;
-            delete[] Egain;
-#endif
         } else {
-            errMsg = tr("Altitude and Power data must be present");
+            fit.errMsg = tr("At least two segments must be independent");
         }
     } else {
-        errMsg = tr("No activity selected");
+        fit.errMsg = tr("At least two segments must be defined");
+    }
+    return fit;
+}
+
+/*
+ * Returns an explanatory error message if the estimate failed,
+ * otherwise it updates cda and crr and returns an empty error message.
+ */
+QString Aerolab::applyFit(const AerolabFit &fit)
+{
+    if (fit.errMsg.isEmpty()) {
+        cda = fit.cda;
+        crr = fit.crr;
     }
-    return errMsg;
+    return fit.errMsg;
 }
@@ -44,6 +44,20 @@ class Context;
 class IntervalAerolabData;
 class LTMToolTip;
 class LTMCanvasPicker;
+class RideFile;
+
+// the samples and parameters the CdA and Crr estimate needs, copied so
+// the estimate can run in the background. Only samples in a lap take
+// part, laps are numbered from 0 and samples outside them are -1.
+struct AerolabFit {
+    QVector<double> power, v, headwind, alt;
+    QVector<int> lap;
+    double dt, rho, eta, totalMass;
+
+    // results
+    double cda, crr;
+    QString errMsg;
+};
 
 
 class Aerolab : public QwtPlot {
@@ -147,6 +161,24 @@ class Aerolab : public QwtPlot {
   int      intEoffset() const { return (int)( eoffset * 100); }
   QString  estimateCdACrr(RideItem* rideItem);
 
+  // the estimate in two halves, so it can run in the background
+  AerolabFit fitData(RideItem *rideItem) const;
+  static AerolabFit fitCdACrr(AerolabFit fit);
+  QString  applyFit(const AerolabFit &fit);
+
+  // Virtual elevation is linear in the parameters, for each sample
+  //   ve = eoffset + eta/m * power - crr * distance - cda*rho/m * aero - accel
+  // where the terms are running totals that only depend on the ride,
+  // so we only work them out when the ride changes and re-evaluating
+  // as sliders move is a handful of multiplies per sample.
+  QVector<double> powerTerm, distanceTerm, aeroTerm, accelTerm;
+  RideFile *termsRide;
+  int termsPoints;
+  bool termsConstantAlt, termsMetric;
+
+  void     prepare(RideFile *ride);
+  void     recalcVE();
+
 };
 
 #endif // _GC_Aerolab_h
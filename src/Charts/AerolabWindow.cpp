@@ -29,8 +29,14 @@
 #include <QtGui>
 #include <qwt_plot_zoomer.h>
 
+#if QT_VERSION > 0x050000
+#include <QtConcurrent>
+#else
+#include <QtConcurrentRun>
+#endif
+
 AerolabWindow::AerolabWindow(Context *context) :
-  GcChartWindow(context), context(context) {
+  GcChartWindow(context), context(context), estimateRide(NULL) {
     setControls(NULL);
 
   // Aerolab tab layout:
@@ -222,7 +228,7 @@ AerolabWindow::AerolabWindow(Context *context) :
   comboDistance->setCurrentIndex(1);
   smoothLayout->addWidget(comboDistance);
 
-  QPushButton *btnEstCdACrr = new QPushButton(tr("&Estimate CdA and Crr"), this);
+  btnEstCdACrr = new QPushButton(tr("&Estimate CdA and Crr"), this);
   smoothLayout->addWidget(btnEstCdACrr);
 
   btnSave = new QPushButton(tr("&Save parameters"), this);
@@ -267,6 +273,7 @@ AerolabWindow::AerolabWindow(Context *context) :
   connect(constantAlt, SIGNAL(stateChanged(int)), this, SLOT(setConstantAlt(int)));
   connect(comboDistance, SIGNAL(currentIndexChanged(int)), this, SLOT(setByDistance(int)));
   connect(btnEstCdACrr, SIGNAL(clicked()), this, SLOT(doEstCdACrr()));
+  connect(&estimate, SIGNAL(finished()), this, SLOT(estimateFinished()));
   connect(btnSave, SIGNAL(clicked()), this, SLOT(saveParametersInRide()));
   connect(context, SIGNAL(configChanged(qint32)), aerolab, SLOT(configChanged(qint32)));
   connect(context, SIGNAL(configChanged(qint32)), this, SLOT(configChanged(qint32)));
@@ -622,9 +629,26 @@ AerolabWindow::setByDistance(int value)
 void
 AerolabWindow::doEstCdACrr()
 {
+    if (estimate.isRunning()) return;
+
+    // the data is copied here, the fit itself can take a while
+    // on a long ride so we do it in the background
+    estimateRide = context->rideItem();
+    btnEstCdACrr->setEnabled(false);
+    estimate.setFuture(QtConcurrent::run(Aerolab::fitCdACrr, aerolab->fitData(estimateRide)));
+}
+
+void
+AerolabWindow::estimateFinished()
+{
+    btnEstCdACrr->setEnabled(true);
+
+    // the user moved on while we were working
     RideItem *ride = context->rideItem();
+    if (ride != estimateRide) return;
+
     /* Estimate Crr&Cda */
-    const QString errMsg = aerolab->estimateCdACrr(ride);
+    const QString errMsg = aerolab->applyFit(estimate.result());
     if (errMsg.isEmpty()) {
         /* Update Crr/Cda values values in UI */
         crrLineEdit->setText(QString("%1").arg(aerolab->getCrr()) );
@@ -22,8 +22,10 @@
 
 #include <QtGui>
 #include <QMessageBox>
+#include <QFutureWatcher>
+
+#include "Aerolab.h"
 
-class Aerolab;
 class Context;
 class QCheckBox;
 class QwtPlotZoomer;
@@ -73,6 +75,7 @@ class AerolabWindow : public GcChartWindow {
   void saveParametersInRide();
 
   protected slots:
+  void estimateFinished();
 
   protected:
   Context *context;
@@ -113,6 +116,11 @@ class AerolabWindow : public GcChartWindow {
   QLineEdit *commentEdit;
 
   QPushButton *btnSave;
+  QPushButton *btnEstCdACrr;
+
+  // the estimate runs in the background
+  QFutureWatcher<AerolabFit> estimate;
+  RideItem *estimateRide;
 
   void refresh(RideItem *_rideItem, bool newzoom);
   bool hasNewParametersInRide();
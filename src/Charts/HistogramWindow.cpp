@@ -47,7 +47,7 @@ static const int gearDigits  = 2;
 //
 // Constructor
 //
-HistogramWindow::HistogramWindow(Context *context, bool rangemode) : GcChartWindow(context), context(context), stale(true), source(NULL), active(false), bactive(false), rangemode(rangemode), compareStale(false), useCustom(false), useToToday(false), precision(99)
+HistogramWindow::HistogramWindow(Context *context, bool rangemode) : GcChartWindow(context), context(context), stale(true), rideStale(true), source(NULL), active(false), bactive(false), rangemode(rangemode), compareStale(false), useCustom(false), useToToday(false), precision(99)
 {
 
     QWidget *c = new QWidget;
@@ -315,7 +315,7 @@ HistogramWindow::HistogramWindow(Context *context, bool rangemode) : GcChartWind
     } else {
         dateSetting->hide();
         connect(this, SIGNAL(rideItemChanged(RideItem*)), this, SLOT(rideSelected()));
-        connect(context, SIGNAL(rideChanged(RideItem*)), this, SLOT(forceReplot()));
+        connect(context, SIGNAL(rideChanged(RideItem*)), this, SLOT(rideChanged()));
         connect(context, SIGNAL(intervalSelected()), this, SLOT(intervalSelected()));
         connect(context, SIGNAL(intervalHover(IntervalItem*)), powerHist, SLOT(intervalHover(IntervalItem*)));
 
@@ -776,9 +776,18 @@ HistogramWindow::intervalSelected()
     updateChart();
 }
 
+void
+HistogramWindow::rideChanged()
+{
+    rideStale = true;
+    forceReplot();
+}
+
 void
 HistogramWindow::rideAddorRemove(RideItem *)
 {
+    rideStale = true;
+    fetched = "";
     stale = true;
     if (amVisible()) updateChart();
 }
@@ -786,6 +795,10 @@ HistogramWindow::rideAddorRemove(RideItem *)
 void
 HistogramWindow::zonesChanged()
 {
+    // zoned histograms need counting again
+    rideStale = true;
+    fetched = "";
+
     if (!amVisible()) return;
 
     powerHist->refreshZoneLabels();
@@ -912,6 +925,7 @@ HistogramWindow::refreshUpdate(QDate past)
 {
     if (!rangemode || cfrom > past || (lastupdate != QTime() && lastupdate.secsTo(QTime::currentTime()) < 5)) return;
     lastupdate = QTime::currentTime();
+    fetched = "";
     forceReplot();
 
 }
@@ -982,13 +996,18 @@ HistogramWindow::updateChart()
             if (data->isChecked()) {
 
                 // plotting a data series, so refresh the ridefilecache
+                // but only when the rides it aggregates have changed,
+                // changing bins, zoning or the series just rebins it
+                QString key = "data " + fetchKey(use);
+                if (source == NULL || key != fetched) {
 
-                source = new RideFileCache(context, use.from, use.to, isfiltered, files, rangemode);
-                cfrom = use.from;
-                cto = use.to;
-                stale = false;
+                    source = new RideFileCache(context, use.from, use.to, isfiltered, files, rangemode);
+                    cfrom = use.from;
+                    cto = use.to;
+                    fetched = key;
 
-                if (old) delete old; // guarantee source pointer changes
+                    if (old) delete old; // guarantee source pointer changes
+                }
                 stale = false; // well we tried
 
                 // and which series to plot
@@ -1019,12 +1038,16 @@ HistogramWindow::updateChart()
                 fs.addFilter(context->isfiltered, context->filters);
                 fs.addFilter(context->ishomefiltered, context->homeFilters);
 
-                // setData using the summary metrics -- always reset since filters may
-                // have changed, or perhaps the bin width...
+                // setData using the summary metrics -- only when the rides or metrics
+                // have changed, the bin width is applied when it is plotted
                 powerHist->setSeries(RideFile::none);
                 powerHist->setDelta(getDelta());
                 powerHist->setDigits(getDigits());
-                powerHist->setData(Specification(use,fs), totalMetric(), distMetric(), &powerHist->standard);
+                QString key = QString("metric %1 %2 %3").arg(totalMetric()).arg(distMetric()).arg(fetchKey(use));
+                if (key != fetched) {
+                    powerHist->setData(Specification(use,fs), totalMetric(), distMetric(), &powerHist->standard);
+                    fetched = key;
+                }
                 powerHist->setColor(colorButton->getColor());
 
             }
@@ -1042,10 +1065,10 @@ HistogramWindow::updateChart()
             powerHist->setWithZeros(showZeroes->isChecked() ? true : false);
             powerHist->setSumY(showSumY->currentIndex()== 0 ? true : false);
 
-            // do once the controls are set
-            powerHist->setData(myRideItem, true); // intervals selected forces data to
-                                                  // be recomputed since interval selection
-                                                  // has changed.
+            // do once the controls are set, the ride is only scanned again
+            // when it was edited or the intervals selected have changed
+            powerHist->setData(myRideItem, rideStale);
+            rideStale = false;
 
         }
 
@@ -1060,6 +1083,21 @@ HistogramWindow::updateChart()
     } // if stale
 }
 
+// the rides a date range histogram is made from
+QString
+HistogramWindow::fetchKey(DateRange use)
+{
+    QString key = QString("%1 %2 %3").arg(use.from.toString(Qt::ISODate))
+                                     .arg(use.to.toString(Qt::ISODate))
+                                     .arg(context->athlete->useMetricUnits);
+
+    if (isfiltered) key += " files " + files.join(",");
+    if (context->isfiltered) key += " filters " + context->filters.join(",");
+    if (context->ishomefiltered) key += " home " + context->homeFilters.join(",");
+
+    return key;
+}
+
 void 
 HistogramWindow::clearFilter()
 {
@@ -147,6 +147,7 @@ class HistogramWindow : public GcChartWindow
 
         void refreshUpdate(QDate);
         void rideSelected();
+        void rideChanged();
         void rideAddorRemove(RideItem*);
         void intervalSelected();
         void zonesChanged();
@@ -215,6 +216,9 @@ class HistogramWindow : public GcChartWindow
         int powerRange, hrRange;
 
         bool stale;
+        bool rideStale;  // ride or zones edited, so rescan the samples
+        QString fetched; // what source or the metric histogram was made from
+        QString fetchKey(DateRange use);
         QDate cfrom, cto;
         RideFileCache *source;
         bool interval;
@@ -28,6 +28,7 @@
 #include "GcUpgrade.h" // for VERSION_CONFIG_PREFIX url to -layout.xml
 #include "LTMSettings.h" // for special case of edit LTM settings
 #include "ChartBar.h"
+#include "MainWindow.h" // for startupPhase
 #include "Utils.h"
 
 // When ESC pressed during R processing we cancel it
@@ -170,6 +171,12 @@ HomeWindow::HomeWindow(Context *context, QString name, QString /* windowtitle */
     // Allow realtime controllers to scroll train view with steering movements
     if (name == "train") connect(context, SIGNAL(steerScroll(int)), this, SLOT(steerScroll(int)));
 
+    // charts not yet shown are built one at a time when idle
+    builder = new QTimer(this);
+    builder->setSingleShot(true);
+    builder->setInterval(0);
+    connect(builder, SIGNAL(timeout()), this, SLOT(instantiateNext()));
+
     installEventFilter(this);
     qApp->installEventFilter(this);
 }
@@ -309,6 +316,8 @@ HomeWindow::selected()
     setUpdatesEnabled(true);
     update();
 
+    // once we have been painted build the rest
+    builder->start();
 }
 
 void
@@ -383,6 +392,9 @@ HomeWindow::tabSelected(int index)
 
     if (index >= 0) {
 
+        // first time shown?
+        instantiate(index);
+
         // HACK XXX Fixup contents margins that are being wiped out "somewhere" but
         //          only manifested when QT_SCALE_FACTOR > 1 and a tabbed view.
         if (currentStyle == 0) {
@@ -413,6 +425,7 @@ HomeWindow::tabSelected(int index, bool forride)
     active = true;
 
     if (index >= 0) {
+        instantiate(index);
         charts[index]->show();
         if (forride) charts[index]->setProperty("ride", property("ride"));
         else charts[index]->setProperty("dateRange", property("dateRange"));
@@ -445,6 +458,10 @@ HomeWindow::styleChanged(int id)
 {
     // ignore if out of bounds or we're already using that style
     if (id > 2 || id < 0 || id == currentStyle) return;
+
+    // all charts are shown when not tabbed
+    instantiateAll();
+
     active = true;
 
     // block updates as it is butt ugly
@@ -735,6 +752,9 @@ HomeWindow::removeChart(int num, bool confirm)
     // just in case its currently selected
     if (clicked == charts[num]) clicked=NULL;
 
+    // or never got built
+    deferred.remove(charts[num]);
+
     // remove the controls
     QWidget *m = controlStack->widget(num);
     if (m) controlStack->removeWidget(m);
@@ -1299,6 +1319,23 @@ HomeWindow::saveState()
 
     // iterate over charts
     foreach (GcChartWindow *chart, charts) {
+
+        // never built, so just as we read it
+        if (deferred.contains(chart)) {
+            const ChartDescriptor &d = deferred[chart];
+
+            out<<"\t<chart id=\""<<static_cast<int>(d.type)<<"\" "
+               <<"name=\""<<Utils::xmlprotect(d.name)<<"\" "
+               <<"title=\""<<Utils::xmlprotect(chart->property("title").toString())<<"\" >\n";
+            foreach (const ChartProperty &p, d.properties) {
+               out<<"\t\t<property name=\""<<Utils::xmlprotect(p.name)<<"\" "
+                  <<"type=\""<<p.type<<"\" "
+                  <<"value=\""<<Utils::xmlprotect(p.value)<<"\" />\n";
+            }
+            out<<"\t</chart>\n";
+            continue;
+        }
+
         GcWinID type = chart->property("type").value<GcWinID>();
 
         out<<"\t<chart id=\""<<static_cast<int>(type)<<"\" "
@@ -1339,6 +1376,9 @@ HomeWindow::saveState()
 void
 HomeWindow::restoreState(bool useDefault)
 {
+    QTime timer;
+    timer.start();
+
     // restore window state
     QString filename = context->athlete->home->config().canonicalPath() + "/" + name + "-layout.xml";
     QFileInfo finfo(filename);
@@ -1419,7 +1459,7 @@ HomeWindow::restoreState(bool useDefault)
         xmlReader.setContentHandler(&handler);
         xmlReader.setErrorHandler(&handler);
 
-        // parse and instantiate the charts
+        // parse the layout, the charts are built below
         xmlReader.parse(source);
 
         // are we english language?
@@ -1433,25 +1473,27 @@ HomeWindow::restoreState(bool useDefault)
             // translate the titles
             translateChartTitles(handler.charts);
 
-            // translate the LTM settings
-            for (int i=0; i<handler.charts.count(); i++) {
-                // find out if it's an LTMWindow via dynamic_cast
-                LTMWindow* ltmW = dynamic_cast<LTMWindow*> (handler.charts[i]);
-                if (ltmW) {
-                    // the current chart is an LTMWindow, let's translate
-
-                    // now get the LTMMetrics
-                    LTMSettings workSettings = ltmW->getSettings();
-                    // replace name and unit for translated versions
-                    workSettings.translateMetrics(context->athlete->useMetricUnits);
-                    ltmW->applySettings(workSettings);
-                }
-            }
+            // translate the LTM settings when they get built
+            for (int i=0; i<handler.charts.count(); i++) handler.charts[i].translate = true;
         }
 
-        // layout the results
+        // layout the results, when tabbed only the first tab is
+        // built now, the rest are built when shown or when idle
         styleChanged(handler.style);
-        foreach(GcChartWindow *chart, handler.charts) addChart(chart);
+        for (int i=0; i<handler.charts.count(); i++) {
+
+            if (currentStyle == 0 && i > 0) {
+
+                GcChartWindow *blank = new GcChartWindow(context);
+                blank->hide();
+                blank->setProperty("title", handler.charts[i].title);
+                deferred.insert(blank, handler.charts[i]);
+                addChart(blank);
+
+            } else {
+                addChart(newChart(handler.charts[i]));
+            }
+        }
     }
 
     // set to whatever we have selected
@@ -1466,6 +1508,146 @@ HomeWindow::restoreState(bool useDefault)
     setUpdatesEnabled(true);
     if (currentStyle == 0 && charts.count()) tabSelected(0);
 
+    startupPhase(QString("%1 layout restored, %2 charts of %3 built in %4ms").arg(name)
+                 .arg(charts.count() - deferred.count()).arg(charts.count()).arg(timer.elapsed()));
+}
+
+// build a chart from the saved layout
+GcChartWindow *
+HomeWindow::newChart(const ChartDescriptor &d)
+{
+    GcChartWindow *chart = GcWindowRegistry::newGcWindow(d.type, context);
+
+    // not one we know (or not in this build), so keep its place
+    if (chart == NULL) chart = new GcChartWindow(context);
+
+    chart->hide();
+
+    foreach(const ChartProperty &p, d.properties) {
+
+        QString type = p.type, value = p.value;
+        QByteArray name = p.name.toLatin1();
+
+        // set the chart property
+        if (type == "int") chart->setProperty(name, QVariant(value.toInt()));
+        if (type == "double") chart->setProperty(name, QVariant(value.toDouble()));
+
+        // deprecate dateRange asa chart property THAT IS DSAVED IN STATE
+        if (type == "QString" && name != "dateRange") chart->setProperty(name, QVariant(QString(value)));
+        if (type == "QDate") chart->setProperty(name, QVariant(QDate::fromString(value)));
+        if (type == "bool") chart->setProperty(name, QVariant(value.toInt() ? true : false));
+        if (type == "LTMSettings") {
+            QByteArray base64(value.toLatin1());
+            QByteArray unmarshall = QByteArray::fromBase64(base64);
+            QDataStream s(&unmarshall, QIODevice::ReadOnly);
+            LTMSettings x;
+            s >> x;
+            chart->setProperty(name, QVariant().fromValue<LTMSettings>(x));
+        }
+    }
+
+    // the title may have been translated
+    chart->setProperty("title", QVariant(d.title));
+
+    if (d.translate) {
+        // find out if it's an LTMWindow via dynamic_cast
+        LTMWindow* ltmW = dynamic_cast<LTMWindow*> (chart);
+        if (ltmW) {
+            // the current chart is an LTMWindow, let's translate
+
+            // now get the LTMMetrics
+            LTMSettings workSettings = ltmW->getSettings();
+            // replace name and unit for translated versions
+            workSettings.translateMetrics(context->athlete->useMetricUnits);
+            ltmW->applySettings(workSettings);
+        }
+    }
+    return chart;
+}
+
+// swap the blank chart for the real thing
+GcChartWindow *
+HomeWindow::instantiate(int index)
+{
+    GcChartWindow *blank = charts[index];
+    if (!deferred.contains(blank)) return blank;
+
+    GcChartWindow *newone = newChart(deferred.take(blank));
+
+    bool wasactive = active;
+    active = true;
+
+    // the controls, the blank one was made in addChart
+    QWidget *x = newone->controls();
+    QWidget *c = (x != NULL) ? x : new QWidget(this);
+    QWidget *m = controlStack->widget(index);
+    int current = controlStack->currentIndex();
+    controlStack->insertWidget(index, c);
+    controlStack->removeWidget(m);
+    controlStack->setCurrentIndex(current);
+    delete m;
+
+    // link settings button to show controls
+    connect(newone, SIGNAL(showControls()), this, SLOT(showControls()));
+    connect(newone, SIGNAL(closeWindow(GcWindow*)), this, SLOT(closeWindow(GcWindow*)));
+
+    // watch for enter events!
+    newone->installEventFilter(this);
+
+    RideItem *notconst = (RideItem*)context->currentRideItem();
+    newone->setProperty("view", name);
+    newone->setProperty("ride", QVariant::fromValue<RideItem*>(notconst));
+    newone->setProperty("dateRange", property("dateRange"));
+    newone->setProperty("style", currentStyle);
+
+    // only ever tabbed, see restoreState()
+    newone->setResizable(false);
+    current = tabbed->currentIndex();
+    tabbed->insertWidget(index, newone);
+    tabbed->removeWidget(blank);
+    tabbed->setCurrentIndex(current);
+
+    // weird bug- set margins *after* tabbed->addwidget since it resets margins (!!)
+    if (newone->showTitle())  newone->setContentsMargins(0,25*dpiYFactor,0,0);
+    else newone->setContentsMargins(0,0,0,0);
+
+    charts[index] = newone;
+    newone->hide();
+
+    // watch for moves etc
+    connect(newone, SIGNAL(resizing(GcWindow*)), this, SLOT(windowResizing(GcWindow*)));
+    connect(newone, SIGNAL(moving(GcWindow*)), this, SLOT(windowMoving(GcWindow*)));
+    connect(newone, SIGNAL(resized(GcWindow*)), this, SLOT(windowResized(GcWindow*)));
+    connect(newone, SIGNAL(moved(GcWindow*)), this, SLOT(windowMoved(GcWindow*)));
+
+    blank->close();
+    blank->deleteLater();
+
+    active = wasactive;
+    return newone;
+}
+
+void
+HomeWindow::instantiateAll()
+{
+    for (int i=0; i<charts.count(); i++) instantiate(i);
+}
+
+void
+HomeWindow::instantiateNext()
+{
+    startupPhase(QString("%1 view painted").arg(name), true);
+
+    for (int i=0; i<charts.count(); i++) {
+        if (deferred.contains(charts[i])) {
+
+            instantiate(i);
+
+            // and again when idle
+            if (deferred.count()) builder->start();
+            return;
+        }
+    }
 }
 
 //
@@ -1496,7 +1678,6 @@ bool ViewParser::startElement( const QString&, const QString&, const QString &na
     else if (name == "chart") {
 
         QString name="", title="", typeStr="";
-        GcWinID type;
 
         // get attributes
         for(int i=0; i<attrs.count(); i++) {
@@ -1505,41 +1686,27 @@ bool ViewParser::startElement( const QString&, const QString&, const QString &na
             if (attrs.qName(i) == "id")  typeStr = Utils::unprotect(attrs.value(i));
         }
 
-        // new chart
-        type = static_cast<GcWinID>(typeStr.toInt());
-        chart = GcWindowRegistry::newGcWindow(type, context);
-        chart->hide();
-        chart->setProperty("title", QVariant(title));
+        // new chart, built later by the HomeWindow
+        chart = ChartDescriptor();
+        chart.type = static_cast<GcWinID>(typeStr.toInt());
+        chart.name = name;
+        chart.title = title;
+        chart.translate = false;
 
     }
     else if (name == "property") {
 
-        QString name, type, value;
+        ChartProperty property;
 
         // get attributes
         for(int i=0; i<attrs.count(); i++) {
-            if (attrs.qName(i) == "name") name = Utils::unprotect(attrs.value(i));
-            if (attrs.qName(i) == "value") value = Utils::unprotect(attrs.value(i));
-            if (attrs.qName(i) == "type")  type = Utils::unprotect(attrs.value(i));
-        }
-
-        // set the chart property
-        if (type == "int") chart->setProperty(name.toLatin1(), QVariant(value.toInt()));
-        if (type == "double") chart->setProperty(name.toLatin1(), QVariant(value.toDouble()));
-
-        // deprecate dateRange asa chart property THAT IS DSAVED IN STATE
-        if (type == "QString" && name != "dateRange") chart->setProperty(name.toLatin1(), QVariant(QString(value)));
-        if (type == "QDate") chart->setProperty(name.toLatin1(), QVariant(QDate::fromString(value)));
-        if (type == "bool") chart->setProperty(name.toLatin1(), QVariant(value.toInt() ? true : false));
-        if (type == "LTMSettings") {
-            QByteArray base64(value.toLatin1());
-            QByteArray unmarshall = QByteArray::fromBase64(base64);
-            QDataStream s(&unmarshall, QIODevice::ReadOnly);
-            LTMSettings x;
-            s >> x;
-            chart->setProperty(name.toLatin1(), QVariant().fromValue<LTMSettings>(x));
+            if (attrs.qName(i) == "name") property.name = Utils::unprotect(attrs.value(i));
+            if (attrs.qName(i) == "value") property.value = Utils::unprotect(attrs.value(i));
+            if (attrs.qName(i) == "type")  property.type = Utils::unprotect(attrs.value(i));
         }
 
+        // keep for when the chart is built
+        chart.properties << property;
     }
     return true;
 }
@@ -1561,7 +1728,7 @@ void HomeWindow::closeWindow(GcWindow*thisone)
         removeChart(charts.indexOf(static_cast<GcChartWindow*>(thisone)));
 }
 
-void HomeWindow::translateChartTitles(QList<GcChartWindow*> charts)
+void HomeWindow::translateChartTitles(QList<ChartDescriptor> &charts)
 {
     // Map default (english) title to external (Localized) name, new default
     // charts in *layout.xml need to be added to this list to be translated
@@ -1605,9 +1772,9 @@ void HomeWindow::translateChartTitles(QList<GcChartWindow*> charts)
     titleMap.insert("Library", tr("Library"));
     titleMap.insert("CV", tr("CV"));
 
-    foreach(GcChartWindow *chart, charts) {
-        QString chartTitle = chart->property("title").toString();
-        chart->setProperty("title", titleMap.value(chartTitle, chartTitle));
+    for (int i=0; i<charts.count(); i++) {
+        QString chartTitle = charts[i].title;
+        charts[i].title = titleMap.value(chartTitle, chartTitle);
     }
 }
 
@@ -1630,6 +1797,11 @@ HomeWindow::presetSelected(int n)
 
                 // find a 'library' chart
                 for(int n=0; n<charts.count(); n++) {
+
+                    // need to build it to know
+                    if (deferred.contains(charts[n]) && deferred[charts[n]].type == GcWindowTypes::LTM)
+                        instantiate(n);
+
                     GcWinID type = charts[n]->property("type").value<GcWinID>();
                     if (type == GcWindowTypes::LTM) {
                         if (static_cast<LTMWindow*>(charts[n])->preset() == true) {
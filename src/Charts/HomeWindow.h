@@ -41,6 +41,19 @@
 class ChartBar;
 class LTMSettings;
 
+// a chart as it was read from the saved layout, charts are only
+// built from these when they are first needed (see HomeWindow::instantiate)
+struct ChartProperty {
+    QString name, type, value;
+};
+
+struct ChartDescriptor {
+    GcWinID type;
+    QString name, title;
+    QList<ChartProperty> properties; // as they were saved
+    bool translate; // default layout in a non-english locale
+};
+
 class HomeWindow : public GcWindow
 {
     Q_OBJECT
@@ -113,6 +126,9 @@ class HomeWindow : public GcWindow
         // Realtime steering control of train window scrolling
         void steerScroll(int scrollAmount);
 
+        // build the next chart not yet built, when idle
+        void instantiateNext();
+
     protected:
         Context *context;
         QString name;
@@ -146,7 +162,16 @@ class HomeWindow : public GcWindow
 
         bool loaded;
 
-        void translateChartTitles(QList<GcChartWindow*> charts);
+        // tabs in the layout that have not been built yet, they are
+        // a blank GcChartWindow in charts until they are first shown
+        // or built in the background once the view has been painted
+        QHash<GcChartWindow*, ChartDescriptor> deferred;
+        QTimer *builder;
+        GcChartWindow *newChart(const ChartDescriptor &descriptor);
+        GcChartWindow *instantiate(int index);
+        void instantiateAll();
+
+        void translateChartTitles(QList<ChartDescriptor> &charts);
 };
 
 // setup the chart
@@ -187,7 +212,7 @@ public:
     ViewParser(Context *context) : style(2), context(context) {}
 
     // the results!
-    QList<GcChartWindow*> charts;
+    QList<ChartDescriptor> charts;
     int style;
 
     // unmarshall
@@ -199,7 +224,7 @@ public:
 
 protected:
     Context *context;
-    GcChartWindow *chart;
+    ChartDescriptor chart;
 
 };
 
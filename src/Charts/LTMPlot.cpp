@@ -144,11 +144,15 @@ LTMPlot::LTMPlot(LTMWindow *parent, Context *context, int position) :
 
 LTMPlot::~LTMPlot()
 {
+    clearSweeps();
 }
 
 void
 LTMPlot::configChanged(qint32)
 {
+    // metrics, units or formulas may have changed
+    clearSweeps();
+
     // set basic plot colors
     setCanvasBackground(GColor(CTRENDPLOTBACKGROUND));
     QPen gridPen(GColor(CPLOTGRID));
@@ -2640,28 +2644,36 @@ LTMPlot::createMetricData(Context *context, LTMSettings *settings, MetricDetail
     unsigned long secondsPerGroupBy=0;
     bool wantZero = forceZero ? 1 : (metricDetail.curveStyle == QwtPlotCurve::Steps);
 
-    // curve specific filter
-    Specification spec = settings->specification;
+    // curve specific filter, the chart specification was applied by the sweep
+    FilterSet curveFilter;
     if (!SearchFilterBox::isNull(metricDetail.datafilter))
-        spec.addMatches(SearchFilterBox::matches(context, metricDetail.datafilter));
+        curveFilter.addFilter(true, SearchFilterBox::matches(context, metricDetail.datafilter));
+
+    // rides, groups and values collected once for all curves
+    LTMSweep *rows = sweep(context, settings);
+    QVector<double> values, counts;
+    if (metricDetail.type != METRIC_META) values = sweepColumn(rows, metricDetail.symbol);
+    if (metricDetail.metric) counts = sweepColumn(rows, metricDetail.metric->symbol(), true);
 
     //
     double ymean_prev=0.0;
 
-    foreach (RideItem *ride, context->athlete->rideCache->rides()) { 
+    for (int row=0; row < rows->rides.count(); row++) {
+
+        RideItem *ride = rows->rides[row];
 
         // filter out unwanted stuff
-        if (!spec.pass(ride)) continue;
+        if (!curveFilter.pass(ride->fileName)) continue;
 
         // day we are on
-        int currentDay = groupForDate(ride->dateTime.date(), settings->groupBy);
+        int currentDay = rows->groups[row];
 
         // value for day
         double value;
         if (metricDetail.type == METRIC_META)
             value = ride->getText(metricDetail.name, "0.0").toDouble();
         else
-            value = ride->getForSymbol(metricDetail.symbol);
+            value = values[row];
 
         // check values are bounded to stop QWT going berserk
         if (std::isnan(value) || std::isinf(value)) value = 0;
@@ -2688,7 +2700,7 @@ LTMPlot::createMetricData(Context *context, LTMSettings *settings, MetricDetail
         }
 
         if (value || wantZero) {
-            unsigned long seconds = metricDetail.metric ? ride->getCountForSymbol(metricDetail.metric->symbol()) : 1;
+            unsigned long seconds = metricDetail.metric ? counts[row] : 1;
             if (currentDay > lastDay) {
                 if (lastDay && wantZero) {
                     while (lastDay<currentDay && n<=maxdays) {
@@ -2802,25 +2814,39 @@ LTMPlot::createFormulaData(Context *context, LTMSettings *settings, MetricDetail
     unsigned long secondsPerGroupBy=0;
     bool wantZero = forceZero ? 1 : (metricDetail.curveStyle == QwtPlotCurve::Steps);
 
-    // curve specific filter
-    Specification spec = settings->specification;
+    // curve specific filter, the chart specification was applied by the sweep
+    FilterSet curveFilter;
     if (!SearchFilterBox::isNull(metricDetail.datafilter))
-        spec.addMatches(SearchFilterBox::matches(context, metricDetail.datafilter));
+        curveFilter.addFilter(true, SearchFilterBox::matches(context, metricDetail.datafilter));
+
+    // rides and groups collected once for all curves, the formula is
+    // evaluated once per sweep and kept alongside the metric columns
+    LTMSweep *rows = sweep(context, settings);
+    QString key = "formula:" + metricDetail.formula;
+    if (!rows->columns.contains(key)) {
+        QVector<double> &column = rows->columns[key];
+        column.reserve(rows->rides.count());
+        foreach(RideItem *ride, rows->rides) {
+            // PARSE + EVALUATE
+            Result res = parser.evaluate(ride, NULL);
+            column << (res.isNumber ? res.number : 0);
+        }
+    }
+    QVector<double> values = rows->columns.value(key);
+    QVector<double> times = sweepColumn(rows, "workout_time");
+
+    for (int row=0; row < rows->rides.count(); row++) {
 
-    foreach (RideItem *ride, context->athlete->rideCache->rides()) { 
+        RideItem *ride = rows->rides[row];
 
         // filter out unwanted stuff
-        if (!spec.pass(ride)) continue;
+        if (!curveFilter.pass(ride->fileName)) continue;
 
         // day we are on
-        int currentDay = groupForDate(ride->dateTime.date(), settings->groupBy);
+        int currentDay = rows->groups[row];
 
         // value for ride
-        double value = 0;
-
-        // PARSE + EVALUATE
-        Result res = parser.evaluate(ride, NULL);
-        if (res.isNumber) value = res.number;
+        double value = values[row];
 
         // check values are bounded to stop QWT going berserk
         if (std::isnan(value) || std::isinf(value)) value = 0;
@@ -2833,7 +2859,7 @@ LTMPlot::createFormulaData(Context *context, LTMSettings *settings, MetricDetail
             metricDetail.uunits == tr("seconds")) value /= 3600;
 
         if (value || wantZero) {
-            unsigned long seconds = ride->getForSymbol("workout_time");
+            unsigned long seconds = times[row];
             if (currentDay > lastDay) {
                 if (lastDay && wantZero) {
                     while (lastDay<currentDay && n<=maxdays) {
@@ -3737,6 +3763,93 @@ LTMPlot::groupForDate(QDate date, int groupby)
     }
 }
 
+void
+LTMPlot::clearSweeps()
+{
+    foreach(LTMSweep *s, sweeps) delete s;
+    sweeps.clear();
+}
+
+LTMSweep *
+LTMPlot::sweep(Context *context, LTMSettings *settings)
+{
+    RideCache *rideCache = context->athlete->rideCache;
+    DateRange dr = settings->specification.dateRange();
+    FilterSet fs = settings->specification.filterSet();
+
+    // already swept ?
+    foreach(LTMSweep *s, sweeps) {
+        if (s->cache == rideCache && s->version == rideCache->version() &&
+            s->groupBy == settings->groupBy &&
+            s->start == settings->start.date() && s->end == settings->end.date() &&
+            s->from == dr.from && s->to == dr.to &&
+            s->filtered == (fs.count() > 0) && s->signature == fs.signature() &&
+            s->matches == fs.matches())
+            return s;
+    }
+
+    LTMSweep *add = new LTMSweep;
+    add->cache = rideCache;
+    add->version = rideCache->version();
+    add->groupBy = settings->groupBy;
+    add->start = settings->start.date();
+    add->end = settings->end.date();
+    add->from = dr.from;
+    add->to = dr.to;
+    add->filtered = fs.count() > 0;
+    add->signature = fs.signature();
+    add->matches = fs.matches();
+
+    // the metric values and counts wanted by the curves on the chart
+    QStringList symbols, counts;
+    foreach(MetricDetail metricDetail, settings->metrics) {
+        if (metricDetail.type == METRIC_DB && metricDetail.metric) {
+            if (!symbols.contains(metricDetail.symbol)) symbols << metricDetail.symbol;
+            if (!counts.contains(metricDetail.metric->symbol())) counts << metricDetail.metric->symbol();
+        }
+    }
+    if (!symbols.contains("workout_time")) symbols << "workout_time"; // formulas aggregate by time
+
+    QVector<QVector<double> *> values, weights;
+    foreach(QString symbol, symbols) values << &add->columns[symbol];
+    foreach(QString symbol, counts) weights << &add->columns["count:" + symbol];
+
+    // one pass through the rides that pass the chart specification
+    QBitArray pass = rideCache->passing(settings->specification);
+    for (int i=0; i<rideCache->rides().count() && i<pass.size(); i++) {
+
+        if (!pass.testBit(i)) continue;
+
+        RideItem *ride = rideCache->rides()[i];
+        add->rides << ride;
+        add->groups << groupForDate(ride->dateTime.date(), settings->groupBy);
+
+        for(int k=0; k<symbols.count(); k++) *values[k] << ride->getForSymbol(symbols[k]);
+        for(int k=0; k<counts.count(); k++) *weights[k] << ride->getCountForSymbol(counts[k]);
+    }
+
+    // one per compare date range is plenty
+    if (sweeps.count() >= 8) delete sweeps.takeFirst();
+    sweeps << add;
+
+    return add;
+}
+
+const QVector<double> &
+LTMPlot::sweepColumn(LTMSweep *sweep, QString symbol, bool count)
+{
+    QString key = count ? "count:" + symbol : symbol;
+
+    // a metric that wasn't on the chart when we swept
+    if (!sweep->columns.contains(key)) {
+        QVector<double> &column = sweep->columns[key];
+        column.reserve(sweep->rides.count());
+        foreach(RideItem *ride, sweep->rides)
+            column << (count ? ride->getCountForSymbol(symbol) : ride->getForSymbol(symbol));
+    }
+    return sweep->columns[key];
+}
+
 void
 LTMPlot::pointHover(QwtPlotCurve *curve, int index)
 {
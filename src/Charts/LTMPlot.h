@@ -43,6 +43,36 @@ class LTMScaleDraw;
 class CompareScaleDraw;
 class StressCalculator;
 class LTMToolTip;
+class RideCache;
+class RideItem;
+
+// One sweep of the ride cache collecting the rides that pass the chart
+// specification along with their date group, and the values for all of
+// the metric curves on the chart as columns. Curves are built from these
+// rather than each of them walking the ride cache, re-applying the filters
+// and grouping by date. They are kept across repaints until the ride cache
+// version or the chart settings change.
+class LTMSweep
+{
+    public:
+        LTMSweep() : cache(NULL), version(0), groupBy(-1), signature(0), filtered(false) {}
+
+        // what was it built for
+        RideCache *cache; // compare may be across athletes
+        unsigned long version;
+        QDate start, end, from, to;
+        int groupBy;
+        uint signature;
+        bool filtered;
+        QSet<QString> matches;
+
+        // a row for each ride that passed
+        QVector<RideItem*> rides;
+        QVector<int> groups;
+
+        // a column for each metric symbol, formula or count
+        QHash<QString, QVector<double> > columns;
+};
 
 class LTMPlot : public QwtPlot
 {
@@ -114,6 +144,13 @@ class LTMPlot : public QwtPlot
         QVector< QVector<double>* > stackY;
 
         int groupForDate(QDate , int);
+
+        // rides and metric columns for the settings, see LTMSweep
+        LTMSweep *sweep(Context *, LTMSettings *);
+        const QVector<double> &sweepColumn(LTMSweep *, QString symbol, bool count=false);
+        void clearSweeps();
+        QList<LTMSweep*> sweeps; // one per compare range
+
         void createCurveData(Context *,LTMSettings *, MetricDetail, QVector<double>&, QVector<double>&, int&, bool=false);
 
         // create curve data from PMCData
@@ -21,6 +21,8 @@
 #include "TabView.h"
 #include "Athlete.h"
 #include "RideCache.h"
+#include "RideSnapshot.h"
+#include "RideSimilarity.h"
 #include "IntervalItem.h"
 
 #include "Zones.h"
@@ -571,6 +573,10 @@ Card::setData(RideItem *item)
             if (!routeline->isVisible()) routeline->show();
             routeline->setData(item);
         } else routeline->hide();
+
+        // and how many others are much like it
+        int like = item->context->athlete->rideCache->similarity()->countLike(item, 50);
+        rank = like ? QString(tr("%1 similar")).arg(like) : "";
     }
 
     // non-numeric META
@@ -606,53 +612,31 @@ Card::setData(RideItem *item)
         }
         points << QPointF(SPARKDAYS, v);
 
-        // set the chart values with the last 10 rides
-        int index = parent->context->athlete->rideCache->rides().indexOf(item);
-
-        int offset = 1;
-        double min = v;
-        double max = v;
-        double sum=0, count=0, avg = 0;
-        while(index-offset >=0) { // ultimately go no further back than first ever ride
-
-            // get value from items before me
-            RideItem *prior = parent->context->athlete->rideCache->rides().at(index-offset);
-
-            // are we still in range ?
-            const qint64 old = prior->dateTime.daysTo(item->dateTime);
-            if (old > SPARKDAYS) break;
-
-            // only activities with matching sport flags
-            if (prior->isRun == item->isRun && prior->isSwim == item->isSwim) {
-
-                double v;
-
-                if (type == METRIC) {
-                    v = (units == tr("seconds")) ?
-                    prior->getForSymbol(settings.symbol, parent->context->athlete->useMetricUnits)
-                    : prior->getStringForSymbol(settings.symbol, parent->context->athlete->useMetricUnits).toDouble();
-                } else {
-
-                    if (fieldtype == FIELD_DOUBLE)  v = prior->getText(settings.symbol, "").toDouble();
-                    else v = prior->getText(settings.symbol, "").toInt();
-                }
-
-                // new no zero value
-                if (v) {
-                    sum += v;
-                    count++;
-
-                    points<<QPointF(SPARKDAYS-old, v);
-                    if (v < min) min = v;
-                    if (v > max) max = v;
-                }
+        // the values for prior rides are worked out once and kept
+        // until the rides change, so clicking through rides is quick
+        RideSnapshots *snapshots = parent->context->athlete->rideCache->snapshots();
+        int how;
+        if (type == METRIC) how = (units == tr("seconds")) ? RideSnapshots::Metric : RideSnapshots::MetricDisplayed;
+        else how = (fieldtype == FIELD_DOUBLE) ? RideSnapshots::MetaDouble : RideSnapshots::MetaInteger;
+        const SparkSnapshot &prior = snapshots->sparkline(item, settings.symbol, how, SPARKDAYS);
+
+        points << prior.points;
+        double min = prior.count ? qMin(v, prior.min) : v;
+        double max = prior.count ? qMax(v, prior.max) : v;
+        double avg = prior.count ? prior.sum / prior.count : 0;
+
+        // where it ranks against its peers, the percentile is of those
+        // with a lower value, which is what we want when lower is better
+        rank = "";
+        if (type == METRIC) {
+            double percentile = snapshots->rank(item, settings.symbol);
+            const RideMetric *m = RideMetricFactory::instance().rideMetric(settings.symbol);
+            if (percentile >= 0 && m) {
+                double top = m->isLowerBetter() ? percentile : 100.0 - percentile;
+                rank = QString(tr("Top %1%")).arg(qMax(1, int(ceil(top))));
             }
-            offset++;
         }
 
-        if (count) avg = sum / count;
-        else avg = 0;
-
         // which way up should the arrow be?
         up = v > avg ? true : false;
 
@@ -1025,6 +1009,13 @@ Card::paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *) {
 
     } else painter->drawPixmap(geometry().width()-20-(ROWHEIGHT*1), 20, ROWHEIGHT*1, ROWHEIGHT*1, grayConfig.pixmap(QSize(ROWHEIGHT*1, ROWHEIGHT*1)));
 
+    // rides like this one bottom left of the route
+    if (type == ROUTE && rank != "") {
+        painter->setPen(QColor(100,100,100));
+        painter->setFont(parent->smallfont);
+        painter->drawText(QPointF(ROWHEIGHT /2.0f, geometry().height() - 20), rank);
+    }
+
     if (!sparkline && type == META && fieldtype >= 0) {
 
         // mid is slightly higher to account for space around title, move mid up
@@ -1117,6 +1108,13 @@ Card::paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *) {
             painter->setPen(QColor(50,50,50));
             painter->drawText(QPointF(right - QFontMetrics(parent->smallfont).width(mean) - 80,
                                   ((top+bottom)/2) + (fm.tightBoundingRect(mean).height()/2) - 60), mean);
+
+            // and rank top left
+            if (rank != "") {
+                painter->setPen(QColor(100,100,100));
+                painter->drawText(QPointF(sparkline->geometry().left() + 80,
+                                  top - 40 + (fm.ascent() / 2.0f)), rank);
+            }
             }
 
             // regardless we always show up/down/same
@@ -1559,9 +1557,30 @@ BubbleViz::setPoints(QList<BPointF> p)
     QVector<bool> available(oldpoints.count());
     available.fill(true);
 
-    // get all the scores
+    // same label and class is the best score there is, so pair those
+    // off first by looking them up, it's usually most of them and
+    // leaves far fewer to score against each other below
+    QHash<QString, QList<int> > same;
+    for (int oldindex=0; oldindex < oldpoints.count(); oldindex++)
+        same[QString::number(oldpoints[oldindex].fill.rgba()) + "|" + oldpoints[oldindex].label] << oldindex;
+
+    QVector<bool> matched(points.count());
+    matched.fill(false);
+    for(int newindex=0; newindex < points.count(); newindex++) {
+        QHash<QString, QList<int> >::iterator it = same.find(QString::number(points[newindex].fill.rgba()) + "|" + points[newindex].label);
+        if (it != same.end() && it.value().count()) {
+            int oldindex = it.value().takeFirst();
+            available[oldindex] = false;
+            matched[newindex] = true;
+            matches[newindex] = oldpoints[oldindex];
+        }
+    }
+
+    // get all the scores for the rest
     for(int newindex =0; newindex < points.count(); newindex++) {
+        if (matched[newindex]) continue;
         for (int oldindex =0; oldindex < oldpoints.count(); oldindex++) {
+            if (!available[oldindex]) continue;
             BubbleVizTuple add;
             add.newindex = newindex;
             add.oldindex = oldindex;
@@ -1939,73 +1958,32 @@ Routeline::setData(RideItem *item)
     owidth = width;
     oheight = height;
 
-    // step 1 normalise the points
+    // the track reduced to ROUTEPOINTS points and its extent, these
+    // are kept so we only go through the samples the first time
+    const RouteSnapshot *route = item->context->athlete->rideCache->snapshots()->route(item, ROUTEPOINTS);
+    path = QPainterPath();
+    if (route == NULL) return;
 
     // set points as ratio from topleft corner
     // and also calculate aspect ratio - to ensure
     // values are mapped to maintain the ratio (!)
-
-    //
-    // Find the top left and bottom right extents
-    // of the trace and calculate offset, factor
-    // and ratios to apply to each data point
-    //
-    double minlat=999, minlon=999;
-    double maxlat=-999, maxlon=-999;
-
-    foreach(RideFilePoint *p, item->ride()->dataPoints()) {
-
-        // ignore zero values and out of bounds
-        if (p->lat == 0 || p->lon == 0 ||
-            p->lon < -180 || p->lon > 180 ||
-            p->lat < -90 || p->lat > 90) continue;
-
-        if (p->lat > maxlat) maxlat=p->lat;
-        if (p->lat < minlat) minlat=p->lat;
-        if (p->lon < minlon) minlon=p->lon;
-        if (p->lon > maxlon) maxlon=p->lon;
-    }
-
-    // calculate aspect ratio
-    path = QPainterPath();
-    double xdiff = (maxlon - minlon);
-    double ydiff = (maxlat - minlat);
+    double minlat = route->bounds.top(), minlon = route->bounds.left();
+    double xdiff = route->bounds.width();
+    double ydiff = route->bounds.height();
     double aspectratio = ydiff/xdiff;
     width = geom.width();
 
     // create a painterpath that uses a 1x1 aspect ratio
     // based upon the GPS co-ords
-    int div = item->ride()->dataPoints().count() / ROUTEPOINTS;
-    int count=0;
     height = geom.width() * aspectratio;
-    int lines=0;
-    foreach(RideFilePoint *p, item->ride()->dataPoints()){
-
-        // ignore zero values and out of bounds
-        if (p->lat == 0 || p->lon == 0 ||
-            p->lon < -180 || p->lon > 180 ||
-            p->lat < -90 || p->lat > 90) continue;
-
-        // filter out most of the points so we end up with ROUTEPOINTS points
-        if (--count < 0) { // first
+    for (int i=0; i<route->points.count(); i++) {
 
-            //path.moveTo(xoff+(geom.width() / (xdiff / (p->lon - minlon))),
-            //            yoff+(geom.height()-(geom.height() / (ydiff / (p->lat - minlat)))));
+        const QPointF &p = route->points[i];
+        QPointF here((geom.width() / (xdiff / (p.x() - minlon))),
+                     (height-(height / (ydiff / (p.y() - minlat)))));
 
-            path.moveTo((geom.width() / (xdiff / (p->lon - minlon))),
-                        (height-(height / (ydiff / (p->lat - minlat)))));
-            count=div;
-
-        } else if (count == 0) {
-
-            //path.lineTo(xoff+(geom.width() / (xdiff / (p->lon - minlon))),
-            //            yoff+(geom.height()-(geom.height() / (ydiff / (p->lat - minlat)))));
-            path.lineTo((geom.width() / (xdiff / (p->lon - minlon))),
-                        (height-(height / (ydiff / (p->lat - minlat)))));
-            count=div;
-            lines++;
-
-        }
+        if (i == 0) path.moveTo(here);
+        else path.lineTo(here);
     }
 
     // if we have a transition
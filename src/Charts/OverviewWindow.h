@@ -167,7 +167,7 @@ class Card : public QGraphicsWidget
         // INTERVAL bubble chart
         BubbleViz *bubble;
 
-        QString upper, lower, mean;
+        QString upper, lower, mean, rank;
         bool up;
         bool showrange;
 
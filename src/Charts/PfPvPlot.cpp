@@ -26,6 +26,7 @@
 #include "Settings.h"
 #include "Zones.h"
 #include "Colors.h"
+#include "ScatterDensity.h"
 
 #include <cmath>
 #include <qwt_series_data.h>
@@ -183,6 +184,9 @@ PfPvPlot::PfPvPlot(Context *context)
     curve = new QwtPlotCurve();
     curve->attach(this);
 
+    density = new ScatterDensity(Qt::red);
+    density->attach(this);
+
     cl_ = appsettings->cvalue(context->athlete->cyclist, GC_CRANKLENGTH).toDouble() / 1000.0;
 
     // markup timeInQuadrant
@@ -519,6 +523,7 @@ PfPvPlot::setData(RideItem *_rideItem)
        }
     }
     intervalCurves.clear();
+    clearIntervalDensities();
 
     // clear the hover curve
     if (hover) {
@@ -535,6 +540,11 @@ PfPvPlot::setData(RideItem *_rideItem)
         // quickly erase old data
         mainCurvesSetVisible(false);
 
+        // very long rides have too many points to draw as
+        // symbols, so all of them are drawn as a density
+        bool dense = ScatterDensity::dense(ride->dataPoints().count());
+        QVector<double> denseCpv, denseAepf;
+
 
         // due to the discrete power and cadence values returned by the
         // power meter, there will very likely be many duplicate values.
@@ -556,6 +566,10 @@ PfPvPlot::setData(RideItem *_rideItem)
                 double cpv = (p1->cad * cl_ * 2.0 * PI) / 60.0;
 
                 if (aepf <= 2500) { // > 2500 newtons is our out of bounds
+                    if (dense) {
+                        denseCpv << cpv;
+                        denseAepf << aepf;
+                    } else
 #if Q_CC_MSVC
                     dataSet.insert(std::make_pair(aepf, cpv));
 #else
@@ -621,6 +635,7 @@ PfPvPlot::setData(RideItem *_rideItem)
             }
 
             curve->setSamples(cpvArray, aepfArray);
+            density->setSamples(denseCpv, denseAepf);
 
             QwtSymbol *sym = new QwtSymbol;
             sym->setStyle(QwtSymbol::Ellipse);
@@ -1320,6 +1335,7 @@ PfPvPlot::showCompareIntervals()
        }
     }
     intervalCurves.clear();
+    clearIntervalDensities();
 
     // quickly erase old data
     mainCurvesSetVisible(false);
@@ -1331,7 +1347,15 @@ PfPvPlot::showCompareIntervals()
 
     recalcCompare();
 
+    // too many points to draw as symbols, so
+    // draw every point as a density instead
+    int total = 0;
+    foreach(CompareInterval compare, context->compareIntervals)
+        if (compare.isChecked()) total += compare.data->dataPoints().count();
+    bool dense = ScatterDensity::dense(total);
+
     QVector<std::set<std::pair<double, double> > > dataSetInterval(num_intervals);
+    QVector<QVector<double> > denseCpv(num_intervals), denseAepf(num_intervals);
     long tot_cad = 0;
     long tot_cad_points = 0;
 
@@ -1347,7 +1371,10 @@ PfPvPlot::showCompareIntervals()
                     double aepf = (p1->watts * 60.0) / (p1->cad * cl_ * 2.0 * PI);
                     double cpv = (p1->cad * cl_ * 2.0 * PI) / 60.0;
 
-                    if (mergeIntervals())
+                    if (dense) {
+                        denseCpv[mergeIntervals() ? 0 : high] << cpv;
+                        denseAepf[mergeIntervals() ? 0 : high] << aepf;
+                    } else if (mergeIntervals())
 #if Q_CC_MSVC
                         dataSetInterval[0].insert(std::make_pair(aepf, cpv));
 #else
@@ -1402,15 +1429,23 @@ PfPvPlot::showCompareIntervals()
             order.next();
             CompareInterval interval = order.value();
 
-            QwtPlotCurve *_curve;
-            _curve = new QwtPlotCurve();
-
             QColor intervalColor;
             if (mergeIntervals())
                 intervalColor = Qt::red;
             else
                 intervalColor = interval.color;
 
+            if (dense) {
+                ScatterDensity *d = new ScatterDensity(intervalColor);
+                d->setSamples(denseCpv[order.key()], denseAepf[order.key()]);
+                d->attach(this);
+                intervalDensities << d;
+                continue;
+            }
+
+            QwtPlotCurve *_curve;
+            _curve = new QwtPlotCurve();
+
             QwtSymbol *sym = new QwtSymbol;
             sym->setStyle(QwtSymbol::Ellipse);
             sym->setSize(4*dpiXFactor);
@@ -1448,5 +1483,16 @@ PfPvPlot::mainCurvesSetVisible(bool visible) {
     }
 
     curve->setVisible(visible ? !gear_ratio_display : false);
+    density->setVisible(visible ? !gear_ratio_display : false);
+
+}
 
+void
+PfPvPlot::clearIntervalDensities()
+{
+    foreach(ScatterDensity *d, intervalDensities) {
+        d->detach();
+        delete d;
+    }
+    intervalDensities.clear();
 }
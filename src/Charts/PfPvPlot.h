@@ -33,6 +33,7 @@ class QwtPlotCurve;
 class QwtPlotMarker;
 class Context;
 class PfPvPlotZoneLabel;
+class ScatterDensity;
 
 class PfPvPlot : public QwtPlot
 {
@@ -98,6 +99,8 @@ class PfPvPlot : public QwtPlot
 
         Context *context;
         QwtPlotCurve *curve;
+        ScatterDensity *density; // instead of curve when there are too many points
+        QList <ScatterDensity *> intervalDensities; // and compared intervals
         QList <QwtPlotCurve *> gearRatioCurves;
         QwtPlotCurve *hover;
         QList <QwtPlotCurve *> intervalCurves;
@@ -122,6 +125,7 @@ class PfPvPlot : public QwtPlot
 
     private:
         void mainCurvesSetVisible(bool);
+        void clearIntervalDensities();
 };
 
 #endif // _GC_QaPlot_h
@@ -1302,9 +1302,12 @@ PowerHist::setData(RideFileCache *cache)
     source = Cache;
     this->cache = cache;
     dt = 1.0f / 60.0f; // rideFileCache is normalised to 1secs
+    LASTbase = "";
 
-    // we set with this data already?
-    if (cache == LASTcache && source == LASTsource) return;
+    // we set with this data already? (the polarised zones
+    // and units are applied as we copy, so check those too)
+    if (cache == LASTcache && source == LASTsource &&
+        withz == LASTwithz && context->athlete->useMetricUnits == LASTuseMetricUnits) return;
 
     // Now go set all those tedious arrays from
     // the ride cache
@@ -1702,6 +1705,7 @@ PowerHist::setData(Specification specification, QString totalMetric, QString dis
 {
     // what metrics are we plotting?
     source = Metric;
+    LASTbase = "";
     const RideMetricFactory &factory = RideMetricFactory::instance();
     const RideMetric *m = factory.rideMetric(distMetric);
     const RideMetric *tm = factory.rideMetric(totalMetric);
@@ -1844,9 +1848,6 @@ PowerHist::setData(RideItem *_rideItem, bool force)
     // from previous ride
     curveHover->hide();
 
-    // we set with this data already
-    if (force == false && _rideItem == LASTrideItem && source == LASTsource) return;
-
     rideItem = _rideItem;
     if (!rideItem) return;
 
@@ -1864,7 +1865,15 @@ PowerHist::setData(RideItem *_rideItem, bool force)
 
     if (ride && hasData) {
         //setTitle(ride->startTime().toString(GC_DATETIME_FORMAT));
-        setArraysFromRide(ride, standard, context->athlete->zones(rideItem->isRun), NULL);
+
+        // the base histograms hold every series at the finest
+        // resolution, so we only need to go back to the samples
+        // when the ride or what they were counted with changed
+        QString base = baseKey(ride);
+        if (force || base != LASTbase) {
+            setArraysFromRide(ride, standard, context->athlete->zones(rideItem->isRun), NULL);
+            LASTbase = base;
+        }
 
     } else {
 
@@ -1882,6 +1891,38 @@ PowerHist::setData(RideItem *_rideItem, bool force)
     //XXX updateLegend();
 }
 
+// everything setArraysFromRide uses besides the samples themselves
+QString
+PowerHist::baseKey(RideFile *ride) const
+{
+    QString key = QString("%1 %2 %3 %4 %5 %6")
+                  .arg(quintptr(ride))
+                  .arg(ride->dataPoints().count())
+                  .arg(series == RideFile::wbal)
+                  .arg(withz)
+                  .arg(context->athlete->useMetricUnits)
+                  .arg(ride->getWeight());
+
+    // zones in use
+    const Zones *zones = context->athlete->zones(rideItem->isRun);
+    int range = zones ? zones->whichRange(ride->startTime().date()) : -1;
+    if (range != -1) key += QString(" cp %1 %2 %3").arg(range).arg(zones->getCP(range)).arg(zones->getWprime(range));
+
+    const HrZones *hrZones = context->athlete->hrZones(ride->isRun());
+    range = hrZones ? hrZones->whichRange(ride->startTime().date()) : -1;
+    if (range != -1) key += QString(" lthr %1 %2").arg(range).arg(hrZones->getLT(range));
+
+    const PaceZones *paceZones = context->athlete->paceZones(ride->isSwim());
+    range = paceZones ? paceZones->whichRange(ride->startTime().date()) : -1;
+    if (range != -1) key += QString(" cv %1 %2").arg(range).arg(paceZones->getCV(range));
+
+    // and the intervals selected
+    foreach (IntervalItem *interval, rideItem->intervalsSelected())
+        key += QString(" %1-%2").arg(interval->start).arg(interval->stop);
+
+    return key;
+}
+
 void
 PowerHist::setArraysFromRide(RideFile *ride, HistData &standard, const Zones *zones, IntervalItem *hover)
 {
@@ -1960,8 +2001,14 @@ PowerHist::setArraysFromRide(RideFile *ride, HistData &standard, const Zones *zo
         standard.wbalZoneArray.resize(4);
         standard.wbalZoneSelectedArray.resize(4);
 
-        // t is time in seconds
-        for(int t=0; t< ride->wprimeData()->ydata().count(); t++) {
+        // t is time in seconds, when hovering only the
+        // interval is needed since only it gets plotted
+        int from = 0, to = ride->wprimeData()->ydata().count()-1;
+        if (hover) {
+            from = qMax(from, int(hover->start));
+            to = qMin(to, int(hover->stop));
+        }
+        for(int t=from; t<=to; t++) {
 
             // get the value
             double value = ride->wprimeData()->ydata()[t];
@@ -2010,7 +2057,15 @@ PowerHist::setArraysFromRide(RideFile *ride, HistData &standard, const Zones *zo
 
     } else {
 
-        foreach(const RideFilePoint *p1, ride->dataPoints()) {
+        // when hovering only the interval is needed since only it gets
+        // plotted, the rest of the ride is already in the standard arrays
+        const QVector<RideFilePoint*> &points = ride->dataPoints();
+        int from = hover ? ride->timeIndex(hover->start) : 0;
+
+        for(int i=from; i<points.count(); i++) {
+
+            const RideFilePoint *p1 = points[i];
+            if (hover && p1->secs > hover->stop) break;
 
             // selected if hovered -or- selected depending on
             // whether we were passed a blank or real RideFileInterval
@@ -152,7 +152,8 @@ class PowerHist : public QwtPlot
         // set data from a ride
         void setData(RideItem *_rideItem, bool force=false);
 
-        // used to set and bin ride data
+        // used to set and bin ride data, force when the ride
+        // or zones have been edited since the last time
         void setArraysFromRide(RideFile *ride, HistData &standard, const Zones *zones, IntervalItem *hover);
         void binData(HistData &standard, QVector<double>&, QVector<double>&, QVector<double>&, QVector<double>&);
 
@@ -280,6 +281,11 @@ class PowerHist : public QwtPlot
         bool LASTwithz;        // whether zeros are included in histogram
         double LASTdt;         // length of sample
         bool LASTabsolutetime; // do we sum absolute or percentage?
+
+        // what the ride histograms in standard were counted from
+        // so changing bins or zoning doesn't rescan the ride
+        QString LASTbase;
+        QString baseKey(RideFile *ride) const;
 };
 
 /*----------------------------------------------------------------------
@@ -39,7 +39,7 @@
 // for strtod
 #include <stdlib.h>
 
-// used to make a lookup string for row/col anomalies
+// row/series as text, for the anomaly and find lists
 static QString xsstring(int x, RideFile::SeriesType series)
 {
     return QString("%1:%2").arg((int)x).arg(static_cast<int>(series));
@@ -113,7 +113,8 @@ getPaste(QVector<QVector<double> >&cells, QStringList &seps, QStringList &head,
     }
 }
 
-RideEditor::RideEditor(Context *context) : GcChartWindow(context), data(NULL), ride(NULL), context(context), inLUW(false), colMapper(NULL)
+RideEditor::RideEditor(Context *context) : GcChartWindow(context), data(NULL), ride(NULL), context(context), inLUW(false),
+    dirtyFrom(-1), dirtyTo(-1), dirtyAll(false), dirtySpikes(false), colMapper(NULL)
 {
     setControls(NULL);
 
@@ -369,7 +370,7 @@ RideEditor::isAnomaly(int row, int col)
 {
     if (row < 0 || col < 0) return false;
 
-    if (data->anomalies.value(xsstring(row,model->columnType(col)), "") != "")
+    if (data->anomalies.contains(EditorData::key(row, model->columnType(col))))
         return true;
 
     return false;
@@ -380,7 +381,7 @@ RideEditor::isFound(int row, int col)
 {
     if (row < 0 || col < 0) return false;
 
-    if (data->found.value(xsstring(row,model->columnType(col)), "") != "")
+    if (data->found.contains(EditorData::key(row, model->columnType(col))))
         return true;
 
     return false;
@@ -391,14 +392,41 @@ RideEditor::isTooPrecise(int row, int column)
 {
     if (row < 0 || column < 0) return false;
 
+    return cell(row, column).precise;
+}
+
+const EditorCell &
+RideEditor::cell(int row, int column)
+{
+    static const EditorCell blank = { QString(), false };
+    if (row < 0 || column < 0 || row >= ride->ride()->dataPoints().count()) return blank;
+
     RideFile::SeriesType what = model->columnType(column);
-    int dp;
-    QString value = QString("%1").arg(getValue(row, column), 0, 'g', 10);
+    qint64 key = EditorData::key(row, what);
 
-    if ((dp = value.indexOf(".")) >= 0)
-        if (value.length()-(dp+1) > RideFile::decimalsFor(what)) return true;
+    QHash<qint64, EditorCell>::const_iterator it = data->cells.constFind(key);
+    if (it != data->cells.constEnd()) return it.value();
 
-    return false;
+    // only the cells on screen get painted, but scrolling
+    // through a long ride would end up with all of them
+    if (data->cells.count() > 10000) data->cells.clear();
+
+    EditorCell cell;
+    double value = ride->ride()->getPointValue(row, what);
+
+    if (what == RideFile::secs) {
+        int seconds, msecs;
+        secsMsecs(value, seconds, msecs);
+        cell.text = QTime(0,0,0,0).addSecs(seconds).addMSecs(msecs).toString("hh:mm:ss.zzz");
+    } else
+        cell.text = ride->ride()->getPoint(row, what).toString();
+
+    // more decimal places than we keep for this series?
+    int dp;
+    QString digits = QString("%1").arg(value, 0, 'g', 10);
+    cell.precise = (dp = digits.indexOf(".")) >= 0 && digits.length()-(dp+1) > RideFile::decimalsFor(what);
+
+    return *data->cells.insert(key, cell);
 }
 
 bool
@@ -489,149 +517,209 @@ RideEditor::xdata()
 }
 
 void
-AnomalyDialog::check()
+AnomalyDialog::limits()
 {
-    // run through all the available channels and find anomalies
-    rideEditor->data->anomalies.clear();
-
-    // clear the list
-    anomalyList->clear();
-    //QStringList header;
-    //header << "Id" << "Anomalies";
-    //anomalyList->setHorizontalHeaderLabels(header);
-    anomalyList->horizontalHeader()->hide();
-
     // use MaxHR if available for suspicious, otherwise 200
     const HrZones *hrZones = rideEditor->context->athlete->hrZones(rideEditor->ride->isRun);
     int hrZR = hrZones ? hrZones->whichRange(rideEditor->ride->dateTime.date()) : -1;
-    int maxHR = hrZR > 0 ? hrZones->getMaxHr(hrZR) : 200;
+    maxHR = hrZR > 0 ? hrZones->getMaxHr(hrZR) : 200;
 
     // Speed threshold depends on sport (9kph~20"/50m, 36kph~10"/100m)
-    double maxKPH = rideEditor->ride->isSwim ? 9.0 :
-                    rideEditor->ride->isRun ? 36.0 : 100.0;
+    maxKPH = rideEditor->ride->isSwim ? 9.0 :
+             rideEditor->ride->isRun ? 36.0 : 100.0;
 
     // Cadence threshold depends on sport
-    int maxCad = rideEditor->ride->isSwim ? 80 :
-                 rideEditor->ride->isRun ? 120 : 200;
+    maxCad = rideEditor->ride->isSwim ? 80 :
+             rideEditor->ride->isRun ? 120 : 200;
+}
 
-    QVector<double> power;
-    QVector<double> cad;
-    QVector<double> secs;
-    double lastdistance=9;
-    double lastpower=0;
-    double lastcad=0;
-    int count = 0;
+void
+AnomalyDialog::check()
+{
+    // run through all the available channels and find anomalies
+    rideEditor->data->anomalies.clear();
+    limits();
 
-    foreach (RideFilePoint *point, rideEditor->ride->ride()->dataPoints()) {
-        power.append(point->watts);
-        cad.append(point->cad);
-        secs.append(point->secs);
+    for (int row=0; row < rideEditor->ride->ride()->dataPoints().count(); row++)
+        checkRow(row);
+    checkSpikes();
 
-        if (count) {
+    refreshList();
 
-            // whilst we are here we might as well check for gaps in recording
-            // anything bigger than a second is of a material concern
-            // and we assume time always flows forward ;-)
-            double diff = secs[count] - (secs[count-1] + rideEditor->ride->ride()->recIntSecs());
-            if (diff > (double)0.0 || diff < (double)0.0 || secs[count] < secs[count-1]) {
-                rideEditor->data->anomalies.insert(xsstring(count, RideFile::secs),
-                                       tr("Invalid recording gap"));
-            }
+    // redraw - even if no anomalies were found since
+    // some may have been highlighted previously. This is
+    // an expensive operation, but then so is the check()
+    // function.
+    rideEditor->model->forceRedraw();
+}
 
-            // and on the same theme what about distance going backwards?
-            if (point->km < lastdistance)
-                rideEditor->data->anomalies.insert(xsstring(count, RideFile::km),
-                                       tr("Distance goes backwards."));
+void
+AnomalyDialog::check(int from, int to, bool spikes)
+{
+    // the anomalies on a row only depend on the point before it
+    // and the two after it, so when rows from..to are edited it
+    // is just rows from-1 .. to+2 that need checking again
+    QMap<qint64, QString> &anomalies = rideEditor->data->anomalies;
+    QMap<qint64, QString> before = anomalies;
+
+    from = qMax(0, from-1);
+    to = qMin(rideEditor->ride->ride()->dataPoints().count()-1, to+2);
 
-            // check for non-zeroed cadence/power "triplet"
-            if (count >= 3 && point->cad == 0 && point->watts == 0 &&
-                              lastcad != 0 && lastpower != 0) {
+    // power is only ever a spike, and they're done below
+    QMap<qint64, QString>::iterator it = anomalies.lowerBound(EditorData::key(from, RideFile::secs));
+    while (it != anomalies.end() && EditorData::row(it.key()) <= to) {
+        if (EditorData::series(it.key()) == RideFile::watts) ++it;
+        else it = anomalies.erase(it);
+    }
 
-                // look at previous 3
-                if (power[count-1] == power[count-2] && power[count-2] == power[count-3] &&
-                    cad[count-1] == cad[count-2] && cad[count-2] == cad[count-3]) {
+    limits();
+    for (int row=from; row <= to; row++) checkRow(row);
 
-                    rideEditor->data->anomalies.insert(xsstring(count-1, RideFile::cad),
-                                       tr("Cadence/Power duplicated when freewheeling."));
-                }
-            }
+    // spikes are ranked against the rest of the ride
+    if (spikes) {
+        it = anomalies.begin();
+        while (it != anomalies.end()) {
+            if (EditorData::series(it.key()) == RideFile::watts) it = anomalies.erase(it);
+            else ++it;
         }
+        checkSpikes();
+    }
 
-        // so we can look back one quickly
-        lastdistance = point->km;
-        lastpower = point->watts;
-        lastcad = point->cad;
+    // nothing changed, the edited cells have already been redrawn
+    if (anomalies == before) return;
 
-        // suspicious values
-        if (point->cad > maxCad) {
-            rideEditor->data->anomalies.insert(xsstring(count, RideFile::cad),
-                                   tr("Suspiciously high cadence"));
-        }
-        if (point->hr > maxHR) {
-            rideEditor->data->anomalies.insert(xsstring(count, RideFile::hr),
-                                   tr("Suspiciously high heartrate"));
-        }
-        if (point->kph > maxKPH) {
-            rideEditor->data->anomalies.insert(xsstring(count, RideFile::kph),
-                                   tr("Suspiciously high speed"));
-        }
-        if (point->lat > 90 || point->lat < -90) {
-            rideEditor->data->anomalies.insert(xsstring(count, RideFile::lat),
-                                   tr("Out of bounds value"));
-        }
-        if (point->lon > 180 || point->lon < -180) {
-            rideEditor->data->anomalies.insert(xsstring(count, RideFile::lon),
-                                   tr("Out of bounds value"));
+    refreshList();
+    rideEditor->model->forceRedraw();
+}
+
+void
+AnomalyDialog::checkRow(int row)
+{
+    RideFile *f = rideEditor->ride->ride();
+    const QVector<RideFilePoint*> &points = f->dataPoints();
+    QMap<qint64, QString> &anomalies = rideEditor->data->anomalies;
+    RideFilePoint *point = points[row];
+
+    if (row) {
+
+        RideFilePoint *last = points[row-1];
+
+        // whilst we are here we might as well check for gaps in recording
+        // anything bigger than a second is of a material concern
+        // and we assume time always flows forward ;-)
+        double diff = point->secs - (last->secs + f->recIntSecs());
+        if (diff > (double)0.0 || diff < (double)0.0 || point->secs < last->secs) {
+            anomalies.insert(EditorData::key(row, RideFile::secs),
+                                   tr("Invalid recording gap"));
         }
-        // Non-zero torque but zero cadence is not an anomaly for runs or swims
-        if (!rideEditor->ride->isRun && !rideEditor->ride->isSwim &&
-            rideEditor->ride->ride()->areDataPresent()->cad &&
-            point->nm && !point->cad) {
 
-            rideEditor->data->anomalies.insert(xsstring(count, RideFile::nm),
-                                   tr("Non-zero torque but zero cadence"));
+        // and on the same theme what about distance going backwards?
+        if (point->km < last->km)
+            anomalies.insert(EditorData::key(row, RideFile::km),
+                                   tr("Distance goes backwards."));
+    }
+
+    // suspicious values
+    if (point->cad > maxCad) {
+        anomalies.insert(EditorData::key(row, RideFile::cad),
+                               tr("Suspiciously high cadence"));
+    }
+    if (point->hr > maxHR) {
+        anomalies.insert(EditorData::key(row, RideFile::hr),
+                               tr("Suspiciously high heartrate"));
+    }
+    if (point->kph > maxKPH) {
+        anomalies.insert(EditorData::key(row, RideFile::kph),
+                               tr("Suspiciously high speed"));
+    }
+    if (point->lat > 90 || point->lat < -90) {
+        anomalies.insert(EditorData::key(row, RideFile::lat),
+                               tr("Out of bounds value"));
+    }
+    if (point->lon > 180 || point->lon < -180) {
+        anomalies.insert(EditorData::key(row, RideFile::lon),
+                               tr("Out of bounds value"));
+    }
+    // Non-zero torque but zero cadence is not an anomaly for runs or swims
+    if (!rideEditor->ride->isRun && !rideEditor->ride->isSwim &&
+        f->areDataPresent()->cad && point->nm && !point->cad) {
+
+        anomalies.insert(EditorData::key(row, RideFile::nm),
+                               tr("Non-zero torque but zero cadence"));
+    }
 
+    // check for non-zeroed cadence/power "triplet", where this row
+    // is the last of three the same and the next one is zeroed
+    if (row >= 2 && row+1 < points.count()) {
+
+        RideFilePoint *next = points[row+1];
+        if (next->cad == 0 && next->watts == 0 && point->cad != 0 && point->watts != 0 &&
+            point->watts == points[row-1]->watts && points[row-1]->watts == points[row-2]->watts &&
+            point->cad == points[row-1]->cad && points[row-1]->cad == points[row-2]->cad) {
+
+            anomalies.insert(EditorData::key(row, RideFile::cad),
+                                   tr("Cadence/Power duplicated when freewheeling."));
         }
-        count++;
     }
+}
 
+void
+AnomalyDialog::checkSpikes()
+{
     // lets look at the Power Column if its there and has enough data
     int column = rideEditor->model->headings().indexOf(tr("Power"));
-    if (column >= 0 && rideEditor->ride->ride()->dataPoints().count() >= 30) {
+    if (column < 0 || rideEditor->ride->ride()->dataPoints().count() < 30) return;
+
+    QVector<double> power;
+    QVector<double> secs;
+    foreach (RideFilePoint *point, rideEditor->ride->ride()->dataPoints()) {
+        power.append(point->watts);
+        secs.append(point->secs);
+    }
 
-        // get spike config
-        double max = appsettings->value(this, GC_DPFS_MAX, "1500").toDouble();
-        double variance = appsettings->value(this, GC_DPFS_VARIANCE, "1000").toDouble();
+    // get spike config
+    double max = appsettings->value(this, GC_DPFS_MAX, "1500").toDouble();
+    double variance = appsettings->value(this, GC_DPFS_VARIANCE, "1000").toDouble();
 
-        LTMOutliers outliers(secs.data(), power.data(), power.count(), 30, false);
+    LTMOutliers outliers(secs.data(), power.data(), power.count(), 30, false);
 
-        // run through the ranked list
-        for (int i=0; i<secs.count(); i++) {
+    // run through the ranked list
+    for (int i=0; i<secs.count(); i++) {
 
-            // is this over variance threshold?
-            if (outliers.getDeviationForRank(i) < variance) break;
+        // is this over variance threshold?
+        if (outliers.getDeviationForRank(i) < variance) break;
 
-            // ok, so its highly variant but is it over
-            // the max value we are willing to accept?
-            if (outliers.getYForRank(i) < max) continue;
+        // ok, so its highly variant but is it over
+        // the max value we are willing to accept?
+        if (outliers.getYForRank(i) < max) continue;
 
-            // which one is it
-            rideEditor->data->anomalies.insert(xsstring(outliers.getIndexForRank(i), RideFile::watts), tr("Data spike candidate"));
-        }
+        // which one is it
+        rideEditor->data->anomalies.insert(EditorData::key(outliers.getIndexForRank(i), RideFile::watts), tr("Data spike candidate"));
     }
+}
+
+void
+AnomalyDialog::refreshList()
+{
+    // clear the list
+    anomalyList->clear();
+    //QStringList header;
+    //header << "Id" << "Anomalies";
+    //anomalyList->setHorizontalHeaderLabels(header);
+    anomalyList->horizontalHeader()->hide();
 
     // now fill in the anomaly list
     anomalyList->setRowCount(0); // <<< fixes crash at ZZZZ
     anomalyList->setRowCount(rideEditor->data->anomalies.count()); // <<< ZZZZ
 
     int counter = 0;
-    QMapIterator<QString,QString> f(rideEditor->data->anomalies);
+    QMapIterator<qint64,QString> f(rideEditor->data->anomalies);
     while (f.hasNext()) {
 
         f.next();
 
         QTableWidgetItem *t = new QTableWidgetItem;
-        t->setText(f.key());
+        t->setText(xsstring(EditorData::row(f.key()), EditorData::series(f.key())));
         t->setFlags(t->flags() & (~Qt::ItemIsEditable));
         anomalyList->setItem(counter, 0, t);
 
@@ -647,12 +735,6 @@ AnomalyDialog::check()
     // enable the toolbar / disable for anomalies found
     if (counter) rideEditor->checkAct->setEnabled(true);
     else rideEditor->checkAct->setEnabled(false);
-
-    // redraw - even if no anomalies were found since
-    // some may have been highlighted previously. This is
-    // an expensive operation, but then so is the check()
-    // function.
-    rideEditor->model->forceRedraw();
 }
 
 //----------------------------------------------------------------------
@@ -1113,8 +1195,6 @@ RideEditor::clear()
 void
 RideEditor::smooth()
 {
-    QString xs = xsstring(currentCell.row, model->columnType(currentCell.column));
-
     // calculate smoothed value
     double left = 0.0;
     double right = 0.0;
@@ -1238,28 +1318,22 @@ class GTextDocument : public QTextDocument
 void CellDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
                          const QModelIndex &index) const
 {
-    // what are we editing?
+    // what are we editing? formatted once and then cached
     RideFile::SeriesType what = rideEditor->model->columnType(index.column());
-    QString value;
-
-    if (what == RideFile::secs) {
-        int seconds, msecs;
-        secsMsecs(index.model()->data(index, Qt::DisplayRole).toDouble(), seconds, msecs);
-        value = QTime(0,0,0,0).addSecs(seconds).addMSecs(msecs).toString("hh:mm:ss.zzz");
-    } else
-        value = index.model()->data(index, Qt::DisplayRole).toString();
+    EditorCell cell = rideEditor->cell(index.row(), index.column());
+    QString value = cell.text;
 
     // best place to update the tooltip is here, rather than whenever we update the editor
     // data, since this is just before it is used...
-    rideEditor->model->setToolTip(index.row(), rideEditor->model->columnType(index.column()),
-        rideEditor->data->anomalies.value(xsstring(index.row(), rideEditor->model->columnType(index.column())),""));
+    QString anomaly = rideEditor->data->anomalies.value(EditorData::key(index.row(), what), "");
+    rideEditor->model->setToolTip(index.row(), what, anomaly);
 
     // found items in yellow
     if (rideEditor->isFound(index.row(), index.column()) == true) {
          painter->fillRect(option.rect, QBrush(QColor(255,255,0)));
     }
 
-    if (rideEditor->isAnomaly(index.row(), index.column())) {
+    if (anomaly != "") {
 
         // wavy line is a pain!
         GTextDocument *meh = new GTextDocument(QString(value));
@@ -1293,7 +1367,7 @@ void CellDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
     }
 
     // warning triangle - for high precision numbers
-    if (rideEditor->isTooPrecise(index.row(), index.column())) {
+    if (cell.precise) {
         QPolygon triangle(3);
         triangle.putPoints(0, 3, option.rect.x(), option.rect.y(),
                                 option.rect.x()+4, option.rect.y(),
@@ -1501,7 +1575,10 @@ RideEditor::rideSelected()
     } else {
         data = ride->ride()->editorData();
         data->found.clear(); // search is not active, so clear
+        data->cells.clear(); // may have been edited elsewhere
     }
+    dirtyFrom = dirtyTo = -1;
+    dirtyAll = dirtySpikes = false;
     model->setRide(ride->ride());
 
     // Set for XDATA, including all views
@@ -1731,6 +1808,12 @@ RideEditor::endCommand(bool undo, RideCommand *cmd)
         {
             SetPointValueCommand *spv = (SetPointValueCommand*)cmd;
 
+            // just this cell to format and check again
+            data->cells.remove(EditorData::key(spv->row, spv->series));
+            if (dirtyFrom < 0 || spv->row < dirtyFrom) dirtyFrom = spv->row;
+            if (spv->row > dirtyTo) dirtyTo = spv->row;
+            if (spv->series == RideFile::watts || spv->series == RideFile::secs) dirtySpikes = true;
+
             // move cursor to point updated
             QModelIndex cursor = model->index(spv->row, model->columnFor(spv->series));
             // NOTE: This is to circumvent a performance issue with multiple calls to setCurrentIndex 
@@ -1899,9 +1982,27 @@ RideEditor::endCommand(bool undo, RideCommand *cmd)
             break;
     }
 
+    // rows or columns moved, so everything needs checking
+    switch (cmd->type) {
+        case RideCommand::InsertPoint:
+        case RideCommand::DeletePoint:
+        case RideCommand::DeletePoints:
+        case RideCommand::AppendPoints:
+        case RideCommand::SetDataPresent:
+            data->cells.clear();
+            dirtyAll = true;
+            break;
+        default:
+            break;
+    }
+
     // check for anomalies
     if (!inLUW) {
-        anomalyTool->check();
+        if (dirtyAll) anomalyTool->check();
+        else if (dirtyFrom >= 0) anomalyTool->check(dirtyFrom, dirtyTo, dirtySpikes);
+        dirtyFrom = dirtyTo = -1;
+        dirtyAll = dirtySpikes = false;
+
         xdataTool->setRideItem(ride);// rebuild tables
 
         // let everyone know we changed some data
@@ -1929,149 +2030,68 @@ RideEditor::rideDirty()
 void
 EditorData::deleteRows(int row, int count)
 {
+    anomalies = deleteRows(anomalies, row, count);
+    found = deleteRows(found, row, count);
+    cells.clear();
+}
 
-    // anomalies
-    if (anomalies.count()) {
-        QMutableMapIterator <QString, QString> a(anomalies);
-        QMap<QString,QString> newa; // updated QMap
-        while (a.hasNext()) {
-            a.next();
-
-            int crow;
-            RideFile::SeriesType series;
-            unxsstring(a.key(), crow, series);
-
-            if (crow >= row && crow <= (row+count-1)) {
-                // do nothing - i.e. don't copy across - it is zapped
-                ;
-            } else if (crow > (row+count-1)) {
-                crow -= count;
-                newa.insert(xsstring(crow,series), a.value());
-            } else {
-                newa.insert(a.key(), a.value());
-            }
-        }
-        anomalies = newa; // replace with resynced values
-    }
-
-    // found
-    if (found.count()) {
-        QMutableMapIterator <QString, QString> r(found);
-        QMap<QString,QString> newr; // updated QMap
-        while (r.hasNext()) {
-            r.next();
+QMap<qint64, QString>
+EditorData::deleteRows(const QMap<qint64, QString> &map, int row, int count)
+{
+    // rows are the high bits of the key so the map is in row
+    // order; keep those before, drop those deleted and move up
+    // the ones after
+    QMap<qint64, QString> updated;
+    QMapIterator<qint64, QString> it(map);
+    while (it.hasNext()) {
+        it.next();
 
-            int crow;
-            RideFile::SeriesType series;
-            unxsstring(r.key(), crow, series);
-
-            if (crow >= row && crow <= (row+count-1)) {
-                // do nothing - i.e. don't copy across
-                ;
-            } else if (crow > (row+count-1)) {
-                crow -= count;
-                newr.insert(xsstring(crow,series), r.value());
-            } else {
-                newr.insert(r.key(), r.value());
-            }
-        }
-        found = newr; // replace with resynced values
+        int crow = EditorData::row(it.key());
+        if (crow < row) updated.insert(it.key(), it.value());
+        else if (crow > (row+count-1)) updated.insert(key(crow-count, series(it.key())), it.value());
     }
+    return updated;
 }
 
 void
 EditorData::deleteSeries(RideFile::SeriesType series)
 {
-
-    // anomalies
-    if (anomalies.count()) {
-        QMutableMapIterator <QString, QString> a(anomalies);
-        QMap<QString,QString> newa; // updated QMap
-        while (a.hasNext()) {
-            a.next();
-
-            int crow;
-            RideFile::SeriesType cseries;
-            unxsstring(a.key(), crow, cseries);
-
-            if (cseries == series) {
-                // do nothing - i.e. don't copy across - it is zapped
-                ;
-            } else {
-                newa.insert(a.key(), a.value());
-            }
-        }
-        anomalies = newa; // replace with resynced values
+    QMap<qint64, QString>::iterator it = anomalies.begin();
+    while (it != anomalies.end()) {
+        if (EditorData::series(it.key()) == series) it = anomalies.erase(it);
+        else ++it;
     }
 
-    // found
-    if (found.count()) {
-        QMutableMapIterator <QString, QString> r(found);
-        QMap<QString,QString> newr; // updated QMap
-        while (r.hasNext()) {
-            r.next();
-
-            int crow;
-            RideFile::SeriesType cseries;
-            unxsstring(r.key(), crow, cseries);
-
-            if (cseries == series) {
-                // do nothing - i.e. don't copy across
-                ;
-            } else {
-                newr.insert(r.key(), r.value());
-            }
-        }
-        found = newr; // replace with resynced values
+    it = found.begin();
+    while (it != found.end()) {
+        if (EditorData::series(it.key()) == series) it = found.erase(it);
+        else ++it;
     }
+
+    cells.clear();
 }
 
 void
 EditorData::insertRows(int row, int count)
 {
+    anomalies = insertRows(anomalies, row, count);
+    found = insertRows(found, row, count);
+    cells.clear();
+}
 
-    // anomalies
-    if (anomalies.count()) {
-        QMutableMapIterator <QString, QString> a(anomalies);
-        QMap<QString,QString> newa; // updated QMap
-        while (a.hasNext()) {
-            a.next();
-
-            int crow;
-            RideFile::SeriesType series;
-            unxsstring(a.key(), crow, series);
-
-            if (crow > row) {
-                crow += count;
-                newa.insert(xsstring(crow,series), a.value());
-            } else {
-                newa.insert(a.key(), a.value());
-            }
-        }
-        anomalies = newa; // replace with resynced values
-    }
-
-    // found
-    if (found.count()) {
-        QMutableMapIterator <QString, QString> r(found);
-        QMap<QString,QString> newr; // updated QMap
-
-        while (r.hasNext()) {
-            r.next();
-
-            int crow;
-            RideFile::SeriesType series;
-            unxsstring(r.key(), crow, series);
+QMap<qint64, QString>
+EditorData::insertRows(const QMap<qint64, QString> &map, int row, int count)
+{
+    QMap<qint64, QString> updated;
+    QMapIterator<qint64, QString> it(map);
+    while (it.hasNext()) {
+        it.next();
 
-            if (crow > row) {
-                crow += count;
-                newr.insert(xsstring(crow,series), r.value());
-            } else {
-                newr.insert(r.key(), r.value());
-            }
-        }
-        found = newr; // replace with resynced values
+        int crow = EditorData::row(it.key());
+        if (crow > row) updated.insert(key(crow+count, series(it.key())), it.value());
+        else updated.insert(it.key(), it.value());
     }
+    return updated;
 }
 
 //----------------------------------------------------------------------
@@ -2303,64 +2323,73 @@ FindDialog::find()
     rideEditor->data->found.clear();
     clearResultsTable();
 
-    for (int i=0; i< rideEditor->ride->ride()->dataPoints().count(); i++) {
-        // for each selected channel, get the value and
-        // see if it matches
+    const QVector<RideFilePoint*> &points = rideEditor->ride->ride()->dataPoints();
+    int n = points.count();
+    QVector<double> values(n);
+    QVector<char> hits(n);
 
-        foreach (QCheckBox *c, channels) {
+    // a channel at a time, copied out of the points so the
+    // comparison runs over a plain array of doubles
+    foreach (QCheckBox *c, channels) {
 
-            if (c->isChecked()) {
+        if (!c->isChecked()) continue;
 
-                // which Column?
-                int col = rideEditor->model->headings().indexOf(c->text());
-                if (col >= 0) {
+        // which Column?
+        int col = rideEditor->model->headings().indexOf(c->text());
+        if (col < 0) continue;
 
-                    double value = rideEditor->getValue(i, col);
+        RideFile::SeriesType series = rideEditor->model->columnType(col);
+        for (int i=0; i<n; i++) values[i] = points[i]->value(series);
 
-                    bool match = false;
-                    switch(type->currentIndex()) {
+        findMatches(values.constData(), hits.data(), n, type->currentIndex(), from->value(), to->value());
 
-                    case 0 : // between
-                        if ((value >= from->value() && value <= to->value()) ||
-                            (value <= from->value() && value >= to->value())) match = true;
-                        break;
-
-                    case 1 : // not between
-                        if (!(value >= from->value() && value <= to->value())) match = true;
-                        break;
+        // highlight on the table
+        for (int i=0; i<n; i++)
+            if (hits[i]) rideEditor->data->found.insert(EditorData::key(i, series), QString("%1").arg(values[i]));
+    }
 
-                    case 2 : // greater than
-                        if (value > from->value()) match = true;
-                        break;
+    dataChanged(); // update results table and redraw
 
-                    case 3 : // less than
-                        if (value < from->value()) match = true;
-                        break;
+    rideEditor->model->forceRedraw();
+}
 
-                    case 4 : // matches
-                        if (value == from->value()) match = true;
-                        break;
+void
+FindDialog::findMatches(const double *values, char *hit, int n, int type, double from, double to)
+{
+    // no branches in the loops, so they vectorise
+    switch(type) {
 
-                    case 5 : // not equal
-                        if (value != from->value()) match = true;
-                        break;
+    case 0 : // between, either way round
+    {
+        double low = qMin(from, to), high = qMax(from, to);
+        for (int i=0; i<n; i++) hit[i] = (values[i] >= low) & (values[i] <= high);
+        break;
+    }
 
-                    }
+    case 1 : // not between
+        for (int i=0; i<n; i++) hit[i] = !((values[i] >= from) & (values[i] <= to));
+        break;
 
-                    if (match == true) {
+    case 2 : // greater than
+        for (int i=0; i<n; i++) hit[i] = values[i] > from;
+        break;
 
-                        // highlight on the table
-                        rideEditor->data->found.insert(xsstring(i,rideEditor->model->columnType(col)), QString("%1").arg(value));
+    case 3 : // less than
+        for (int i=0; i<n; i++) hit[i] = values[i] < from;
+        break;
 
-                    }
-                }
-            }
-        }
-    }
+    case 4 : // matches
+        for (int i=0; i<n; i++) hit[i] = values[i] == from;
+        break;
 
-    dataChanged(); // update results table and redraw
+    case 5 : // not equal
+        for (int i=0; i<n; i++) hit[i] = values[i] != from;
+        break;
 
-    rideEditor->model->forceRedraw();
+    default :
+        for (int i=0; i<n; i++) hit[i] = 0;
+        break;
+    }
 }
 
 void
@@ -2382,7 +2411,7 @@ FindDialog::dataChanged()
     resultsTable->setRowCount(rideEditor->data->found.count()); // <<< ZZZZ
     resultsTable->setColumnCount(4);
     resultsTable->setColumnHidden(3, true); // has start xystring
-    QMapIterator<QString,QString> f(rideEditor->data->found);
+    QMapIterator<qint64,QString> f(rideEditor->data->found);
 
     resultsTable->setSortingEnabled(false);// see QT Bug QTBUG-7483
 
@@ -2391,9 +2420,8 @@ FindDialog::dataChanged()
 
         f.next();
 
-        int row;
-        RideFile::SeriesType series;
-        unxsstring(f.key(), row, series);
+        int row = EditorData::row(f.key());
+        RideFile::SeriesType series = EditorData::series(f.key());
 
         // time -- format correctly... held as a double in the model
         int seconds, msecs;
@@ -2419,7 +2447,7 @@ FindDialog::dataChanged()
 
         // xs for selection
         t = new QTableWidgetItem;
-        t->setText(f.key());
+        t->setText(xsstring(row, series));
         t->setFlags(t->flags() & (~Qt::ItemIsEditable));
         resultsTable->setItem(counter, 3, t);
 
@@ -39,8 +39,10 @@
 #include <QToolBar>
 #include <QItemDelegate>
 #include <QStackedWidget>
+#include <QHash>
 
 class EditorData;
+struct EditorCell;
 class CellDelegate;
 class XDataCellDelegate;
 class RideModel;
@@ -83,6 +85,9 @@ class RideEditor : public GcChartWindow
         bool isRowSelected();
         bool isColumnSelected();
 
+        // formatted for painting, cached
+        const EditorCell &cell(int row, int column);
+
     signals:
         void insertRows();
         void insertColumns();
@@ -157,6 +162,11 @@ class RideEditor : public GcChartWindow
         bool inLUW;
         QList<QModelIndex> itemselection;
 
+        // rows changed by the commands since the last anomaly
+        // check, or all of them when rows or columns changed
+        int dirtyFrom, dirtyTo;
+        bool dirtyAll, dirtySpikes;
+
         QList<QString> whatColumns();
         QSignalMapper *colMapper;
 
@@ -172,17 +182,37 @@ class RideEditor : public GcChartWindow
         struct { int row, column; } currentCell;
 };
 
+// a cell as it is painted
+struct EditorCell
+{
+    QString text;
+    bool precise; // more decimals than the series is held to
+};
+
 class EditorData
 {
     public:
-        QMap<QString, QString> anomalies;
-        QMap<QString, QString> found;
+        // keyed by row and series, see key(), so in row order
+        QMap<qint64, QString> anomalies;
+        QMap<qint64, QString> found;
+
+        // cells formatted when painted, so only the visible ones,
+        // cells are removed when edited and all when rows move
+        QHash<qint64, EditorCell> cells;
+
+        static qint64 key(int row, RideFile::SeriesType series) { return (qint64(row) << 8) | series; }
+        static int row(qint64 key) { return key >> 8; }
+        static RideFile::SeriesType series(qint64 key) { return static_cast<RideFile::SeriesType>(key & 0xff); }
 
         // when underlying data is modified
         // these are called to adjust references
         void deleteRows(int row, int count);
         void insertRows(int row, int count);
         void deleteSeries(RideFile::SeriesType);
+
+    private:
+        static QMap<qint64, QString> deleteRows(const QMap<qint64, QString> &, int row, int count);
+        static QMap<qint64, QString> insertRows(const QMap<qint64, QString> &, int row, int count);
 };
 
 class RideModel : public QStandardItemModel
@@ -272,12 +302,25 @@ class AnomalyDialog : public QWidget
         void closeEvent(QCloseEvent*event);
         QTableWidget *anomalyList;
 
+        // just the rows either side of those edited, the
+        // power spikes are ranked over the whole ride
+        void check(int from, int to, bool spikes);
+
     public slots:
         void reject();
         void check();
 
     private:
         RideEditor *rideEditor;
+
+        // thresholds for the ride being checked
+        int maxHR, maxCad;
+        double maxKPH;
+        void limits();
+
+        void checkRow(int row);
+        void checkSpikes();
+        void refreshList();
 };
 
 //
@@ -326,6 +369,10 @@ class FindDialog : public QWidget
         QTableWidget *resultsTable;
 
         void clearResultsTable();
+
+        // sets hit[i] for the values that match, a loop per comparison
+        // so the compiler can vectorise it
+        static void findMatches(const double *values, char *hit, int n, int type, double from, double to);
 };
 
 //
@@ -45,10 +45,11 @@
 #include "TabView.h"
 #include "GcOverlayWidget.h"
 #include "IntervalSummaryWindow.h"
+#include "RideTrack.h"
 #include <QDebug>
 
 RideMapWindow::RideMapWindow(Context *context, int mapType) : GcChartWindow(context), context(context),
-                                                       range(-1), current(NULL), firstShow(true), stale(false)
+                                                       range(-1), current(NULL), track(NULL), fitzoom(-1), mapzoom(-1), firstShow(true), stale(false)
 {
     //
     // Chart settings
@@ -181,6 +182,7 @@ RideMapWindow::RideMapWindow(Context *context, int mapType) : GcChartWindow(cont
 RideMapWindow::~RideMapWindow()
 {
     delete webBridge;
+    if (track) delete track;
 }
 
 void
@@ -293,6 +295,18 @@ RideMapWindow::configChanged(qint32)
 #endif
 }
 
+// the track for the ride on the map, built again if the ride
+// has been edited since, or closed and read back differently
+RideTrack *
+RideMapWindow::rideTrack()
+{
+    if (track && current && track->stale()) {
+        delete track;
+        track = new RideTrack(context, current);
+    }
+    return track;
+}
+
 void
 RideMapWindow::forceReplot()
 {
@@ -332,6 +346,10 @@ RideMapWindow::rideSelected()
         if (range >= 0) rideCP = context->athlete->zones(ride->isRun)->getCP(range);
     }
 
+    // the route is drawn from the simplified track, usually from the cache
+    if (track) delete track;
+    track = new RideTrack(context, ride);
+
     loadRide();
     smallPlot->setData(ride);
 }
@@ -391,6 +409,10 @@ void RideMapWindow::createHtml()
         setIsBlank(false);
     }
 
+    // the route is drawn for this zoom until the map tells us otherwise
+    fitzoom = RideTrack::zoomFor(minLat, minLon, maxLat, maxLon, view->width(), view->height());
+    mapzoom = -1;
+
     // load the Map API
     currentPage = QString("<!DOCTYPE html> \n"
     "<html>\n"
@@ -440,6 +462,7 @@ void RideMapWindow::createHtml()
     "var markerList;\n"  // array of markers
     "var polyList;\n"  // array of polylines
     "var tmpIntervalHighlighter;\n"  // temp interval
+    "var routeYellow;\n"  // the route, redrawn as the zoom changes
 
     // Draw the entire route, we use a local webbridge
     // to supply the data to a) reduce bandwidth and
@@ -448,10 +471,10 @@ void RideMapWindow::createHtml()
     "function drawRoute() {\n"
 #ifdef NOWEBKIT
     // load the GPS co-ordinates
-    "   webBridge.getLatLons(0, drawRouteForLatLons);\n"
+    "   webBridge.getLatLons(0, map.getZoom() || -1, drawRouteForLatLons);\n"
 #else
     // load the GPS co-ordinates
-    "    var latlons = webBridge.getLatLons(0);\n" // interval "0" is the entire route
+    "    var latlons = webBridge.getLatLons(0, map.getZoom() || -1);\n" // interval "0" is the entire route
     "   drawRouteForLatLons(latlons);\n"
 #endif
     "}\n"
@@ -472,8 +495,9 @@ void RideMapWindow::createHtml()
             "        zIndex: -2\n"
             "    };\n"
 
-            // create the route Polyline
-            "    var routeYellow = new google.maps.Polyline(routeOptionsYellow);\n"
+            // create the route Polyline, replacing any drawn at another zoom
+            "    if (routeYellow) routeYellow.setMap(null);\n"
+            "    routeYellow = new google.maps.Polyline(routeOptionsYellow);\n"
             "    routeYellow.setMap(map);\n"
 
             // lastly, populate the route path
@@ -513,9 +537,9 @@ void RideMapWindow::createHtml()
 
     "   while (intervals > 0) {\n"
 #ifdef NOWEBKIT
-    "       webBridge.getLatLons(intervals, drawInterval);\n"
+    "       webBridge.getLatLons(intervals, map.getZoom() || -1, drawInterval);\n"
 #else
-    "       drawInterval(webBridge.getLatLons(intervals));\n"
+    "       drawInterval(webBridge.getLatLons(intervals, map.getZoom() || -1));\n"
 #endif
     "       intervals--;\n"
     "   }\n"
@@ -658,6 +682,9 @@ void RideMapWindow::createHtml()
             // catch signals to redraw intervals
             "    webBridge.drawIntervals.connect(drawIntervals);\n"
 
+            // only the detail needed for the zoom is drawn, so redraw as it changes
+            "    google.maps.event.addListener(map, 'zoom_changed', function() { drawRoute(); drawIntervals(); });\n"
+
             // we're done now let the C++ side draw its overlays
             "    webBridge.drawOverlays();\n"
 
@@ -697,7 +724,14 @@ RideMapWindow::drawShadedRoute()
 
     QString code;
 
-    foreach(RideFilePoint *rfp, myRideItem->ride()->dataPoints()) {
+    // the shaded route is drawn once, for all zoom levels, so we keep
+    // everything that shows at the closest zoom but not the points
+    // along straight lines or whilst stopped
+    const int closest = 18;
+    rideTrack(); // in case the ride has changed since
+
+    for (int i=0; i<myRideItem->ride()->dataPoints().count(); i++) {
+        RideFilePoint *rfp = myRideItem->ride()->dataPoints()[i];
         if (mapCombo->currentIndex() == GOOGLE || mapCombo->currentIndex() == OSM) {
             if (count == 0) {
                 code = QString("{\nvar polyline = new google.maps.Polyline();\n"
@@ -709,7 +743,7 @@ RideMapWindow::drawShadedRoute()
                                 "google.maps.event.addListener(polyline, 'mouseup',   function(event) { map.setOptions({draggable: true, zoomControl: true, scrollwheel: true, disableDoubleClickZoom: false}); webBridge.mouseup(); });\n"
                                 "google.maps.event.addListener(polyline, 'mouseover', function(event) { webBridge.hoverPath(event.latLng.lat(), event.latLng.lng()); });\n");
             } else {
-                if (rfp->lat || rfp->lon)
+                if ((rfp->lat || rfp->lon) && (!track || track->significant(i, closest)))
                     code += QString("path.push(new google.maps.LatLng(%1,%2));\n").arg(rfp->lat,0,'g',GPS_COORD_TO_STRING).arg(rfp->lon,0,'g',GPS_COORD_TO_STRING);
             }
         }
@@ -788,11 +822,18 @@ RideMapWindow::drawTempInterval(IntervalItem *current) {
                     "    var path = tmpIntervalHighlighter.getPath();\n"
                     "    path.clear();\n");
 
-    foreach(RideFilePoint *rfp, myRideItem->ride()->dataPoints()) {
+    // only the points that show at this zoom, and the ends
+    // so it's still there when there are none of those
+    rideTrack(); // in case the ride has changed since
+    int first = -1, last = -1;
+    if (track) track->ends(current->start, current->stop, first, last);
+
+    for (int i=0; i<myRideItem->ride()->dataPoints().count(); i++) {
+        RideFilePoint *rfp = myRideItem->ride()->dataPoints()[i];
         if (rfp->secs+myRideItem->ride()->recIntSecs() > current->start
             && rfp->secs< current->stop) {
 
-            if (rfp->lat || rfp->lon) {
+            if ((rfp->lat || rfp->lon) && (!track || i == first || i == last || track->significant(i, zoom()))) {
                 code += QString("    path.push(new google.maps.LatLng(%1,%2));\n").arg(rfp->lat,0,'g',GPS_COORD_TO_STRING).arg(rfp->lon,0,'g',GPS_COORD_TO_STRING);
             }
         }
@@ -1055,39 +1096,31 @@ MapWebBridge::intervalCount()
 }
 
 // get a latlon array for the i'th selected interval
+// with just the detail needed at the map zoom level
 QVariantList
-MapWebBridge::getLatLons(int i)
+MapWebBridge::getLatLons(int i, int zoom)
 {
     QVariantList latlons;
     RideItem *rideItem = mw->property("ride").value<RideItem*>();
+    RideTrack *track = mw->rideTrack();
 
-    if (rideItem && i > 0 && rideItem->intervalsSelected().count() >= i) {
+    // map not ready yet so we don't know
+    if (zoom >= 0) mw->setZoom(zoom);
+    zoom = mw->zoom();
 
-        IntervalItem *current = rideItem->intervalsSelected().at(i-1);
+    if (!rideItem || !track) return latlons;
+
+    if (i > 0 && rideItem->intervalsSelected().count() >= i) {
 
         // so this one is the interval we need.. lets
         // snaffle up the points in this section
-        foreach (RideFilePoint *p1, rideItem->ride()->dataPoints()) {
-            if (p1->secs+rideItem->ride()->recIntSecs() > current->start
-                && p1->secs< current->stop) {
-
-                if (p1->lat || p1->lon) {
-                    latlons << p1->lat;
-                    latlons << p1->lon;
-                }
-            }
-        }
-        return latlons;
+        IntervalItem *current = rideItem->intervalsSelected().at(i-1);
+        latlons = track->latlons(zoom, current->start, current->stop);
 
-    } else if (rideItem) {
+    } else {
 
         // get latlons for entire route
-        foreach (RideFilePoint *p1, rideItem->ride()->dataPoints()) {
-            if (p1->lat || p1->lon) {
-                latlons << p1->lat;
-                latlons << p1->lon;
-            }
-        }
+        latlons = track->latlons(zoom);
     }
     return latlons;
 }
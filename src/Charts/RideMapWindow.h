@@ -54,6 +54,7 @@ class QTabWidget;
 class RideMapWindow;
 class IntervalSummaryWindow;
 class SmallPlot;
+class RideTrack;
 
 // trick the maps api into ignoring gestures by
 // pretending to be chrome. see: http://developer.qt.nokia.com/forums/viewthread/1643/P15
@@ -93,7 +94,7 @@ class MapWebBridge : public QObject
 
         // drawing basic route, and interval polylines
         Q_INVOKABLE int intervalCount();
-        Q_INVOKABLE QVariantList getLatLons(int i); // get array of latitudes for highlighted n
+        Q_INVOKABLE QVariantList getLatLons(int i, int zoom); // get array of latitudes for highlighted n at map zoom
 
         // once map and basic route is loaded
         // this slot is called to draw additional
@@ -164,6 +165,12 @@ class RideMapWindow : public GcChartWindow
         QString getStyleOptions() const { return styleoptions; }
         void setStyleOptions(QString x) { styleoptions=x; }
 
+        // simplified gps track for the current ride, and the map zoom
+        // which is the fitted zoom until the map tells us otherwise
+        RideTrack *rideTrack();
+        int zoom() const { return mapzoom >= 0 ? mapzoom : fitzoom; }
+        void setZoom(int x) { mapzoom = x; }
+
     public slots:
         void mapTypeSelected(int x);
         void tileTypeSelected(int x);
@@ -209,6 +216,8 @@ class RideMapWindow : public GcChartWindow
         int rideCP; // rider's CP
         QString currentPage;
         RideItem *current;
+        RideTrack *track;
+        int fitzoom, mapzoom;
         bool firstShow;
         IntervalSummaryWindow *overlayIntervals;
 
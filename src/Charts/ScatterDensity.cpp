@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2020 GoldenCheetah contributors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "ScatterDensity.h"
+#include "Colors.h" // for dpiXFactor
+
+#include <QPainter>
+#include <QThread>
+#if QT_VERSION > 0x050000
+#include <QtConcurrent>
+#else
+#include <QtConcurrentRun>
+#endif
+#include <cmath>
+
+// how many rasters to keep, one per zoom level
+static const int MAXGRIDS = 8;
+
+// a slice of the points counted on its own thread
+struct DensityChunk {
+    const double *x, *y, *z;    // z is NULL when just counting
+    int from, to;
+    QwtScaleMap xMap, yMap;
+    double left, top;
+    int cell, cols, rows;
+
+    QVector<int> counts;        // per cell, row by row
+    QVector<double> sums;       // of z per cell
+};
+
+static void
+binChunk(DensityChunk &c)
+{
+    c.counts.fill(0, c.cols * c.rows);
+    if (c.z) c.sums.fill(0, c.cols * c.rows);
+
+    for (int i=c.from; i<c.to; i++) {
+
+        double px = c.xMap.transform(c.x[i]) - c.left;
+        double py = c.yMap.transform(c.y[i]) - c.top;
+        // off the plot, or nan, before converting to int
+        if (!(px >= 0 && px < c.cols * c.cell) || !(py >= 0 && py < c.rows * c.cell)) continue;
+
+        int col = qMin(int(px) / c.cell, c.cols - 1);
+        int row = qMin(int(py) / c.cell, c.rows - 1);
+
+        int index = (row * c.cols) + col;
+        c.counts[index]++;
+        if (c.z) c.sums[index] += c.z[i];
+    }
+}
+
+ScatterDensity::ScatterDensity(QColor color) : zmin(0), zmax(0), color(color)
+{
+    setItemAttribute(QwtPlotItem::AutoScale, true);
+    setRenderHint(QwtPlotItem::RenderAntialiased, false);
+}
+
+void
+ScatterDensity::setSamples(const QVector<double> &x, const QVector<double> &y)
+{
+    setSamples(x, y, QVector<double>());
+}
+
+void
+ScatterDensity::setSamples(const QVector<double> &x, const QVector<double> &y, const QVector<double> &z)
+{
+    int n = qMin(x.count(), y.count());
+    this->x = x.mid(0, n);
+    this->y = y.mid(0, n);
+    this->z = z.count() >= n ? z.mid(0, n) : QVector<double>();
+    grids.clear();
+
+    // extent of the points and the range of the values
+    double minx=0, maxx=0, miny=0, maxy=0;
+    zmin = zmax = 0;
+    for (int i=0; i<n; i++) {
+        if (i == 0 || x[i] < minx) minx = x[i];
+        if (i == 0 || x[i] > maxx) maxx = x[i];
+        if (i == 0 || y[i] < miny) miny = y[i];
+        if (i == 0 || y[i] > maxy) maxy = y[i];
+        if (this->z.count()) {
+            if (i == 0 || z[i] < zmin) zmin = z[i];
+            if (i == 0 || z[i] > zmax) zmax = z[i];
+        }
+    }
+    bounds = n ? QRectF(minx, miny, maxx-minx, maxy-miny) : QRectF(1.0, 1.0, -2.0, -2.0); // invalid
+
+    itemChanged();
+}
+
+void
+ScatterDensity::setColor(QColor color)
+{
+    this->color = color;
+    grids.clear();
+    itemChanged();
+}
+
+void
+ScatterDensity::draw(QPainter *painter, const QwtScaleMap &xMap, const QwtScaleMap &yMap, const QRectF &canvasRect) const
+{
+    if (x.count() == 0) return;
+
+    // binned at this zoom and size already?
+    int found = -1;
+    for (int i=0; i<grids.count() && found < 0; i++) {
+        const DensityGrid &g = grids[i];
+        if (g.s[0] == xMap.s1() && g.s[1] == xMap.s2() && g.s[2] == yMap.s1() && g.s[3] == yMap.s2() &&
+            g.p[0] == xMap.p1() && g.p[1] == xMap.p2() && g.p[2] == yMap.p1() && g.p[3] == yMap.p2() &&
+            g.where.topLeft() == canvasRect.topLeft()) found = i;
+    }
+
+    if (found < 0) {
+        grids.prepend(bin(xMap, yMap, canvasRect));
+        while (grids.count() > MAXGRIDS) grids.removeLast();
+    } else if (found > 0) {
+        grids.move(found, 0);
+    }
+
+    // cells are scaled up, don't blur them
+    painter->save();
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, false);
+    painter->drawImage(grids[0].where, grids[0].image);
+    painter->restore();
+}
+
+DensityGrid
+ScatterDensity::bin(const QwtScaleMap &xMap, const QwtScaleMap &yMap, const QRectF &canvasRect) const
+{
+    DensityGrid returning;
+    returning.s[0] = xMap.s1(); returning.s[1] = xMap.s2();
+    returning.s[2] = yMap.s1(); returning.s[3] = yMap.s2();
+    returning.p[0] = xMap.p1(); returning.p[1] = xMap.p2();
+    returning.p[2] = yMap.p1(); returning.p[3] = yMap.p2();
+
+    // cells a couple of pixels square
+    int cell = qMax(1, int(2 * dpiXFactor));
+    int cols = qMax(1, int(ceil(canvasRect.width() / cell)));
+    int rows = qMax(1, int(ceil(canvasRect.height() / cell)));
+    returning.where = QRectF(canvasRect.left(), canvasRect.top(), cols * cell, rows * cell);
+
+    // a slice of the points per thread, unless there are
+    // too few for it to be worth the overhead
+    int n = x.count();
+    int threads = qBound(1, qMin(QThread::idealThreadCount(), n / 25000), 16);
+
+    QVector<DensityChunk> chunks(threads);
+    for (int t=0; t<threads; t++) {
+        DensityChunk &c = chunks[t];
+        c.x = x.constData();
+        c.y = y.constData();
+        c.z = z.count() ? z.constData() : NULL;
+        c.from = (n * t) / threads;
+        c.to = (n * (t+1)) / threads;
+        c.xMap = xMap;
+        c.yMap = yMap;
+        c.left = canvasRect.left();
+        c.top = canvasRect.top();
+        c.cell = cell;
+        c.cols = cols;
+        c.rows = rows;
+    }
+    if (threads > 1) QtConcurrent::blockingMap(chunks, binChunk);
+    else binChunk(chunks[0]);
+
+    // merge the slices
+    QVector<int> counts = chunks[0].counts;
+    QVector<double> sums = chunks[0].sums;
+    for (int t=1; t<threads; t++) {
+        for (int i=0; i<counts.count(); i++) counts[i] += chunks[t].counts[i];
+        if (z.count()) for (int i=0; i<sums.count(); i++) sums[i] += chunks[t].sums[i];
+    }
+
+    int max = 0;
+    foreach(int count, counts) if (count > max) max = count;
+
+    // opacity on a log scale, or a single point would be invisible
+    // next to the thousands sat at the same power and cadence
+    returning.image = QImage(cols, rows, QImage::Format_ARGB32);
+    returning.image.fill(Qt::transparent);
+    if (max == 0) return returning;
+
+    double lmax = log(1.0 + max);
+    for (int row=0; row<rows; row++) {
+        QRgb *line = reinterpret_cast<QRgb*>(returning.image.scanLine(row));
+        for (int col=0; col<cols; col++) {
+
+            int index = (row * cols) + col;
+            if (counts[index] == 0) continue;
+
+            QColor c = color;
+            if (z.count()) {
+                double mean = sums[index] / counts[index];
+                double f = zmax > zmin ? (mean - zmin) / (zmax - zmin) : 0.5;
+                c.setHsv(int(240 * (1.0 - qBound(0.0, f, 1.0))), 255, 255);
+            }
+            c.setAlpha(64 + int(191.0 * log(1.0 + counts[index]) / lmax));
+            line[col] = c.rgba();
+        }
+    }
+    return returning;
+}
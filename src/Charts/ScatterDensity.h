@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2020 GoldenCheetah contributors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_ScatterDensity_h
+#define _GC_ScatterDensity_h 1
+#include "GoldenCheetah.h"
+
+#include <QVector>
+#include <QList>
+#include <QColor>
+#include <QImage>
+#include <qwt_plot_item.h>
+#include <qwt_scale_map.h>
+
+// a density raster for one zoom level and canvas size
+struct DensityGrid {
+    double s[4], p[4];  // x and y scale maps it was binned for
+    QRectF where;       // where it is drawn
+    QImage image;       // one pixel per cell
+};
+
+//
+// A scatter of many thousands of points drawn as a density raster.
+//
+// Plotting every sample as a symbol is fine for a ride, but a season
+// of compared rides is millions of symbols that take seconds to paint
+// and mostly overlap. Instead the points are counted into a grid of
+// cells a couple of pixels square, the counts drawn as a raster with
+// denser cells more opaque. When a third value is given each cell is
+// coloured by its mean, from blue (low) to red (high).
+//
+// Counting is split across threads and the rasters are kept for the
+// last few zoom levels, so panning back and forth or zooming out
+// again doesn't need to count the points again.
+//
+class ScatterDensity : public QwtPlotItem
+{
+    public:
+
+        ScatterDensity(QColor color);
+
+        // draw as a density rather than symbols above this many points
+        static bool dense(int points) { return points > 50000; }
+
+        void setSamples(const QVector<double> &x, const QVector<double> &y);
+        void setSamples(const QVector<double> &x, const QVector<double> &y, const QVector<double> &z);
+        void setColor(QColor color);
+
+        int rtti() const { return QwtPlotItem::Rtti_PlotUserItem; }
+        QRectF boundingRect() const { return bounds; }
+        void draw(QPainter *painter, const QwtScaleMap &xMap, const QwtScaleMap &yMap, const QRectF &canvasRect) const;
+
+    private:
+
+        QVector<double> x, y, z;
+        double zmin, zmax;
+        QRectF bounds;
+        QColor color;
+
+        // most recently used first
+        mutable QList<DensityGrid> grids;
+        DensityGrid bin(const QwtScaleMap &xMap, const QwtScaleMap &yMap, const QRectF &canvasRect) const;
+};
+
+#endif
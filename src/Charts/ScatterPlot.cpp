@@ -18,6 +18,7 @@
 
 #include "ScatterPlot.h"
 #include "ScatterWindow.h"
+#include "ScatterDensity.h"
 #include "Statistic.h"
 #include "IntervalItem.h"
 #include "Context.h"
@@ -265,6 +266,11 @@ void ScatterPlot::setData (ScatterSettings *settings)
         delete c;
     }
     intervalCurves.clear();
+    foreach(ScatterDensity *d, densities) {
+        d->detach();
+        delete d;
+    }
+    densities.clear();
 
     // clear out any label
     foreach(QwtPlotMarker *c, labels) {
@@ -310,6 +316,17 @@ void ScatterPlot::setData (ScatterSettings *settings)
         curves = 1;
     }
 
+    // when there are too many points to draw as symbols
+    // (a long ride, or lots of them compared) show the density
+    int total = 0;
+    if (context->isCompareIntervals) {
+        foreach(CompareInterval compare, context->compareIntervals)
+            if (compare.checked) total += compare.data->dataPoints().count();
+    } else {
+        total = settings->ride->ride()->dataPoints().count();
+    }
+    bool dense = ScatterDensity::dense(total * curves);
+
     for (int side = 0; side < curves; side++) {
 
         if (context->isCompareIntervals == false) {
@@ -416,7 +433,19 @@ void ScatterPlot::setData (ScatterSettings *settings)
             if (intervals.count() == 0 || settings->frame) {
                 smooth(x, y, points, settings->smoothing);
 
-                if (side) {
+                if (dense) {
+
+                    ScatterDensity *d = new ScatterDensity(side ? Qt::cyan : Qt::red);
+                    d->setSamples(x, y);
+                    d->setZ(-1);
+                    d->attach(this);
+                    densities << d;
+
+                    if (settings->trendLine>0)  {
+                        addTrendLine(x, y, points, side ? Qt::cyan : Qt::red);
+                    }
+
+                } else if (side) {
 
                     QwtSymbol *sym = new QwtSymbol;
                     sym->setStyle(QwtSymbol::Ellipse);
@@ -521,21 +550,31 @@ void ScatterPlot::setData (ScatterSettings *settings)
                     // left / right are darker lighter
                     if (side) intervalColor = intervalColor.lighter(50);
 
-                    QwtSymbol *sym = new QwtSymbol;
-                    sym->setStyle(QwtSymbol::Ellipse);
-                    sym->setSize(4*dpiXFactor);
-                    sym->setBrush(QBrush(intervalColor));
-                    sym->setPen(QPen(intervalColor));
+                    if (dense) {
 
-                    QwtPlotCurve *ic = new QwtPlotCurve();
+                        ScatterDensity *d = new ScatterDensity(intervalColor);
+                        d->setSamples(xval, yval);
+                        d->attach(this);
+                        densities << d;
 
-                    ic->setSymbol(sym);
-                    ic->setStyle(QwtPlotCurve::Dots);
-                    ic->setRenderHint(QwtPlotItem::RenderAntialiased);
-                    ic->setSamples(xval.constData(), yval.constData(), nbPoints);
-                    ic->attach(this);
+                    } else {
 
-                    intervalCurves.append(ic);
+                        QwtSymbol *sym = new QwtSymbol;
+                        sym->setStyle(QwtSymbol::Ellipse);
+                        sym->setSize(4*dpiXFactor);
+                        sym->setBrush(QBrush(intervalColor));
+                        sym->setPen(QPen(intervalColor));
+
+                        QwtPlotCurve *ic = new QwtPlotCurve();
+
+                        ic->setSymbol(sym);
+                        ic->setStyle(QwtPlotCurve::Dots);
+                        ic->setRenderHint(QwtPlotItem::RenderAntialiased);
+                        ic->setSamples(xval.constData(), yval.constData(), nbPoints);
+                        ic->attach(this);
+
+                        intervalCurves.append(ic);
+                    }
 
                     if (settings->trendLine>0)  {
                         addTrendLine(xval, yval, nbPoints, intervalColor);
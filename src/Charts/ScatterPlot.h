@@ -72,6 +72,7 @@
 
 // the data provider for the plot
 class ScatterSettings;
+class ScatterDensity;
 
 // the core surface plot
 class ScatterPlot : public QwtPlot
@@ -98,6 +99,7 @@ class ScatterPlot : public QwtPlot
         double cranklength;
 
         QList <QwtPlotCurve *> intervalCurves; // each curve on plot
+        QList <ScatterDensity *> densities; // curves with too many points to draw as symbols
         QList <QwtPlotMarker *> intervalMarkers; // each marker on plot
         QList <QwtPlotMarker *> labels; // each label on plot
 
@@ -25,6 +25,7 @@
 #include "RideFile.h"
 #include "RideFileCache.h"
 #include "CsvRideFile.h"
+#include "MetricExport.h"
 
 #include "Zones.h"
 #include "HrZones.h"
@@ -84,6 +85,8 @@ APIWebService::athleteData(QStringList &paths, HttpRequest &request, HttpRespons
 
         // LIST ACTIVITIES FOR ATHLETE
         // http://localhost:12021/athlete
+        // optional query parameter:
+        //      ?where=TSS>100,Workout_Code=Race  (needs the ride index)
         listRides(paths[0], request, response);
         return;
 
@@ -212,6 +215,9 @@ APIWebService::writeRideLine(RideItem &item, HttpRequest *request, HttpResponse
     // are we doing rides or intervals?
     listRideSettings *settings = static_cast<listRideSettings *>(response->userData());
 
+    // matches where= ?
+    if (settings->filtered && !settings->passing.contains(item.fileName)) return;
+
     if (settings->intervals == true) {
 
         // loop through all available intervals for this ride item
@@ -236,14 +242,14 @@ APIWebService::writeRideLine(RideItem &item, HttpRequest *request, HttpResponse
                 foreach(int index, settings->wanted) {
                     double value = interval->metrics()[index];
                     response->bwrite(",");
-                    response->bwrite(QString("%1").arg(value, 'f').simplified().toLocal8Bit());
+                    response->bwrite(MetricExport::number(value));
                 }
             } else {
     
                 // all metrics...
                 foreach(double value, interval->metrics()) {
                     response->bwrite(",");
-                    response->bwrite(QString("%1").arg(value, 'f').simplified().toLocal8Bit());
+                    response->bwrite(MetricExport::number(value));
                 }
             }
             response->bwrite("\n");
@@ -263,14 +269,14 @@ APIWebService::writeRideLine(RideItem &item, HttpRequest *request, HttpResponse
             foreach(int index, settings->wanted) {
                 double value = item.metrics()[index];
                 response->bwrite(",");
-                response->bwrite(QString("%1").arg(value, 'f').simplified().toLocal8Bit());
+                response->bwrite(MetricExport::number(value));
             }
         } else {
     
             // all metrics...
             foreach(double value, item.metrics()) {
                 response->bwrite(",");
-                response->bwrite(QString("%1").arg(value, 'f').simplified().toLocal8Bit());
+                response->bwrite(MetricExport::number(value));
             }
         }
 
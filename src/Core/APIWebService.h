@@ -23,12 +23,15 @@
 #include "RideItem.h"
 #include "RideMetadata.h"
 #include <QDir>
+#include <QSet>
 
 struct listRideSettings {
     bool intervals;
     QList<int> wanted; // metrics to list
     QList<FieldDefinition> metafields;
     QList<QString> metawanted; // metadata to list
+    bool filtered; // where= was passed
+    QSet<QString> passing; // rides matching where= from the ride index
 };
 
 class APIWebService : public HttpRequestHandler
@@ -98,6 +98,9 @@ Athlete::Athlete(Context *context, const QDir &homeDir)
     }
     useMetricUnits = (unit.toString() == GC_UNIT_METRIC);
 
+    // default weight and height
+    readDefaults();
+
     // Power Zones for Bike & Run
     for (int i=0; i < 2; i++) {
         zones_[i] = new Zones(i>0);
@@ -225,6 +228,7 @@ Athlete::~Athlete()
 {
     // close the ride cache down first
     delete rideCache;
+    rideCache = NULL;
 
     // save those preset charts
     LTMSettings reader;
@@ -351,6 +355,9 @@ Athlete::configChanged(qint32 state)
         useMetricUnits = (unit.toString() == GC_UNIT_METRIC);
     }
 
+    // default weight and height
+    if (state & (CONFIG_ATHLETE | CONFIG_GENERAL)) readDefaults();
+
     // invalidate PMC data
     if (state & (CONFIG_PMC | CONFIG_SEASONS)) {
         QMapIterator<QString, PMCData *> pmcs(pmcData);
@@ -491,7 +498,7 @@ Athlete::getWeight(QDate date, RideFile *ride)
 
     // global options
     if (!weight)
-        weight = appsettings->cvalue(context->athlete->cyclist, GC_WEIGHT, "75.0").toString().toDouble(); // default to 75kg
+        weight = defaultWeight;
 
     // No weight default is weird, we'll set to 80kg
     if (weight <= 0.00) weight = 80.00;
@@ -499,6 +506,13 @@ Athlete::getWeight(QDate date, RideFile *ride)
     return weight;
 }
 
+void
+Athlete::readDefaults()
+{
+    defaultWeight = appsettings->cvalue(cyclist, GC_WEIGHT, "75.0").toString().toDouble(); // default to 75kg
+    defaultHeight = appsettings->cvalue(cyclist, GC_HEIGHT, 0.0f).toString().toDouble();
+}
+
 double
 Athlete::getHeight(RideFile *ride)
 {
@@ -508,7 +522,7 @@ Athlete::getHeight(RideFile *ride)
     if (ride) height = ride->getTag("Height", "0.0").toDouble();
 
     // global options ?
-    if (!height) height = appsettings->cvalue(context->athlete->cyclist, GC_HEIGHT, 0.0f).toString().toDouble();
+    if (!height) height = defaultHeight;
 
     // from weight via Stillman Average?
     if (!height && ride) height = (getWeight(ride->startTime().date(), ride)+100.0)/98.43;
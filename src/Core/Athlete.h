@@ -116,6 +116,11 @@ class Athlete : public QObject
         double getWeight(QDate date, RideFile *ride=NULL);
         double getHeight(RideFile *ride=NULL);
 
+        // configured defaults, read once and on config change since
+        // getWeight/getHeight are called for every ride and interval
+        double defaultWeight, defaultHeight;
+        void readDefaults();
+
         // athlete's calendar
         CalendarDownload *calendarDownload;
 #ifdef GC_HAVE_ICAL
@@ -27,6 +27,11 @@
 #include <QJsonArray>
 #include <QJsonObject>
 
+#include <algorithm>
+
+// used to binary search measures by date
+static bool bodyMeasureAfter(const QDate &date, const BodyMeasure &x) { return date < x.when.date(); }
+
 quint16
 BodyMeasure::getFingerprint() const
 {
@@ -213,24 +218,21 @@ BodyMeasures::getFieldUnits(int field, bool useMetricUnits) const {
 
 void
 BodyMeasures::getBodyMeasure(QDate date, BodyMeasure &here) const {
-    // the optimisation below is not thread safe and should be encapsulated
-    // by a mutex, but this kind of defeats to purpose of the optimisation!
-
-    //if (withings_.count() && withings_.last().when.date() <= date) here = withings_.last();
-    //if (!withings_.count() || withings_.first().when.date() > date) here = WithingsReading();
 
     // always set to not found before searching
     here = BodyMeasure();
 
-    // loop
-    foreach(BodyMeasure x, bodyMeasures_) {
-
-        // we only look for weight readings at present
-        // some readings may not include this so skip them
-        if (x.weightkg <= 0) continue;
-
-        if (x.when.date() <= date) here = x;
-        if (x.when.date() > date) break;
+    // measures are in date order (see setBodyMeasures) so find the
+    // first one after the date and walk back to the last reading
+    // that has a weight, some readings may not include it
+    QList<BodyMeasure>::const_iterator it = std::upper_bound(bodyMeasures_.constBegin(), bodyMeasures_.constEnd(),
+                                                             date, bodyMeasureAfter);
+    while (it != bodyMeasures_.constBegin()) {
+        --it;
+        if ((*it).weightkg > 0) {
+            here = *it;
+            break;
+        }
     }
 
     // will be empty if none found
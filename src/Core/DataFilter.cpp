@@ -26,8 +26,13 @@
 #include "PMCData.h"
 #include "VDOTCalculator.h"
 #include "DataProcessor.h"
+#include "RideCache.h"
+#include "RideSimilarity.h"
+#include "RideIndex.h"
 #include <QDebug>
 #include <QMutex>
+#include <QThread>
+#include <QCoreApplication>
 
 #ifdef GC_WANT_PYTHON
 #include "PythonEmbed.h"
@@ -128,6 +133,9 @@ static struct {
 
     // how many performance tests in the ride?
     { "tests", 0 },
+
+    // how alike this activity is to the one selected, 0-100
+    { "similarity", 0 },
     // add new ones above this line
     { "", -1 }
 };
@@ -171,6 +179,8 @@ DataFilter::builtins()
             for (int g=0; g<groupSymbols.count(); g++)
                 foreach (QString fieldSymbol, measures.getFieldSymbols(g))
                     returning << QString("measure(Date, \"%1\", \"%2\")").arg(groupSymbols[g]).arg(fieldSymbol);
+        } else if (i == 44) {
+            returning << "similarity()";
         } else {
             QString function;
             function = DataFilterFunctions[i].name + "(";
@@ -944,6 +954,107 @@ static bool isCoggan(QString symbol)
     return false;
 }
 
+// translate a filter into a where clause for the ride index. only simple
+// comparisons of a symbol with a constant, joined with && || and !, are
+// translated; anything else returns false and is evaluated ride by ride
+static bool indexPredicate(DataFilterRuntime *df, Leaf *leaf, QString &where, QVariantList &binds)
+{
+    switch(leaf->type) {
+
+    case Leaf::Logical :
+    {
+        QString lhs, rhs;
+        if (!indexPredicate(df, leaf->lvalue.l, lhs, binds)) return false;
+        if (leaf->op == 0) { // parenthesis
+            where = "(" + lhs + ")";
+            return true;
+        }
+        if (leaf->op != AND && leaf->op != OR) return false;
+        if (!indexPredicate(df, leaf->rvalue.l, rhs, binds)) return false;
+        where = QString("(%1 %2 %3)").arg(lhs).arg(leaf->op == AND ? "AND" : "OR").arg(rhs);
+        return true;
+    }
+
+    case Leaf::UnaryOperation :
+    {
+        QString lhs;
+        if (leaf->op != '!' || !indexPredicate(df, leaf->lvalue.l, lhs, binds)) return false;
+        where = "NOT (" + lhs + ")";
+        return true;
+    }
+
+    case Leaf::Operation :
+    {
+        QString op;
+        switch(leaf->op) {
+        case EQ : op = "="; break;
+        case NEQ : op = "!="; break;
+        case LT : op = "<"; break;
+        case LTE : op = "<="; break;
+        case GT : op = ">"; break;
+        case GTE : op = ">="; break;
+        default : return false;
+        }
+
+        Leaf *lhs = leaf->lvalue.l;
+        Leaf *rhs = leaf->rvalue.l;
+        if (lhs->type != Leaf::Symbol) return false;
+
+        // the constant, strings that are dates are numbers (see eval)
+        bool isNumber = true;
+        double number = 0;
+        QString string;
+        if (rhs->type == Leaf::Integer) number = rhs->lvalue.i;
+        else if (rhs->type == Leaf::Float) number = rhs->lvalue.f;
+        else if (rhs->type == Leaf::String) {
+            QDate date = QDate::fromString(*(rhs->lvalue.s), "yyyy/MM/dd");
+            if (date.isValid()) number = QDate(1900,01,01).daysTo(date);
+            else {
+                isNumber = false;
+                string = *(rhs->lvalue.s);
+            }
+        } else return false;
+
+        // user symbols and anything computed on the fly can't be indexed
+        QString symbol = *(lhs->lvalue.n);
+        if (df->symbols.contains(symbol) || symbol == "x" || isCoggan(symbol) ||
+            !symbol.compare("NA", Qt::CaseInsensitive) || !symbol.compare("RECINTSECS", Qt::CaseInsensitive) ||
+            !symbol.compare("Current", Qt::CaseInsensitive) || !symbol.compare("Today", Qt::CaseInsensitive)) return false;
+
+        if (!symbol.compare("Date", Qt::CaseInsensitive)) {
+            if (!isNumber || number != int(number)) return false;
+            where = RideIndex::datePredicate(op, QDate(1900,01,01).addDays(number), binds);
+            return true;
+        }
+
+        if (symbol == "isRun" || symbol == "isSwim") {
+            if (!isNumber) return false;
+            where = RideIndex::sportPredicate(symbol, op, number, binds);
+            return true;
+        }
+
+        QString name = df->lookupMap.value(symbol, "");
+        if (df->lookupType.value(symbol)) {
+
+            // numeric metadata converts text differently to sqlite
+            if (!isNumber || !RideMetricFactory::instance().haveMetric(name)) return false;
+            where = RideIndex::metricPredicate(name, op, number, binds);
+            return true;
+
+        } else {
+
+            // strings only compare for (in)equality the same way
+            if (isNumber || (op != "=" && op != "!=")) return false;
+            where = RideIndex::metaPredicate(name, op, string, binds);
+            return true;
+        }
+    }
+
+    default:
+        return false;
+    }
+}
+
 bool Leaf::isNumber(DataFilterRuntime *df, Leaf *leaf)
 {
     switch(leaf->type) {
@@ -1326,6 +1437,12 @@ void Leaf::validateFilter(Context *context, DataFilterRuntime *df, Leaf *leaf)
                     foreach(Leaf *p, leaf->fparms) validateFilter(context, df, p);
                 }
 
+                // depends on the ride selected, so can't be cached in a metric
+                if (leaf->function == "similarity" && df->usermetric) {
+                    DataFiltererrors << QString(tr("similarity() can't be used in a user metric."));
+                    leaf->inerror = true;
+                }
+
                 // does it exist?
                 for(int i=0; DataFilterFunctions[i].parameters != -1; i++) {
                     if (DataFilterFunctions[i].name == leaf->function) {
@@ -1470,6 +1587,7 @@ DataFilter::DataFilter(QObject *parent, Context *context) : QObject(parent), con
 {
     // be sure not to enable this by accident!
     rt.isdynamic = false;
+    rt.usermetric = false;
 
     // set up the models we support
     rt.models << new CP2Model(context);
@@ -1487,6 +1605,7 @@ DataFilter::DataFilter(QObject *parent, Context *context, QString formula) : QOb
 {
     // be sure not to enable this by accident!
     rt.isdynamic = false;
+    rt.usermetric = false;
 
     // set up the models we support
     rt.models << new CP2Model(context);
@@ -1497,6 +1616,9 @@ DataFilter::DataFilter(QObject *parent, Context *context, QString formula) : QOb
 
     configChanged(CONFIG_FIELDS);
 
+    // only user metrics are compiled this way
+    rt.usermetric = true;
+
     // regardless of success or failure set signature
     setSignature(formula);
 
@@ -1623,9 +1745,25 @@ QStringList DataFilter::parseFilter(Context *context, QString query, QStringList
         // clear current filter list
         filenames.clear();
 
+        // push simple filters down to the ride index when we have one
+        QSet<QString> indexed;
+        bool pushdown = false;
+        RideIndex *index = context->athlete->rideCache->rideIndex();
+        if (index && !rt.isdynamic) {
+            QString where;
+            QVariantList binds;
+            if (indexPredicate(&rt, treeRoot, where, binds))
+                pushdown = index->filenames(where, binds, indexed);
+        }
+
         // get all fields...
         foreach(RideItem *item, context->athlete->rideCache->rides()) {
 
+            if (pushdown) {
+                if (indexed.contains(item->fileName)) filenames << item->fileName;
+                continue;
+            }
+
             // evaluate each ride...
             Result result = treeRoot->eval(&rt, treeRoot, 0, item, NULL);
             if (result.isNumber && result.number) {
@@ -2521,6 +2659,18 @@ Result Leaf::eval(DataFilterRuntime *df, Leaf *leaf, float x, RideItem *m, RideF
                     }
                 }
                 break;
+
+        case 44 :
+                {   // SIMILARITY() to the currently selected activity, 0-100
+                    // only on the GUI thread, which is the one that changes the selection
+                    if (m == NULL || m->context->currentRideItem() == NULL) return Result(0);
+                    if (QThread::currentThread() != QCoreApplication::instance()->thread()) return Result(0);
+
+                    RideItem *selected = const_cast<RideItem*>(m->context->currentRideItem());
+                    if (selected == m) return Result(100);
+                    return Result(m->context->athlete->rideCache->similarity()->similarity(m, selected));
+                }
+                break;
         default:
             return Result(0);
         }
@@ -122,6 +122,9 @@ public:
     // needs to be reapplied as the ride selection changes
     bool isdynamic;
 
+    // compiled for a user metric, computed off the GUI thread and cached
+    bool usermetric;
+
     // Lookup tables
     QMap<QString,QString> lookupMap;
     QMap<QString,bool> lookupType; // true if a number, false if a string
@@ -23,6 +23,8 @@
 #include "IntervalItem.h"
 #include "RideCache.h"
 
+#include <algorithm>
+
 FreeSearch::FreeSearch(QObject *parent, Context *context) : QObject(parent), context(context)
 {
     // nothing to do, all the data we need is in the ridecache
@@ -76,43 +78,185 @@ static QStringList searchSplit(QString string)
     return returning;
 }
 
-QList<QString> FreeSearch::search(QString query)
+// words are separated by the same whitespace as search tokens
+// so any unquoted token can only ever match within a single word
+static bool searchSpace(QChar c)
 {
-    filenames.clear();
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == QChar(0);
+}
 
-    // search split will tokenise and handle quoting and escaping
-    QStringList tokens = searchSplit(query);
+static QStringList searchWords(const QString &text)
+{
+    QStringList returning;
+    int start = -1;
+    for (int i=0; i<=text.length(); i++) {
+        if (i == text.length() || searchSpace(text[i])) {
+            if (start >= 0) returning << text.mid(start, i-start);
+            start = -1;
+        } else if (start < 0) {
+            start = i;
+        }
+    }
+    return returning;
+}
 
-    foreach(RideItem*item, context->athlete->rideCache->rides()) {
+void
+FreeSearchIndex::tokenize(Entry &entry)
+{
+    entry.metadata = entry.item->metadata();
+    entry.intervals.clear();
+    foreach(IntervalItem *interval, entry.item->intervals()) entry.intervals << interval->name;
 
-        QMapIterator<QString,QString> meta(item->metadata());
-        meta.toFront();
-        while (meta.hasNext()) {
-            meta.next();
+    QStringList values = entry.metadata.values();
+    values << entry.intervals;
+    entry.empty = values.isEmpty();
+    entry.text = values.join(QChar(0)).toCaseFolded();
+    entry.words = searchWords(entry.text).toSet().toList();
+}
 
-            // does the super string contain the tokens?
-            foreach(QString token, tokens) {
+void
+FreeSearchIndex::refresh()
+{
+    const QVector<RideItem*> &rides = rideCache->rides();
 
-                if (meta.value().contains(token, Qt::CaseInsensitive)) {
-                    filenames << item->fileName;
-                    goto nextItem;
-                }
+    // anything changed ? metadata is shared with the item until
+    // it gets updated, so that check is cheap
+    bool changed = rides.count() != entries.count();
+    for (int i=0; !changed && i<rides.count(); i++) {
+        const Entry &entry = entries[i];
+        if (entry.item != rides[i] || !entry.metadata.isSharedWith(rides[i]->metadata()) ||
+            entry.intervals.count() != rides[i]->intervals().count()) {
+            changed = true;
+            break;
+        }
+        for (int j=0; j<entry.intervals.count(); j++) {
+            if (entry.intervals[j] != rides[i]->intervals()[j]->name) {
+                changed = true;
+                break;
             }
         }
+    }
+    if (!changed) return;
+
+    // reuse what we can, rides may have moved
+    QHash<RideItem*, int> previous;
+    for (int i=0; i<entries.count(); i++) previous.insert(entries[i].item, i);
+
+    QVector<Entry> update(rides.count());
+    for (int i=0; i<rides.count(); i++) {
+        int prior = previous.value(rides[i], -1);
+        if (prior >= 0) {
+            update[i] = entries[prior];
+
+            // still the same ?
+            bool same = update[i].metadata.isSharedWith(rides[i]->metadata()) &&
+                        update[i].intervals.count() == rides[i]->intervals().count();
+            for (int j=0; same && j<update[i].intervals.count(); j++)
+                if (update[i].intervals[j] != rides[i]->intervals()[j]->name) same = false;
+            if (same) continue;
+        }
+        update[i].item = rides[i];
+        tokenize(update[i]);
+    }
+    entries = update;
+
+    // rebuild the postings from the words in each ride
+    QHash<QString, QVector<int> > words;
+    for (int i=0; i<entries.count(); i++)
+        foreach(const QString &word, entries[i].words) words[word] << i;
+
+    vocabulary = words.keys();
+    vocabulary.sort();
+    postings.resize(vocabulary.count());
+    for (int i=0; i<vocabulary.count(); i++) postings[i] = words.value(vocabulary[i]);
+
+    // vocabulary changed
+    lastToken = QString();
+    lastWords.clear();
+}
+
+QVector<int>
+FreeSearchIndex::wordsContaining(QString folded)
+{
+    QVector<int> returning;
+
+    if (!lastToken.isEmpty() && folded.contains(lastToken)) {
+
+        // only words that matched a shorter token can match
+        foreach(int i, lastWords) if (vocabulary[i].contains(folded)) returning << i;
+
+    } else {
+
+        // words starting with the token are together since the
+        // vocabulary is sorted, the rest need to be checked in turn
+        QStringList::const_iterator from = std::lower_bound(vocabulary.constBegin(), vocabulary.constEnd(), folded);
+        int first = from - vocabulary.constBegin();
+        int i = first;
+        for (; i<vocabulary.count() && vocabulary[i].startsWith(folded); i++) returning << i;
+        int last = i;
+        for (i=0; i<vocabulary.count(); i++) {
+            if (i == first) i = last;
+            if (i < vocabulary.count() && vocabulary[i].contains(folded)) returning << i;
+        }
+        std::sort(returning.begin(), returning.end());
+    }
+
+    lastToken = folded;
+    lastWords = returning;
+    return returning;
+}
+
+QBitArray
+FreeSearchIndex::search(QStringList tokens)
+{
+    QMutexLocker locker(&lock);
+    refresh();
+
+    QBitArray returning(entries.count());
+
+    foreach(QString token, tokens) {
 
-        // user intervals - even autodiscovered
-        foreach(IntervalItem *interval, item->intervals()) {
+        QString folded = token.toCaseFolded();
+        QStringList pieces = searchWords(folded);
 
-            foreach (QString token, tokens) {
+        if (pieces.count() == 1 && pieces[0] == folded) {
 
-                if (interval->name.contains(token, Qt::CaseInsensitive)) {
-                    filenames << item->fileName;
-                    goto nextItem;
-                }
+            // a single word, look in the vocabulary
+            foreach(int word, wordsContaining(folded))
+                foreach(int i, postings[word]) returning.setBit(i);
+
+        } else {
+
+            // a phrase (or empty), rides must have all the words
+            QBitArray candidates(entries.count(), true);
+            foreach(QString piece, pieces) {
+                QBitArray has(entries.count());
+                foreach(int word, wordsContaining(piece))
+                    foreach(int i, postings[word]) has.setBit(i);
+                candidates &= has;
             }
+
+            // and then the phrase itself
+            for (int i=0; i<entries.count(); i++)
+                if (candidates.testBit(i) && !entries[i].empty && entries[i].text.contains(folded))
+                    returning.setBit(i);
         }
-        nextItem:;
     }
+    return returning;
+}
+
+QList<QString> FreeSearch::search(QString query)
+{
+    filenames.clear();
+
+    // search split will tokenise and handle quoting and escaping
+    QStringList tokens = searchSplit(query);
+
+    // rides that match any token, via the index
+    QBitArray matches = context->athlete->rideCache->searchIndex()->search(tokens);
+    const QVector<RideItem*> &rides = context->athlete->rideCache->rides();
+    for (int i=0; i<matches.size() && i<rides.count(); i++)
+        if (matches.testBit(i)) filenames << rides[i]->fileName;
 
     emit results(filenames);
 
@@ -23,12 +23,58 @@
 #include <QString>
 #include <QDir>
 #include <QMutex>
+#include <QBitArray>
+#include <QVector>
 
 #include "Context.h"
 #include "RideMetadata.h"
 #include "RideCache.h"
 #include "RideItem.h"
 
+// tokenized, case folded index of ride metadata and interval names
+// owned by the ride cache so it outlives the FreeSearch instances that
+// come and go with each query. It is brought up to date on each search
+// but only rides whose metadata or intervals changed are tokenized again
+class FreeSearchIndex
+{
+public:
+    FreeSearchIndex(RideCache *rideCache) : rideCache(rideCache) {}
+
+    // rides that match any of the tokens as a bitset indexed as
+    // rideCache->rides(), a case insensitive substring match as
+    // always; words are matched against the vocabulary and phrases
+    // checked against the rides that contain all their words
+    QBitArray search(QStringList tokens);
+
+private:
+    void refresh();
+    QVector<int> wordsContaining(QString folded);
+
+    struct Entry {
+        RideItem *item;
+        QMap<QString,QString> metadata; // shared until the item changes it
+        QStringList intervals;
+        QString text; // case folded values, separated by QChar(0)
+        QStringList words; // distinct words in text
+        bool empty; // no metadata or intervals at all
+    };
+    void tokenize(Entry &entry);
+
+    RideCache *rideCache;
+    QVector<Entry> entries; // as rideCache->rides()
+
+    // distinct words in sorted order and the rides they're in
+    QStringList vocabulary;
+    QVector<QVector<int> > postings;
+
+    // as you type the token gets longer so we only need to
+    // rescan the words that matched the last one
+    QString lastToken;
+    QVector<int> lastWords;
+
+    QMutex lock;
+};
+
 class FreeSearch : public QObject
 {
     Q_OBJECT
@@ -27,6 +27,11 @@
 #include <QJsonArray>
 #include <QJsonObject>
 
+#include <algorithm>
+
+// used to binary search measures by date
+static bool hrvMeasureAfter(const QDate &date, const HrvMeasure &x) { return date < x.when.date(); }
+
 quint16
 HrvMeasure::getFingerprint() const
 {
@@ -222,12 +227,11 @@ HrvMeasures::getHrvMeasure(QDate date, HrvMeasure &here) const {
     // always set to not found before searching
     here = HrvMeasure();
 
-    // loop
-    foreach(HrvMeasure x, hrvMeasures_) {
-
-        if (x.when.date() == date) here = x;
-        if (x.when.date() > date) break;
-    }
+    // measures are in date order so find the first one after
+    // the date, the one before it is the last on that day if any
+    QList<HrvMeasure>::const_iterator it = std::upper_bound(hrvMeasures_.constBegin(), hrvMeasures_.constEnd(),
+                                                            date, hrvMeasureAfter);
+    if (it != hrvMeasures_.constBegin() && (*(it-1)).when.date() == date) here = *(it-1);
 
     // will be empty if none found
     return;
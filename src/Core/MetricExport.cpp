@@ -0,0 +1,570 @@
+/*
+ * Copyright (c) 2020 GoldenCheetah contributors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "MetricExport.h"
+#include "Context.h"
+#include "Athlete.h"
+#include "RideCache.h"
+#include "RideItem.h"
+#include "IntervalItem.h"
+#include "RideMetric.h"
+
+#include <QtEndian>
+#if QT_VERSION > 0x050000
+#include <QtConcurrent>
+#else
+#include <QtConcurrentRun>
+#endif
+#include <cmath>
+#include <cstring>
+
+// write to the file in blocks of about this many bytes
+static const int BLOCKSIZE = 1024 * 1024;
+
+// rows in each columnar row group
+static const int GROUPSIZE = 4096;
+
+// powers of ten that are exact as doubles
+static const double POW10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+                                1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15 };
+
+MetricExport::MetricExport(Context *context) : context(context), format(CSV), content(Activities), cancelled(0), ok(false)
+{
+    connect(&watcher, SIGNAL(finished()), this, SLOT(done()));
+}
+
+MetricExport::~MetricExport()
+{
+    cancel();
+    wait();
+}
+
+QString
+MetricExport::suffix(int format)
+{
+    switch (format) {
+    default:
+    case CSV: return "csv";
+    case JSONL: return "jsonl";
+    case Columnar: return "gccols";
+    }
+}
+
+QStringList
+MetricExport::filters()
+{
+    // in the same order as the formats
+    QStringList returning;
+    returning << tr("Comma Separated Variables (*.csv)");
+    returning << tr("JSON Lines (*.jsonl)");
+    returning << tr("Columnar Binary (*.gccols)");
+    return returning;
+}
+
+int
+MetricExport::formatNumber(double value, char *buffer)
+{
+    char *p = buffer;
+
+    if (std::isnan(value)) {
+        memcpy(p, "nan", 3);
+        return 3;
+    }
+    if (value < 0) {
+        *p++ = '-';
+        value = -value;
+    }
+    if (std::isinf(value)) {
+        memcpy(p, "inf", 3);
+        return (p - buffer) + 3;
+    }
+
+    // very small or very large, leave it to qt
+    if (value != 0 && (value < 1e-4 || value >= 1e15)) {
+        QByteArray g = QByteArray::number(value, 'g', 6);
+        memcpy(p, g.constData(), g.length());
+        return (p - buffer) + g.length();
+    }
+
+    // six significant digits, or all of them for big
+    // whole numbers, then trim any trailing zeroes
+    int decimals = 0;
+    if (value >= 1) {
+        int digits = 1;
+        while (digits < 15 && value >= POW10[digits]) digits++;
+        decimals = qMax(0, 6 - digits);
+    } else if (value > 0) {
+        int lead = 0;
+        while (lead < 4 && value * POW10[lead+1] < 1) lead++;
+        decimals = 6 + lead;
+    }
+
+    quint64 scale = quint64(POW10[decimals]);
+    quint64 scaled = quint64((value * POW10[decimals]) + 0.5);
+    quint64 whole = scaled / scale;
+    quint64 fraction = scaled % scale;
+
+    char digits[24];
+    int n = 0;
+    do {
+        digits[n++] = '0' + (whole % 10);
+        whole /= 10;
+    } while (whole);
+    while (n) *p++ = digits[--n];
+
+    if (fraction) {
+        *p++ = '.';
+        for (int i=decimals-1; i>=0; i--) {
+            digits[i] = '0' + (fraction % 10);
+            fraction /= 10;
+        }
+        int last = decimals;
+        while (last > 0 && digits[last-1] == '0') last--;
+        memcpy(p, digits, last);
+        p += last;
+    }
+    return p - buffer;
+}
+
+QByteArray
+MetricExport::number(double value)
+{
+    char buffer[40];
+    return QByteArray(buffer, formatNumber(value, buffer));
+}
+
+bool
+MetricExport::start(QString filename)
+{
+    if (isRunning()) return false;
+
+    file.setFileName(filename);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+        error = tr("File: %1 cannot be opened for 'Writing'. Please check file properties.").arg(filename);
+        return false;
+    }
+
+    cancelled = 0;
+    ok = false;
+    collect();
+
+    buffer.clear();
+    buffer.reserve(BLOCKSIZE + 4096);
+
+    future = QtConcurrent::run(runExport, this);
+    watcher.setFuture(future);
+    return true;
+}
+
+void
+MetricExport::collect()
+{
+    headings.clear();
+    keys.clear();
+    indexes.clear();
+    rows.clear();
+
+    // only activities have metadata
+    if (content != Activities) fields.clear();
+
+    if (content == Samples) {
+
+        // the series asked for, or the common ones if none were
+        QList<RideFile::SeriesType> series = this->series;
+        if (series.isEmpty()) {
+            series << RideFile::secs << RideFile::km << RideFile::watts << RideFile::hr
+                   << RideFile::cad << RideFile::kph << RideFile::nm << RideFile::alt
+                   << RideFile::lat << RideFile::lon << RideFile::slope << RideFile::temp;
+        }
+        foreach(RideFile::SeriesType type, series) {
+            QString key = RideFile::symbolForSeries(type);
+            if (key.isEmpty()) key = RideFile::seriesName(type, true);
+
+            headings << RideFile::seriesName(type, true);
+            keys << key;
+            indexes << int(type);
+        }
+
+    } else {
+
+        // the metrics asked for, or all of them in index order
+        const RideMetricFactory &factory = RideMetricFactory::instance();
+        QVector<const RideMetric *> metrics;
+        if (symbols.isEmpty()) {
+            metrics.resize(factory.metricCount());
+            foreach(QString name, factory.allMetrics()) {
+                const RideMetric *m = factory.rideMetric(name);
+                metrics[m->index()] = m;
+            }
+        } else {
+            foreach(QString symbol, symbols) {
+                const RideMetric *m = factory.rideMetric(symbol);
+                if (m) metrics << m;
+            }
+        }
+        foreach(const RideMetric *m, metrics) {
+            if (m->name().startsWith("BikeScore")) headings << "BikeScore";
+            else headings << m->name();
+            keys << m->symbol();
+            indexes << m->index();
+        }
+    }
+
+    // copy the values we need, rides can change once we're running
+    foreach(RideItem *item, context->athlete->rideCache->rides()) {
+
+        if (!spec.pass(item)) continue;
+
+        ExportRow here;
+        here.when = item->dateTime;
+        here.fileName = item->fileName;
+        here.type = 0;
+
+        switch (content) {
+        case Activities:
+            here.values.resize(indexes.count());
+            for (int i=0; i<indexes.count(); i++) here.values[i] = item->metrics().value(indexes[i], 0);
+            foreach(QString field, fields) here.meta << item->getText(field, "");
+            rows << here;
+            break;
+
+        case Intervals:
+            foreach(IntervalItem *interval, item->intervals()) {
+                here.name = interval->name;
+                here.type = int(interval->type);
+                here.values.resize(indexes.count());
+                for (int i=0; i<indexes.count(); i++) here.values[i] = interval->metrics().value(indexes[i], 0);
+                rows << here;
+            }
+            break;
+
+        case Samples:
+            path = item->path;
+            rows << here;
+            break;
+        }
+    }
+}
+
+void
+MetricExport::runExport(MetricExport *exporter)
+{
+    if (exporter->content == Samples) exporter->ok = exporter->writeSamples();
+    else exporter->ok = exporter->write();
+}
+
+void
+MetricExport::done()
+{
+    file.close();
+    rows.clear();
+    emit finished(ok);
+}
+
+bool
+MetricExport::write()
+{
+    header();
+    for (int i=0; i<rows.count(); i++) {
+
+        if (cancelled) return false;
+
+        row(rows[i]);
+        if (!flush()) return false;
+
+        if (i % 256 == 0) emit progress((100 * i) / rows.count());
+    }
+    footer();
+    emit progress(100);
+    return flush(true);
+}
+
+bool
+MetricExport::writeSamples()
+{
+    header();
+    for (int i=0; i<rows.count(); i++) {
+
+        if (cancelled) return false;
+
+        // same as RideItem::ride() but on this thread and not kept
+        QStringList errors;
+        QFile rideFile(path + "/" + rows[i].fileName);
+        RideFile *ride = RideFileFactory::instance().openRideFile(context, rideFile, errors);
+        if (ride) {
+
+            ExportRow sample = rows[i];
+            sample.values.resize(indexes.count());
+            foreach(RideFilePoint *p, ride->dataPoints()) {
+                for (int j=0; j<indexes.count(); j++)
+                    sample.values[j] = p->value(static_cast<RideFile::SeriesType>(indexes[j]));
+                row(sample);
+                if (!flush()) {
+                    delete ride;
+                    return false;
+                }
+            }
+            delete ride;
+        }
+
+        // rides in a group of their own
+        if (format == Columnar && group.count()) writeGroup();
+
+        emit progress((100 * (i+1)) / rows.count());
+    }
+    footer();
+    return flush(true);
+}
+
+bool
+MetricExport::flush(bool all)
+{
+    if (buffer.length() < BLOCKSIZE && !all) return true;
+
+    bool written = file.write(buffer) == buffer.length();
+    buffer.truncate(0);
+    if (!written) error = file.errorString();
+    return written;
+}
+
+void
+MetricExport::header()
+{
+    switch (format) {
+    case CSV:
+        // as it's always been, so spreadsheets that read it still do
+        buffer.append("date, time, filename");
+        if (content == Intervals) buffer.append(", interval, type");
+        foreach(QString heading, headings) {
+            buffer.append(", ");
+            buffer.append(heading.toUtf8());
+        }
+        foreach(QString field, fields) {
+            buffer.append(", ");
+            buffer.append(field.toUtf8());
+        }
+        buffer.append('\n');
+        break;
+
+    case JSONL:
+        // every line is self describing
+        break;
+
+    case Columnar:
+        {
+            QStringList names;
+            QByteArray types;
+            names << "time" << "filename";
+            types.append(char(2)).append(char(1));
+            if (content == Intervals) {
+                names << "interval" << "type";
+                types.append(char(1)).append(char(0));
+            }
+            foreach(QString key, keys) {
+                names << key;
+                types.append(char(0));
+            }
+            foreach(QString field, fields) {
+                names << field;
+                types.append(char(1));
+            }
+
+            buffer.append("GCCOLS01");
+            quint32 count = qToLittleEndian(quint32(names.count()));
+            buffer.append(reinterpret_cast<const char*>(&count), 4);
+            for (int i=0; i<names.count(); i++) {
+                QByteArray name = names[i].toUtf8();
+                quint32 length = qToLittleEndian(quint32(name.length()));
+                buffer.append(reinterpret_cast<const char*>(&length), 4);
+                buffer.append(name);
+                buffer.append(types[i]);
+            }
+        }
+        break;
+    }
+}
+
+void
+MetricExport::row(const ExportRow &row)
+{
+    switch (format) {
+    case CSV: csv(row); break;
+    case JSONL: jsonl(row); break;
+    case Columnar:
+        group << row;
+        if (group.count() >= GROUPSIZE) writeGroup();
+        break;
+    }
+}
+
+void
+MetricExport::footer()
+{
+    if (format == Columnar) {
+        if (group.count()) writeGroup();
+        quint32 end = 0;
+        buffer.append(reinterpret_cast<const char*>(&end), 4);
+    }
+}
+
+void
+MetricExport::value(double v)
+{
+    char number[40];
+    buffer.append(number, formatNumber(v, number));
+}
+
+void
+MetricExport::text(const QString &value, bool json)
+{
+    QByteArray utf8 = value.toUtf8();
+    buffer.append('"');
+    for (int i=0; i<utf8.length(); i++) {
+        char c = utf8[i];
+        if (json) {
+            switch (c) {
+            case '"': buffer.append("\\\""); break;
+            case '\\': buffer.append("\\\\"); break;
+            case '\n': buffer.append("\\n"); break;
+            case '\r': buffer.append("\\r"); break;
+            case '\t': buffer.append("\\t"); break;
+            default:
+                if (uchar(c) < 0x20) buffer.append(QString("\\u%1").arg(int(c), 4, 16, QChar('0')).toLatin1());
+                else buffer.append(c);
+            }
+        } else {
+            if (c == '"') buffer.append("\"\"");
+            else buffer.append(c);
+        }
+    }
+    buffer.append('"');
+}
+
+void
+MetricExport::csv(const ExportRow &row)
+{
+    buffer.append(row.when.date().toString("MM/dd/yy").toLatin1());
+    buffer.append(',');
+    buffer.append(row.when.time().toString("hh:mm:ss").toLatin1());
+    buffer.append(',');
+    buffer.append(row.fileName.toUtf8());
+
+    if (content == Intervals) {
+        buffer.append(',');
+        text(row.name, false);
+        buffer.append(',');
+        value(row.type);
+    }
+    foreach(double v, row.values) {
+        buffer.append(',');
+        value(v);
+    }
+    foreach(QString field, row.meta) {
+        buffer.append(',');
+        text(field, false);
+    }
+    buffer.append('\n');
+}
+
+void
+MetricExport::jsonl(const ExportRow &row)
+{
+    buffer.append("{\"date\":\"");
+    buffer.append(row.when.date().toString("yyyy-MM-dd").toLatin1());
+    buffer.append("\",\"time\":\"");
+    buffer.append(row.when.time().toString("hh:mm:ss").toLatin1());
+    buffer.append("\",\"filename\":");
+    text(row.fileName, true);
+
+    if (content == Intervals) {
+        buffer.append(",\"interval\":");
+        text(row.name, true);
+        buffer.append(",\"type\":");
+        value(row.type);
+    }
+    for (int i=0; i<row.values.count(); i++) {
+        buffer.append(",\"");
+        buffer.append(keys[i].toUtf8());
+        buffer.append("\":");
+        if (std::isnan(row.values[i]) || std::isinf(row.values[i])) buffer.append("null");
+        else value(row.values[i]);
+    }
+    for (int i=0; i<row.meta.count(); i++) {
+        buffer.append(',');
+        text(fields[i], true);
+        buffer.append(':');
+        text(row.meta[i], true);
+    }
+    buffer.append("}\n");
+}
+
+void
+MetricExport::writeGroup()
+{
+    // see the header for the layout
+    quint32 count = qToLittleEndian(quint32(group.count()));
+    buffer.append(reinterpret_cast<const char*>(&count), 4);
+
+    foreach(const ExportRow &row, group) {
+        qint64 secs = qToLittleEndian(qint64(row.when.toUTC().toMSecsSinceEpoch() / 1000));
+        buffer.append(reinterpret_cast<const char*>(&secs), 8);
+    }
+
+    QList<QStringList> texts;
+    QStringList names;
+    foreach(const ExportRow &row, group) names << row.fileName;
+    texts << names;
+    if (content == Intervals) {
+        names.clear();
+        foreach(const ExportRow &row, group) names << row.name;
+        texts << names;
+    }
+    foreach(const QStringList &column, texts) {
+        foreach(QString value, column) {
+            QByteArray utf8 = value.toUtf8();
+            quint32 length = qToLittleEndian(quint32(utf8.length()));
+            buffer.append(reinterpret_cast<const char*>(&length), 4);
+            buffer.append(utf8);
+        }
+    }
+
+    // numbers a column at a time
+    int columns = indexes.count() + (content == Intervals ? 1 : 0);
+    for (int c=0; c<columns; c++) {
+        foreach(const ExportRow &row, group) {
+            double v;
+            if (content == Intervals) v = c == 0 ? row.type : row.values[c-1];
+            else v = row.values[c];
+
+            quint64 bits;
+            memcpy(&bits, &v, 8);
+            bits = qToLittleEndian(bits);
+            buffer.append(reinterpret_cast<const char*>(&bits), 8);
+        }
+    }
+
+    for (int f=0; f<fields.count() && content == Activities; f++) {
+        foreach(const ExportRow &row, group) {
+            QByteArray utf8 = row.meta.value(f).toUtf8();
+            quint32 length = qToLittleEndian(quint32(utf8.length()));
+            buffer.append(reinterpret_cast<const char*>(&length), 4);
+            buffer.append(utf8);
+        }
+    }
+    group.clear();
+}
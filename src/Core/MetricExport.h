@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2020 GoldenCheetah contributors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_MetricExport_h
+#define _GC_MetricExport_h 1
+#include "GoldenCheetah.h"
+
+#include <QObject>
+#include <QFile>
+#include <QDateTime>
+#include <QStringList>
+#include <QVector>
+#include <QByteArray>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QAtomicInt>
+
+#include "Specification.h"
+#include "RideFile.h"
+
+class Context;
+
+// one line of output, the values are in the order of the columns
+struct ExportRow {
+    QDateTime when;
+    QString fileName;
+    QString name;               // interval name, intervals only
+    int type;                   // interval type, intervals only
+    QVector<double> values;
+    QStringList meta;           // metadata fields, activities only
+};
+
+//
+// Bulk export of metrics, intervals or samples for the rides that
+// pass a date range and filter, written as CSV, JSON lines or a
+// simple columnar binary.
+//
+// Everything that needs the ride cache is copied on the GUI thread
+// when the export is started, it's just a copy of the values asked
+// for so it's quick. Formatting and writing them, which is where the
+// time goes, is then done on a background thread with progress as it
+// goes. Sample exports open each ride file on the background thread.
+//
+// Numbers are formatted directly into a buffer rather than through
+// QString and the file is written in large blocks.
+//
+// The columnar format is a row group at a time, each column stored
+// contiguously within the group, little endian:
+//
+//     "GCCOLS01" columns:u32 { name:utf8 type:u8 }*
+//     { rows:u32 { column values }* }* 0:u32
+//
+// where numbers are f64, text is u32 length and utf8 bytes, and times
+// are i64 seconds since the epoch, UTC. It reads straight into numpy
+// or an Arrow table without parsing any text.
+//
+class MetricExport : public QObject
+{
+    Q_OBJECT
+
+    public:
+
+        enum { CSV, JSONL, Columnar };
+        enum { Activities, Intervals, Samples };
+
+        MetricExport(Context *context);
+        ~MetricExport();
+
+        // what and how, defaults to CSV of all the metrics for all activities
+        void setFormat(int format) { this->format = format; }
+        void setContent(int content) { this->content = content; }
+        void setSpecification(Specification spec) { this->spec = spec; }
+
+        // metric symbols, all of them if empty
+        void setSymbols(QStringList symbols) { this->symbols = symbols; }
+        void setMetadata(QStringList fields) { this->fields = fields; }
+
+        // series for samples, the common ones if empty; not all of
+        // them have a symbol so they're passed as they are
+        void setSeries(QList<RideFile::SeriesType> series) { this->series = series; }
+
+        // copies what is needed and starts writing in the background,
+        // false if the file cannot be opened
+        bool start(QString filename);
+        void wait() { future.waitForFinished(); }
+        bool isRunning() { return future.isRunning(); }
+        bool isCancelled() const { return cancelled != 0; }
+        QString errorString() const { return error; }
+        QString fileName() const { return file.fileName(); }
+
+        // value as text, the same as "%g" but quicker and without
+        // the locale; returns how many characters were written
+        static int formatNumber(double value, char *buffer);
+        static QByteArray number(double value);
+
+        // file suffix and dialog filter for each format
+        static QString suffix(int format);
+        static QStringList filters();
+
+    public slots:
+
+        void cancel() { cancelled = 1; }
+
+    signals:
+
+        void progress(int percent);
+        void finished(bool ok);
+
+    private slots:
+
+        void done();
+
+    private:
+
+        Context *context;
+        int format, content;
+        Specification spec;
+        QStringList symbols, fields;
+        QList<RideFile::SeriesType> series;
+
+        // columns and rows copied at the start
+        QStringList headings, keys;     // display names and symbols
+        QVector<int> indexes;           // metric index or series type
+        QList<ExportRow> rows;
+        QString path;                   // of the activities, for samples
+
+        QFile file;
+        QString error;
+        QAtomicInt cancelled;
+        bool ok;
+
+        QFuture<void> future;
+        QFutureWatcher<void> watcher;
+
+        void collect();
+        static void runExport(MetricExport *exporter);
+        bool write();
+        bool writeSamples();
+
+        // writing, through a buffer flushed as it fills
+        QByteArray buffer;
+        bool flush(bool all=false);
+        void header();
+        void row(const ExportRow &row);
+        void footer();
+
+        void csv(const ExportRow &row);
+        void jsonl(const ExportRow &row);
+        void text(const QString &value, bool json);
+        void value(double v);
+
+        // columnar row groups
+        QList<ExportRow> group;
+        void writeGroup();
+};
+
+#endif
@@ -25,6 +25,12 @@
 #include "Specification.h"
 #include "DataProcessor.h"
 #include "Estimator.h"
+#include "FreeSearch.h"
+#include "RideIndex.h"
+#include "RideSnapshot.h"
+#include "RideSimilarity.h"
+#include "RideResidency.h"
+#include "Settings.h"
 
 #include "Route.h"
 
@@ -49,7 +55,7 @@
 bool rideCacheGreaterThan(const RideItem *a, const RideItem *b) { return a->dateTime > b->dateTime; }
 bool rideCacheLessThan(const RideItem *a, const RideItem *b) { return a->dateTime < b->dateTime; }
 
-RideCache::RideCache(Context *context) : context(context)
+RideCache::RideCache(Context *context) : context(context), searchIndex_(NULL), rideIndex_(NULL), snapshots_(NULL), similarity_(NULL), residency_(NULL), version_(0), compiledVersion(0)
 {
     directory = context->athlete->home->activities();
     plannedDirectory = context->athlete->home->planned();
@@ -58,6 +64,9 @@ RideCache::RideCache(Context *context) : context(context)
     exiting = false;
     estimator = new Estimator(context);
 
+    // closes rides nobody is using when they take too much memory
+    residency_ = new RideResidency(context, this);
+
     // initial load of user defined metrics - do once we have an initial context
     // but before we refresh or check metrics for the first time
     if (UserMetricSchemaVersion == 0) {
@@ -133,6 +142,9 @@ RideCache::RideCache(Context *context) : context(context)
     // set model once we have the basics
     model_ = new RideCacheModel(context, this);
 
+    // optional sqlite index, updated as each refresh completes
+    if (appsettings->cvalue(context->athlete->cyclist, GC_RIDEINDEX, false).toBool()) openRideIndex();
+
     // after the first ridecache refresh we set initial pd estimates
     first= true;
     connect(context, SIGNAL(refreshEnd()), this, SLOT(initEstimates()));
@@ -140,11 +152,16 @@ RideCache::RideCache(Context *context) : context(context)
     // now refresh just in case.
     refresh();
 
+    // created here on the GUI thread, not when first asked for; that
+    // may be from a python script. routes wait until the refresh ends
+    similarity_ = new RideSimilarity(context, this);
+
     // do we have any stale items ?
     connect(context, SIGNAL(configChanged(qint32)), this, SLOT(configChanged(qint32)));
 
 
     // future watching
+    connect(&watcher, SIGNAL(finished()), this, SLOT(bumpVersion()));
     connect(&watcher, SIGNAL(finished()), this, SLOT(garbageCollect()));
     connect(&watcher, SIGNAL(finished()), this, SLOT(save()));
     connect(&watcher, SIGNAL(finished()), context, SLOT(notifyRefreshEnd()));
@@ -161,6 +178,32 @@ RideCache::~RideCache()
 
     // save to store
     save();
+
+    if (searchIndex_) delete searchIndex_;
+    if (snapshots_) delete snapshots_;
+    if (similarity_) delete similarity_;
+    delete residency_;
+    residency_ = NULL;
+}
+
+FreeSearchIndex *
+RideCache::searchIndex()
+{
+    if (searchIndex_ == NULL) searchIndex_ = new FreeSearchIndex(this);
+    return searchIndex_;
+}
+
+RideSnapshots *
+RideCache::snapshots()
+{
+    if (snapshots_ == NULL) snapshots_ = new RideSnapshots(context, this);
+    return snapshots_;
+}
+
+RideSimilarity *
+RideCache::similarity()
+{
+    return similarity_;
 }
 
 void
@@ -182,9 +225,27 @@ RideCache::initEstimates()
     }
 }
 
+void
+RideCache::openRideIndex()
+{
+    rideIndex_ = new RideIndex(context, this);
+    if (rideIndex_->isOpen()) connect(&watcher, SIGNAL(finished()), rideIndex_, SLOT(update()));
+}
+
 void
 RideCache::configChanged(qint32 what)
 {
+    // the ride index was turned on or off, the refresh
+    // below brings a new one up to date when it ends
+    if (what & CONFIG_GENERAL) {
+        bool indexed = appsettings->cvalue(context->athlete->cyclist, GC_RIDEINDEX, false).toBool();
+        if (indexed && rideIndex_ == NULL) openRideIndex();
+        else if (!indexed && rideIndex_) {
+            delete rideIndex_;
+            rideIndex_ = NULL;
+        }
+    }
+
     // if the wbal formula changed invalidate all cached values
     if (what & CONFIG_WBAL) {
         foreach(RideItem *item, rides()) {
@@ -218,6 +279,9 @@ RideCache::itemChanged()
     // BECAUSE IT IS ASSUMED BELOW THE SENDER IS A RIDEITEM
     RideItem *item = static_cast<RideItem*>(QObject::sender());
 
+    // dates, names and sport may have changed
+    bumpVersion();
+
     // the model is particularly interested in ANY item that changes
     emit itemChanged(item);
 
@@ -268,6 +332,7 @@ RideCache::addRide(QString name, bool dosignal, bool select, bool useTempActivit
         qSort(rides_.begin(), rides_.end(), rideCacheLessThan);
         model_->endReset();
     }
+    bumpVersion();
 
     // refresh metrics for *this ride only*
     last->refresh();
@@ -336,6 +401,7 @@ RideCache::removeCurrentRide()
     model_->startRemove(index);
     rides_.remove(index, 1);
     delete_<<todelete;
+    bumpVersion();
     model_->endRemove(index);
 
     // delete the file by renaming it
@@ -356,10 +422,11 @@ RideCache::removeCurrentRide()
 
     // remove any other derived/additional files; notes, cpi etc (they can only exist in /cache )
     QStringList extras;
-    extras << "notes" << "cpi" << "cpx";
+    extras << "notes" << "cpi" << "cpx" << "trk";
     foreach (QString extension, extras) {
 
         QString deleteMe = QFileInfo(strOldFileName).baseName() + "." + extension;
+        if (extension == "cpx") RideFileCacheMap::instance().invalidate(context->athlete->home->cache().canonicalPath() + "/" + deleteMe);
         QFile::remove(context->athlete->home->cache().canonicalPath() + "/" + deleteMe);
 
     }
@@ -389,61 +456,6 @@ RideCache::removeCurrentRide()
 // overhead and (believe it or not) simplicity
 // RideCache::load() and save() -- see RideDB.y
 
-// export metrics to csv, for users to play with R, Matlab, Excel etc
-void
-RideCache::writeAsCSV(QString filename)
-{
-    const RideMetricFactory &factory = RideMetricFactory::instance();
-    QVector<const RideMetric *> indexed(factory.metricCount());
-
-    // get metrics indexed in same order as the array
-    foreach(QString name, factory.allMetrics()) {
-
-        const RideMetric *m = factory.rideMetric(name);
-        indexed[m->index()] = m;
-    }
-
-    // open file.. truncate if exists already
-    QFile file(filename);
-    if (!file.open(QFile::WriteOnly)) {
-        QMessageBox msgBox;
-        msgBox.setIcon(QMessageBox::Critical);
-        msgBox.setText(tr("Problem Saving Ride Cache"));
-        msgBox.setInformativeText(tr("File: %1 cannot be opened for 'Writing'. Please check file properties.").arg(filename));
-        msgBox.exec();
-        return;
-    };
-    file.resize(0);
-    QTextStream out(&file);
-
-    // write headings
-    out<<"date, time, filename";
-    foreach(const RideMetric *m, indexed) {
-        if (m->name().startsWith("BikeScore"))
-            out <<", BikeScore";
-        else
-            out <<", " <<m->name();
-    }
-    out<<"\n";
-
-    // write values
-    foreach(RideItem *item, rides()) {
-
-        // date, time, filename
-        out << item->dateTime.date().toString("MM/dd/yy");
-        out << "," << item->dateTime.time().toString("hh:mm:ss");
-        out << "," << item->fileName;
-
-        // values
-        foreach(double value, item->metrics()) {
-            out << "," << QString("%1").arg(value, 'f').simplified();
-        }
-
-        out<<"\n";
-    }
-    file.close();
-}
-
 void
 itemRefresh(RideItem *&item)
 {
@@ -517,6 +529,53 @@ RideCache::refresh()
     }
 }
 
+QBitArray
+RideCache::passing(Specification specification)
+{
+    QMutexLocker locker(&compiledLock);
+
+    // ride list changed, so start again
+    if (compiledVersion != version_ || runs_.size() != rides_.count()) {
+        compiled.clear();
+        compiledVersion = version_;
+
+        runs_ = QBitArray(rides_.count());
+        swims_ = QBitArray(rides_.count());
+        for (int i=0; i<rides_.count(); i++) {
+            if (rides_[i]->isRun) runs_.setBit(i);
+            if (rides_[i]->isSwim) swims_.setBit(i);
+        }
+    }
+
+    DateRange dr = specification.dateRange();
+    FilterSet fs = specification.filterSet();
+
+    // already compiled ? comparing sets is cheap when they
+    // share data, which they will when the filterset was copied
+    foreach(const CompiledSpecification &c, compiled) {
+        if (c.from == dr.from && c.to == dr.to && c.filtered == (fs.count() > 0) &&
+            c.signature == fs.signature() && c.matches == fs.matches())
+            return c.bits;
+    }
+
+    // compile it
+    CompiledSpecification add;
+    add.from = dr.from;
+    add.to = dr.to;
+    add.filtered = fs.count() > 0;
+    add.signature = fs.signature();
+    add.matches = fs.matches();
+    add.bits = QBitArray(rides_.count());
+    for (int i=0; i<rides_.count(); i++)
+        if (specification.pass(rides_[i])) add.bits.setBit(i);
+
+    // charts use a handful at a time
+    if (compiled.count() >= 32) compiled.removeFirst();
+    compiled << add;
+
+    return add.bits;
+}
+
 QString
 RideCache::getAggregate(QString name, Specification spec, bool useMetricUnits, bool nofmt)
 {
@@ -532,10 +591,12 @@ RideCache::getAggregate(QString name, Specification spec, bool useMetricUnits, b
     double rcount = 0; // using double to avoid rounding issues with int when dividing
 
     // loop through and aggregate
-    foreach (RideItem *item, rides()) {
+    QBitArray pass = passing(spec);
+    for (int i=0; i<rides_.count() && i<pass.size(); i++) {
 
         // skip filtered rides
-        if (!spec.pass(item)) continue;
+        if (!pass.testBit(i)) continue;
+        RideItem *item = rides_[i];
 
         // get this value
         double value = item->getForSymbol(name);
@@ -629,10 +690,12 @@ RideCache::getBests(QString symbol, int n, Specification specification, bool use
     if (!metric) return results;
 
     // loop through and aggregate
-    foreach (RideItem *ride, rides_) {
+    QBitArray pass = passing(specification);
+    for (int i=0; i<rides_.count() && i<pass.size(); i++) {
 
         // skip filtered rides
-        if (!specification.pass(ride)) continue;
+        if (!pass.testBit(i)) continue;
+        RideItem *ride = rides_[i];
 
         // get this value
         AthleteBest add;
@@ -748,19 +811,19 @@ void
 RideCache::getRideTypeCounts(Specification specification, int& nActivities,
                              int& nRides, int& nRuns, int& nSwims)
 {
-    nActivities = nRides = nRuns = nSwims = 0;
-
-    // loop through and aggregate
-    foreach (RideItem *ride, rides_) {
+    // count the compiled bitsets
+    QBitArray pass = passing(specification);
 
-        // skip filtered rides
-        if (!specification.pass(ride)) continue;
-
-        nActivities++;
-        if (ride->isSwim) nSwims++;
-        else if (ride->isRun) nRuns++;
-        else nRides++;
+    QMutexLocker locker(&compiledLock);
+    if (pass.size() != runs_.size()) {
+        nActivities = nRides = nRuns = nSwims = 0;
+        return;
     }
+
+    nActivities = pass.count(true);
+    nSwims = (pass & swims_).count(true);
+    nRuns = (pass & runs_ & ~swims_).count(true);
+    nRides = nActivities - nSwims - nRuns;
 }
 
 bool
@@ -769,10 +832,12 @@ RideCache::isMetricRelevantForRides(Specification specification,
                                     SportRestriction sport)
 {
     // loop through and aggregate
-    foreach (RideItem *ride, rides_) {
+    QBitArray pass = passing(specification);
+    for (int i=0; i<rides_.count() && i<pass.size(); i++) {
 
         // skip filtered rides
-        if (!specification.pass(ride)) continue;
+        if (!pass.testBit(i)) continue;
+        RideItem *ride = rides_[i];
 
         // skip non selected sports when restriction supplied
         if ((sport == OnlyRides) && (ride->isSwim || ride->isRun)) continue;
@@ -27,6 +27,8 @@
 
 #include <QVector>
 #include <QThread>
+#include <QBitArray>
+#include <QMutex>
 
 #include <QFuture>
 #include <QFutureWatcher>
@@ -42,6 +44,11 @@ class Specification;
 class AthleteBest;
 class RideCacheModel;
 class Estimator;
+class FreeSearchIndex;
+class RideIndex;
+class RideSnapshots;
+class RideSimilarity;
+class RideResidency;
 
 class RideCache : public QObject
 {
@@ -72,6 +79,12 @@ class RideCache : public QObject
         QHash<QString,int> getRankedValues(QString name); // metadata
         QStringList getDistinctValues(QString name); // metadata
 
+        // the rides that pass a specification as a bitset indexed as rides()
+        // compiled once and cached until the ride list changes (see version)
+        QBitArray passing(Specification specification);
+        int count(Specification specification) { return passing(specification).count(true); }
+        unsigned long version() const { return version_; }
+
         // Count of activities matching specification
         void getRideTypeCounts(Specification specification, int& nActivities,
                                int& nRides, int& nRuns, int& nSwims);
@@ -91,8 +104,20 @@ class RideCache : public QObject
         void addRide(QString name, bool dosignal, bool select, bool useTempActivities, bool planned);
         void removeCurrentRide();
 
-        // export metrics in CSV format
-        void writeAsCSV(QString filename);
+        // metadata and interval names for free text search
+        FreeSearchIndex *searchIndex();
+
+        // sqlite index for pushing down predicates, NULL unless enabled
+        RideIndex *rideIndex() { return rideIndex_; }
+
+        // what the overview cards show for each ride
+        RideSnapshots *snapshots();
+
+        // finding the rides most like another
+        RideSimilarity *similarity();
+
+        // keeps the ride data that is open within budget
+        RideResidency *residency() { return residency_; }
 
         // the background refresher !
         void refresh();
@@ -122,6 +147,9 @@ class RideCache : public QObject
         // first run to initialise estimates
         void initEstimates();
 
+        // ride list, dates or sport changed so compiled specifications are stale
+        void bumpVersion() { version_++; }
+
     signals:
 
         void modelProgress(int, int); // let others know when we're refreshing the model estimates
@@ -148,6 +176,26 @@ class RideCache : public QObject
 
         Estimator *estimator;
         bool first; // updated when estimates are marked stale
+
+        FreeSearchIndex *searchIndex_;
+        RideIndex *rideIndex_;
+        void openRideIndex();
+        RideSnapshots *snapshots_;
+        RideSimilarity *similarity_;
+        RideResidency *residency_;
+
+        // compiled specifications, see passing()
+        struct CompiledSpecification {
+            QDate from, to;
+            uint signature;
+            bool filtered;
+            QSet<QString> matches;
+            QBitArray bits;
+        };
+        unsigned long version_, compiledVersion;
+        QList<CompiledSpecification> compiled;
+        QBitArray runs_, swims_;
+        QMutex compiledLock;
 };
 
 class AthleteBest
@@ -62,13 +62,29 @@ RideCacheModel::flags(const QModelIndex &index) const
 QVariant 
 RideCacheModel::data(const QModelIndex &index, int role) const
 {
-    Q_UNUSED(role);
-
     if (!index.isValid() || index.row() < 0 || index.row() >= rideCache->count() ||
         index.column() < 0 || index.column() >= columns_) return QVariant();
 
     RideItem *item = rideCache->rides()[index.row()];
 
+    // raw sort keys, straight from the item without any formatting
+    if (role == SortRole && index.column() > 5) {
+
+        if (index.column()-5 < factory->metricCount()) {
+
+            const RideMetric *m = factory->rideMetric(factory->metricName(index.column()-5));
+            return item->metrics_.value(m->index());
+
+        } else {
+
+            const FieldDefinition &field = metadata[index.column() -5 - factory->metricCount()];
+            QString text = item->getText(field.name, "");
+
+            if (field.type == FIELD_INTEGER || field.type == FIELD_DOUBLE) return text.toDouble();
+            return text;
+        }
+    }
+
     switch (index.column()) {
         case 0 : return item->path;
         case 1 : return item->fileName;
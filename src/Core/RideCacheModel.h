@@ -40,6 +40,11 @@ class RideCacheModel : public QAbstractTableModel
     public:
         RideCacheModel(Context *, RideCache *);
 
+        // data() for this role returns the raw value to sort on; metrics
+        // as unconverted doubles, dates as QDateTime and numeric metadata
+        // as doubles, so sorting doesn't need to format and parse strings
+        enum { SortRole = Qt::UserRole + 16 };
+
         // must reimplement these
         int rowCount(const QModelIndex &parent = QModelIndex()) const; 
         int columnCount(const QModelIndex &parent = QModelIndex()) const;
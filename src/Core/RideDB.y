@@ -811,6 +811,7 @@ void RideCache::save(bool opendata, QString filename)
 
 #ifdef GC_WANT_HTTP
 #include "RideMetadata.h"
+#include "RideIndex.h"
 
 void
 APIWebService::listRides(QString athlete, HttpRequest &request, HttpResponse &response)
@@ -841,6 +842,56 @@ APIWebService::listRides(QString athlete, HttpRequest &request, HttpResponse &re
 
     // write headings
     const RideMetricFactory &factory = RideMetricFactory::instance();
+
+    // where parameter, e.g. where=TSS>100,Workout_Code=Race is pushed
+    // down to the ride index, so it needs to have been enabled
+    settings.filtered = false;
+    QString wherep(request.getParameter("where"));
+    if (wherep != "") {
+
+        QString where;
+        QVariantList binds;
+        QRegExp predicate("^([^<>=!]+)(<=|>=|!=|=|<|>)(.*)$");
+
+        foreach(QString clause, wherep.split(",")) {
+
+            if (!predicate.exactMatch(clause.trimmed())) {
+                response.setStatus(500);
+                response.write("malformed where clause; expected name<op>value.\n");
+                return;
+            }
+            QString name = predicate.cap(1).trimmed();
+            QString op = predicate.cap(2);
+            QString value = predicate.cap(3).trimmed();
+
+            // metric by symbol or name, otherwise metadata
+            QString symbol;
+            if (factory.haveMetric(name)) symbol = name;
+            else {
+                foreach(QString metric, factory.allMetrics()) {
+                    if (factory.rideMetric(metric)->name().replace(" ","_") == name) symbol = metric;
+                }
+            }
+
+            if (where != "") where += " AND ";
+            if (symbol != "") where += RideIndex::metricPredicate(symbol, op, value.toDouble(), binds);
+            else where += RideIndex::metaPredicate(name.replace("_"," "), op, value, binds);
+        }
+
+        // honour since and before too
+        QString sincep(request.getParameter("since"));
+        if (sincep != "") where += " AND " + RideIndex::datePredicate(">=", QDate::fromString(sincep,"yyyy/MM/dd"), binds);
+        QString beforep(request.getParameter("before"));
+        if (beforep != "") where += " AND " + RideIndex::datePredicate("<=", QDate::fromString(beforep,"yyyy/MM/dd"), binds);
+
+        QString index = QString("%1/%2/cache/%3").arg(home.absolutePath()).arg(athlete).arg(RideIndex::filename());
+        if (!RideIndex::filenames(index, where, binds, settings.passing)) {
+            response.setStatus(500);
+            response.write("where clauses need the ride index, which is not enabled for this athlete.\n");
+            return;
+        }
+        settings.filtered = true;
+    }
     QVector<const RideMetric *> indexed(factory.metricCount());
 
     // get metrics indexed in same order as the array
@@ -1028,6 +1079,9 @@ APIWebService::listRides(QString athlete, HttpRequest &request, HttpResponse &re
             // is it a backup ?
             if (name.endsWith(".bak")) continue;
 
+            // matches where= ?
+            if (settings.filtered && !settings.passing.contains(name)) continue;
+
             // out a line
             response.bwrite(dateTime.date().toString("yyyy/MM/dd").toLocal8Bit());
             response.bwrite(", ");
@@ -0,0 +1,401 @@
+/*
+ * Copyright (c) 2020 GoldenCheetah contributors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RideIndex.h"
+#include "Athlete.h"
+#include "Context.h"
+#include "RideCache.h"
+#include "RideItem.h"
+#include "IntervalItem.h"
+#include "RideMetric.h"
+
+#include <QUuid>
+
+// DB Schema Version - YOU MUST UPDATE THIS IF THE RIDE INDEX SCHEMA CHANGES
+static int RideIndexSchemaVersion = 1;
+
+// dates are held as days since 1900/01/01, the same as the data filter
+static const QDate epoch(1900,01,01);
+
+RideIndex::RideIndex(Context *context, RideCache *cache) : QObject(cache), context(context), rideCache(cache),
+                                                           open(false), current(false)
+{
+    // one connection per athlete
+    sessionid = QString("rideindex-%1").arg(context->athlete->cyclist);
+
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", sessionid);
+    db.setDatabaseName(context->athlete->home->cache().canonicalPath() + "/" + filename());
+
+    if (!db.open()) {
+        qDebug()<<"ride index: unable to open"<<db.databaseName()<<db.lastError().text();
+    } else {
+        open = createDatabase();
+    }
+
+    // stay in step with the cache
+    connect(cache, SIGNAL(itemChanged(RideItem*)), this, SLOT(itemChanged(RideItem*)));
+    connect(context, SIGNAL(rideAdded(RideItem*)), this, SLOT(itemChanged(RideItem*)));
+    connect(context, SIGNAL(rideDeleted(RideItem*)), this, SLOT(rideDeleted(RideItem*)));
+    connect(context, SIGNAL(refreshStart()), this, SLOT(refreshStart()));
+}
+
+RideIndex::~RideIndex()
+{
+    {
+        // connection must go out of scope before removing it
+        QSqlDatabase db = connection();
+        if (db.isOpen()) db.close();
+    }
+    QSqlDatabase::removeDatabase(sessionid);
+}
+
+bool
+RideIndex::createDatabase()
+{
+    QSqlDatabase db = connection();
+    QSqlQuery query(db);
+
+    // check the schema version, if its old we start over
+    // it is only an index, the ride cache is the master
+    int version = 0;
+    if (query.exec("SELECT schema_version FROM version WHERE table_name = 'rides';") && query.next())
+        version = query.value(0).toInt();
+
+    if (version == RideIndexSchemaVersion) return true;
+
+    QStringList tables;
+    tables << "version" << "rides" << "metrics" << "metadata" << "intervals" << "intervalmetrics";
+    foreach(QString table, tables) query.exec(QString("DROP TABLE IF EXISTS %1;").arg(table));
+
+    QStringList create;
+    create << "CREATE TABLE version (table_name varchar primary key,"
+              "schema_version integer,"
+              "creation_date integer);"
+
+           // signature is the fingerprint and crcs, if they're the same the ride is too
+           << "CREATE TABLE rides (filename varchar primary key,"
+              "date integer,"
+              "datetime varchar,"
+              "isrun integer,"
+              "isswim integer,"
+              "planned integer,"
+              "signature varchar);"
+           << "CREATE INDEX rides_date ON rides (date);"
+
+           // values as the data filter sees them, i.e. metric units
+           << "CREATE TABLE metrics (filename varchar,"
+              "symbol varchar,"
+              "value double,"
+              "primary key (filename, symbol));"
+           << "CREATE INDEX metrics_value ON metrics (symbol, value);"
+
+           << "CREATE TABLE metadata (filename varchar,"
+              "field varchar,"
+              "value varchar,"
+              "primary key (filename, field));"
+           << "CREATE INDEX metadata_value ON metadata (field, value);"
+
+           << "CREATE TABLE intervals (filename varchar,"
+              "seq integer,"
+              "name varchar,"
+              "type integer,"
+              "start double,"
+              "stop double,"
+              "primary key (filename, seq));"
+
+           << "CREATE TABLE intervalmetrics (filename varchar,"
+              "seq integer,"
+              "symbol varchar,"
+              "value double,"
+              "primary key (filename, seq, symbol));"
+           << "CREATE INDEX intervalmetrics_value ON intervalmetrics (symbol, value);";
+
+    foreach(QString sql, create) {
+        if (!query.exec(sql)) {
+            qDebug()<<"ride index: create failed"<<query.lastError().text();
+            return false;
+        }
+    }
+
+    query.prepare("INSERT INTO version (table_name, schema_version, creation_date) values (?,?,?);");
+    query.addBindValue("rides");
+    query.addBindValue(RideIndexSchemaVersion);
+    query.addBindValue(QDateTime::currentDateTime().toTime_t());
+    return query.exec();
+}
+
+QString
+RideIndex::signature(RideItem *item)
+{
+    return QString("%1:%2:%3:%4").arg(item->fingerprint).arg(item->crc).arg(item->metacrc).arg(item->timestamp);
+}
+
+void
+RideIndex::itemChanged(RideItem *item)
+{
+    if (item) stale.insert(item->fileName);
+    current = false;
+}
+
+void
+RideIndex::rideDeleted(RideItem *)
+{
+    // update() removes anything no longer in the cache
+    current = false;
+}
+
+bool
+RideIndex::update()
+{
+    if (!open) return false;
+
+    QSqlDatabase db = connection();
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+
+    // what we have indexed already
+    QHash<QString, QString> indexed;
+    QSqlQuery query(db);
+    if (query.exec("SELECT filename, signature FROM rides;")) {
+        while (query.next()) indexed.insert(query.value(0).toString(), query.value(1).toString());
+    }
+    query.finish();
+
+    // one transaction for the lot, either all rides are brought
+    // up to date or none are and we will try again next time
+    if (!db.transaction()) return false;
+
+    QStringList tables;
+    tables << "rides" << "metrics" << "metadata" << "intervals" << "intervalmetrics";
+    QList<QSqlQuery*> removes;
+    foreach(QString table, tables) {
+        QSqlQuery *remove = new QSqlQuery(db);
+        remove->prepare(QString("DELETE FROM %1 WHERE filename = ?;").arg(table));
+        removes << remove;
+    }
+
+    QSqlQuery ride(db), metric(db), meta(db), interval(db), intervalmetric(db);
+    ride.prepare("INSERT INTO rides (filename, date, datetime, isrun, isswim, planned, signature) values (?,?,?,?,?,?,?);");
+    metric.prepare("INSERT INTO metrics (filename, symbol, value) values (?,?,?);");
+    meta.prepare("INSERT INTO metadata (filename, field, value) values (?,?,?);");
+    interval.prepare("INSERT INTO intervals (filename, seq, name, type, start, stop) values (?,?,?,?,?,?);");
+    intervalmetric.prepare("INSERT INTO intervalmetrics (filename, seq, symbol, value) values (?,?,?,?);");
+
+    bool ok = true;
+    int rewritten = 0;
+
+    foreach(RideItem *item, rideCache->rides()) {
+
+        QString sig = signature(item);
+        bool unchanged = indexed.contains(item->fileName) && indexed.value(item->fileName) == sig
+                         && !stale.contains(item->fileName);
+        indexed.remove(item->fileName);
+        if (unchanged) continue;
+
+        // out with the old
+        foreach(QSqlQuery *remove, removes) {
+            remove->addBindValue(item->fileName);
+            ok &= remove->exec();
+        }
+
+        // in with the new
+        ride.addBindValue(item->fileName);
+        ride.addBindValue(epoch.daysTo(item->dateTime.date()));
+        ride.addBindValue(item->dateTime.toString(Qt::ISODate));
+        ride.addBindValue(item->isRun ? 1 : 0);
+        ride.addBindValue(item->isSwim ? 1 : 0);
+        ride.addBindValue(item->planned ? 1 : 0);
+        ride.addBindValue(sig);
+        ok &= ride.exec();
+
+        // metric values as the data filter would evaluate them,
+        // a metadata override is used in place of the computed value
+        QVariantList filenames, symbols, values;
+        for (int i=0; i<factory.metricCount(); i++) {
+            QString symbol = factory.metricName(i);
+            QString override = item->getText(symbol, "unknown");
+
+            filenames << item->fileName;
+            symbols << symbol;
+            values << (override == "unknown" ? item->getForSymbol(symbol) : override.toDouble());
+        }
+        metric.addBindValue(filenames);
+        metric.addBindValue(symbols);
+        metric.addBindValue(values);
+        ok &= metric.execBatch();
+
+        QMapIterator<QString,QString> it(item->metadata());
+        while (it.hasNext()) {
+            it.next();
+            meta.addBindValue(item->fileName);
+            meta.addBindValue(it.key());
+            meta.addBindValue(it.value());
+            ok &= meta.exec();
+        }
+
+        for (int seq=0; seq<item->intervals().count(); seq++) {
+
+            IntervalItem *p = item->intervals().at(seq);
+            interval.addBindValue(item->fileName);
+            interval.addBindValue(seq);
+            interval.addBindValue(p->name);
+            interval.addBindValue(static_cast<int>(p->type));
+            interval.addBindValue(p->start);
+            interval.addBindValue(p->stop);
+            ok &= interval.exec();
+
+            QVariantList filenames, seqs, symbols, values;
+            for (int i=0; i<factory.metricCount(); i++) {
+                const RideMetric *m = factory.rideMetric(factory.metricName(i));
+                if (m->index() >= p->metrics().count()) continue;
+
+                filenames << item->fileName;
+                seqs << seq;
+                symbols << factory.metricName(i);
+                values << p->metrics()[m->index()];
+            }
+            if (values.count()) {
+                intervalmetric.addBindValue(filenames);
+                intervalmetric.addBindValue(seqs);
+                intervalmetric.addBindValue(symbols);
+                intervalmetric.addBindValue(values);
+                ok &= intervalmetric.execBatch();
+            }
+        }
+
+        if (!ok) break;
+        rewritten++;
+    }
+
+    // anything left over has been deleted from the cache
+    if (ok) {
+        foreach(QString filename, indexed.keys()) {
+            foreach(QSqlQuery *remove, removes) {
+                remove->addBindValue(filename);
+                ok &= remove->exec();
+            }
+        }
+    }
+
+    foreach(QSqlQuery *remove, removes) delete remove;
+
+    if (ok && db.commit()) {
+        stale.clear();
+        current = true;
+        return true;
+    }
+
+    qDebug()<<"ride index: update failed after"<<rewritten<<"rides"<<db.lastError().text();
+    db.rollback();
+    return false;
+}
+
+bool
+RideIndex::query(QSqlDatabase db, QString where, QVariantList binds, QSet<QString> &returning)
+{
+    QSqlQuery query(db);
+    query.prepare(QString("SELECT r.filename FROM rides r WHERE %1;").arg(where == "" ? "1" : where));
+    foreach(QVariant bind, binds) query.addBindValue(bind);
+
+    if (!query.exec()) {
+        qDebug()<<"ride index: query failed"<<where<<query.lastError().text();
+        return false;
+    }
+
+    returning.clear();
+    while (query.next()) returning.insert(query.value(0).toString());
+    return true;
+}
+
+bool
+RideIndex::filenames(QString where, QVariantList binds, QSet<QString> &returning)
+{
+    if (!open) return false;
+
+    // rides changed since the last refresh, or metrics are being
+    // rewritten now; not worth updating here on the GUI thread
+    if (!current || rideCache->isRunning()) return false;
+
+    return query(connection(), where, binds, returning);
+}
+
+bool
+RideIndex::filenames(QString path, QString where, QVariantList binds, QSet<QString> &returning)
+{
+    if (!QFile(path).exists()) return false;
+
+    // a connection just for this query, we may be called from
+    // any of the web service threads so the name must be unique
+    QString session = QString("rideindex-%1").arg(QUuid::createUuid().toString());
+    bool success = false;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", session);
+        db.setDatabaseName(path);
+        db.setConnectOptions("QSQLITE_OPEN_READONLY");
+        if (db.open()) {
+            success = query(db, where, binds, returning);
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(session);
+    return success;
+}
+
+bool
+RideIndex::validOperator(QString op)
+{
+    static const QStringList ops = QStringList() << "=" << "!=" << "<" << "<=" << ">" << ">=";
+    return ops.contains(op);
+}
+
+QString
+RideIndex::datePredicate(QString op, QDate date, QVariantList &binds)
+{
+    if (!validOperator(op)) return "0";
+
+    binds << epoch.daysTo(date);
+    return QString("r.date %1 ?").arg(op);
+}
+
+QString
+RideIndex::sportPredicate(QString sport, QString op, double value, QVariantList &binds)
+{
+    if (!validOperator(op)) return "0";
+
+    binds << value;
+    return QString("r.%1 %2 ?").arg(sport == "isSwim" ? "isswim" : "isrun").arg(op);
+}
+
+QString
+RideIndex::metricPredicate(QString symbol, QString op, double value, QVariantList &binds)
+{
+    if (!validOperator(op)) return "0";
+
+    // goes via the (symbol, value) index
+    binds << symbol << value;
+    return QString("r.filename IN (SELECT filename FROM metrics WHERE symbol = ? AND value %1 ?)").arg(op);
+}
+
+QString
+RideIndex::metaPredicate(QString field, QString op, QString value, QVariantList &binds)
+{
+    if (!validOperator(op)) return "0";
+
+    // missing fields are blank, not null
+    binds << field << value;
+    return QString("coalesce((SELECT value FROM metadata m WHERE m.filename = r.filename AND m.field = ?), '') %1 ?").arg(op);
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2020 GoldenCheetah contributors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RideIndex_h
+#define _GC_RideIndex_h 1
+
+#include "GoldenCheetah.h"
+
+#include <QObject>
+#include <QSet>
+#include <QDate>
+#include <QVariant>
+#include <QtSql>
+
+class Context;
+class RideCache;
+class RideItem;
+
+//
+// An optional SQLite mirror of the ride cache, one per athlete, kept in
+// ~athlete/cache/rideIndex.db. It holds the ride metrics, metadata,
+// intervals and interval metrics with indexes on the values so date range,
+// metric threshold and metadata predicates can be pushed down to it rather
+// than evaluated ride by ride. It is enabled with the GC_RIDEINDEX athlete
+// setting and brought up to date in a single transaction as refreshes
+// complete; only rides whose content changed are rewritten.
+//
+// Predicates are built with the helpers below, each returns a fragment of
+// SQL over the rides table (aliased as r) and appends its bind values.
+//
+class RideIndex : public QObject
+{
+    Q_OBJECT
+
+    public:
+
+        RideIndex(Context *context, RideCache *cache);
+        ~RideIndex();
+
+        // did the database open ok?
+        bool isOpen() const { return open; }
+
+        // filenames of rides matching where, false if rides changed
+        // since it was last updated or a refresh is running; it is
+        // brought up to date when the refresh ends, callers should
+        // evaluate the rides themselves until then
+        bool filenames(QString where, QVariantList binds, QSet<QString> &returning);
+
+        // same again for an index on disk, for when the athlete isn't
+        // open (e.g. the web service), returns false if there isn't one
+        static bool filenames(QString path, QString where, QVariantList binds, QSet<QString> &returning);
+
+        // predicate helpers, op is one of = != < <= > >=
+        static QString datePredicate(QString op, QDate date, QVariantList &binds);
+        static QString sportPredicate(QString sport, QString op, double value, QVariantList &binds);
+        static QString metricPredicate(QString symbol, QString op, double value, QVariantList &binds);
+        static QString metaPredicate(QString field, QString op, QString value, QVariantList &binds);
+        static bool validOperator(QString op);
+
+        // where we live
+        static QString filename() { return "rideIndex.db"; }
+
+    public slots:
+
+        // bring up to date with the ride cache
+        bool update();
+
+        // rides changed or removed, so we're stale
+        void itemChanged(RideItem *item);
+        void rideDeleted(RideItem *item);
+        void refreshStart() { current = false; }
+
+    private:
+
+        Context *context;
+        RideCache *rideCache;
+        QString sessionid;
+        bool open, current;
+        QSet<QString> stale;
+
+        QSqlDatabase connection() { return QSqlDatabase::database(sessionid); }
+        bool createDatabase();
+        static QString signature(RideItem *item);
+        static bool query(QSqlDatabase db, QString where, QVariantList binds, QSet<QString> &returning);
+};
+
+#endif
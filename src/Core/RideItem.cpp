@@ -32,12 +32,20 @@
 #include "AddIntervalDialog.h" // till we fixup ridefilecache to have offsets
 #include "TimeUtils.h" // time_to_string()
 #include "WPrime.h" // for matches
+#include "EffortSearch.h"
+#include "RideResidency.h"
 
 #include <cmath>
 #include <QtAlgorithms>
 #include <QMap>
 #include <QMapIterator>
 #include <QByteArray>
+#include <QMutex>
+#if QT_VERSION > 0x050000
+# include <QtConcurrent>
+#else
+# include <QtConcurrentMap>
+#endif
 
 // used to create a temporary ride item that is not in the cache and just
 // used to enable using the same calling semantics in things like the
@@ -168,7 +176,14 @@ RideItem::metaCRC()
 
 RideFile *RideItem::ride(bool open)
 {
-    if (!open || ride_) return ride_;
+    if (!open) return ride_;
+
+    // already open, just let residency know it is in use
+    if (ride_) {
+        RideResidency *residency = RideResidency::of(this);
+        if (residency) residency->used(this);
+        return ride_;
+    }
 
     // open the ride file
     QFile file(path + "/" + fileName);
@@ -230,6 +245,10 @@ RideFile *RideItem::ride(bool open)
     connect(ride_, SIGNAL(saved()), this, SLOT(saved()));
     connect(ride_, SIGNAL(reverted()), this, SLOT(reverted()));
 
+    // it will be closed when memory is short
+    RideResidency *residency = RideResidency::of(this);
+    if (residency) residency->opened(this);
+
     return ride_;
 }
 
@@ -247,6 +266,11 @@ RideItem::~RideItem()
 RideFileCache *
 RideItem::fileCache()
 {
+    // interval metrics are computed in parallel and user metrics
+    // can ask for it, so make sure only one of them creates it;
+    // the lock is ours alone so other rides build theirs meanwhile
+    QMutexLocker locker(&fileCacheLock);
+
     if (!fileCache_) {
         fileCache_ = new RideFileCache(context, fileName, getWeight(), ride());
         if (isDirty()) fileCache_->refresh(ride_); // refresh from what we have now !
@@ -438,6 +462,9 @@ RideItem::close()
         foreach(IntervalItem *x, intervals()) x->rideInterval = NULL;
         delete ride_;
         ride_ = NULL;
+
+        RideResidency *residency = RideResidency::of(this);
+        if (residency) residency->closed(this);
     }
 
     // and the cpx data
@@ -679,7 +706,9 @@ RideItem::refresh()
 double
 RideItem::getWeight(int type)
 {
-    // get any body measurements first
+    // get any body measurements first, local since interval
+    // metrics are computed in parallel and all call here
+    BodyMeasure weightData;
     BodyMeasures* pBodyMeasures = dynamic_cast <BodyMeasures*>(context->athlete->measures->getGroup(Measures::Body));
     pBodyMeasures->getBodyMeasure(dateTime.date(), weightData);
 
@@ -690,18 +719,21 @@ RideItem::getWeight(int type)
     case BodyMeasure::WeightKg:
     {
         // get weight from whatever we got
-        weight = weightData.weightkg;
+        double kg = weightData.weightkg;
 
         // from metadata
-        if (weight <= 0.00) weight = metadata_.value("Weight", "0.0").toDouble();
+        if (kg <= 0.00) kg = metadata_.value("Weight", "0.0").toDouble();
 
         // global options and if not set default to 75 kg.
-        if (weight <= 0.00) weight = appsettings->cvalue(context->athlete->cyclist, GC_WEIGHT, "75.0").toString().toDouble();
+        if (kg <= 0.00) kg = appsettings->cvalue(context->athlete->cyclist, GC_WEIGHT, "75.0").toString().toDouble();
 
         // No weight default is weird, we'll set to 80kg
-        if (weight <= 0.00) weight = 80.00;
+        if (kg <= 0.00) kg = 80.00;
 
-        return weight;
+        // only written when it changes, updateIntervals() gets it before
+        // the interval metrics call here in parallel
+        if (weight != kg) weight = kg;
+        return kg;
     }
 
     // all the other weight measures supported by BodyMetrics
@@ -819,17 +851,18 @@ RideItem::getStringForSymbol(QString name, bool useMetricUnits)
     return returning;
 }
 
-struct effort {
-    int start, duration, joules;
-    int zone;
-    double quality;
-};
-
 static bool intervalGreaterThanZone(const IntervalItem *a, const IntervalItem *b) { 
     return const_cast<IntervalItem*>(a)->getForSymbol("power_zone") > 
            const_cast<IntervalItem*>(b)->getForSymbol("power_zone"); 
 }
 
+// compute metrics for an interval, run via QtConcurrent::blockingMap
+// the entire activity interval just copies the ride metrics
+static void intervalRefresh(IntervalItem *&item)
+{
+    if (item->type != RideFileInterval::ALL) item->refresh();
+}
+
 void
 RideItem::updateIntervals()
 {
@@ -935,7 +968,6 @@ RideItem::updateIntervals()
                                                       RideFileInterval::USER);
 
         intervalItem->rideInterval = interval;
-        intervalItem->refresh();        // XXX will get called in constructor when refactor
         intervals_ << intervalItem;
 
         count++;
@@ -972,7 +1004,6 @@ RideItem::updateIntervals()
                                                             false,
                                                             RideFileInterval::PEAKPOWER);
                 intervalItem->rideInterval = NULL;
-                intervalItem->refresh();        // XXX will get called in constructore when refactor
                 intervals_ << intervalItem;
             }
         }
@@ -1009,7 +1040,6 @@ RideItem::updateIntervals()
                                                             false,
                                                             RideFileInterval::PEAKPACE);
                 intervalItem->rideInterval = NULL;
-                intervalItem->refresh();        // XXX will get called in constructore when refactor
                 intervals_ << intervalItem;
             }
         }
@@ -1017,266 +1047,20 @@ RideItem::updateIntervals()
 
 
     //qDebug() << "SEARCH EFFORTS";
-    QList<effort> candidates[10];
-    QList<effort> candidates_sprint;
+    QList<Effort> candidates[10];
+    QList<Effort> candidates_sprint;
     
     if ((discovery & RideFileInterval::intervalTypeBits(RideFileInterval::EFFORT)) &&
         CP > 0 && WPRIME > 0 && PMAX > 0 && !f->isRun() && !f->isSwim() && f->isDataPresent(RideFile::watts)) {
 
-        const int SAMPLERATE = 1000; // 1000ms samplerate = 1 second samples
-
-        RideFilePoint sample;        // we reuse this to aggregate all values
-        long time = 0L;              // current time accumulates as we run through data
-        double lastT = 0.0f;         // last sample time seen in seconds
-
-        // set the array size
-        int arraySize = f->dataPoints().last()->secs + f->recIntSecs();
-
-        // anything longer than a day or negative is skipped
-        if (arraySize >= 0 && arraySize < (24*3600)) { // no indent, as added late
-
-        QTime timer;
-        timer.start();
-
-        // setup an integrated series
-        long *integrated_series = (long*)malloc(sizeof(long) * arraySize);
-        long *pi = integrated_series;
-        long rtot = 0;
-
-        long secs = 0;
-        foreach(RideFilePoint *p, f->dataPoints()) {
-
-            // increment secs by recIntSecs as the time series
-            // always starts at zero, normalized by the file reader
-            double psecs = p->secs + f->recIntSecs();
-
-            // whats the dt in microseconds
-            int dt = (psecs * 1000) - (lastT * 1000);
-            lastT = psecs;
-
-
-            // ignore time goes backwards
-            if (dt < 0) continue;
-
-            //
-            // AGGREGATE INTO SAMPLES
-            //
-            while (secs < arraySize && dt) {
-
-                // we keep track of how much time has been aggregated
-                // into sample, so 'need' is whats left to aggregate 
-                // for the full sample
-                int need = SAMPLERATE - sample.secs;
-
-                // aggregate
-                if (dt < need) {
-
-                    // the entire sample read is less than we need
-                    // so aggregate the whole lot and wait fore more
-                    // data to be read. If there is no more data then
-                    // this will be lost, we don't keep incomplete samples
-                    sample.secs += dt;
-                    sample.watts += float(dt) * p->watts;
-                    dt = 0;
-
-                } else {
-
-                    // dt is more than we need to fill and entire sample
-                    // so lets just take the fraction we need
-                    dt -= need;
-
-                    // accumulating time and distance
-                    sample.secs = time; time += double(SAMPLERATE) / 1000.0f;
-
-                    // averaging sample data
-                    sample.watts += float(need) * p->watts;
-                    sample.watts /= 1000;
-
-                    // integrate
-                    rtot += sample.watts;
-                    *pi++ = rtot;
-                    secs++;
-                    // reset back to zero so we can aggregate
-                    // the next sample
-                    sample.secs = 0;
-                    sample.watts = 0;
-                }
-            }
-        }
-
-        // now the data is integrated we can look at the 
-        // accumulated energy for each ride
-        for (long i=0; i<secs; i++) {
-
-            // start out at 30 minutes and drop back to
-            // 2 minutes, anything shorter and we are done
-            int t = (secs-i-1) > 3600 ? 3600 : secs-i-1;
-
-            // if we find one lets record it
-            bool found = false;
-            bool foundSprint = false;
-            effort tte;
-            effort sprint;
-
-            while (t > 120) {
-
-                // calculate the TTE for the joules in the interval
-                // starting at i seconds with duration t
-                // This takes the monod equation p(t) = W'/t + CP and
-                // solves for t, but the added complication of also
-                // accounting for the fact it is expressed in joules
-                // So take Joules = (W'/t + CP) * t and solving that
-                // for t gives t = (Joules - W') / CP
-                double tc = ((integrated_series[i+t]-integrated_series[i]) - WPRIME) / CP;
-                // NOTE FOR ABOVE: it is looking at accumulation AFTER this point
-                //                 not FROM this point, so we are looking 1s ahead of i
-                //                 which is why the interval is registered as starting
-                //                 at i+1 in the code below
-
-                // the TTE for this interval is greater or equal to
-                // the duration of the interval !
-                if (tc >= (t*0.85f)) {
-
-                    if (found == false) {
-
-                        // first one we found
-                        found = true;
-
-                        // register a candidate
-                        tte.start = i + 1; // see NOTE above
-                        tte.duration = t;
-                        tte.joules = integrated_series[i+t]-integrated_series[i];
-                        tte.quality = tc / double(t);
-                        tte.zone = zoneok ? context->athlete->zones(isRun)->whichZone(zoneRange, tte.joules/tte.duration) : 1;
-
-                    } else {
-
-                        double thisquality = tc / double(t);
-
-                        // found one with a higher quality
-                        if (tte.quality < thisquality) {
-                            tte.duration = t;
-                            tte.joules = integrated_series[i+t]-integrated_series[i];
-                            tte.quality = thisquality;
-                            tte.zone = zoneok ? context->athlete->zones(isRun)->whichZone(zoneRange, tte.joules/tte.duration) : 1;
-                        }
-
-                    }
-
-                    // look for smaller
-                    t--;
-
-                } else {
-                    t = tc;
-                    if (t<120)
-                        t=120;
-                }
-            }
-
-            //if (t>60)
-            //    t=60;
-
-            // Search sprint
-            while (t >= 5) {
-                // On Pmax only
-                // double tc = (integrated_series[i+t]-integrated_series[i]) / (PMAX);
-
-                // With the 3 components model
-                // t = W'/(P − CP) + W'/(CP − Pmax)
-                double p = (integrated_series[i+t]-integrated_series[i])/t;
-
-                if (p>0.5*(PMAX-CP)+CP) {
-                    double tc = WPRIME / (p-CP) + WPRIME / ( CP - PMAX);
-
-                    if (tc >= (t*0.85f)) {
-
-                        if (foundSprint == false) {
-
-                            // first one we found
-                            foundSprint = true;
-
-                            // register a candidate
-                            sprint.start = i + 1; // see NOTE above
-                            sprint.duration = t;
-                            sprint.joules = integrated_series[i+t]-integrated_series[i];
-                            sprint.quality = double(t) + (sprint.joules/sprint.duration/1000.0);
-
-                        } else {
-
-                            double thisquality = double(t) + (integrated_series[i+t]-integrated_series[i])/t/1000.0;
-
-                            // found one with a higher quality
-                            if (sprint.quality < thisquality) {
-                                sprint.duration = t;
-                                sprint.joules = integrated_series[i+t]-integrated_series[i];
-                                sprint.quality = thisquality;
-                            }
-
-                        }
-                        //qDebug() << "sprint" << i << sprint.duration << sprint.joules/sprint.duration << "W" << sprint.quality;
-                    }
-                }
-                // look for smaller
-                t--;
-            }
-
-
-            // add the best one we found here
-            if (found && tte.zone >= 0) {
-
-                // if we overlap with the last one and
-                // we are better then replace otherwise skip
-                if (candidates[tte.zone].count()) {
-
-                    effort &last = candidates[tte.zone].last();
-                    if ((tte.start >= last.start && tte.start <= (last.start+last.duration)) ||
-                       (tte.start+tte.duration >= last.start && tte.start+tte.duration <= (last.start+last.duration))) {
-
-                        // we overlap but we are higher quality
-                        if (tte.quality > last.quality) last = tte;
-
-                    } else{
-
-                        // we don't overlap
-                        candidates[tte.zone] << tte;
-                    }
-                } else {
-
-                    // we are the first
-                    candidates[tte.zone] << tte;
-                }
-            }
-
-            // add the best one we found here
-            if (foundSprint) {
-
-                // if we overlap with the last one and
-                // we are better then replace otherwise skip
-                if (candidates_sprint.count()) {
-
-                    effort &last = candidates_sprint.last();
-                    if ((sprint.start >= last.start && sprint.start <= (last.start+last.duration)) ||
-                       (sprint.start+sprint.duration >= last.start && sprint.start+sprint.duration <= (last.start+last.duration))) {
-
-                        // we overlap but we are higher quality
-                        if (sprint.quality > last.quality) last = sprint;
-
-                    } else{
-
-                        // we don't overlap
-                        candidates_sprint << sprint;
-                    }
-                } else {
-
-                    // we are the first
-                    candidates_sprint << sprint;
-                }
-            }
-        }
+        // rides longer than a day have no samples so find nothing
+        EffortSearch search(f);
+        search.search(CP, WPRIME, PMAX, zoneok ? context->athlete->zones(isRun) : NULL, zoneRange,
+                      candidates, candidates_sprint);
 
         // add any we found
         for (int i=0; i<10; i++) {
-        foreach(effort x, candidates[i]) {
+        foreach(Effort x, candidates[i]) {
 
             IntervalItem *intervalItem=NULL;
             int zone = zoneok ? 1 + context->athlete->zones(isRun)->whichZone(zoneRange, x.joules/x.duration) : 1;
@@ -1296,7 +1080,6 @@ RideItem::updateIntervals()
             }
 
             intervalItem->rideInterval = NULL;
-            intervalItem->refresh();        // XXX will get called in constructore when refactor
             intervals_ << intervalItem;
 
             //qDebug()<<fileName<<"IS EFFORT"<<x.quality<<"at"<<x.start<<"duration"<<x.duration;
@@ -1304,7 +1087,7 @@ RideItem::updateIntervals()
         }
         }
 
-        foreach(effort x, candidates_sprint) {
+        foreach(Effort x, candidates_sprint) {
 
             IntervalItem *intervalItem=NULL;
 
@@ -1317,132 +1100,37 @@ RideItem::updateIntervals()
 
 
             intervalItem->rideInterval = NULL;
-            intervalItem->refresh();        // XXX will get called in constructore when refactor
             intervals_ << intervalItem;
 
             //qDebug()<<fileName<<"IS EFFORT"<<x.quality<<"at"<<x.start<<"duration"<<x.duration;
 
         }
-
-        free(integrated_series);
-
-    // we skipped for whatever reason
-        //qDebug()<<fileName<<"of"<<secs<<"seconds took "<<timer.elapsed()<<"ms to find"<<candidates.count();
     }
-    } // if arraySize is in bounds, no indent from above
 
     //qDebug() << "SEARCH HILLS";
     if ((discovery & RideFileInterval::intervalTypeBits(RideFileInterval::CLIMB)) &&
         !f->isSwim() && f->isDataPresent(RideFile::alt)) {
 
-        // log of progress
-        QFile log(context->athlete->home->logs().canonicalPath() + "/" + "climb.log");
-        log.open(QIODevice::ReadWrite);
-        log.atEnd();
-        QTextStream out(&log);
-
-        //qDebug() << "SEARCH CLIMB STARTS: " << fileName;
-        out << "SEARCH CLIMB STARTS: " << fileName << "\r\n";
-        out << "START" << QDateTime::currentDateTime().toString() + "\r\n";
-
-        // Initialisation
+        // the climbs are found along with the rest of the elevation profile
         int hills = 0;
-
-        RideFilePoint *pstart = f->dataPoints().at(0);
-        RideFilePoint *pstop = f->dataPoints().at(0);
-
-        foreach(RideFilePoint *p, f->dataPoints()) {
-            // new min altitude
-            if (pstart->alt > p->alt) {
-                //update start
-                pstart = p;
-                // update stop
-                pstop = p;
-            }
-            // Update max altitude
-            if (pstop->alt < p->alt) {
-                // update stop
-                pstop = p;
-            }
-
-            bool downhill = (pstop->alt > p->alt+0.2*(pstop->alt-pstart->alt));
-            bool flat = (!downhill && (p->km - pstop->km)>1/3.0*(p->km - pstart->km));
-            bool end = (p == f->dataPoints().last() );
-
-
-
-            if (flat || downhill || end ) {
-                double distance =  pstop->km - pstart->km;
-
-
-                if (distance >= 0.5) {
-                    // Candidat
-
-                    // Check groundrise at end
-                    int start = f->dataPoints().indexOf(pstart);
-                    int stop = f->dataPoints().indexOf(pstop);
-
-                    for (int i=stop;i>start;i--) {
-                        RideFilePoint *p2 = f->dataPoints().at(i);
-                        double distance2 =  pstop->km - p2->km;
-                        if (distance2>0.1) {
-                            if ((pstop->alt-p2->alt)/distance2<20.0) {
-                                //qDebug() << "        correct stop " << (pstop->alt-p2->alt)/distance2;
-                                pstop = p2;
-                            } else
-                                i = start;
-                        }
-                    }
-
-                    for (int i=start;i<stop;i++) {
-                        RideFilePoint *p2 = f->dataPoints().at(i);
-                        double distance2 = p2->km-pstart->km;
-                        if (distance2>0.1) {
-                            if ((p2->alt-pstart->alt)/distance2<20.0) {
-                                //qDebug() << "        correct start " << (p2->alt-pstart->alt)/distance2;
-                                pstart = p2;
-                            } else
-                                i = stop;
-                        }
-                    }
-
-                    distance =  pstop->km - pstart->km;
-                    double height = pstop->alt - pstart->alt;
-
-                    if (distance >= 0.5) {
-
-                        if ((distance < 4.0 && height/distance >= 60-10*distance) ||
-                            (distance >= 4.0 && height/distance >= 20)) {
-
-                            //qDebug() << "    NEW HILL " << (hills+1) << " at " << pstart->km  << "km " << pstart->secs/60.0 <<"-"<< pstop->secs/60.0 << "min " << distance << "km " << height/distance/10.0 << "%";
-                            out << "    NEW HILL " << (hills+1) << " at " << pstart->km << "km " << pstart->secs/60.0 <<"-"<< pstop->secs/60.0 << "min " << distance << "km " << height/distance/10.0 << "%\r\n";
-
-
-                            // create a new interval item
-                            IntervalItem *intervalItem = new IntervalItem(this, QString(tr("Climb %1")).arg(++hills),
-                                                                          pstart->secs, pstop->secs,
-                                                                          pstart->km,
-                                                                          pstop->km,
-                                                                          count++,
-                                                                          QColor(Qt::green),
-                                                                          false,
-                                                                          RideFileInterval::CLIMB);
-                            intervalItem->rideInterval = NULL;
-                            intervalItem->refresh();        // XXX will get called in constructore when refactor
-                            intervals_ << intervalItem;
-                        } else {
-                            out << "        NOT HILL " << "at " << pstart->km << "km " << pstart->secs/60.0 <<"-"<< pstop->secs/60.0 << "min " << distance << "km " << height/distance/10.0 << "%\r\n";
-
-                            //qDebug() << "        NOT HILL " << "at " << pstart->km << "km " <<  pstart->secs/60.0 <<"-"<< pstop->secs/60.0 << "min " <<  distance  << "km" << height/distance/10.0 << "%";
-                        }
-                    }
-                }
-
-                pstart = pstop;
-            }
+        QPair<int,int> climb;
+        foreach(climb, f->elevation()->climbs) {
+
+            RideFilePoint *pstart = f->dataPoints().at(climb.first);
+            RideFilePoint *pstop = f->dataPoints().at(climb.second);
+
+            // create a new interval item
+            IntervalItem *intervalItem = new IntervalItem(this, QString(tr("Climb %1")).arg(++hills),
+                                                          pstart->secs, pstop->secs,
+                                                          pstart->km,
+                                                          pstop->km,
+                                                          count++,
+                                                          QColor(Qt::green),
+                                                          false,
+                                                          RideFileInterval::CLIMB);
+            intervalItem->rideInterval = NULL;
+            intervals_ << intervalItem;
         }
-        out << "STOP" << QDateTime::currentDateTime().toString() + "\r\n";
-        log.close();
     }
 
 
@@ -1456,12 +1144,13 @@ RideItem::updateIntervals()
         // add to ride !
         foreach(IntervalItem *add, here) {
             add->rideInterval = NULL;
-            add->refresh();
             intervals_ << add;
         }
     }
 
     // Search W' MATCHES incl. those that take us to EXHAUSTION
+    QList<IntervalItem*> matchItems;
+    QList<struct Match> matches;
     if ((discovery & RideFileInterval::intervalTypeBits(RideFileInterval::EFFORT)) &&
         f->isDataPresent(RideFile::watts) && f->wprimeData()) {
 
@@ -1480,28 +1169,44 @@ RideItem::updateIntervals()
                                                             false, // XXX FIXME should this be a test if to exhaustion ??? XXX
                                                             RideFileInterval::EFFORT);
                 intervalItem->rideInterval = NULL;
-                intervalItem->refresh();        // XXX will get called in constructore when refactor
-
-                // now all the metrics are computed update the name to
-                // reflect the AP which was calculated for it, and duration
-
-                // which zone was this match ?
-                double ap = intervalItem->getForSymbol("average_power");
-                double duration = intervalItem->getForSymbol("workout_time");
-                int zone = zoneok ? 1 + context->athlete->zones(isRun)->whichZone(zoneRange, ap) : 1;
-
-                intervalItem->name = QString(tr("L%1 %5 %2 (%3w %4 kJ)"))
-                                                 .arg(zone)
-                                                 .arg(time_to_string(duration))
-                                                 .arg((int)ap)
-                                                 .arg(match.cost/1000)
-                                                 .arg(match.exhaust ? tr("TE MATCH") : tr("MATCH"));
-
                 intervals_ << intervalItem;
+
+                // named below, once the metrics are computed
+                matchItems << intervalItem;
+                matches << match;
             }
         }
     }
 
+    // compute the metrics for all the intervals we found, the interval
+    // metrics are independent of each other so we compute them in
+    // parallel. W' and the running totals are shared by all of them
+    // so make sure they are ready before we start.
+    if (f->isDataPresent(RideFile::watts)) f->wprimeData();
+    f->sums();
+    getWeight();
+    QtConcurrent::blockingMap(intervals_, intervalRefresh);
+
+    // now all the metrics are computed update the match names to
+    // reflect the AP which was calculated for it, and duration
+    for (int i=0; i<matchItems.count(); i++) {
+
+        IntervalItem *intervalItem = matchItems[i];
+        const struct Match &match = matches[i];
+
+        // which zone was this match ?
+        double ap = intervalItem->getForSymbol("average_power");
+        double duration = intervalItem->getForSymbol("workout_time");
+        int zone = zoneok ? 1 + context->athlete->zones(isRun)->whichZone(zoneRange, ap) : 1;
+
+        intervalItem->name = QString(tr("L%1 %5 %2 (%3w %4 kJ)"))
+                                         .arg(zone)
+                                         .arg(time_to_string(duration))
+                                         .arg((int)ap)
+                                         .arg(match.cost/1000)
+                                         .arg(match.exhaust ? tr("TE MATCH") : tr("MATCH"));
+    }
+
     // we now calculate sustained time in zone metrics
     // this uses the EFFORT intervals, if the point
     // is part of an effort interval we include it
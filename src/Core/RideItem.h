@@ -28,6 +28,7 @@
 #include <QString>
 #include <QMap>
 #include <QVector>
+#include <QMutex>
 
 class RideFile;
 class RideFileCache;
@@ -60,6 +61,7 @@ class RideItem : public QObject
         // ridefile
         RideFile *ride_;
         RideFileCache *fileCache_;
+        QMutex fileCacheLock; // creating fileCache_
 
         // precomputed metrics & user overrides
         QVector<double> metrics_;
@@ -155,7 +157,6 @@ class RideItem : public QObject
         double weight; // what weight was used ?
 
         // access to the cached data !
-        BodyMeasure weightData;
         RideFile *ride(bool open=true);
         RideFileCache *fileCache();
         QVector<double> &metrics() { return metrics_; }
@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2020 GoldenCheetah contributors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RideResidency.h"
+#include "Context.h"
+#include "Athlete.h"
+#include "Settings.h"
+#include "RideCache.h"
+#include "RideItem.h"
+#include "RideFile.h"
+
+#include <QPair>
+#include <QtAlgorithms>
+
+RideResidency::RideResidency(Context *context, RideCache *rideCache) :
+    context(context), rideCache(rideCache), budget_(0), closing(NULL), tick(0), bytes(0), peak_(0),
+    hits_(0), misses_(0), evictions_(0), scheduled(0)
+{
+    configChanged(CONFIG_GENERAL);
+
+    // rides may have been used by the refresh, and we
+    // don't close any while it is running
+    connect(context, SIGNAL(refreshEnd()), this, SLOT(evict()));
+    connect(context, SIGNAL(configChanged(qint32)), this, SLOT(configChanged(qint32)));
+}
+
+RideResidency::~RideResidency()
+{
+}
+
+RideResidency *
+RideResidency::of(RideItem *item)
+{
+    if (item == NULL || item->context == NULL || item->context->athlete == NULL) return NULL;
+    if (item->context->athlete->rideCache == NULL) return NULL;
+    return item->context->athlete->rideCache->residency();
+}
+
+qint64
+RideResidency::sizeOf(RideFile *ride)
+{
+    if (ride == NULL) return 0;
+
+    qint64 size = sizeof(RideFile);
+    size += ride->dataPoints().count() * (sizeof(RideFilePoint) + sizeof(RideFilePoint*));
+    size += ride->referencePoints().count() * (sizeof(RideFilePoint) + sizeof(RideFilePoint*));
+    size += ride->intervals().count() * sizeof(RideFileInterval);
+    foreach(XDataSeries *series, ride->xdata())
+        size += series->datapoints.count() * (sizeof(XDataPoint) + sizeof(XDataPoint*));
+
+    return size;
+}
+
+void
+RideResidency::configChanged(qint32 what)
+{
+    if (what & CONFIG_GENERAL) {
+        int mb = appsettings->value(NULL, GC_RIDE_MEMORY, RIDE_MEMORY_DEFAULT).toInt();
+        setBudget(qint64(mb) * 1024 * 1024);
+    }
+}
+
+void
+RideResidency::setBudget(qint64 size)
+{
+    budget_ = size;
+    schedule();
+}
+
+void
+RideResidency::schedule()
+{
+    QMutexLocker locker(&lock);
+
+    // once, from the event loop on our own thread
+    if (budget_ > 0 && bytes > budget_ && scheduled.testAndSetOrdered(0, 1))
+        QMetaObject::invokeMethod(this, "evict", Qt::QueuedConnection);
+}
+
+void
+RideResidency::opened(RideItem *item)
+{
+    qint64 size = sizeOf(item->ride(false));
+
+    lock.lock();
+    Resident &here = open[item];
+    bytes += size - here.bytes;
+    here.bytes = size;
+    here.used = ++tick;
+    misses_++;
+    if (bytes > peak_) peak_ = bytes;
+    lock.unlock();
+
+    schedule();
+}
+
+void
+RideResidency::used(RideItem *item)
+{
+    lock.lock();
+    QHash<RideItem*, Resident>::iterator it = open.find(item);
+    if (it != open.end()) {
+        it.value().used = ++tick;
+        hits_++;
+    }
+    lock.unlock();
+}
+
+void
+RideResidency::closed(RideItem *item)
+{
+    lock.lock();
+    QHash<RideItem*, Resident>::iterator it = open.find(item);
+    if (it != open.end()) {
+        bytes -= it.value().bytes;
+        open.erase(it);
+    }
+    lock.unlock();
+}
+
+void
+RideResidency::pin(RideItem *item)
+{
+    lock.lock();
+    while (closing == item) closed_.wait(&lock);
+    pins[item]++;
+    lock.unlock();
+}
+
+void
+RideResidency::unpin(RideItem *item)
+{
+    lock.lock();
+    QHash<RideItem*, int>::iterator it = pins.find(item);
+    if (it != pins.end() && --it.value() <= 0) pins.erase(it);
+    lock.unlock();
+
+    schedule();
+}
+
+bool
+RideResidency::isPinned(RideItem *item)
+{
+    return pins.contains(item) || item == context->ride || item->isedit || item->isDirty();
+}
+
+void
+RideResidency::evict()
+{
+    scheduled = 0;
+    if (budget_ <= 0) return;
+
+    // the refresh is using rides on other threads,
+    // we get called again when it ends
+    if (rideCache->isRunning()) return;
+
+    QList<RideItem*> victims;
+
+    lock.lock();
+
+    // sizes change as rides are edited, so update them
+    // and order least recently used first
+    QList<QPair<quint64, RideItem*> > lru;
+    bytes = 0;
+    QMutableHashIterator<RideItem*, Resident> it(open);
+    while (it.hasNext()) {
+        it.next();
+        it.value().bytes = sizeOf(it.key()->ride(false));
+        bytes += it.value().bytes;
+        lru << QPair<quint64, RideItem*>(it.value().used, it.key());
+    }
+    qSort(lru);
+
+    qint64 over = bytes - budget_;
+    for (int i=0; i<lru.count() && over > 0; i++) {
+        RideItem *item = lru[i].second;
+        if (isPinned(item)) continue;
+
+        victims << item;
+        over -= open.value(item).bytes;
+    }
+
+    lock.unlock();
+
+    foreach(RideItem *item, victims) {
+
+        // it may have been pinned since we chose it
+        lock.lock();
+        if (isPinned(item)) {
+            lock.unlock();
+            continue;
+        }
+        closing = item;
+        evictions_++;
+        lock.unlock();
+
+        // close will call closed() to update the totals
+        item->close();
+
+        lock.lock();
+        closing = NULL;
+        closed_.wakeAll();
+        lock.unlock();
+    }
+}
+
+int
+RideResidency::count()
+{
+    QMutexLocker locker(&lock);
+    return open.count();
+}
+
+qint64
+RideResidency::resident()
+{
+    QMutexLocker locker(&lock);
+    return bytes;
+}
+
+qint64
+RideResidency::peak()
+{
+    QMutexLocker locker(&lock);
+    return peak_;
+}
+
+quint64
+RideResidency::hits()
+{
+    QMutexLocker locker(&lock);
+    return hits_;
+}
+
+quint64
+RideResidency::misses()
+{
+    QMutexLocker locker(&lock);
+    return misses_;
+}
+
+quint64
+RideResidency::evictions()
+{
+    QMutexLocker locker(&lock);
+    return evictions_;
+}
+
+QString
+RideResidency::summary()
+{
+    QMutexLocker locker(&lock);
+    return tr("%1 activities open using %2 MB of %3 MB (peak %4 MB), %5 hits, %6 reads, %7 closed")
+           .arg(open.count())
+           .arg(bytes / (1024*1024))
+           .arg(budget_ / (1024*1024))
+           .arg(peak_ / (1024*1024))
+           .arg(hits_)
+           .arg(misses_)
+           .arg(evictions_);
+}
+
+RideResidencyPin::RideResidencyPin(RideItem *item) : item(item), residency(RideResidency::of(item))
+{
+    if (residency) residency->pin(item);
+}
+
+RideResidencyPin::~RideResidencyPin()
+{
+    if (residency) residency->unpin(item);
+}
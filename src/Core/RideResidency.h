@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2020 GoldenCheetah contributors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RideResidency_h
+#define _GC_RideResidency_h 1
+#include "GoldenCheetah.h"
+
+#include <QObject>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+
+class Context;
+class RideCache;
+class RideItem;
+class RideFile;
+
+// default budget for ride data held open, in MB
+#define RIDE_MEMORY_DEFAULT 1024
+
+//
+// Keeps track of the ride files that are open and closes the least
+// recently used ones when they take up more memory than the budget
+// set in preferences.
+//
+// RideItem::ride() tells us whenever a ride is opened or used, and
+// close() when it is closed; those can be on any thread so the book
+// keeping is behind a mutex. Closing rides is only ever done on the
+// GUI thread, from the event loop, and not while the ride cache is
+// refreshing, so nobody is part way through using a ride we close.
+// Each ride is checked again just before it is closed, and pin() waits
+// for a ride that is being closed, so once pinned it stays open, or
+// is opened again by ride().
+//
+// Rides are never closed when they are;
+//     - the ride currently selected
+//     - being edited, or changed and not saved yet
+//     - pinned, by code that uses a ride from another thread or
+//       holds on to it across the event loop (see RideResidencyPin)
+//
+// The sizes are an estimate from the samples and xdata, which is
+// where nearly all of the memory goes.
+//
+class RideResidency : public QObject
+{
+    Q_OBJECT
+
+    public:
+
+        RideResidency(Context *context, RideCache *rideCache);
+        ~RideResidency();
+
+        // called by RideItem, on any thread
+        void opened(RideItem *item);
+        void used(RideItem *item);
+        void closed(RideItem *item);
+
+        // pinned rides are not closed, calls must balance
+        void pin(RideItem *item);
+        void unpin(RideItem *item);
+
+        // budget in bytes, 0 means no limit
+        qint64 budget() const { return budget_; }
+        void setBudget(qint64 size);
+
+        // how we're doing
+        int count();            // rides open
+        qint64 resident();      // bytes open, estimated
+        qint64 peak();          // most bytes ever open
+        quint64 hits();         // ride() on an open ride
+        quint64 misses();       // ride() had to read the file
+        quint64 evictions();    // closed to stay in budget
+        QString summary();
+
+        // estimated memory used by the ride data
+        static qint64 sizeOf(RideFile *ride);
+
+        // the one looking after this ride, NULL if there isn't one
+        static RideResidency *of(RideItem *item);
+
+    public slots:
+
+        // close rides until back in budget
+        void evict();
+
+        void configChanged(qint32);
+
+    private:
+
+        Context *context;
+        RideCache *rideCache;
+        qint64 budget_;
+
+        struct Resident {
+            Resident() : bytes(0), used(0) {}
+            qint64 bytes;
+            quint64 used;       // tick when last used
+        };
+
+        QMutex lock;
+        QHash<RideItem*, Resident> open;
+        QHash<RideItem*, int> pins;
+        RideItem *closing;              // by evict(), pin() waits for it
+        QWaitCondition closed_;
+        quint64 tick;
+        qint64 bytes, peak_;
+        quint64 hits_, misses_, evictions_;
+
+        // evict() is queued once when over budget
+        QAtomicInt scheduled;
+        void schedule();
+
+        bool isPinned(RideItem *item); // with lock held
+};
+
+// pins a ride for as long as it is in scope, use it when
+// working with a ride away from the GUI thread, e.g.
+//
+//     RideResidencyPin pin(item);
+//     RideFile *f = item->ride();
+//
+class RideResidencyPin
+{
+    public:
+        RideResidencyPin(RideItem *item);
+        ~RideResidencyPin();
+
+    private:
+        RideItem *item;
+        RideResidency *residency;
+};
+
+#endif
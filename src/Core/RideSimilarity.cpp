@@ -0,0 +1,460 @@
+/*
+ * Copyright (c) 2020 GoldenCheetah contributors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RideSimilarity.h"
+#include "Context.h"
+#include "Athlete.h"
+#include "RideCache.h"
+#include "RideItem.h"
+#include "RideFile.h"
+
+#include <QFile>
+#include <QDataStream>
+#include <QPair>
+#include <QReadLocker>
+#include <QWriteLocker>
+#if QT_VERSION > 0x050000
+#include <QtConcurrent>
+#else
+#include <QtConcurrentRun>
+#endif
+#include <algorithm>
+#include <cmath>
+
+// km in a degree of latitude
+static const double KMPERDEGREE = 111.2;
+
+// how much a difference counts in each feature, see the header
+static const double STARTKM = 2.0;
+static const double ROUTEKM = 1.0;
+static const double LONGER = log(1.25);
+static const double INTENSITY = 0.05;
+static const double HEARTRATE = 8.0;
+
+// and for a feature only one of the rides has
+static const float MISSING = 2.0f;
+
+static void
+routeJob(SimilarityJob &job)
+{
+    QStringList errors;
+    QFile file(job.path + "/" + job.fileName);
+    RideFile *ride = RideFileFactory::instance().openRideFile(job.context, file, errors);
+    if (ride) {
+        RideSimilarity::routeFor(ride, job.route);
+        delete ride;
+    }
+    job.route.crc = job.crc;
+    job.route.timestamp = job.timestamp;
+    job.done = true;
+}
+
+RideSimilarity::RideSimilarity(Context *context, RideCache *rideCache) : context(context), rideCache(rideCache)
+{
+    connect(context, SIGNAL(rideAdded(RideItem*)), this, SLOT(rideAdded(RideItem*)));
+    connect(context, SIGNAL(rideDeleted(RideItem*)), this, SLOT(rideDeleted(RideItem*)));
+    connect(context, SIGNAL(refreshEnd()), this, SLOT(refreshEnd()));
+    connect(rideCache, SIGNAL(itemChanged(RideItem*)), this, SLOT(itemChanged(RideItem*)));
+    connect(&watcher, SIGNAL(finished()), this, SLOT(routesDone()));
+
+    readCache();
+    foreach(RideItem *item, rideCache->rides()) update(item);
+    start();
+}
+
+RideSimilarity::~RideSimilarity()
+{
+    // keep what was worked out before we were stopped
+    future.cancel();
+    future.waitForFinished();
+    collect();
+    writeCache();
+}
+
+bool
+RideSimilarity::routeFor(RideFile *ride, SimilarityRoute &route)
+{
+    route.gps = false;
+    for (int i=0; i<SimilarityRoute::Size; i++) route.v[i] = 0;
+
+    // the valid positions and how far along each one is
+    QVector<double> lats, lons, kms;
+    double km = 0;
+    foreach(RideFilePoint *p, ride->dataPoints()) {
+
+        if (p->lat == 0 || p->lon == 0 ||
+            p->lon < -180 || p->lon > 180 ||
+            p->lat < -90 || p->lat > 90) continue;
+
+        if (lats.count()) {
+            double dx = (p->lon - lons.last()) * KMPERDEGREE * cos(((p->lat + lats.last()) / 2.0) * M_PI / 180.0);
+            double dy = (p->lat - lats.last()) * KMPERDEGREE;
+            km += sqrt(dx*dx + dy*dy);
+        }
+        lats << p->lat;
+        lons << p->lon;
+        kms << km;
+    }
+    if (lats.count() == 0) return false;
+
+    // local x,y in km, longitude scaled at the start
+    double scale = KMPERDEGREE * cos(lats[0] * M_PI / 180.0);
+    route.v[0] = lons[0] * scale;
+    route.v[1] = lats[0] * KMPERDEGREE;
+
+    // positions at even fractions of the distance
+    int j = 0;
+    for (int k=1; k<=SimilarityRoute::Points; k++) {
+
+        double target = (km * k) / SimilarityRoute::Points;
+        while (j < kms.count()-1 && kms[j] < target) j++;
+
+        double lat = lats[j], lon = lons[j];
+        if (j > 0 && kms[j] > kms[j-1]) {
+            double f = (target - kms[j-1]) / (kms[j] - kms[j-1]);
+            lat = lats[j-1] + f * (lats[j] - lats[j-1]);
+            lon = lons[j-1] + f * (lons[j] - lons[j-1]);
+        }
+        route.v[2*k] = (lon - lons[0]) * scale;
+        route.v[(2*k)+1] = (lat - lats[0]) * KMPERDEGREE;
+    }
+    route.gps = true;
+    return true;
+}
+
+bool
+RideSimilarity::route(RideItem *item, SimilarityRoute &route)
+{
+    // worked out already for this version of the file
+    QHash<QString, SimilarityRoute>::const_iterator found = routes.constFind(item->fileName);
+    if (found != routes.constEnd() && found.value().crc == quint32(item->crc) &&
+        found.value().timestamp == quint32(item->timestamp)) {
+        route = found.value();
+        return true;
+    }
+
+    // open already so no need to wait, but unsaved changes aren't kept
+    RideFile *ride = item->ride(false);
+    if (ride) {
+        routeFor(ride, route);
+        if (!item->isDirty()) {
+            route.crc = item->crc;
+            route.timestamp = item->timestamp;
+            routes.insert(item->fileName, route);
+        }
+        return true;
+    }
+
+    pending.insert(item);
+    return false;
+}
+
+void
+RideSimilarity::update(RideItem *item)
+{
+    double secs = item->getForSymbol("workout_time");
+    if (item->planned || secs <= 0) {
+        remove(item);
+        return;
+    }
+
+    // worked out before taking the lock, the route may open the ride
+    Row r;
+    r.item = item;
+    r.sport = item->isRun ? 1 : (item->isSwim ? 2 : 0);
+    r.has = HasDuration;
+
+    float v[Dims];
+    for (int i=0; i<Dims; i++) v[i] = 0;
+
+    v[Duration] = log(secs) / LONGER;
+
+    double km = item->getForSymbol("total_distance");
+    if (km > 0.1) {
+        r.has |= HasDistance;
+        v[Distance] = log(km) / LONGER;
+    }
+
+    double IF = item->getForSymbol("coggan_if");
+    if (IF > 0) {
+        r.has |= HasIntensity;
+        v[Intensity] = IF / INTENSITY;
+    }
+
+    double hr = item->getForSymbol("average_hr");
+    if (hr > 0) {
+        r.has |= HasHeartRate;
+        v[HeartRate] = hr / HEARTRATE;
+    }
+
+    // each point along the route counts for less, so the
+    // route as a whole counts about as much as the start
+    SimilarityRoute here;
+    if (route(item, here) && here.gps) {
+        r.has |= HasStart;
+        v[StartX] = here.v[0] / STARTKM;
+        v[StartY] = here.v[1] / STARTKM;
+        double pointkm = ROUTEKM * sqrt(double(SimilarityRoute::Points));
+        for (int i=2; i<SimilarityRoute::Size; i++) v[Path+i-2] = here.v[i] / pointkm;
+    }
+
+    QWriteLocker locker(&lock);
+    int row = rowOf.value(item, -1);
+    if (row < 0) {
+        row = rows.count();
+        rows.resize(row+1);
+        table.resize((row+1) * Dims);
+        rowOf.insert(item, row);
+    }
+    rows[row] = r;
+    for (int i=0; i<Dims; i++) table[(row * Dims) + i] = v[i];
+}
+
+void
+RideSimilarity::remove(RideItem *item)
+{
+    QWriteLocker locker(&lock);
+    int row = rowOf.value(item, -1);
+    if (row < 0) return;
+
+    // move the last row into the gap
+    int last = rows.count()-1;
+    if (row != last) {
+        rows[row] = rows[last];
+        for (int i=0; i<Dims; i++) table[(row * Dims) + i] = table[(last * Dims) + i];
+        rowOf.insert(rows[row].item, row);
+    }
+    rows.resize(last);
+    table.resize(last * Dims);
+    rowOf.remove(item);
+}
+
+float
+RideSimilarity::distance(int a, int b) const
+{
+    // features in the same order as the Has flags
+    static const struct { int has, from, to; } groups[] = {
+        { HasStart, StartX, Duration },
+        { HasDuration, Duration, Distance },
+        { HasDistance, Distance, Intensity },
+        { HasIntensity, Intensity, HeartRate },
+        { HasHeartRate, HeartRate, Dims }
+    };
+
+    const float *va = table.constData() + (a * Dims);
+    const float *vb = table.constData() + (b * Dims);
+    const quint8 ha = rows[a].has, hb = rows[b].has;
+
+    float sum = 0;
+    for (int g=0; g<5; g++) {
+        bool ina = ha & groups[g].has;
+        bool inb = hb & groups[g].has;
+        if (ina && inb) {
+            for (int i=groups[g].from; i<groups[g].to; i++) {
+                float d = va[i] - vb[i];
+                sum += d*d;
+            }
+        } else if (ina || inb) sum += MISSING * MISSING;
+    }
+    return sqrt(sum);
+}
+
+double
+RideSimilarity::score(float distance)
+{
+    return 100.0 * exp(-distance / 4.0);
+}
+
+double
+RideSimilarity::similarity(RideItem *a, RideItem *b)
+{
+    QReadLocker locker(&lock);
+    int ra = rowOf.value(a, -1);
+    int rb = rowOf.value(b, -1);
+    if (ra < 0 || rb < 0 || rows[ra].sport != rows[rb].sport) return 0;
+
+    return score(distance(ra, rb));
+}
+
+QList<RideItem*>
+RideSimilarity::like(RideItem *item, int count, QVector<double> *scores)
+{
+    QList<RideItem*> returning;
+    if (scores) scores->clear();
+
+    QReadLocker locker(&lock);
+    int me = rowOf.value(item, -1);
+    if (me < 0 || count <= 0) return returning;
+
+    QVector<QPair<float, int> > near;
+    near.reserve(rows.count());
+    for (int i=0; i<rows.count(); i++) {
+        if (i == me || rows[i].sport != rows[me].sport) continue;
+        near << QPair<float, int>(distance(me, i), i);
+    }
+
+    // only the nearest need to be in order
+    int n = qMin(count, near.count());
+    std::partial_sort(near.begin(), near.begin() + n, near.end());
+
+    for (int i=0; i<n; i++) {
+        returning << rows[near[i].second].item;
+        if (scores) *scores << score(near[i].first);
+    }
+    return returning;
+}
+
+int
+RideSimilarity::countLike(RideItem *item, double atleast)
+{
+    QReadLocker locker(&lock);
+    int me = rowOf.value(item, -1);
+    if (me < 0) return 0;
+
+    int count = 0;
+    for (int i=0; i<rows.count(); i++) {
+        if (i == me || rows[i].sport != rows[me].sport) continue;
+        if (score(distance(me, i)) >= atleast) count++;
+    }
+    return count;
+}
+
+void
+RideSimilarity::rideAdded(RideItem *item)
+{
+    update(item);
+    start();
+}
+
+void
+RideSimilarity::rideDeleted(RideItem *item)
+{
+    remove(item);
+    pending.remove(item);
+    routes.remove(item->fileName);
+}
+
+void
+RideSimilarity::itemChanged(RideItem *item)
+{
+    update(item);
+    start();
+}
+
+void
+RideSimilarity::refreshEnd()
+{
+    // metrics may have been recomputed
+    foreach(RideItem *item, rideCache->rides()) update(item);
+    start();
+}
+
+void
+RideSimilarity::start()
+{
+    // not while the ride cache is refreshing, it's opening them too, and
+    // not until routesDone() has collected the last lot, it starts us again
+    if (future.isRunning() || jobs.count() || pending.isEmpty() || rideCache->isRunning()) return;
+
+    jobs.clear();
+    foreach(RideItem *item, pending) {
+        SimilarityJob job;
+        job.context = context;
+        job.path = item->path;
+        job.fileName = item->fileName;
+        job.crc = item->crc;
+        job.timestamp = item->timestamp;
+        job.done = false;
+        jobs << job;
+    }
+    pending.clear();
+
+    future = QtConcurrent::map(jobs, routeJob);
+    watcher.setFuture(future);
+}
+
+void
+RideSimilarity::collect()
+{
+    foreach(const SimilarityJob &job, jobs)
+        if (job.done) routes.insert(job.fileName, job.route);
+}
+
+void
+RideSimilarity::routesDone()
+{
+    collect();
+
+    // the rides they were for
+    QHash<QString, RideItem*> items;
+    foreach(RideItem *item, rideCache->rides()) items.insert(item->fileName, item);
+    foreach(const SimilarityJob &job, jobs) {
+        RideItem *item = items.value(job.fileName, NULL);
+        if (item && job.done) update(item);
+    }
+    jobs.clear();
+
+    writeCache();
+    emit updated();
+
+    // any that arrived while we were busy
+    start();
+}
+
+void
+RideSimilarity::readCache()
+{
+    QFile cacheFile(context->athlete->home->cache().canonicalPath() + "/similarity.dat");
+    if (!cacheFile.open(QIODevice::ReadOnly)) return;
+
+    QDataStream in(&cacheFile);
+    in.setVersion(QDataStream::Qt_4_6);
+    in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    quint32 version, count;
+    in >> version >> count;
+    if (version != RideSimilarityVersion) return;
+
+    for (quint32 i=0; i<count && in.status() == QDataStream::Ok; i++) {
+        QString fileName;
+        SimilarityRoute route;
+        in >> fileName >> route.crc >> route.timestamp >> route.gps;
+        for (int j=0; j<SimilarityRoute::Size; j++) in >> route.v[j];
+        if (in.status() == QDataStream::Ok) routes.insert(fileName, route);
+    }
+}
+
+void
+RideSimilarity::writeCache()
+{
+    QFile cacheFile(context->athlete->home->cache().canonicalPath() + "/similarity.dat");
+    if (!cacheFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) return;
+
+    QDataStream out(&cacheFile);
+    out.setVersion(QDataStream::Qt_4_6);
+    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    out << quint32(RideSimilarityVersion) << quint32(routes.count());
+    QHashIterator<QString, SimilarityRoute> it(routes);
+    while (it.hasNext()) {
+        it.next();
+        const SimilarityRoute &route = it.value();
+        out << it.key() << route.crc << route.timestamp << route.gps;
+        for (int j=0; j<SimilarityRoute::Size; j++) out << route.v[j];
+    }
+}
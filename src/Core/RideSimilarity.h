@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2020 GoldenCheetah contributors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RideSimilarity_h
+#define _GC_RideSimilarity_h 1
+#include "GoldenCheetah.h"
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QVector>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QReadWriteLock>
+
+class Context;
+class RideCache;
+class RideItem;
+class RideFile;
+
+// bumped when the route features or how they are worked out changes
+#define RideSimilarityVersion 1
+
+// where a ride went, worked out from the samples and kept in
+// the cache so the ride files aren't opened again at startup
+struct SimilarityRoute {
+    enum { Points = 8 };    // positions along the way
+
+    SimilarityRoute() : crc(0), timestamp(0), gps(false) { for (int i=0; i<Size; i++) v[i]=0; }
+
+    quint32 crc, timestamp; // of the ride file it was worked out from
+    bool gps;               // false if the ride has no positions
+
+    // start x,y then each point x,y relative to the start, in km
+    enum { Size = 2 + (2 * Points) };
+    float v[Size];
+};
+
+// a ride file to be opened in the background for its route
+struct SimilarityJob {
+    Context *context;
+    QString path, fileName;
+    quint32 crc, timestamp;
+    bool done;              // false if cancelled before we got to it
+    SimilarityRoute route;
+};
+
+//
+// Finds the rides most like another one.
+//
+// Each ride is described by a short vector of features; where it
+// started, a fingerprint of the route (positions at even fractions of
+// the distance, relative to the start), the log of its duration and
+// distance, its intensity factor and average heart rate. They are
+// scaled so a difference of 1 is about as significant in each; 2km
+// between starts, 1km along the route, 25% longer or further, 0.05 IF
+// or 8bpm. Rides are compared on the features they both have, with a
+// fixed penalty for each one only one of them has (a ride without GPS
+// is never a good match for a ride with).
+//
+// The vectors are packed into one array, a row per ride, and updated
+// in place as rides are added, deleted or changed, so a search is a
+// single pass over a few floats per ride; for 15 years of rides that
+// is well under a millisecond, so there is no need for an approximate
+// index to go faster.
+//
+// Only the route needs the samples, so it is worked out in the
+// background for rides that aren't open, and kept in the cache
+// directory with the crc and timestamp of the file it came from.
+//
+// It is created with the ride cache and only updated on the GUI
+// thread, but the searches may come from python scripts too, so the
+// rows are guarded by a read/write lock.
+//
+class RideSimilarity : public QObject
+{
+    Q_OBJECT
+
+    public:
+
+        RideSimilarity(Context *context, RideCache *rideCache);
+        ~RideSimilarity();
+
+        // 0-100, 100 being the same ride, 0 if not comparable
+        double similarity(RideItem *a, RideItem *b);
+
+        // up to count rides of the same sport most like this one, most alike
+        // first, with their similarity if scores is not NULL
+        QList<RideItem*> like(RideItem *item, int count, QVector<double> *scores=NULL);
+
+        // how many rides are at least this similar
+        int countLike(RideItem *item, double atleast);
+
+        // routes still being worked out in the background
+        bool isRunning() { return future.isRunning(); }
+
+        // from the samples, false if there are no positions
+        static bool routeFor(RideFile *ride, SimilarityRoute &route);
+
+    signals:
+
+        // more routes were worked out
+        void updated();
+
+    public slots:
+
+        void rideAdded(RideItem *item);
+        void rideDeleted(RideItem *item);
+        void itemChanged(RideItem *item);
+        void refreshEnd();
+        void routesDone();
+
+    private:
+
+        Context *context;
+        RideCache *rideCache;
+
+        // which features a ride has, the groups of values in a row
+        enum { HasStart = 0x01, HasDuration = 0x02, HasDistance = 0x04,
+               HasIntensity = 0x08, HasHeartRate = 0x10 };
+
+        enum { StartX = 0, StartY = 1, Path = 2,
+               Duration = Path + (2 * SimilarityRoute::Points),
+               Distance, Intensity, HeartRate, Dims };
+
+        // rows in the same order as the vectors in table
+        mutable QReadWriteLock lock;
+        struct Row {
+            RideItem *item;
+            quint8 has;
+            quint8 sport;
+        };
+        QVector<Row> rows;
+        QVector<float> table;
+        QHash<RideItem*, int> rowOf;
+
+        void update(RideItem *item);
+        void remove(RideItem *item);
+        float distance(int a, int b) const;
+        static double score(float distance);
+
+        // routes by ride filename
+        QHash<QString, SimilarityRoute> routes;
+        bool route(RideItem *item, SimilarityRoute &route);
+        void readCache();
+        void writeCache();
+
+        // working out routes in the background
+        QSet<RideItem*> pending;
+        QVector<SimilarityJob> jobs;
+        QFuture<void> future;
+        QFutureWatcher<void> watcher;
+        void start();
+        void collect();
+};
+
+#endif
@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2020 GoldenCheetah contributors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RideSnapshot.h"
+#include "Context.h"
+#include "Athlete.h"
+#include "RideCache.h"
+#include "RideItem.h"
+#include "RideFile.h"
+#include "Settings.h"
+
+#include <QtAlgorithms>
+#include <cmath>
+
+RideSnapshots::RideSnapshots(Context *context, RideCache *rideCache) : context(context), rideCache(rideCache)
+{
+    peerType = appsettings->value(NULL, GC_RANK_PEERS, SameSport).toInt();
+
+    connect(context, SIGNAL(rideAdded(RideItem*)), this, SLOT(rideAdded(RideItem*)));
+    connect(context, SIGNAL(rideDeleted(RideItem*)), this, SLOT(rideDeleted(RideItem*)));
+    connect(context, SIGNAL(refreshEnd()), this, SLOT(refreshEnd()));
+    connect(context, SIGNAL(configChanged(qint32)), this, SLOT(configChanged(qint32)));
+    connect(rideCache, SIGNAL(itemChanged(RideItem*)), this, SLOT(itemChanged(RideItem*)));
+}
+
+RideSnapshots::~RideSnapshots()
+{
+    clearPeers();
+}
+
+void
+RideSnapshots::clearPeers()
+{
+    foreach(PeerSet *set, peers) delete set;
+    peers.clear();
+}
+
+QString
+RideSnapshots::sport(RideItem *item)
+{
+    if (item->isRun) return "Run";
+    if (item->isSwim) return "Swim";
+    return "Bike";
+}
+
+QString
+RideSnapshots::group(RideItem *item) const
+{
+    switch (peerType) {
+    case AllRides: return "All";
+    case SameSportYear: return QString("%1 %2").arg(sport(item)).arg(item->dateTime.date().year());
+    default:
+    case SameSport: return sport(item);
+    }
+}
+
+double
+RideSnapshots::value(RideItem *item, QString symbol, int type)
+{
+    bool metric = context->athlete->useMetricUnits;
+
+    switch (type) {
+    default:
+    case Metric: return item->getForSymbol(symbol, metric);
+    case MetricDisplayed: return item->getStringForSymbol(symbol, metric).toDouble();
+    case MetaDouble: return item->getText(symbol, "").toDouble();
+    case MetaInteger: return item->getText(symbol, "").toInt();
+    }
+}
+
+RideSnapshot &
+RideSnapshots::snapshot(RideItem *item)
+{
+    // anything worked out before the rides last changed is stale
+    RideSnapshot &here = snapshots[item];
+    if (here.version != rideCache->version()) {
+        here = RideSnapshot();
+        here.version = rideCache->version();
+    }
+    return here;
+}
+
+int
+RideSnapshots::indexOf(RideItem *item)
+{
+    // rides are in date order so search by date, then
+    // step over any that started at the same time
+    const QVector<RideItem*> &rides = rideCache->rides();
+    int low = 0, high = rides.count();
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (rides[mid]->dateTime < item->dateTime) low = mid + 1;
+        else high = mid;
+    }
+    for (int i=low; i<rides.count() && rides[i]->dateTime == item->dateTime; i++)
+        if (rides[i] == item) return i;
+
+    // not where it should be, the list may not be sorted yet
+    return rides.indexOf(item);
+}
+
+const SparkSnapshot &
+RideSnapshots::sparkline(RideItem *item, QString symbol, int type, int days)
+{
+    RideSnapshot &here = snapshot(item);
+    QString key = QString("%1 %2 %3").arg(symbol).arg(type).arg(days);
+
+    QHash<QString, SparkSnapshot>::const_iterator found = here.sparks.constFind(key);
+    if (found != here.sparks.constEnd()) return found.value();
+
+    SparkSnapshot &spark = here.sparks[key];
+
+    // walk back over the rides before, no further than days
+    int index = indexOf(item);
+    for (int i=index-1; i >= 0; i--) {
+
+        RideItem *prior = rideCache->rides().at(i);
+
+        const qint64 old = prior->dateTime.daysTo(item->dateTime);
+        if (old > days) break;
+
+        // only activities with matching sport flags
+        if (prior->isRun != item->isRun || prior->isSwim != item->isSwim) continue;
+
+        double v = value(prior, symbol, type);
+        if (v) {
+            if (spark.count == 0 || v < spark.min) spark.min = v;
+            if (spark.count == 0 || v > spark.max) spark.max = v;
+            spark.sum += v;
+            spark.count++;
+            spark.points << QPointF(days-old, v);
+        }
+    }
+    return spark;
+}
+
+const RouteSnapshot *
+RideSnapshots::route(RideItem *item, int count)
+{
+    RideSnapshot &here = snapshot(item);
+    RouteSnapshot &route = here.route;
+
+    if (route.count != count) {
+
+        route = RouteSnapshot();
+        route.count = count;
+
+        RideFile *ride = item->ride();
+        if (ride && ride->areDataPresent()->lat) {
+
+            // every div'th valid position, so we end up with around count points
+            int div = ride->dataPoints().count() / count;
+            int skip = 0;
+            double minlat=999, minlon=999;
+            double maxlat=-999, maxlon=-999;
+
+            foreach(RideFilePoint *p, ride->dataPoints()) {
+
+                // ignore zero values and out of bounds
+                if (p->lat == 0 || p->lon == 0 ||
+                    p->lon < -180 || p->lon > 180 ||
+                    p->lat < -90 || p->lat > 90) continue;
+
+                // extents are from all of them
+                if (p->lat > maxlat) maxlat=p->lat;
+                if (p->lat < minlat) minlat=p->lat;
+                if (p->lon < minlon) minlon=p->lon;
+                if (p->lon > maxlon) maxlon=p->lon;
+
+                if (--skip < 0 || skip == 0) {
+                    route.points << QPointF(p->lon, p->lat);
+                    skip = div;
+                }
+            }
+            if (route.points.count()) route.bounds = QRectF(minlon, minlat, maxlon-minlon, maxlat-minlat);
+        }
+    }
+
+    return route.points.count() ? &route : NULL;
+}
+
+RideSnapshots::PeerSet *
+RideSnapshots::peerSet(QString symbol, RideItem *like)
+{
+    QString want = group(like);
+    QString key = symbol + "|" + want;
+    PeerSet *set = peers.value(key, NULL);
+    if (set) return set;
+
+    // first time asked, so collect and sort once
+    set = new PeerSet;
+    foreach(RideItem *item, rideCache->rides()) {
+        if (item->planned || group(item) != want) continue;
+
+        double v = value(item, symbol, Metric);
+        if (v && !std::isnan(v) && !std::isinf(v)) {
+            set->values.insert(item, v);
+            set->sorted << v;
+        }
+    }
+    qSort(set->sorted);
+    peers.insert(key, set);
+    return set;
+}
+
+void
+RideSnapshots::insert(PeerSet *set, RideItem *item, double v)
+{
+    if (!v || std::isnan(v) || std::isinf(v)) return;
+
+    set->values.insert(item, v);
+    set->sorted.insert(qLowerBound(set->sorted.begin(), set->sorted.end(), v) - set->sorted.begin(), v);
+}
+
+void
+RideSnapshots::remove(PeerSet *set, RideItem *item)
+{
+    if (!set->values.contains(item)) return;
+
+    double v = set->values.take(item);
+    QVector<double>::iterator it = qLowerBound(set->sorted.begin(), set->sorted.end(), v);
+    if (it != set->sorted.end() && *it == v) set->sorted.erase(it);
+}
+
+double
+RideSnapshots::rank(RideItem *item, QString symbol)
+{
+    PeerSet *set = peerSet(symbol, item);
+
+    double v = value(item, symbol, Metric);
+    if (!v || set->sorted.count() == 0) return -1;
+
+    int lower = qLowerBound(set->sorted.begin(), set->sorted.end(), v) - set->sorted.begin();
+    return 100.0 * double(lower) / double(set->sorted.count());
+}
+
+void
+RideSnapshots::rideAdded(RideItem *item)
+{
+    QHashIterator<QString, PeerSet*> it(peers);
+    while (it.hasNext()) {
+        it.next();
+        if (item->planned || it.key().section('|', 1) != group(item)) continue;
+        insert(it.value(), item, value(item, it.key().section('|', 0, 0), Metric));
+    }
+}
+
+void
+RideSnapshots::rideDeleted(RideItem *item)
+{
+    snapshots.remove(item);
+    foreach(PeerSet *set, peers) remove(set, item);
+}
+
+void
+RideSnapshots::itemChanged(RideItem *item)
+{
+    // the sport or date may have changed too
+    rideDeleted(item);
+    rideAdded(item);
+}
+
+void
+RideSnapshots::refreshEnd()
+{
+    // metrics were recomputed, only move those that changed
+    QHashIterator<QString, PeerSet*> it(peers);
+    while (it.hasNext()) {
+        it.next();
+
+        QString symbol = it.key().section('|', 0, 0);
+        PeerSet *set = it.value();
+        foreach(RideItem *item, rideCache->rides()) {
+            if (item->planned || it.key().section('|', 1) != group(item)) continue;
+
+            double v = value(item, symbol, Metric);
+            if (set->values.value(item, 0) != v) {
+                remove(set, item);
+                insert(set, item, v);
+            }
+        }
+    }
+}
+
+void
+RideSnapshots::configChanged(qint32 what)
+{
+    // units change the values, so start again
+    if (what & CONFIG_UNITS) {
+        clearPeers();
+        snapshots.clear();
+    }
+
+    // ranking against different rides
+    if (what & CONFIG_GENERAL) {
+        int type = appsettings->value(NULL, GC_RANK_PEERS, SameSport).toInt();
+        if (type != peerType) {
+            peerType = type;
+            clearPeers();
+        }
+    }
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2020 GoldenCheetah contributors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RideSnapshot_h
+#define _GC_RideSnapshot_h 1
+#include "GoldenCheetah.h"
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <QPointF>
+#include <QRectF>
+
+class Context;
+class RideCache;
+class RideItem;
+
+// values of a metric or metadata field for the rides before
+// one, as shown in the sparkline on an overview card
+struct SparkSnapshot {
+    SparkSnapshot() : min(0), max(0), sum(0), count(0) {}
+
+    QList<QPointF> points;  // x is days into the period
+    double min, max, sum;   // of the points, excluding zeroes
+    int count;
+};
+
+// the GPS track reduced for the route card
+struct RouteSnapshot {
+    RouteSnapshot() : count(-1) {}
+
+    int count;               // asked for, -1 until worked out
+    QVector<QPointF> points; // lon, lat
+    QRectF bounds;
+};
+
+// all we've worked out for one ride, stamped with the
+// ride cache version it was worked out for
+struct RideSnapshot {
+    RideSnapshot() : version(0) {}
+
+    unsigned long version;
+    QHash<QString, SparkSnapshot> sparks;
+    RouteSnapshot route;
+};
+
+//
+// What the overview cards show for a ride besides its own values,
+// worked out once and kept until the rides change.
+//
+// The sparklines look back over prior rides of the same sport, which
+// means finding the ride in the cache and reading a metric from each
+// one before it, for every card, every time a ride is clicked. The
+// ranks need the value of every ride in the cache. So these are kept
+// per ride, and versioned with the ride cache so adding, deleting or
+// editing a ride refreshes them when next asked for.
+//
+// Ranks are against a peer set chosen in preferences; rides of the
+// same sport (the default), of the same sport in the same year, or all
+// of them. The sorted values are kept per metric and peer group and
+// updated in place as rides are added, deleted or have their metrics
+// refreshed, rather than sorted again.
+//
+class RideSnapshots : public QObject
+{
+    Q_OBJECT
+
+    public:
+
+        RideSnapshots(Context *context, RideCache *rideCache);
+        ~RideSnapshots();
+
+        // how the values are read, displayed is rounded as shown
+        enum { Metric, MetricDisplayed, MetaDouble, MetaInteger };
+
+        // who a ride is ranked against, as saved in GC_RANK_PEERS
+        enum { SameSport, SameSportYear, AllRides };
+
+        // prior values over days before the ride
+        const SparkSnapshot &sparkline(RideItem *item, QString symbol, int type, int days);
+
+        // percentile of peers with a lower value, -1 if it has no value
+        double rank(RideItem *item, QString symbol);
+
+        // the track reduced to around count points, NULL if no GPS
+        const RouteSnapshot *route(RideItem *item, int count);
+
+    public slots:
+
+        void rideAdded(RideItem *item);
+        void rideDeleted(RideItem *item);
+        void itemChanged(RideItem *item);
+        void refreshEnd();
+        void configChanged(qint32);
+
+    private:
+
+        Context *context;
+        RideCache *rideCache;
+
+        QHash<RideItem*, RideSnapshot> snapshots;
+        RideSnapshot &snapshot(RideItem *item);
+
+        // values of a metric for every ride of a sport in
+        // ascending order, and the value each one added
+        struct PeerSet {
+            QVector<double> sorted;
+            QHash<RideItem*, double> values;
+        };
+        QHash<QString, PeerSet*> peers; // keyed by symbol|group
+        int peerType;
+        PeerSet *peerSet(QString symbol, RideItem *like);
+        void insert(PeerSet *set, RideItem *item, double value);
+        void remove(PeerSet *set, RideItem *item);
+        double value(RideItem *item, QString symbol, int type);
+        static QString sport(RideItem *item);
+        QString group(RideItem *item) const; // of peers it belongs to
+        void clearPeers();
+
+        // position in rideCache->rides() found by date
+        int indexOf(RideItem *item);
+};
+
+#endif
@@ -149,6 +149,8 @@
 #define GC_BIKESCOREMODE                    "<global-general>bikeScoreMode"
 #define GC_WARNCONVERT                  "<global-general>warnconvert"
 #define GC_WARNEXIT                     "<global-general>warnexit"
+#define GC_RIDE_MEMORY                  "<global-general>rideMemory"                         // MB of activity data kept open
+#define GC_RANK_PEERS                   "<global-general>rankPeers"                          // overview ranks against, see RideSnapshots
 #define GC_HIST_BIN_WIDTH               "<global-general>histogamWindow/binWidth"
 #define GC_WORKOUTDIR                   "<global-general>workoutDir"                         // used for Workouts and Videosyn files
 #define GC_LINEWIDTH                    "<global-general>linewidth"
@@ -265,6 +267,7 @@
 #define GC_BIO                          "<athlete-preferences>bio"
 #define GC_AVATAR                       "<athlete-preferences>avatar"
 #define GC_DISCOVERY                    "<athlete-preferences>intervals/discovery"   // intervals to discover
+#define GC_RIDEINDEX                    "<athlete-preferences>rideindex"             // keep a sqlite index of the ride cache
 #define GC_SB_TODAY                     "<athlete-preferences>PMshowSBtoday"
 #define GC_LTS_DAYS                             "<athlete-preferences>LTSdays"
 #define GC_STS_DAYS                             "<athlete-preferences>STSdays"
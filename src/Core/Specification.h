@@ -21,6 +21,8 @@
 
 #include <QString>
 #include <QStringList>
+#include <QVector>
+#include <QSet>
 #include "TimeUtils.h"
 
 //
@@ -42,35 +44,54 @@ class FilterSet
     // used to collect filters and apply if needed
     QVector<QStringList> filters_;
 
+    // the filters are compiled as they are added into the set of
+    // names that pass all of them, so pass() is a hash lookup and
+    // not a scan of every list. the signature is used by RideCache
+    // to find a compiled bitset for an equivalent filter set
+    QSet<QString> matches_;
+    uint signature_;
+
     public:
 
         // create one with a set
-        FilterSet(bool on, QStringList list) {
-            if (on) filters_ << list;
+        FilterSet(bool on, QStringList list) : signature_(0) {
+            addFilter(on, list);
         }
 
         // create an empty set
-        FilterSet() {}
+        FilterSet() : signature_(0) {}
 
         // add a new filter
         void addFilter(bool on, QStringList list) {
-            if (on) filters_ << list;
+            if (!on) return;
+
+            // filters are AND'ed together
+            if (filters_.count()) matches_.intersect(list.toSet());
+            else matches_ = list.toSet();
+            filters_ << list;
+
+            // independent of order, since sets are unordered
+            signature_ = matches_.count();
+            foreach(QString name, matches_) signature_ += qHash(name);
         }
 
         // clear the filter set
         void clear() {
             filters_.clear();
+            matches_.clear();
+            signature_ = 0;
         }
 
         // does the name in question pass the filter set ?
-        bool pass(QString name) {
-            foreach(QStringList list, filters_)
-                if (!list.contains(name))
-                    return false;
-            return true;
+        bool pass(QString name) const {
+            return filters_.count() == 0 || matches_.contains(name);
         }
 
-        int count() { return filters_.count(); }
+        int count() const { return filters_.count(); }
+
+        // compiled form
+        const QSet<QString> &matches() const { return matches_; }
+        uint signature() const { return signature_; }
 };
 
 class RideFileIterator;
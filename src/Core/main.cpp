@@ -25,6 +25,7 @@
 #include "Colors.h"
 #include "GcUpgrade.h"
 #include "IdleTimer.h"
+#include "EffortSearch.h"
 
 #include <QApplication>
 #include <QDesktopWidget>
@@ -34,6 +35,7 @@
 #include <QWebSettings>
 #endif
 #include <QMessageBox>
+#include <QElapsedTimer>
 #include "ChooseCyclistDialog.h"
 #ifdef GC_WANT_HTTP
 #include "httplistener.h"
@@ -63,6 +65,23 @@ bool restarting = false;
 static bool nogui;
 static int gc_opened=0;
 
+//
+// startup timing, when asked for with --timing each phase is logged
+// with the time since launch until the first view has been painted
+//
+static QElapsedTimer gcstartup;
+static bool gcstarted = false;
+static bool gctiming = false;
+
+void
+startupPhase(QString phase, bool done)
+{
+    if (gcstarted || !gctiming) return;
+
+    qDebug()<<"Startup:"<<phase<<gcstartup.elapsed()<<"ms";
+    if (done) gcstarted = true;
+}
+
 //
 // global application
 //
@@ -173,6 +192,7 @@ int
 main(int argc, char *argv[])
 {
     int ret=2; // return code from qapplication, default to error
+    gcstartup.start();
 
     //
     // PROCESS COMMAND LINE SWITCHES
@@ -196,6 +216,7 @@ main(int argc, char *argv[])
     bool server = false;
     nogui = false;
     bool help = false;
+    bool selftest = false;
 
     // honour command line switches
     foreach (QString arg, sargs) {
@@ -217,6 +238,8 @@ main(int argc, char *argv[])
 #ifdef GC_HAS_CLOUD_DB
             fprintf(stderr, "--clouddbcurator    to add CloudDB curator specific functions to the menus\n");
 #endif
+            fprintf(stderr, "--timing            to log how long each phase of startup takes\n");
+            fprintf(stderr, "--selftest [folder] to check the effort search against a full scan of the rides in folder\n");
 #ifdef GC_WANT_PYTHON
             fprintf(stderr, "--no-python         to disable Python startup\n");
 #endif
@@ -252,6 +275,14 @@ main(int argc, char *argv[])
 #else
             debug = true;
 #endif
+        } else if (arg == "--timing") {
+
+            gctiming = true;
+
+        } else if (arg == "--selftest") {
+
+            selftest = true;
+
         } else if (arg == "--clouddbcurator") {
 #ifdef GC_HAS_CLOUD_DB
             CloudDBCommon::addCuratorFeatures = true;
@@ -329,6 +360,9 @@ main(int argc, char *argv[])
     appsettings->migrateQSettingsSystem(); // colors must be setup before migration can take place, but reading has to be from the migrated ones
     GCColor::readConfig();
 
+    // check the effort search on a folder of rides, test/rides if none given
+    if (selftest) exit(EffortSearch::selfTest(args.count() > 1 ? args[1] : QString("test/rides")) ? 1 : 0);
+
     // set defaultfont - may be adjusted below
     QFont font;
     font.fromString(appsettings->value(NULL, GC_FONT_DEFAULT, QFont().toString()).toString());
@@ -533,6 +567,7 @@ main(int argc, char *argv[])
 
         // Initialize global registry once the translator is installed
         GcWindowRegistry::initialize();
+        startupPhase("metrics and charts registered");
 
         // initialise the trainDB
         trainDB = new TrainDB(home);
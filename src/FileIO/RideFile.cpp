@@ -63,8 +63,8 @@
 const QChar deltaChar(0x0394);
 
 RideFile::RideFile(const QDateTime &startTime, double recIntSecs) :
-            wstale(true), startTime_(startTime), recIntSecs_(recIntSecs),
-            deviceType_("unknown"), data(NULL), wprime_(NULL), 
+            wstale(true), sstale(true), estale(true), startTime_(startTime), recIntSecs_(recIntSecs),
+            deviceType_("unknown"), data(NULL), wprime_(NULL), sums_(NULL), elevation_(NULL), 
             weight_(0), totalCount(0), totalTemp(0), dstale(true)
 {
     command = new RideFileCommand(this);
@@ -79,7 +79,7 @@ RideFile::RideFile(const QDateTime &startTime, double recIntSecs) :
 // when constructing a temporary ridefile when computing intervals
 // and we want to get special fields and ESPECIALLY "CP" and "Weight"
 RideFile::RideFile(RideFile *p) :
-    wstale(true), recIntSecs_(p->recIntSecs_), deviceType_(p->deviceType_), data(NULL), wprime_(NULL), 
+    wstale(true), sstale(true), estale(true), recIntSecs_(p->recIntSecs_), deviceType_(p->deviceType_), data(NULL), wprime_(NULL), sums_(NULL), elevation_(NULL), 
     weight_(p->weight_), totalCount(0), dstale(true)
 {
     startTime_ = p->startTime_;
@@ -100,7 +100,7 @@ RideFile::RideFile(RideFile *p) :
 }
 
 RideFile::RideFile() : 
-    wstale(true), recIntSecs_(0.0), deviceType_("unknown"), data(NULL), wprime_(NULL), 
+    wstale(true), sstale(true), estale(true), recIntSecs_(0.0), deviceType_("unknown"), data(NULL), wprime_(NULL), sums_(NULL), elevation_(NULL), 
     weight_(0), totalCount(0), dstale(true)
 {
     command = new RideFileCommand(this);
@@ -122,6 +122,8 @@ RideFile::~RideFile()
         //delete interval;
     delete command;
     if (wprime_) delete wprime_;
+    if (sums_) delete sums_;
+    if (elevation_) delete elevation_;
 
     // delete any Xdata
     QMapIterator<QString,XDataSeries*> it(xdata_);
@@ -212,6 +214,34 @@ RideFile::wprimeData()
     return wprime_;
 }
 
+RideFileSums *
+RideFile::sums()
+{
+    // points may be appended or removed without a modified signal
+    if (sums_ == NULL || sstale || sums_->points() != dataPoints_.count()) {
+        if (sums_) delete sums_;
+        sums_ = new RideFileSums(this);
+        sstale = false;
+    }
+    return sums_;
+}
+
+RideFileElevation *
+RideFile::elevation()
+{
+    // hysteresis can be configured, we default to 3.0
+    double hysteresis = appsettings->value(NULL, GC_ELEVATION_HYSTERESIS).toDouble();
+    if (hysteresis <= 0.1) hysteresis = 3.00;
+
+    if (elevation_ == NULL || estale || elevation_->hysteresis != hysteresis ||
+        elevation_->samples != dataPoints_.count()) {
+        if (elevation_) delete elevation_;
+        elevation_ = new RideFileElevation(this, hysteresis);
+        estale = false;
+    }
+    return elevation_;
+}
+
 bool
 RideFile::isRun() const
 {
@@ -2155,7 +2185,7 @@ void
 RideFile::emitSaved()
 {
     weight_ = 0;
-    wstale = dstale = true;
+    wstale = sstale = estale = dstale = true;
     emit saved();
 }
 
@@ -2163,7 +2193,7 @@ void
 RideFile::emitReverted()
 {
     weight_ = 0;
-    wstale = dstale = true;
+    wstale = sstale = estale = dstale = true;
     emit reverted();
 }
 
@@ -2171,7 +2201,7 @@ void
 RideFile::emitModified()
 {
     weight_ = 0;
-    wstale = dstale = true;
+    wstale = sstale = estale = dstale = true;
     emit modified();
 }
 
@@ -3376,6 +3406,147 @@ RideFileIterator::previous()
     else return NULL;
 }
 
+RideFileSums::RideFileSums(RideFile *f)
+{
+    int n = f->dataPoints().count();
+    watts.resize(n+1); wattsCount.resize(n+1);
+    hr.resize(n+1); hrCount.resize(n+1);
+    cad.resize(n+1); cadCount.resize(n+1);
+
+    watts[0] = wattsCount[0] = hr[0] = hrCount[0] = cad[0] = cadCount[0] = 0;
+    for (int i=0; i<n; i++) {
+        const RideFilePoint *p = f->dataPoints()[i];
+
+        watts[i+1] = watts[i] + (p->watts >= 0 ? p->watts : 0);
+        wattsCount[i+1] = wattsCount[i] + (p->watts >= 0 ? 1 : 0);
+        hr[i+1] = hr[i] + (p->hr > 0 ? p->hr : 0);
+        hrCount[i+1] = hrCount[i] + (p->hr > 0 ? 1 : 0);
+        cad[i+1] = cad[i] + (p->cad > 0 ? p->cad : 0);
+        cadCount[i+1] = cadCount[i] + (p->cad > 0 ? 1 : 0);
+    }
+}
+
+const QVector<double> *
+RideFileSums::totals(RideFile::SeriesType series, bool counts) const
+{
+    switch (series) {
+    case RideFile::watts : return counts ? &wattsCount : &watts;
+    case RideFile::hr : return counts ? &hrCount : &hr;
+    case RideFile::cad : return counts ? &cadCount : &cad;
+    default: return NULL;
+    }
+}
+
+double
+RideFileSums::sum(RideFile::SeriesType series, int from, int to) const
+{
+    const QVector<double> *t = totals(series, false);
+    if (!t || from < 0 || to < from || to+1 >= t->count()) return 0;
+    return t->at(to+1) - t->at(from);
+}
+
+double
+RideFileSums::count(RideFile::SeriesType series, int from, int to) const
+{
+    const QVector<double> *t = totals(series, true);
+    if (!t || from < 0 || to < from || to+1 >= t->count()) return 0;
+    return t->at(to+1) - t->at(from);
+}
+
+RideFileElevation::RideFileElevation(RideFile *f, double hysteresis)
+    : hysteresis(hysteresis), gain(0), loss(0), samples(f->dataPoints().count())
+{
+    if (samples == 0) return;
+
+    const QVector<RideFilePoint*> &data = f->dataPoints();
+
+    // ASCENT AND DESCENT
+    // altitude only counts once it has moved by more than the hysteresis
+    double running = data[0]->alt;
+    for (int i=1; i<samples; i++) {
+
+        double alt = data[i]->alt;
+        if (alt > running + hysteresis) {
+            gain += alt - running;
+            running = alt;
+            points << QPointF(i, running);
+        } else if (alt < running - hysteresis) {
+            loss += running - alt;
+            running = alt;
+            points << QPointF(i, running);
+        }
+    }
+
+    // peaks and troughs, there are only ups and downs, no flats
+    for (int i=1; i<(points.count()-1); i++) {
+
+        // peak
+        if (points[i].y() > points[i-1].y() &&
+            points[i].y() > points[i+1].y()) peaks << points[i];
+
+        // trough
+        if (points[i].y() < points[i-1].y() &&
+            points[i].y() < points[i+1].y()) peaks << points[i];
+    }
+
+    // CLIMBS
+    // from the lowest point follow the highest point until the
+    // road goes flat or down, then trim the flatter ends and
+    // keep it if it is steep and long enough
+    int pstart = 0, pstop = 0;
+    for (int i=0; i<samples; i++) {
+
+        const RideFilePoint *p = data[i];
+
+        // new min altitude, update start and stop
+        if (data[pstart]->alt > p->alt) pstart = pstop = i;
+
+        // Update max altitude
+        if (data[pstop]->alt < p->alt) pstop = i;
+
+        bool downhill = (data[pstop]->alt > p->alt+0.2*(data[pstop]->alt-data[pstart]->alt));
+        bool flat = (!downhill && (p->km - data[pstop]->km)>1/3.0*(p->km - data[pstart]->km));
+        bool end = (i == samples-1);
+
+        if (flat || downhill || end) {
+
+            if (data[pstop]->km - data[pstart]->km >= 0.5) {
+
+                // Check groundrise at end
+                int start = pstart;
+                int stop = pstop;
+                for (int j=stop; j>start; j--) {
+                    double distance2 = data[pstop]->km - data[j]->km;
+                    if (distance2>0.1) {
+                        if ((data[pstop]->alt-data[j]->alt)/distance2<20.0) pstop = j;
+                        else break;
+                    }
+                }
+
+                // and at the start
+                for (int j=start; j<stop; j++) {
+                    double distance2 = data[j]->km-data[pstart]->km;
+                    if (distance2>0.1) {
+                        if ((data[j]->alt-data[pstart]->alt)/distance2<20.0) pstart = j;
+                        else break;
+                    }
+                }
+
+                double distance = data[pstop]->km - data[pstart]->km;
+                double height = data[pstop]->alt - data[pstart]->alt;
+
+                if (distance >= 0.5 &&
+                    ((distance < 4.0 && height/distance >= 60-10*distance) ||
+                     (distance >= 4.0 && height/distance >= 20))) {
+                    climbs << QPair<int,int>(pstart, pstop);
+                }
+            }
+
+            pstart = pstop;
+        }
+    }
+}
+
 struct CompareXDataPointSecs {
     bool operator()(const XDataPoint *p1, const XDataPoint *p2) {
         return p1->secs < p2->secs;
@@ -26,6 +26,8 @@
 #include <QList>
 #include <QMap>
 #include <QVector>
+#include <QPair>
+#include <QPointF>
 #include <QObject>
 
 class RideItem;
@@ -34,6 +36,8 @@ class Specification;
 class IntervalItem;
 class WPrime;
 class RideFile;
+class RideFileSums;
+class RideFileElevation;
 class XDataSeries;
 class XDataPoint;
 struct RideFilePoint;
@@ -354,6 +358,8 @@ class RideFile : public QObject // QObject to emit signals
         double getHeight(); // legacy - moved to Athlete::getHeight
  
         WPrime *wprimeData(); // return wprime, init/refresh if needed
+        RideFileSums *sums(); // prefix sums, init/refresh if needed
+        RideFileElevation *elevation(); // ascents and climbs, init/refresh if needed
 
         // XDATA
         XDataSeries *xdata(QString name) { return xdata_.value(name, NULL); }
@@ -408,7 +414,7 @@ class RideFile : public QObject // QObject to emit signals
         void emitReverted();
         void emitModified();
 
-        bool wstale;
+        bool wstale, sstale, estale;
 
     private:
 
@@ -429,6 +435,8 @@ class RideFile : public QObject // QObject to emit signals
         QMap<QString,QString> tags_;
         EditorData *data;
         WPrime *wprime_;
+        RideFileSums *sums_;
+        RideFileElevation *elevation_;
         double weight_; // cached to save calls to getWeight();
         double totalCount, totalTemp;
 
@@ -545,6 +553,57 @@ class RideFileIterator {
         int start, stop, index;
 };
 
+// Running totals of the samples so the sum and count over any range of
+// samples, e.g. an interval from RideFileIterator first to last index,
+// can be had without iterating over them. Only the series whose averages
+// are range decomposable are kept; watts counts samples >= 0 whilst hr
+// and cad count samples > 0, as the average metrics do.
+class RideFileSums {
+
+    public:
+
+        RideFileSums(RideFile *f);
+
+        // from and to are inclusive sample indexes
+        double sum(RideFile::SeriesType series, int from, int to) const;
+        double count(RideFile::SeriesType series, int from, int to) const;
+
+        // how many samples when we were built
+        int points() const { return watts.count() - 1; }
+
+    private:
+        const QVector<double> *totals(RideFile::SeriesType series, bool counts) const;
+
+        // element i is the total for samples before i
+        QVector<double> watts, wattsCount, hr, hrCount, cad, cadCount;
+};
+
+// The elevation profile of a ride, worked out in a single pass over the
+// altitude and shared by the elevation metrics, climb discovery and the
+// add interval dialog. Altitude changes smaller than the hysteresis
+// (GC_ELEVATION_HYSTERESIS) are ignored.
+class RideFileElevation {
+
+    public:
+
+        RideFileElevation(RideFile *f, double hysteresis);
+
+        double hysteresis;
+
+        // whole ride gain and loss in meters
+        double gain, loss;
+
+        // sample index and altitude where the hysteresis filtered
+        // altitude changed, and the peaks and troughs among them
+        QVector<QPointF> points, peaks;
+
+        // sample indexes of the start and end of categorised climbs
+        QList<QPair<int,int> > climbs;
+
+        // how many samples when we were built
+        int samples;
+};
+
 #define XDATA_MAXVALUES 32
 
 class XDataPoint {
@@ -28,6 +28,7 @@
 #include "LTMSettings.h" // getAllBestsFor needs this
 
 #include <cmath> // for pow()
+#include <cstring> // for memcpy()
 #include <QDebug>
 #include <QFileInfo>
 #include <QMessageBox>
@@ -353,59 +354,17 @@ QVector<float> RideFileCache::meanMaxPowerFor(Context *context, QVector<float> &
 
 QVector<float> RideFileCache::meanMaxPowerFor(Context *context, QVector<float>&wpk, QString fileName)
 {
-    QTime start;
-    start.start();
-
-    QVector<float> returning;
-
     // Get info for ride file and cache file
     QFileInfo rideFileInfo(fileName);
     QString cacheFilename = context->athlete->home->cache().canonicalPath() + "/" + rideFileInfo.baseName() + ".cpx";
-    QFileInfo cacheFileInfo(cacheFilename);
-
-    // is it up-to-date?
-    if (cacheFileInfo.exists() && cacheFileInfo.size() >= (int)sizeof(struct RideFileCacheHeader)) {
-
-        // we have a file, it is more recent than the ride file
-        // but is it the latest version?
-        RideFileCacheHeader head;
-        QFile cacheFile(cacheFilename);
-        if (cacheFile.open(QIODevice::ReadOnly) == true) {
-
-            // read the header
-            QDataStream inFile(&cacheFile);
-            inFile.readRawData((char *) &head, sizeof(head));
-
-            // check its an up to date format and contains power
-            if (head.version == RideFileCacheVersion && head.wattsMeanMaxCount > 0) {
-
-                // seek to start of meanmax array in the cache
-                long offset = offsetForMeanMax(head, RideFile::watts) + sizeof(head);
-                cacheFile.seek(qint64(offset));
-
-                // read from cache and put straight into QVector memory
-                // a little naughty but seems to work ok
-                returning.resize(head.wattsMeanMaxCount);
-                inFile.readRawData((char*)returning.constData(), head.wattsMeanMaxCount * sizeof(float));
-
-                offset = offsetForMeanMax(head, RideFile::wattsKg) + sizeof(head);
-                cacheFile.seek(qint64(offset));
-
-                wpk.resize(head.wattsKgMeanMaxCount);
-                inFile.readRawData((char*)wpk.constData(), head.wattsKgMeanMaxCount * sizeof(float));
-                for(int i=0; i<wpk.size(); i++) wpk[i] = wpk[i] / 100.00f;
-
-                //qDebug()<<"retrieved:"<<head.wattsMeanMaxCount<<"in:"<<start.elapsed()<<"ms";
-            }
-
-            // we're done reading
-            cacheFile.close();
-        }
-    }
 
     // will be empty if no up to date cache
+    QVector<float> returning = RideFileCacheMap::instance().meanMax(cacheFilename, RideFile::watts);
+    if (returning.count()) {
+        wpk = RideFileCacheMap::instance().meanMax(cacheFilename, RideFile::wattsKg);
+        for(int i=0; i<wpk.size(); i++) wpk[i] = wpk[i] / 100.00f;
+    }
     return returning;
-
 }
 
 // the next 2 are used by the API web services to extract meanmax data from the cache
@@ -413,50 +372,8 @@ QVector<float> RideFileCache::meanMaxPowerFor(Context *context, QVector<float>&w
 // API bests for a ride
 QVector<float> RideFileCache::meanMaxFor(QString cacheFilename, RideFile::SeriesType series)
 {
-    QTime start;
-    start.start();
-
-    QVector<float> returning;
-
-    // Get info for ride file and cache file
-    QFileInfo cacheFileInfo(cacheFilename);
-
-    // is it up-to-date?
-    if (cacheFileInfo.exists() && cacheFileInfo.size() >= (int)sizeof(struct RideFileCacheHeader)) {
-
-        // we have a file, it is more recent than the ride file
-        // but is it the latest version?
-        RideFileCacheHeader head;
-        QFile cacheFile(cacheFilename);
-        if (cacheFile.open(QIODevice::ReadOnly) == true) {
-
-            // read the header
-            QDataStream inFile(&cacheFile);
-            inFile.readRawData((char *) &head, sizeof(head));
-
-            int count = countForMeanMax(head, series);
-
-            // check its an up to date format and contains power
-            if (head.version == RideFileCacheVersion && count>0) {
-
-                // seek to start of meanmax array in the cache
-                long offset = offsetForMeanMax(head, series) + sizeof(head);
-                cacheFile.seek(qint64(offset));
-
-                // read from cache and put straight into QVector memory
-                // a little naughty but seems to work ok
-                returning.resize(count);
-                inFile.readRawData((char*)returning.constData(), count * sizeof(float));
-            }
-
-            // we're done reading
-            cacheFile.close();
-        }
-    }
-
     // will be empty if no up to date cache
-    return returning;
-
+    return RideFileCacheMap::instance().meanMax(cacheFilename, series);
 }
 
 // API bests for a date range
@@ -835,8 +752,11 @@ RideFileCache::refreshCache()
     // set head crc
     crc = RideFile::computeFileCRC(rideFileName);
 
-    // update cache!
-    QFile cacheFile(cacheFileName);
+    // update cache! we write a new file alongside and swap it in once
+    // it is complete, the old one may be mapped and truncating it
+    // underneath a reader would crash it
+    QString newFileName = cacheFileName + ".new";
+    QFile cacheFile(newFileName);
 
     if (cacheFile.open(QIODevice::WriteOnly) == true) {
 
@@ -852,6 +772,12 @@ RideFileCache::refreshCache()
         // all done now, phew
         cacheFile.close();
 
+        if (!RideFileCacheMap::instance().replace(cacheFileName, newFileName)) {
+            qDebug()<<"cannot replace cache file"<<cacheFileName;
+            QFile::remove(newFileName);
+            return;
+        }
+
         // invalidate any incore cache of aggregate
         // that contains this ride in its date range
         QDate date = ride->startTime().date();
@@ -2145,76 +2071,193 @@ int RideFileCache::rank(Context *context, RideFile::SeriesType series, int durat
 double 
 RideFileCache::best(Context *context, QString filename, RideFile::SeriesType series, int duration)
 {
-    // read the header
-    QFileInfo rideFileInfo(context->athlete->home->activities().canonicalPath() + "/" + filename);
-    QString cacheFileName(context->athlete->home->cache().canonicalPath() + "/" + rideFileInfo.baseName() + ".cpx");
-    QFileInfo cacheFileInfo(cacheFileName);
+    QString cacheFileName(context->athlete->home->cache().absolutePath() + "/" + QFileInfo(filename).baseName() + ".cpx");
+    return RideFileCacheMap::instance().best(cacheFileName, series, duration);
+}
 
-    // head
-    RideFileCacheHeader head;
-    QFile cacheFile(cacheFileName);
+int 
+RideFileCache::tiz(Context *context, QString filename, RideFile::SeriesType series, int zone)
+{
+    QString cacheFileName(context->athlete->home->cache().absolutePath() + "/" + QFileInfo(filename).baseName() + ".cpx");
+    return RideFileCacheMap::instance().tiz(cacheFileName, series, zone); // will convert to int
+}
 
-    if (cacheFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered) == true) {
-        QDataStream inFile(&cacheFile);
-        inFile.readRawData((char *) &head, sizeof(head));
+//
+// Memory mapped cpx files
+//
 
-        // out of date or not enough samples
-        if (head.version != RideFileCacheVersion || duration > countForMeanMax(head, series)) {
-            cacheFile.close();
-            return 0;
-        }
+// the file may not exist yet, so resolve via its directory
+static QString canonicalCacheName(QString filename)
+{
+    QFileInfo info(filename);
+    QString dir = QFileInfo(info.absolutePath()).canonicalFilePath();
+    if (dir == "") return info.absoluteFilePath();
+    return dir + "/" + info.fileName();
+}
 
-        // jump to correct offset
-        long offset = offsetForMeanMax(head, series) + (sizeof(float) * (duration));
-        inFile.skipRawData(offset);
+RideFileCacheHandle::RideFileCacheHandle(QString filename) : file(filename), data(NULL), mapped(NULL), size(0)
+{
+    canonical = canonicalCacheName(filename);
 
-        float readhere = 0;
-        inFile.readRawData((char*)&readhere, sizeof(float));
-        cacheFile.close();
+    if (file.open(QIODevice::ReadOnly) == false) return;
 
-        double divisor = pow(10, decimalsFor(series)); // ? 10 : 1;
-        return readhere / divisor; // will convert to double
+    size = file.size();
+    if (size < (qint64)sizeof(RideFileCacheHeader)) {
+        file.close();
+        return;
     }
 
-    return 0;
+    // map it, but some filesystems won't let us so read it all in
+    data = mapped = file.map(0, size);
+    if (data == NULL) {
+        buffer = file.readAll();
+        file.close();
+        size = buffer.size();
+        if (size < (qint64)sizeof(RideFileCacheHeader)) return;
+        data = (const uchar*)buffer.constData();
+    }
+
+    memcpy(&head, data, sizeof(head));
+
+    // out of date, so no use to anyone
+    if (head.version != RideFileCacheVersion) {
+        if (mapped) file.unmap(mapped);
+        if (file.isOpen()) file.close();
+        data = mapped = NULL;
+        buffer.clear();
+    }
 }
 
-int 
-RideFileCache::tiz(Context *context, QString filename, RideFile::SeriesType series, int zone)
+RideFileCacheHandle::~RideFileCacheHandle()
+{
+    if (mapped) file.unmap(mapped);
+    if (file.isOpen()) file.close();
+}
+
+const float *
+RideFileCacheHandle::floats(long offset, long count) const
+{
+    if (data == NULL || offset < 0 || count < 0) return NULL;
+
+    qint64 from = sizeof(RideFileCacheHeader) + offset;
+    if (from + (qint64(count) * sizeof(float)) > size) return NULL;
+
+    return reinterpret_cast<const float*>(data + from);
+}
+
+RideFileCacheMap &
+RideFileCacheMap::instance()
+{
+    static RideFileCacheMap map;
+    return map;
+}
+
+RideFileCacheHandle *
+RideFileCacheMap::handle(QString cacheFileName)
+{
+    RideFileCacheHandle *h = handles.object(cacheFileName);
+    if (h == NULL) {
+        // we remember files that are missing or out of date too, since
+        // they will be invalidated when the cache gets refreshed
+        h = new RideFileCacheHandle(cacheFileName);
+        handles.insert(cacheFileName, h, 1);
+    }
+    return h;
+}
+
+bool
+RideFileCacheMap::available(QString cacheFileName)
+{
+    QMutexLocker locker(&lock);
+    return handle(cacheFileName)->isValid();
+}
+
+double
+RideFileCacheMap::best(QString cacheFileName, RideFile::SeriesType series, int duration)
+{
+    QMutexLocker locker(&lock);
+
+    RideFileCacheHandle *h = handle(cacheFileName);
+    if (!h->isValid() || duration < 0 || duration >= countForMeanMax(h->head, series)) return 0;
+
+    const float *value = h->floats(offsetForMeanMax(h->head, series) + (sizeof(float) * duration), 1);
+    if (value == NULL) return 0;
+
+    double divisor = pow(10, RideFileCache::decimalsFor(series));
+    return *value / divisor;
+}
+
+double
+RideFileCacheMap::tiz(QString cacheFileName, RideFile::SeriesType series, int zone)
 {
     if (zone < 1 || zone > 10) return 0;
 
-    // read the header
-    QFileInfo rideFileInfo(context->athlete->home->activities().canonicalPath() + "/" + filename);
-    QString cacheFileName(context->athlete->home->cache().canonicalPath() + "/" + rideFileInfo.baseName() + ".cpx");
-    QFileInfo cacheFileInfo(cacheFileName);
+    QMutexLocker locker(&lock);
 
-    // head
-    RideFileCacheHeader head;
-    QFile cacheFile(cacheFileName);
+    RideFileCacheHandle *h = handle(cacheFileName);
+    if (!h->isValid()) return 0;
 
-    if (cacheFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered) == true) {
-        QDataStream inFile(&cacheFile);
-        inFile.readRawData((char *) &head, sizeof(head));
+    const float *value = h->floats(offsetForTiz(h->head, series) + (sizeof(float) * (zone-1)), 1);
+    if (value == NULL) return 0;
 
-        // out of date 
-        if (head.version != RideFileCacheVersion) {
-            cacheFile.close();
-            return 0;
-        }
+    return *value;
+}
 
-        // jump to correct offset
-        long offset = offsetForTiz(head, series) + (sizeof(float) * (zone-1));
-        inFile.skipRawData(offset);
+QVector<float>
+RideFileCacheMap::meanMax(QString cacheFileName, RideFile::SeriesType series)
+{
+    QVector<float> returning;
 
-        float readhere = 0;
-        inFile.readRawData((char*)&readhere, sizeof(float));
-        cacheFile.close();
+    QMutexLocker locker(&lock);
+
+    RideFileCacheHandle *h = handle(cacheFileName);
+    if (!h->isValid()) return returning;
+
+    long count = countForMeanMax(h->head, series);
+    const float *values = h->floats(offsetForMeanMax(h->head, series), count);
+    if (values == NULL || count == 0) return returning;
+
+    returning.resize(count);
+    memcpy(returning.data(), values, count * sizeof(float));
+    return returning;
+}
+
+void
+RideFileCacheMap::invalidate(QString cacheFileName)
+{
+    QMutexLocker locker(&lock);
+    drop(cacheFileName);
+}
+
+void
+RideFileCacheMap::drop(QString cacheFileName)
+{
+    QString canonical = canonicalCacheName(cacheFileName);
 
-        return readhere; // will convert to double
+    // the same file may be referenced via different paths
+    foreach(QString key, handles.keys()) {
+        if (key == cacheFileName || handles.object(key)->canonical == canonical)
+            handles.remove(key);
     }
+}
 
-    return 0;
+bool
+RideFileCacheMap::replace(QString cacheFileName, QString newFileName)
+{
+    QMutexLocker locker(&lock);
+
+    // unmap the old one first, it can't be removed whilst mapped on
+    // windows, and rename won't overwrite an existing file
+    drop(cacheFileName);
+    if (QFile::exists(cacheFileName) && !QFile::remove(cacheFileName)) return false;
+    return QFile::rename(newFileName, cacheFileName);
+}
+
+void
+RideFileCacheMap::clear()
+{
+    QMutexLocker locker(&lock);
+    handles.clear();
 }
 
 // get best values (as passed in the list of MetricDetails between the dates specified
@@ -2250,25 +2293,10 @@ RideFileCache::getAllBestsFor(Context *context, QList<MetricDetail> metrics, Spe
         if (!specification.pass(ride)) continue;
 
         // get the ride cache name
+        QString cacheFileName(context->athlete->home->cache().absolutePath() + "/" + QFileInfo(ride->fileName).baseName() + ".cpx");
 
-        // CPX ?
-        QFileInfo rideFileInfo(context->athlete->home->activities().canonicalPath() + "/" + ride->fileName);
-        QString cacheFileName(context->athlete->home->cache().canonicalPath() + "/" + rideFileInfo.baseName() + ".cpx");
-        RideFileCacheHeader head;
-        QFile cacheFile(cacheFileName);
-
-        // open ok ?
-        if (cacheFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered) == false) continue;
-
-        // get header
-        QDataStream inFile(&cacheFile);
-        inFile.readRawData((char *) &head, sizeof(head));
-
-        // out of date - just skip
-        if (head.version != RideFileCacheVersion) {
-            cacheFile.close();
-            continue;
-        }
+        // missing or out of date - just skip
+        if (!RideFileCacheMap::instance().available(cacheFileName)) continue;
 
         RideBest add;
         add.setFileName(ride->fileName);
@@ -2278,31 +2306,11 @@ RideFileCache::getAllBestsFor(Context *context, QList<MetricDetail> metrics, Spe
         foreach (MetricDetail workitem, worklist) {
 
             int seconds = workitem.duration * workitem.duration_units;
-            float value;
-
-            if (seconds > countForMeanMax(head, workitem.series)) value=0.0;
-            else {
-
-                // get the values and place into the summarymetric map
-                long offset = offsetForMeanMax(head, workitem.series) + 
-                              (sizeof(head)) +
-                              (sizeof(float) * ((workitem.duration*workitem.duration_units)));
-
-                cacheFile.seek(qint64(offset));
-                inFile.readRawData((char*)&value, sizeof(float));
-                double divisor = pow(10, decimalsFor(workitem.series));
-                value = value / divisor;
-
-            }
-            add.setForSymbol(workitem.bestSymbol, value);
-
+            add.setForSymbol(workitem.bestSymbol, RideFileCacheMap::instance().best(cacheFileName, workitem.series, seconds));
         }
 
         // add to the results
         results << add;
-
-        // close CPX file
-        cacheFile.close();
     }
 
     // all done, return results
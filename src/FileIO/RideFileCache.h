@@ -23,6 +23,9 @@
 #include <QDataStream>
 #include <QVector>
 #include <QThread>
+#include <QFile>
+#include <QCache>
+#include <QMutex>
 
 class Context;
 class RideFile;
@@ -362,6 +365,77 @@ class RideFileCache
         QVector<float> wbalTimeInZone;      // time in zone in seconds
 };
 
+// RideFileCacheMap holds memory mapped .cpx files so the single value lookups
+// used by the datafilter best() and tiz() functions, ranking, the API and the
+// R and Python bindings don't need to open, read and close the cache file for
+// every value they retrieve. An LTM formula like best(power,300) evaluated
+// across a season would otherwise open every cpx file once per ride per point.
+//
+// It is process wide, bounded to maxhandles open files (least recently used
+// are closed first) and thread safe since lookups happen in the refresh
+// threads as well as the GUI and API threads.
+//
+// Whenever a .cpx file is rewritten or removed the handle must be invalidated
+// before the file is touched, see RideFileCache::refreshCache()
+class RideFileCacheHandle
+{
+    public:
+        RideFileCacheHandle(QString filename);
+        ~RideFileCacheHandle();
+
+        bool isValid() const { return data != NULL; }
+
+        // pointer to count floats at offset from the end of the header
+        // or NULL if the file is truncated (e.g. being written)
+        const float *floats(long offset, long count) const;
+
+        QString canonical;      // canonical path, used for invalidation
+        RideFileCacheHeader head;
+
+    private:
+        QFile file;
+        QByteArray buffer;      // fallback when the file cannot be mapped
+        const uchar *data;
+        uchar *mapped;
+        qint64 size;
+};
+
+class RideFileCacheMap
+{
+    public:
+        static RideFileCacheMap &instance();
+
+        // exists and is the current version
+        bool available(QString cacheFileName);
+
+        // values are returned the same as the RideFileCache static
+        // methods that use them; best is scaled, meanMax is raw
+        double best(QString cacheFileName, RideFile::SeriesType series, int duration);
+        double tiz(QString cacheFileName, RideFile::SeriesType series, int zone);
+        QVector<float> meanMax(QString cacheFileName, RideFile::SeriesType series);
+
+        // the cache file has been (or is about to be) rewritten or deleted
+        void invalidate(QString cacheFileName);
+        void clear();
+
+        // put a newly written file in place of the cache file, nothing
+        // can map it whilst it is swapped over; false if it couldn't be
+        bool replace(QString cacheFileName, QString newFileName);
+
+    private:
+        // drop the handles for the file, lock must be held
+        void drop(QString cacheFileName);
+
+        RideFileCacheMap() : handles(maxhandles) {}
+
+        // get the handle, opening and mapping if needed, lock must be held
+        RideFileCacheHandle *handle(QString cacheFileName);
+
+        static const int maxhandles = 256; // keep well under the fd limits
+        QMutex lock;
+        QCache<QString, RideFileCacheHandle> handles;
+};
+
 // Ride Bests in an associative array
 // used to plot peak x seconds on LTM
 
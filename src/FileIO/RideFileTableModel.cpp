@@ -454,16 +454,17 @@ RideFileTableModel::endCommand(bool undo, RideCommand *cmd)
     }
 }
 
-// Tooltips are kept in a QMap, since they SHOULD be sparse
-static QString xsstring(int x, RideFile::SeriesType series)
+// Tooltips are kept in a QHash, since they SHOULD be sparse, and
+// the key is just the row and series since we look them up a lot
+static qint64 xskey(int x, RideFile::SeriesType series)
 {
-    return QString("%1:%2").arg((int)x).arg(static_cast<int>(series));
+    return (qint64(x) << 8) | series;
 }
 
 void
 RideFileTableModel::setToolTip(int row, RideFile::SeriesType series, QString text)
 {
-    QString key = xsstring(row, series);
+    qint64 key = xskey(row, series);
 
     // if text is blank we are removing it
     if (text == "") tooltips.remove(key);
@@ -475,6 +476,5 @@ RideFileTableModel::setToolTip(int row, RideFile::SeriesType series, QString tex
 QString
 RideFileTableModel::toolTip(int row, RideFile::SeriesType series) const
 {
-    QString key = xsstring(row, series);
-    return tooltips.value(key, "");
+    return tooltips.value(xskey(row, series), "");
 }
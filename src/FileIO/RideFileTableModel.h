@@ -24,6 +24,7 @@
 #include "RideFileCommand.h"
 #include "Context.h"
 #include <QAbstractTableModel>
+#include <QHash>
 
 //
 // Provides a QAbstractTableModel interface to a ridefile and can be used as a
@@ -96,7 +97,7 @@ class RideFileTableModel : public QAbstractTableModel
 
     private:
         RideFile *ride;
-        QMap <QString,QString> tooltips;
+        QHash <qint64,QString> tooltips;
 
         QStringList headings_;
         QVector<RideFile::SeriesType> headingsType;
@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2020 GoldenCheetah contributors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RideTrack.h"
+#include "RideItem.h"
+#include "RideFile.h"
+#include "Context.h"
+#include "Athlete.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <float.h>
+#include <cmath>
+
+// a run of gps samples still to be split
+struct TrackSegment {
+    TrackSegment() : from(0), to(0), limit(0) {}
+    TrackSegment(int from, int to, float limit) : from(from), to(to), limit(limit) {}
+    int from, to;
+    float limit;
+};
+
+RideTrack::RideTrack(Context *context, RideItem *item) : item(item)
+{
+    RideFile *ride = item->ride();
+    if (!ride) return;
+
+    QFileInfo rideFileInfo(item->path + "/" + item->fileName);
+    cacheFileName = context->athlete->home->cache().canonicalPath() + "/" + rideFileInfo.baseName() + ".trk";
+
+    // unsaved changes are never written to the cache
+    if (item->isDirty()) {
+        simplify(ride);
+        return;
+    }
+
+    if (!readCache(ride)) {
+        simplify(ride);
+        writeCache();
+    }
+}
+
+bool
+RideTrack::stale() const
+{
+    RideFile *ride = item ? item->ride() : NULL;
+    return ride && significance.count() != ride->dataPoints().count();
+}
+
+double
+RideTrack::tolerance(int zoom)
+{
+    // a 256 pixel tile spans the globe at zoom 0
+    if (zoom < 0) zoom = 0;
+    if (zoom > 22) zoom = 22;
+    return 360.0 / (256.0 * double(1 << zoom));
+}
+
+int
+RideTrack::zoomFor(double minLat, double minLon, double maxLat, double maxLon, int width, int height)
+{
+    // the widest zoom that shows the whole box, as fitBounds does
+    if (width <= 0) width = 256;
+    if (height <= 0) height = 256;
+    double lonspan = qMax(maxLon - minLon, 0.000001);
+    double latspan = qMax(maxLat - minLat, 0.000001) / cos(((minLat+maxLat)/2.0) * M_PI / 180.0);
+
+    int zoom = 22;
+    while (zoom > 0 && (lonspan > width * tolerance(zoom) || latspan > height * tolerance(zoom))) zoom--;
+    return zoom;
+}
+
+QVariantList
+RideTrack::latlons(int zoom, double start, double stop) const
+{
+    QVariantList returning;
+    RideFile *ride = item ? item->ride() : NULL;
+    if (!ride) return returning;
+
+    // not simplified for what's there now, so send the lot
+    bool all = significance.count() != ride->dataPoints().count();
+
+    int first = -1, last = -1;
+    if (stop >= 0) ends(start, stop, first, last);
+
+    double tol = tolerance(zoom);
+    for (int i=0; i<ride->dataPoints().count(); i++) {
+
+        if (!all && significance[i] < tol && i != first && i != last) continue;
+
+        const RideFilePoint *p = ride->dataPoints()[i];
+        if (all && !p->lat && !p->lon) continue;
+        if (stop >= 0 && (p->secs+ride->recIntSecs() <= start || p->secs >= stop)) continue;
+
+        returning << p->lat;
+        returning << p->lon;
+    }
+    return returning;
+}
+
+void
+RideTrack::ends(double start, double stop, int &first, int &last) const
+{
+    first = last = -1;
+    RideFile *ride = item ? item->ride() : NULL;
+    if (!ride) return;
+
+    for (int i=0; i<ride->dataPoints().count(); i++) {
+        const RideFilePoint *p = ride->dataPoints()[i];
+        if (!p->lat && !p->lon) continue;
+        if (p->secs+ride->recIntSecs() <= start || p->secs >= stop) continue;
+
+        if (first < 0) first = i;
+        last = i;
+    }
+}
+
+void
+RideTrack::simplify(RideFile *ride)
+{
+    const QVector<RideFilePoint*> &data = ride->dataPoints();
+    significance.fill(-1, data.count());
+
+    // just the samples with a position, and the latitude
+    // we use to scale longitude so distances are even-ish
+    QVector<int> gps;
+    double latsum = 0;
+    for (int i=0; i<data.count(); i++) {
+        if (data[i]->lat || data[i]->lon) {
+            gps << i;
+            latsum += data[i]->lat;
+        }
+    }
+    if (gps.count() == 0) return;
+
+    double scale = cos((latsum / gps.count()) * M_PI / 180.0);
+
+    // the ends are always kept
+    significance[gps.first()] = FLT_MAX;
+    significance[gps.last()] = FLT_MAX;
+
+    // Douglas-Peucker without a tolerance; each split point is given
+    // the distance that split it, but no more than its parent so that
+    // a point is never kept when the segment that contains it isn't
+    QVector<TrackSegment> stack;
+    stack << TrackSegment(0, gps.count()-1, FLT_MAX);
+
+    while (stack.count()) {
+
+        TrackSegment s = stack.last();
+        stack.removeLast();
+        if (s.to - s.from < 2) continue;
+
+        const RideFilePoint *a = data[gps[s.from]];
+        const RideFilePoint *b = data[gps[s.to]];
+        double ax = a->lon * scale, ay = a->lat;
+        double dx = (b->lon * scale) - ax, dy = b->lat - ay;
+        double len2 = dx*dx + dy*dy;
+
+        // furthest point from the line a-b
+        int split = -1;
+        double furthest = -1;
+        for (int j=s.from+1; j<s.to; j++) {
+
+            const RideFilePoint *p = data[gps[j]];
+            double px = (p->lon * scale) - ax, py = p->lat - ay;
+
+            double d2;
+            if (len2 > 0) {
+                double t = qBound(0.0, (px*dx + py*dy) / len2, 1.0);
+                double ex = px - t*dx, ey = py - t*dy;
+                d2 = ex*ex + ey*ey;
+            } else {
+                d2 = px*px + py*py;
+            }
+            if (d2 > furthest) {
+                furthest = d2;
+                split = j;
+            }
+        }
+
+        float sig = qMin(float(sqrt(furthest)), s.limit);
+        significance[gps[split]] = sig;
+        stack << TrackSegment(s.from, split, sig);
+        stack << TrackSegment(split, s.to, sig);
+    }
+}
+
+bool
+RideTrack::readCache(RideFile *ride)
+{
+    QFileInfo cacheFileInfo(cacheFileName);
+    QFileInfo rideFileInfo(item->path + "/" + item->fileName);
+    if (!cacheFileInfo.exists() || rideFileInfo.lastModified() > cacheFileInfo.lastModified()) return false;
+
+    QFile cacheFile(cacheFileName);
+    if (!cacheFile.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream in(&cacheFile);
+    in.setVersion(QDataStream::Qt_4_6);
+    in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    quint32 version, count;
+    in >> version >> count;
+    if (version != RideTrackVersion || int(count) != ride->dataPoints().count()) return false;
+
+    significance.resize(count);
+    for (quint32 i=0; i<count; i++) in >> significance[i];
+
+    if (in.status() != QDataStream::Ok) {
+        significance.clear();
+        return false;
+    }
+    return true;
+}
+
+void
+RideTrack::writeCache()
+{
+    QFile cacheFile(cacheFileName);
+    if (!cacheFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) return;
+
+    QDataStream out(&cacheFile);
+    out.setVersion(QDataStream::Qt_4_6);
+    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    out << quint32(RideTrackVersion) << quint32(significance.count());
+    foreach(float s, significance) out << s;
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2020 GoldenCheetah contributors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RideTrack_h
+#define _GC_RideTrack_h 1
+#include "GoldenCheetah.h"
+
+#include <QVector>
+#include <QVariantList>
+#include <QPointer>
+
+#include "RideItem.h"
+
+class Context;
+class RideFile;
+
+// increment when the cache file format or simplification changes
+#define RideTrackVersion 1
+
+//
+// The GPS track of a ride simplified for drawing on a map.
+//
+// Each GPS sample is given a significance; the largest Douglas-Peucker
+// tolerance (in degrees) at which it would still be kept. Drawing the
+// track at a map zoom level then only needs those samples that are more
+// significant than a pixel at that zoom, so the map gets a few thousand
+// points rather than every sample of a multi-day ride.
+//
+// The significance is saved in the athlete cache alongside the .cpx
+// file (as .trk) and reused until the ride file changes.
+//
+// We don't hold on to the ride data since it may be closed to save
+// memory, or edited; it is fetched from the ride item when needed and
+// the track is stale once the samples no longer match it.
+//
+class RideTrack {
+
+    public:
+
+        RideTrack(Context *context, RideItem *item);
+
+        // lat,lon pairs for samples between start and stop secs
+        // (the whole ride when stop < 0) needed at this zoom level,
+        // every sample with a position if the track is stale; the
+        // ends of the range are always included, see ends()
+        QVariantList latlons(int zoom, double start=-1, double stop=-1) const;
+
+        // first and last samples with a position between start and stop
+        // secs, -1 if there are none. They are drawn at every zoom level
+        // so a short interval doesn't vanish when zoomed out
+        void ends(double start, double stop, int &first, int &last) const;
+
+        // the samples have changed since, so it needs building again
+        bool stale() const;
+
+        // is sample index needed at this zoom level?
+        bool significant(int index, int zoom) const {
+            return index >= 0 && index < significance.count() && significance[index] >= tolerance(zoom);
+        }
+
+        // degrees per pixel at a google/osm zoom level
+        static double tolerance(int zoom);
+
+        // zoom level that fits the bounding box into the size in pixels
+        static int zoomFor(double minLat, double minLon, double maxLat, double maxLon, int width, int height);
+
+    private:
+
+        QPointer<RideItem> item;
+        QVector<float> significance; // per sample, -1 if no gps
+
+        QString cacheFileName;
+        bool readCache(RideFile *ride);
+        void writeCache();
+        void simplify(RideFile *ride);
+};
+
+#endif
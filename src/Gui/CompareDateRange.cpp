@@ -26,23 +26,15 @@
 RideFileCache *
 CompareDateRange::rideFileCache()
 {
-    // refresh cache if incomplete, return otherwise
-    if (cache) {
-        if (cache->incomplete == false) return cache;
-        else {
-            delete cache;
-            cache = NULL;
-        }
-    }
+    // refresh cache if incomplete, return otherwise, other
+    // copies keep the old one until they refresh too
+    if (cache && cache->incomplete == false) return cache.data();
 
-    // create one and set        
-    return (cache = new RideFileCache(sourceContext, start, end, false, QStringList(), true));
+    // create one and set
+    cache = QSharedPointer<RideFileCache>(new RideFileCache(sourceContext, start, end, false, QStringList(), true));
+    return cache.data();
 }
 
 CompareDateRange::~CompareDateRange()
 {
-    if (cache) {
-        //XXX need to reference count! delete cache;
-        cache = NULL;
-    }
 }
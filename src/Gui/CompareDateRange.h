@@ -27,11 +27,12 @@ class RideFileCache;
 #include <QColor>
 #include <QDate>
 #include <QString>
+#include <QSharedPointer>
 
 class CompareDateRange
 {
     public:
-        CompareDateRange() : context(NULL), days(0), sourceContext(NULL), checked(false), cache(NULL) {}
+        CompareDateRange() : context(NULL), days(0), sourceContext(NULL), checked(false) {}
         ~CompareDateRange();
 
         Context *context;
@@ -49,7 +50,8 @@ class CompareDateRange
         RideFileCache *rideFileCache();
 
     private:
-        RideFileCache *cache;
+        // shared by the copies charts take, see CompareInterval
+        QSharedPointer<RideFileCache> cache;
 };
 
 #endif
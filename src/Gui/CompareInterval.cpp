@@ -24,24 +24,20 @@
 #include <QColor>
 
 CompareInterval::CompareInterval(Context *context, QString name, RideFile *data, QColor color, Context *sourceContext, bool checked) :
-    context(context), name(name), rideItem(NULL), data(data), color(color), sourceContext(sourceContext), checked(checked),  cache(NULL)
+    context(context), name(name), rideItem(NULL), data(data), color(color), sourceContext(sourceContext), checked(checked)
 {
 }
 
-CompareInterval::CompareInterval() : context(NULL), rideItem(NULL), data(NULL), sourceContext(NULL), checked(false),  cache(NULL)
+CompareInterval::CompareInterval() : context(NULL), rideItem(NULL), data(NULL), sourceContext(NULL), checked(false)
 {
 }
 
 RideFileCache *CompareInterval::rideFileCache()
 {   
-    if (cache) return cache;
-    else return (cache = RideFileCache::createCacheFor(data));
+    if (!cache) cache = QSharedPointer<RideFileCache>(RideFileCache::createCacheFor(data));
+    return cache.data();
 }
 
 CompareInterval::~CompareInterval()
 {
-    if (cache) {
-        //XXX need to reference count! delete cache;
-        cache = NULL;
-    }
 }
@@ -27,6 +27,7 @@ class RideItem;
 #include <QObject>
 #include <QColor>
 #include <QUuid>
+#include <QSharedPointer>
 
 
 class CompareInterval
@@ -51,7 +52,9 @@ class CompareInterval
         void setChecked(bool x) { checked=x; }
 
     private:
-        RideFileCache *cache;
+        // shared by the copies charts take, so it is only
+        // computed once and deleted with the last of them
+        QSharedPointer<RideFileCache> cache;
 };
 
 #endif
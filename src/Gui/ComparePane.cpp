@@ -33,6 +33,13 @@
 #include "Utils.h"
 
 #include <QCheckBox>
+#include <QApplication>
+#include <QFutureWatcher>
+#if QT_VERSION > 0x050000
+#include <QtConcurrent>
+#else
+#include <QtConcurrentMap>
+#endif
 #include <QFormLayout>
 #include <QTextEdit>
 
@@ -151,6 +158,16 @@ ComparePane::ComparePane(Context *context, QWidget *parent, CompareMode mode) :
 
     connect(context, SIGNAL(configChanged(qint32)), this, SLOT(configChanged(qint32)));
     connect(table->horizontalHeader(), SIGNAL(sectionClicked(int)), this, SLOT(itemsWereSorted()));
+    connect(&watcher, SIGNAL(finished()), this, SLOT(prepared()));
+}
+
+ComparePane::~ComparePane()
+{
+    // they are being worked on in our list
+    watcher.cancel();
+    watcher.waitForFinished();
+    if (preparing.count()) QApplication::restoreOverrideCursor();
+    foreach(CompareInterval ci, preparing) delete ci.data;
 }
 
 void
@@ -616,6 +633,69 @@ ComparePane::daterangeButtonsChanged()
     if (changed) context->notifyCompareDateRangesChanged();
 }
 
+// the expensive part of adding an interval, once its data
+// and fake ride item have been set up on the GUI thread
+void
+ComparePane::prepareInterval(CompareInterval &add)
+{
+    add.data->recalculateDerivedSeries();
+
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+
+    QHash<QString,RideMetricPtr> computed= RideMetric::computeMetrics(add.rideItem, Specification(), factory.allMetrics());
+    add.rideItem->metrics_.fill(0, factory.metricCount());
+    add.rideItem->count_.fill(0, factory.metricCount());
+    QHashIterator<QString, RideMetricPtr> l(computed);
+    while (l.hasNext()) {
+        l.next();
+        add.rideItem->metrics_[l.value()->index()] = l.value()->value();
+        add.rideItem->count_[l.value()->index()] = l.value()->count();
+    }
+    for(int j=0; j<factory.metricCount(); j++)
+        if (std::isinf(add.rideItem->metrics_[j]) || std::isnan(add.rideItem->metrics_[j]))
+            add.rideItem->metrics_[j] = 0.00f;
+
+    // mean max and distributions
+    add.rideFileCache();
+}
+
+void
+ComparePane::prepare(QList<CompareInterval> &intervals)
+{
+    // don't take any more drops until we're done
+    setAcceptDrops(false);
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+
+    // added when they're ready, see prepared()
+    preparing = intervals;
+    preparingFor = context;
+    watcher.setFuture(QtConcurrent::map(preparing, prepareInterval));
+}
+
+void
+ComparePane::prepared()
+{
+    QApplication::restoreOverrideCursor();
+    setAcceptDrops(true);
+
+    QList<CompareInterval> newOnes = preparing;
+    preparing.clear();
+
+    // the context may have gone while we were busy
+    if (preparingFor.isNull()) {
+        foreach(CompareInterval ci, newOnes) delete ci.data;
+        return;
+    }
+
+    context->compareIntervals.append(newOnes);
+
+    // refresh the table to reflect the new list
+    refreshTable();
+
+    // let all the charts know
+    context->notifyCompareIntervalsChanged();
+}
+
 void 
 ComparePane::dragEnterEvent(QDragEnterEvent *event)
 {
@@ -779,8 +859,6 @@ ComparePane::dropEvent(QDropEvent *event)
                 }
             }
 
-            add.data->recalculateDerivedSeries();
-
             // just use standard colors and cycle round
             // we will of course repeat, but the user can
             // just edit them using the button
@@ -799,22 +877,7 @@ ComparePane::dropEvent(QDropEvent *event)
             add.rideItem->isSwim = add.data->isSwim();
             add.rideItem->present = add.data->getTag("Data", "");
             add.rideItem->samples = add.data->dataPoints().count() > 0;
-
-            const RideMetricFactory &factory = RideMetricFactory::instance();
-
-            QHash<QString,RideMetricPtr> computed= RideMetric::computeMetrics(add.rideItem, Specification(), factory.allMetrics());
-            add.rideItem->metrics_.fill(0, factory.metricCount());
-            add.rideItem->count_.fill(0, factory.metricCount());
-            QHashIterator<QString, RideMetricPtr> l(computed);
-            while (l.hasNext()) {
-                l.next();
-                add.rideItem->metrics_[l.value()->index()] = l.value()->value();
-                add.rideItem->count_[l.value()->index()] = l.value()->count();
-            }
-            for(int j=0; j<factory.metricCount(); j++)
-                if (std::isinf(add.rideItem->metrics_[j]) || std::isnan(add.rideItem->metrics_[j]))
-                    add.rideItem->metrics_[j] = 0.00f;
-            // end of fake RideItem hack XXX
+            // end of fake RideItem hack XXX, metrics are computed in prepareInterval()
 
             // now add but only if not empty
             if (!add.data->dataPoints().empty()) newOnes << add;
@@ -931,7 +994,6 @@ ComparePane::dropEvent(QDropEvent *event)
                                     l->apower = p->apower;
                                 }
                             }
-                            add.data->recalculateDerivedSeries();
 
                             // construct a fake RideItem, slightly hacky need to fix this later XXX fixme
                             //                            mostly cut and paste from RideItem::refresh
@@ -946,21 +1008,7 @@ ComparePane::dropEvent(QDropEvent *event)
                             add.rideItem->isSwim = add.data->isSwim();
                             add.rideItem->present = add.data->getTag("Data", "");
                             add.rideItem->samples = add.data->dataPoints().count() > 0;
-
-                            const RideMetricFactory &factory = RideMetricFactory::instance();
-                            QHash<QString,RideMetricPtr> computed= RideMetric::computeMetrics(add.rideItem, Specification(), factory.allMetrics());
-                            add.rideItem->metrics_.fill(0, factory.metricCount());
-                            add.rideItem->count_.fill(0, factory.metricCount());
-                            QHashIterator<QString, RideMetricPtr> l(computed);
-                            while (l.hasNext()) {
-                                l.next();
-                                add.rideItem->metrics_[l.value()->index()] = l.value()->value();
-                                add.rideItem->count_[l.value()->index()] = l.value()->count();
-                            }
-                            for(int j=0; j<factory.metricCount(); j++)
-                                if (std::isinf(add.rideItem->metrics_[j]) || std::isnan(add.rideItem->metrics_[j]))
-                                    add.rideItem->metrics_[j] = 0.00f;
-                            // end of fake RideItem hack XXX
+                            // end of fake RideItem hack XXX, metrics are computed in prepareInterval()
 
                             // just use standard colors and cycle round
                             // we will of course repeat, but the user can
@@ -978,13 +1026,12 @@ ComparePane::dropEvent(QDropEvent *event)
         // how many we get ?
         if (newOnes.count()) {
 
-            context->compareIntervals.append(newOnes);
-
-            // refresh the table to reflect the new list
-            refreshTable();
-
-            // let all the charts know
-            context->notifyCompareIntervalsChanged();
+            // derived series, metrics, mean max and distributions for the
+            // new ones only, in parallel and off the GUI thread. The charts
+            // all share them rather than working them out again for
+            // themselves, see CompareInterval::rideFileCache(). They are
+            // added when done, we don't wait here in the drop event
+            prepare(newOnes);
         }
 
     } else { // SEASONS
@@ -1028,6 +1075,10 @@ ComparePane::dropEvent(QDropEvent *event)
         // how many we get ?
         if (newOnes.count()) {
 
+            // aggregate once for all the charts to share, this uses the
+            // athlete's cpx cache so it stays on the GUI thread
+            for(int i=0; i<newOnes.count(); i++) newOnes[i].rideFileCache();
+
             context->compareDateRanges.append(newOnes);
 
             // refresh the table to reflect the new list
@@ -25,6 +25,8 @@
 #include <QTableWidget>
 #include <QScrollArea>
 #include <QDialog>
+#include <QPointer>
+#include <QFutureWatcher>
 
 #include "GcSideBarItem.h"
 #include "Context.h"
@@ -40,6 +42,7 @@ class ComparePane : public QWidget
         typedef enum mode CompareMode;
 
         ComparePane(Context *context, QWidget *parent, CompareMode mode=interval);
+        ~ComparePane();
 
     protected:
         void dragEnterEvent(QDragEnterEvent*);
@@ -58,8 +61,17 @@ class ComparePane : public QWidget
         void intervalButtonsChanged();
         void daterangeButtonsChanged();
 
+        void prepared(); // new intervals are ready to add
+
     protected:
         void refreshTable();
+        void prepare(QList<CompareInterval> &intervals);
+        static void prepareInterval(CompareInterval &add);
+
+        // dropped intervals being prepared in the background
+        QList<CompareInterval> preparing;
+        QPointer<Context> preparingFor;
+        QFutureWatcher<void> watcher;
 
     private:
         Context *context;
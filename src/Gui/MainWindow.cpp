@@ -28,6 +28,7 @@
 #include <QTabBar>
 #include <QStyleFactory>
 #include <QRect>
+#include <QProgressDialog>
 
 // DATA STRUCTURES
 #include "MainWindow.h"
@@ -37,6 +38,8 @@
 
 #include "Colors.h"
 #include "RideCache.h"
+#include "MetricExport.h"
+#include "MetricExportDialog.h"
 #include "RideItem.h"
 #include "IntervalItem.h"
 #include "RideFile.h"
@@ -147,7 +150,9 @@ MainWindow::MainWindow(const QDir &home)
     // bootstrap
     Context *context = new Context(this);
     context->athlete = new Athlete(context, home);
+    startupPhase("athlete opened");
     currentTab = new Tab(context);
+    startupPhase("views created");
 
     // get rid of splash when currentTab is shown
     clearSplash();
@@ -472,7 +477,7 @@ MainWindow::MainWindow(const QDir &home)
     optionsMenu->addAction(tr("Scan disk for workouts, videos, videoSyncs..."), this, SLOT(manageLibrary()));
 
     optionsMenu->addAction(tr("Create Heat Map..."), this, SLOT(generateHeatMap()), tr(""));
-    optionsMenu->addAction(tr("Export Metrics as CSV..."), this, SLOT(exportMetrics()), tr(""));
+    optionsMenu->addAction(tr("Export Metrics..."), this, SLOT(exportMetrics()), tr(""));
 
 #ifdef GC_HAS_CLOUD_DB
     // CloudDB options
@@ -1938,12 +1943,40 @@ MainWindow::exportMetrics()
         return;
     }
 
-    // all good lets choose a file
-    QString fileName = QFileDialog::getSaveFileName( this, tr("Export Metrics"), QDir::homePath(), tr("Comma Separated Variables (*.csv)"));
-    if (fileName.length() == 0) return;
+    // all good lets choose what to export and where
+    MetricExportDialog dialog(currentTab->context);
+    if (dialog.exec() != QDialog::Accepted) return;
+
+    // written in the background, it goes when the tab does if not before
+    MetricExport *exporter = new MetricExport(currentTab->context);
+    exporter->setParent(currentTab);
+    dialog.configure(exporter);
+
+    if (!exporter->start(dialog.fileName())) {
+        QMessageBox::critical(this, tr("Export Metrics"), exporter->errorString());
+        delete exporter;
+        return;
+    }
+
+    QProgressDialog *progress = new QProgressDialog(tr("Exporting metrics..."), tr("Cancel"), 0, 100, this);
+    progress->setAttribute(Qt::WA_DeleteOnClose);
+    progress->setMinimumDuration(500);
+    connect(exporter, SIGNAL(progress(int)), progress, SLOT(setValue(int)));
+    connect(progress, SIGNAL(canceled()), exporter, SLOT(cancel()));
+    connect(exporter, SIGNAL(finished(bool)), progress, SLOT(close()));
+    connect(exporter, SIGNAL(finished(bool)), this, SLOT(exportMetricsDone(bool)));
+    connect(exporter, SIGNAL(finished(bool)), exporter, SLOT(deleteLater()));
+}
+
+void
+MainWindow::exportMetricsDone(bool ok)
+{
+    MetricExport *exporter = qobject_cast<MetricExport*>(sender());
+    if (exporter == NULL || ok) return;
 
-    // export
-    currentTab->context->athlete->rideCache->writeAsCSV(fileName);
+    // don't leave half a file behind
+    if (exporter->isCancelled()) QFile::remove(exporter->fileName());
+    else QMessageBox::critical(this, tr("Export Metrics"), exporter->errorString());
 }
 
 /*----------------------------------------------------------------------
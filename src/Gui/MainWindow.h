@@ -72,6 +72,7 @@ class Tab;
 extern QList<MainWindow *> mainwindows; // keep track of all the MainWindows we have open
 extern QDesktopWidget *desktop;         // how many screens / res etc
 extern QString gcroot;                  // root directory for gc
+extern void startupPhase(QString phase, bool done=false); // startup timing (see main.cpp)
 
 class MainWindow : public QMainWindow
 {
@@ -220,6 +221,7 @@ class MainWindow : public QMainWindow
         void exportBatch();
         void generateHeatMap();
         void exportMetrics();
+        void exportMetricsDone(bool);
         void addAccount();
         void manualProcess(QString);
         void importFile();
@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2020 GoldenCheetah contributors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "MetricExportDialog.h"
+#include "MetricExport.h"
+#include "Athlete.h"
+#include "Colors.h"
+#include "RideCache.h"
+#include "RideItem.h"
+#include "RideMetric.h"
+#include "RideMetadata.h"
+#include "Specification.h"
+
+#include <QVBoxLayout>
+#include <QGridLayout>
+#include <QFileDialog>
+#include <QMessageBox>
+
+MetricExportDialog::MetricExportDialog(Context *context) : QDialog(context->mainWindow), context(context)
+{
+    setWindowTitle(tr("Export Metrics"));
+
+    // make the dialog a resonable size
+    setMinimumWidth(450 *dpiXFactor);
+    setMinimumHeight(500 *dpiYFactor);
+
+    QVBoxLayout *layout = new QVBoxLayout;
+    setLayout(layout);
+
+    // what and how
+    content = new QComboBox(this);
+    content->addItem(tr("Activity metrics"), MetricExport::Activities);
+    content->addItem(tr("Interval metrics"), MetricExport::Intervals);
+    content->addItem(tr("Activity samples"), MetricExport::Samples);
+
+    format = new QComboBox(this);
+    format->addItems(MetricExport::filters());
+
+    // all of them by default
+    QDate first = QDate::currentDate();
+    if (context->athlete->rideCache->rides().count())
+        first = context->athlete->rideCache->rides().first()->dateTime.date();
+
+    from = new QDateEdit(first, this);
+    from->setCalendarPopup(true);
+    to = new QDateEdit(QDate::currentDate(), this);
+    to->setCalendarPopup(true);
+
+    filtered = new QCheckBox(tr("Only activities that pass the current filter"), this);
+    filtered->setChecked(context->isfiltered || context->ishomefiltered);
+    filtered->setEnabled(context->isfiltered || context->ishomefiltered);
+
+    QGridLayout *grid = new QGridLayout;
+    grid->addWidget(new QLabel(tr("Export"), this), 0,0, Qt::AlignLeft);
+    grid->addWidget(content, 0,1, Qt::AlignLeft);
+    grid->addWidget(new QLabel(tr("Format"), this), 1,0, Qt::AlignLeft);
+    grid->addWidget(format, 1,1, Qt::AlignLeft);
+    grid->addWidget(new QLabel(tr("From"), this), 2,0, Qt::AlignLeft);
+    grid->addWidget(from, 2,1, Qt::AlignLeft);
+    grid->addWidget(new QLabel(tr("To"), this), 3,0, Qt::AlignLeft);
+    grid->addWidget(to, 3,1, Qt::AlignLeft);
+    grid->addWidget(filtered, 4,1, Qt::AlignLeft);
+    grid->setColumnStretch(0, 1);
+    grid->setColumnStretch(1, 10);
+
+    // the columns, filled in for the content chosen
+    columns = new QTreeWidget(this);
+    columns->headerItem()->setText(0, tr("Columns"));
+    columns->setColumnCount(1);
+    columns->setUniformRowHeights(true);
+    columns->setIndentation(0);
+
+    all = new QCheckBox(tr("check/uncheck all"), this);
+    all->setChecked(true);
+
+    // buttons
+    QHBoxLayout *buttons = new QHBoxLayout;
+    cancel = new QPushButton(tr("Cancel"), this);
+    ok = new QPushButton(tr("Export"), this);
+    buttons->addWidget(all);
+    buttons->addStretch();
+    buttons->addWidget(cancel);
+    buttons->addWidget(ok);
+
+    layout->addLayout(grid);
+    layout->addWidget(columns);
+    layout->addLayout(buttons);
+
+    contentChanged();
+
+    connect(content, SIGNAL(currentIndexChanged(int)), this, SLOT(contentChanged()));
+    connect(all, SIGNAL(stateChanged(int)), this, SLOT(allClicked()));
+    connect(cancel, SIGNAL(clicked()), this, SLOT(reject()));
+    connect(ok, SIGNAL(clicked()), this, SLOT(okClicked()));
+}
+
+void
+MetricExportDialog::contentChanged()
+{
+    columns->clear();
+    int what = content->itemData(content->currentIndex()).toInt();
+
+    if (what == MetricExport::Samples) {
+
+        // those kept with each sample, the rest are worked out from the whole ride
+        for (int i=0; i<int(RideFile::none); i++) {
+            RideFile::SeriesType type = static_cast<RideFile::SeriesType>(i);
+            if (type == RideFile::vam || type == RideFile::wattsKg || type == RideFile::wprime ||
+                type == RideFile::wbal || type == RideFile::clength || type == RideFile::aPowerKg ||
+                type == RideFile::index || type == RideFile::hrv) continue;
+
+            QTreeWidgetItem *add = new QTreeWidgetItem(columns->invisibleRootItem(), Column);
+            add->setText(0, RideFile::seriesName(type, true));
+            add->setData(0, Qt::UserRole, int(type));
+            add->setCheckState(0, Qt::Checked);
+        }
+
+    } else {
+
+        // metrics in index order, as they were always exported
+        const RideMetricFactory &factory = RideMetricFactory::instance();
+        QVector<const RideMetric *> metrics(factory.metricCount());
+        foreach(QString name, factory.allMetrics()) {
+            const RideMetric *m = factory.rideMetric(name);
+            metrics[m->index()] = m;
+        }
+        foreach(const RideMetric *m, metrics) {
+            QTreeWidgetItem *add = new QTreeWidgetItem(columns->invisibleRootItem(), Column);
+            add->setText(0, m->name());
+            add->setData(0, Qt::UserRole, m->symbol());
+            add->setCheckState(0, Qt::Checked);
+        }
+
+        // only activities have metadata, not checked to start with
+        if (what == MetricExport::Activities) {
+            foreach(FieldDefinition field, context->athlete->rideMetadata()->getFields()) {
+                QTreeWidgetItem *add = new QTreeWidgetItem(columns->invisibleRootItem(), Field);
+                add->setText(0, field.name);
+                add->setData(0, Qt::UserRole, field.name);
+                add->setCheckState(0, Qt::Unchecked);
+            }
+        }
+    }
+    all->setChecked(true);
+}
+
+void
+MetricExportDialog::allClicked()
+{
+    // metadata is left as it is
+    Qt::CheckState state = all->isChecked() ? Qt::Checked : Qt::Unchecked;
+    for(int i=0; i<columns->invisibleRootItem()->childCount(); i++) {
+        QTreeWidgetItem *current = columns->invisibleRootItem()->child(i);
+        if (current->type() == Column) current->setCheckState(0, state);
+    }
+}
+
+QStringList
+MetricExportDialog::checked(int type)
+{
+    QStringList returning;
+    for(int i=0; i<columns->invisibleRootItem()->childCount(); i++) {
+        QTreeWidgetItem *current = columns->invisibleRootItem()->child(i);
+        if (current->type() == type && current->checkState(0) == Qt::Checked)
+            returning << current->data(0, Qt::UserRole).toString();
+    }
+    return returning;
+}
+
+void
+MetricExportDialog::okClicked()
+{
+    if (checked(Column).isEmpty()) {
+        QMessageBox::warning(this, tr("Export Metrics"), tr("Please choose at least one column to export."));
+        return;
+    }
+
+    // the format was chosen above, so only offer that one
+    QString filter = format->currentText();
+    filename = QFileDialog::getSaveFileName(this, tr("Export Metrics"), QDir::homePath(), filter, &filter);
+    if (filename.length() == 0) return;
+
+    QString suffix = "." + MetricExport::suffix(format->currentIndex());
+    if (!filename.endsWith(suffix, Qt::CaseInsensitive)) filename += suffix;
+
+    accept();
+}
+
+void
+MetricExportDialog::configure(MetricExport *exporter)
+{
+    exporter->setFormat(format->currentIndex());
+    int what = content->itemData(content->currentIndex()).toInt();
+    exporter->setContent(what);
+    exporter->setMetadata(checked(Field));
+
+    // series by type, some of them don't have a symbol
+    if (what == MetricExport::Samples) {
+        QList<RideFile::SeriesType> series;
+        foreach(QString type, checked(Column)) series << static_cast<RideFile::SeriesType>(type.toInt());
+        exporter->setSeries(series);
+    } else {
+        exporter->setSymbols(checked(Column));
+    }
+
+    // pushed down to the copy taken when it starts
+    FilterSet fs;
+    if (filtered->isChecked()) {
+        fs.addFilter(context->isfiltered, context->filters);
+        fs.addFilter(context->ishomefiltered, context->homeFilters);
+    }
+    exporter->setSpecification(Specification(DateRange(from->date(), to->date()), fs));
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2020 GoldenCheetah contributors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _MetricExportDialog_h
+#define _MetricExportDialog_h
+#include "GoldenCheetah.h"
+#include "Context.h"
+
+#include <QDialog>
+#include <QTreeWidget>
+#include <QComboBox>
+#include <QDateEdit>
+#include <QCheckBox>
+#include <QLabel>
+#include <QPushButton>
+
+class MetricExport;
+
+// Choose what to export, the formats, dates, filter and columns,
+// then the file to write to; the export itself is run by the caller
+class MetricExportDialog : public QDialog
+{
+    Q_OBJECT
+    G_OBJECT
+
+public:
+    MetricExportDialog(Context *context);
+
+    // the file chosen and the exporter set up to match the choices
+    QString fileName() const { return filename; }
+    void configure(MetricExport *exporter);
+
+private slots:
+    void contentChanged();
+    void allClicked();
+    void okClicked();
+
+private:
+    Context *context;
+    QString filename;
+
+    QComboBox *content, *format;
+    QDateEdit *from, *to;
+    QCheckBox *filtered, *all;
+    QTreeWidget *columns;
+    QPushButton *cancel, *ok;
+
+    // checked items with this type, the symbol or series is kept as data
+    enum { Column = QTreeWidgetItem::UserType, Field };
+    QStringList checked(int type);
+};
+#endif // _MetricExportDialog_h
@@ -48,6 +48,8 @@
 #ifdef GC_WANT_PYTHON
 #include "PythonEmbed.h"
 #endif
+#include "RideResidency.h" // for default memory
+#include "RideSnapshot.h" // for rank peers
 extern ConfigDialog *configdialog_ptr;
 
 //
@@ -170,6 +172,30 @@ GeneralPage::GeneralPage(Context *context) : context(context)
     warnOnExit->setChecked(appsettings->value(NULL, GC_WARNEXIT, true).toBool());
     configLayout->addWidget(warnOnExit, 6,1, Qt::AlignLeft);
 
+    //
+    // Memory used by activity data kept open
+    //
+    QLabel *memoryLabel = new QLabel(tr("Activity data memory (MB)"));
+    rideMemory = new QSpinBox(this);
+    rideMemory->setMinimum(64);
+    rideMemory->setMaximum(65536);
+    rideMemory->setSingleStep(128);
+    rideMemory->setValue(appsettings->value(NULL, GC_RIDE_MEMORY, RIDE_MEMORY_DEFAULT).toInt());
+    configLayout->addWidget(memoryLabel, 7,0, Qt::AlignRight);
+    configLayout->addWidget(rideMemory, 7,1, Qt::AlignLeft);
+
+    //
+    // Who activities are ranked against on the overview
+    //
+    QLabel *peersLabel = new QLabel(tr("Rank activities against"));
+    rankPeers = new QComboBox(this);
+    rankPeers->addItem(tr("Same sport"));
+    rankPeers->addItem(tr("Same sport and year"));
+    rankPeers->addItem(tr("All activities"));
+    rankPeers->setCurrentIndex(appsettings->value(NULL, GC_RANK_PEERS, RideSnapshots::SameSport).toInt());
+    configLayout->addWidget(peersLabel, 8,0, Qt::AlignRight);
+    configLayout->addWidget(rankPeers, 8,1, Qt::AlignLeft);
+
     //
     // Run API web services when running
     //
@@ -178,12 +204,12 @@ GeneralPage::GeneralPage(Context *context) : context(context)
     offset += 1;
     startHttp = new QCheckBox(tr("Enable API Web Services"), this);
     startHttp->setChecked(appsettings->value(NULL, GC_START_HTTP, false).toBool());
-    configLayout->addWidget(startHttp, 7,1, Qt::AlignLeft);
+    configLayout->addWidget(startHttp, 9,1, Qt::AlignLeft);
 #endif
 #ifdef GC_WANT_R
     embedR = new QCheckBox(tr("Enable R"), this);
     embedR->setChecked(appsettings->value(NULL, GC_EMBED_R, true).toBool());
-    configLayout->addWidget(embedR, 7+offset,1, Qt::AlignLeft);
+    configLayout->addWidget(embedR, 9+offset,1, Qt::AlignLeft);
     offset += 1;
     connect(embedR, SIGNAL(stateChanged(int)), this, SLOT(embedRchanged(int)));
 #endif
@@ -191,7 +217,7 @@ GeneralPage::GeneralPage(Context *context) : context(context)
 #ifdef GC_WANT_PYTHON
     embedPython = new QCheckBox(tr("Enable Python"), this);
     embedPython->setChecked(appsettings->value(NULL, GC_EMBED_PYTHON, true).toBool());
-    configLayout->addWidget(embedPython, 7+offset,1, Qt::AlignLeft);
+    configLayout->addWidget(embedPython, 9+offset,1, Qt::AlignLeft);
     connect(embedPython, SIGNAL(stateChanged(int)), this, SLOT(embedPythonchanged(int)));
     offset += 1;
 #endif
@@ -200,11 +226,17 @@ GeneralPage::GeneralPage(Context *context) : context(context)
     opendata = new QCheckBox(tr("Share to the OpenData project"), this);
     QString grant = appsettings->cvalue(context->athlete->cyclist, GC_OPENDATA_GRANTED, "X").toString();
     opendata->setChecked(grant == "Y");
-    configLayout->addWidget(opendata, 7+offset,1, Qt::AlignLeft);
+    configLayout->addWidget(opendata, 9+offset,1, Qt::AlignLeft);
     if (grant == "X") opendata->hide();
     offset += 1;
 #endif
 
+    // searching and filtering through an index of this athlete's activities
+    rideIndex = new QCheckBox(tr("Index activities for faster filters"), this);
+    rideIndex->setChecked(appsettings->cvalue(context->athlete->cyclist, GC_RIDEINDEX, false).toBool());
+    configLayout->addWidget(rideIndex, 9+offset,1, Qt::AlignLeft);
+    offset += 1;
+
     //
     // Athlete directory (home of athletes)
     //
@@ -216,9 +248,9 @@ GeneralPage::GeneralPage(Context *context) : context(context)
     athleteBrowseButton = new QPushButton(tr("Browse"));
     //XXathleteBrowseButton->setFixedWidth(120);
 
-    configLayout->addWidget(athleteLabel, 7 + offset,0, Qt::AlignRight);
-    configLayout->addWidget(athleteDirectory, 7 + offset,1);
-    configLayout->addWidget(athleteBrowseButton, 7 + offset,2);
+    configLayout->addWidget(athleteLabel, 9 + offset,0, Qt::AlignRight);
+    configLayout->addWidget(athleteDirectory, 9 + offset,1);
+    configLayout->addWidget(athleteBrowseButton, 9 + offset,2);
 
     connect(athleteBrowseButton, SIGNAL(clicked()), this, SLOT(browseAthleteDir()));
 
@@ -234,9 +266,9 @@ GeneralPage::GeneralPage(Context *context) : context(context)
     workoutBrowseButton = new QPushButton(tr("Browse"));
     //XXworkoutBrowseButton->setFixedWidth(120);
 
-    configLayout->addWidget(workoutLabel, 8 + offset,0, Qt::AlignRight);
-    configLayout->addWidget(workoutDirectory, 8 + offset,1);
-    configLayout->addWidget(workoutBrowseButton, 8 + offset,2);
+    configLayout->addWidget(workoutLabel, 10 + offset,0, Qt::AlignRight);
+    configLayout->addWidget(workoutDirectory, 10 + offset,1);
+    configLayout->addWidget(workoutBrowseButton, 10 + offset,2);
 
     connect(workoutBrowseButton, SIGNAL(clicked()), this, SLOT(browseWorkoutDir()));
     offset++;
@@ -254,9 +286,9 @@ GeneralPage::GeneralPage(Context *context) : context(context)
     rBrowseButton = new QPushButton(tr("Browse"));
     //XXrBrowseButton->setFixedWidth(120);
 
-    configLayout->addWidget(rLabel, 8 + offset,0, Qt::AlignRight);
-    configLayout->addWidget(rDirectory, 8 + offset,1);
-    configLayout->addWidget(rBrowseButton, 8 + offset,2);
+    configLayout->addWidget(rLabel, 10 + offset,0, Qt::AlignRight);
+    configLayout->addWidget(rDirectory, 10 + offset,1);
+    configLayout->addWidget(rBrowseButton, 10 + offset,2);
     offset++;
 
     connect(rBrowseButton, SIGNAL(clicked()), this, SLOT(browseRDir()));
@@ -272,9 +304,9 @@ GeneralPage::GeneralPage(Context *context) : context(context)
     pythonDirectory->setText(pythonDir.toString());
     pythonBrowseButton = new QPushButton(tr("Browse"));
 
-    configLayout->addWidget(pythonLabel, 8 + offset,0, Qt::AlignRight);
-    configLayout->addWidget(pythonDirectory, 8 + offset,1);
-    configLayout->addWidget(pythonBrowseButton, 8 + offset,2);
+    configLayout->addWidget(pythonLabel, 10 + offset,0, Qt::AlignRight);
+    configLayout->addWidget(pythonDirectory, 10 + offset,1);
+    configLayout->addWidget(pythonBrowseButton, 10 + offset,2);
     offset++;
 
     connect(pythonBrowseButton, SIGNAL(clicked()), this, SLOT(browsePythonDir()));
@@ -285,6 +317,9 @@ GeneralPage::GeneralPage(Context *context) : context(context)
     b4.hyst = elevationHysteresis.toFloat();
     b4.wbal = wbalForm->currentIndex();
     b4.warn = warnOnExit->isChecked();
+    b4.memory = rideMemory->value();
+    b4.peers = rankPeers->currentIndex();
+    b4.rideindex = rideIndex->isChecked();
 #ifdef GC_WANT_HTTP
     b4.starthttp = startHttp->isChecked();
 #endif
@@ -344,6 +379,15 @@ GeneralPage::saveClicked()
     // Elevation
     appsettings->setValue(GC_ELEVATION_HYSTERESIS, hystedit->text());
 
+    // Activity data memory
+    appsettings->setValue(GC_RIDE_MEMORY, rideMemory->value());
+
+    // Overview ranks
+    appsettings->setValue(GC_RANK_PEERS, rankPeers->currentIndex());
+
+    // Ride index
+    appsettings->setCValue(context->athlete->cyclist, GC_RIDEINDEX, rideIndex->isChecked());
+
     // wbal formula
     appsettings->setValue(GC_WBALFORM, wbalForm->currentIndex() ? "int" : "diff");
 
@@ -369,9 +413,15 @@ GeneralPage::saveClicked()
     // general stuff changed ?
 #ifdef GC_WANT_HTTP
     if (b4.hyst != hystedit->text().toFloat() ||
+        b4.memory != rideMemory->value() ||
+        b4.peers != rankPeers->currentIndex() ||
+        b4.rideindex != rideIndex->isChecked() ||
         b4.starthttp != startHttp->isChecked())
 #else
-    if (b4.hyst != hystedit->text().toFloat())
+    if (b4.hyst != hystedit->text().toFloat() ||
+        b4.memory != rideMemory->value() ||
+        b4.peers != rankPeers->currentIndex() ||
+        b4.rideindex != rideIndex->isChecked())
 #endif
         state += CONFIG_GENERAL;
 
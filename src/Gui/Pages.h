@@ -115,9 +115,12 @@ class GeneralPage : public QWidget
 #endif
 #if QT_VERSION >= 0x050000
         QCheckBox *opendata;
+        QCheckBox *rideIndex;
 #endif
         QLineEdit *garminHWMarkedit;
         QLineEdit *hystedit;
+        QSpinBox *rideMemory;
+        QComboBox *rankPeers;
         QLineEdit *athleteDirectory;
         QLineEdit *workoutDirectory;
         QPushButton *workoutBrowseButton;
@@ -144,6 +147,9 @@ class GeneralPage : public QWidget
             float hyst;
             int wbal;
             bool warn;
+            int memory;
+            int peers;
+            bool rideindex;
 #ifdef GC_WANT_HTTP
             bool starthttp;
 #endif
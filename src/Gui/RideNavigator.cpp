@@ -1394,17 +1394,22 @@ RideNavigatorSortProxyModel::RideNavigatorSortProxyModel(QObject *parent) : QSor
 bool RideNavigatorSortProxyModel::lessThan(const QModelIndex &left,
                                            const QModelIndex &right) const
 {
-    QVariant leftData = sourceModel()->data(left);
-    QVariant rightData = sourceModel()->data(right);
+    // raw sort keys from the ride cache model, this avoids formatting
+    // and parsing the values on every comparison when sorting
+    QVariant leftData = sourceModel()->data(left, RideCacheModel::SortRole);
+    QVariant rightData = sourceModel()->data(right, RideCacheModel::SortRole);
 
     if (leftData.type() == QVariant::DateTime) {
         return leftData.toDateTime() < rightData.toDateTime();
     }
+    if (leftData.type() == QVariant::Double && rightData.type() == QVariant::Double) {
+        return leftData.toDouble() < rightData.toDouble();
+    }
     QString leftString = leftData.toString();
     QString rightString = rightData.toString();
 
-    if (leftString.contains(QRegExp("[^0-9.,]")) ||
-            rightString.contains(QRegExp("[^0-9.,]"))) { // alpha
+    static const QRegExp alpha("[^0-9.,]");
+    if (leftString.contains(alpha) || rightString.contains(alpha)) { // alpha
         return QString::localeAwareCompare(leftString, rightString) < 0;
     }
     // assume numeric
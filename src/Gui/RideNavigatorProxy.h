@@ -38,6 +38,7 @@
 
 #include <QtGui>
 #include "RideNavigator.h"
+#include "RideCacheModel.h"
 #include "RideItem.h"
 #include "RideFile.h"
 
@@ -76,11 +77,17 @@ private:
 
     QList<QString> groups;
     QList<QModelIndex> groupIndexes;
+    QList<QVector<int>*> groupRows; // same order as groups
 
     QMap<QString, QVector<int>*> groupToSourceRow;
     QVector<int> sourceRowToGroupRow;
+    QVector<int> sourceRowToGroup;
     QList<rankx> rankedRows;
 
+    // the value each source row was grouped on, so we can tell
+    // if a change to a ride means it needs to move group
+    QVector<QString> groupValues;
+
     void clearGroups() {
         // Wipe current
         QMapIterator<QString, QVector<int>*> i(groupToSourceRow);
@@ -90,9 +97,12 @@ private:
         }
         groups.clear();
         groupIndexes.clear();
+        groupRows.clear();
         groupToSourceRow.clear();
         sourceRowToGroupRow.clear();
+        sourceRowToGroup.clear();
         rankedRows.clear();
+        groupValues.clear();
     }
 
     static bool initGroupRanges();
@@ -148,7 +158,7 @@ public:
         setIndexes();
 
         connect(model, SIGNAL(modelReset()), this, SLOT(sourceModelChanged()));
-        connect(model, SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SIGNAL(dataChanged(QModelIndex, QModelIndex)));
+        connect(model, SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(sourceDataChanged(QModelIndex, QModelIndex)));
         connect(model, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(sourceModelChanged()));
         connect(model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)), this, SLOT(sourceModelChanged()));
         connect(model, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(sourceModelChanged()));
@@ -187,7 +197,7 @@ public:
                 return QModelIndex();
             }
 
-            return sourceModel()->index(groupToSourceRow.value(groups[groupNo])->at(proxyIndex.row()),
+            return sourceModel()->index(groupRows[groupNo]->at(proxyIndex.row()),
                                         proxyIndex.column()-2, // accommodate virtual columns
                                         QModelIndex());
         }
@@ -197,18 +207,15 @@ public:
     QModelIndex mapFromSource(const QModelIndex &sourceIndex) const {
 
         // which group did we put this row into?
-        QString group = whichGroup(sourceIndex.row());
-        int groupNo = groups.indexOf(group);
+        int row = sourceIndex.row();
+        if (row < 0 || row >= sourceRowToGroup.size()) return QModelIndex();
 
-        if (groupNo < 0) {
-            return QModelIndex();
-        } else {
-            QModelIndex *p = new QModelIndex(createIndex(groupNo, 0, (void*)NULL));
-            if (sourceIndex.row() > 0 && sourceIndex.row() < sourceRowToGroupRow.size())
-                return createIndex(sourceRowToGroupRow[sourceIndex.row()], sourceIndex.column()+2, &p); // accommodate virtual columns
-            else
-                return QModelIndex();
-        }
+        int groupNo = sourceRowToGroup[row];
+        if (groupNo < 0 || groupNo >= groupIndexes.count()) return QModelIndex();
+
+        // the parent is encoded in the index, just like index() does it
+        return createIndex(sourceRowToGroupRow[row], sourceIndex.column()+2, // accommodate virtual columns
+                           (void*)&groupIndexes[groupNo]);
     }
 
     // we override the standard version to make our virtual column zero
@@ -291,7 +298,7 @@ public:
                     // hideous code, sorry
                     int groupNo = ((QModelIndex*)proxyIndex.internalPointer())->row();
                     if (groupNo < 0 || groupNo >= groups.count() || proxyIndex.column() == 0) returning="";
-                    else string = sourceModel()->data(sourceModel()->index(groupToSourceRow.value(groups[groupNo])->at(proxyIndex.row()), calendarText)).toString();
+                    else string = sourceModel()->data(sourceModel()->index(groupRows[groupNo]->at(proxyIndex.row()), calendarText)).toString();
                     // get rid of cr, lf and tab chars
                     string.replace("\n", " ");
                     string.replace("\t", " ");
@@ -316,7 +323,7 @@ public:
                     int groupNo = ((QModelIndex*)proxyIndex.internalPointer())->row();
                     if (groupNo < 0 || groupNo >= groups.count() || proxyIndex.column() == 0)
                         colorstring= GColor(CPLOTMARKER).name();
-                    else colorstring = sourceModel()->data(sourceModel()->index(groupToSourceRow.value(groups[groupNo])->at(proxyIndex.row()), colorColumn)).toString();
+                    else colorstring = sourceModel()->data(sourceModel()->index(groupRows[groupNo]->at(proxyIndex.row()), colorColumn)).toString();
 
                     returning = QColor(colorstring);
                 } else {
@@ -333,7 +340,7 @@ public:
                     int groupNo = ((QModelIndex*)proxyIndex.internalPointer())->row();
                     if (groupNo < 0 || groupNo >= groups.count() || proxyIndex.column() == 0)
                         filename="";
-                    else filename = sourceModel()->data(sourceModel()->index(groupToSourceRow.value(groups[groupNo])->at(proxyIndex.row()), fileIndex)).toString();
+                    else filename = sourceModel()->data(sourceModel()->index(groupRows[groupNo]->at(proxyIndex.row()), fileIndex)).toString();
 
                     returning = filename;
                 } else {
@@ -350,7 +357,7 @@ public:
                     int groupNo = ((QModelIndex*)proxyIndex.internalPointer())->row();
                     if (groupNo < 0 || groupNo >= groups.count() || proxyIndex.column() == 0)
                         returning = false;
-                    else isRun = sourceModel()->data(sourceModel()->index(groupToSourceRow.value(groups[groupNo])->at(proxyIndex.row()), isRunIndex)).toBool();
+                    else isRun = sourceModel()->data(sourceModel()->index(groupRows[groupNo]->at(proxyIndex.row()), isRunIndex)).toBool();
 
                     returning = isRun;
                 } else {
@@ -361,23 +368,26 @@ public:
 
                 // column 1 = ride_time we have to use ride_date
                 if (proxyIndex.column() == 1 && proxyIndex.internalPointer())  {
-                    QString date;
+                    QVariant date;
 
                     // hideous code, sorry
                     int groupNo = ((QModelIndex*)proxyIndex.internalPointer())->row();
                     if (groupNo < 0 || groupNo >= groups.count() || proxyIndex.column() == 0)
                         date="";
-                    else date = sourceModel()->data(sourceModel()->index(groupToSourceRow.value(groups[groupNo])->at(proxyIndex.row()), dateColumn)).toString();
+                    else date = sourceModel()->data(sourceModel()->index(groupRows[groupNo]->at(proxyIndex.row()), dateColumn));
 
-                    returning = date;//sourceModel()->data(sourceModel()->index(proxyIndex.row(),dateColumn)).toString();
+                    // sort on the datetime, but display the string
+                    if (role == RideCacheModel::SortRole) returning = date;
+                    else returning = date.toString();
 
                 } else {
 
                     // get the data
-                    returning = sourceModel()->data(mapToSource(proxyIndex), role);
+                    QModelIndex sourceIndex = mapToSource(proxyIndex);
+                    returning = sourceModel()->data(sourceIndex, role);
 
                     // -255 temperature means not present
-                    if (mapToSource(proxyIndex).column() == tempIndex && returning.toDouble() == RideFile::NA) {
+                    if (sourceIndex.column() == tempIndex && returning.toDouble() == RideFile::NA) {
                          returning = "";
                     }
                 }
@@ -397,11 +407,11 @@ public:
                     QString returnString = QString(tr("%1: %2 (%3 activities)"))
                                            .arg(sourceModel()->headerData(groupBy, Qt::Horizontal).toString())
                                            .arg(group)
-                                           .arg(groupToSourceRow.value(groups[proxyIndex.row()])->count());
+                                           .arg(groupRows[proxyIndex.row()]->count());
                     returning = QVariant(returnString);
                 } else {
                     QString returnString = QString(tr("%1 activities"))
-                                           .arg(groupToSourceRow.value(groups[proxyIndex.row()])->count());
+                                           .arg(groupRows[proxyIndex.row()]->count());
                     returning = QVariant(returnString);
                 }
             }
@@ -443,7 +453,7 @@ public:
         } else if (parent.column() == 0 && parent.internalPointer() == NULL) {
 
             // second level return count of rows for group
-            return groupToSourceRow.value(groups[parent.row()])->count();
+            return groupRows[parent.row()]->count();
 
         } else {
 
@@ -463,7 +473,7 @@ public:
         } else if (index.column() == 0 && index.internalPointer() == NULL) {
 
             // first column - the group bys
-            return (groupToSourceRow.value(groups[index.row()])->count() > 0);
+            return (groupRows[index.row()]->count() > 0);
 
         } else {
 
@@ -490,13 +500,9 @@ public:
 
     QString whichGroup(int row) const {
 
-        if (row < 0 || row >= rankedRows.count()) return ("");
         if (groupBy == -1) return tr("All Activities");
-        else return groupFromValue(headerData(groupBy+2, // accommodate virtual column
-                                    Qt::Horizontal).toString(),
-                                    sourceModel()->data(sourceModel()->index(row,groupBy)).toString(),
-                                    rankedRows[row].value, rankedRows.count());
-
+        if (row < 0 || row >= sourceRowToGroup.count()) return ("");
+        return groups.value(sourceRowToGroup[row]);
     }
 
     // implemented in RideNavigator.cpp, to avoid developers
@@ -516,12 +522,21 @@ public:
         // wipe whatever is there first
         clearGroups();
 
+        int rowCount = sourceModel()->rowCount(QModelIndex());
+
         if (groupBy >= 0) {
 
+            // fetch the values just once, they get formatted on demand
+            // by the source model so it isn't cheap to keep asking
+            groupValues.resize(rowCount);
+            for (int i=0; i<rowCount; i++) {
+                groupValues[i] = sourceModel()->data(sourceModel()->index(i,groupBy)).toString();
+            }
+
             // rank all the values
-            for (int i=0; i<sourceModel()->rowCount(QModelIndex()); i++) {
+            for (int i=0; i<rowCount; i++) {
                 rankx rank;
-                rank.value = sourceModel()->data(sourceModel()->index(i,groupBy)).toDouble();
+                rank.value = groupValues[i].toDouble();
                 rank.row = i;
                 rankedRows << rank;
             }
@@ -537,10 +552,11 @@ public:
 
 
             // create a QMap from 'group' string to list of rows in that group
-            for (int i=0; i<sourceModel()->rowCount(QModelIndex()); i++) {
+            QString heading = headerData(groupBy+2, Qt::Horizontal).toString(); // accommodate virtual column
+            for (int i=0; i<rowCount; i++) {
 
                 // which group are we in?
-                QString value = whichGroup(i); // uses rankedRows
+                QString value = groupFromValue(heading, groupValues[i], rankedRows[i].value, rankedRows.count());
 
                 QVector<int> *rows;
                 if ((rows=groupToSourceRow.value(value,NULL)) == NULL) {
@@ -561,7 +577,7 @@ public:
 
             // Just one group by 'All Activities'
             QVector<int> *rows = new QVector<int>;
-            for (int i=0; i<sourceModel()->rowCount(QModelIndex()); i++) {
+            for (int i=0; i<rowCount; i++) {
                 rows->append(i);
                 sourceRowToGroupRow.append(i);
             }
@@ -571,10 +587,13 @@ public:
 
         // Update list of groups
         int group=0;
+        sourceRowToGroup.fill(-1, rowCount);
         QMapIterator<QString, QVector<int>*> j(groupToSourceRow);
         while (j.hasNext()) {
             j.next();
             groups << j.key();
+            groupRows << j.value();
+            foreach(int row, *j.value()) sourceRowToGroup[row] = group;
             groupIndexes << createIndex(group++,0,(void*)NULL);
         }
 
@@ -605,6 +624,33 @@ public slots:
         // now show em
         rideNavigator->tableView->expandAll();
     }
+
+    void sourceDataChanged(QModelIndex topLeft, QModelIndex bottomRight) {
+
+        if (!topLeft.isValid() || !bottomRight.isValid()) return;
+
+        // if the value we group on changed then the ride may need to
+        // move group (or the ranks changed), so regroup from scratch
+        if (groupBy >= 0) {
+            for (int i=topLeft.row(); i<=bottomRight.row(); i++) {
+                if (i >= groupValues.count() ||
+                    sourceModel()->data(sourceModel()->index(i,groupBy)).toString() != groupValues[i]) {
+                    sourceModelChanged();
+                    return;
+                }
+            }
+        }
+
+        // otherwise the groups are the same, just tell the views the
+        // rows changed. the parent is only encoded in column 0 indexes
+        for (int i=topLeft.row(); i<=bottomRight.row(); i++) {
+            QModelIndex first = mapFromSource(sourceModel()->index(i, 0));
+            if (!first.isValid()) continue;
+
+            QModelIndex parent = groupIndexes[sourceRowToGroup[i]];
+            emit dataChanged(index(first.row(), 0, parent), index(first.row(), columnCount()-1, parent));
+        }
+    }
 };
 
 
@@ -615,7 +661,7 @@ class SearchFilter : public QSortFilterProxyModel
 
     public:
 
-    SearchFilter(QWidget *p) : QSortFilterProxyModel(p), searchActive(false) {}
+    SearchFilter(QWidget *p) : QSortFilterProxyModel(p), searchActive(false), dirty(true) {}
 
     void setSourceModel(QAbstractItemModel *model) {
         QAbstractProxyModel::setSourceModel(model);
@@ -630,9 +676,16 @@ class SearchFilter : public QSortFilterProxyModel
             }
         }
 
+        // rows moved around, so matches need recomputing; these must be
+        // connected first so they are stale before anyone asks upstream
+        connect(model, SIGNAL(modelReset()), this, SLOT(sourceRowsChanged()));
+        connect(model, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(sourceRowsChanged()));
+        connect(model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)), this, SLOT(sourceRowsChanged()));
+        connect(model, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(sourceRowsChanged()));
+
 	// make sure changes are propogated upstream
         connect(model, SIGNAL(modelReset()), this, SIGNAL(modelReset()));
-        connect(model, SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SIGNAL(dataChanged(QModelIndex, QModelIndex)));
+        connect(model, SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(sourceDataChanged(QModelIndex, QModelIndex)));
         connect(model, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SIGNAL(modelReset()));
         connect(model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)), this, SIGNAL(modelReset()));
         connect(model, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SIGNAL(modelReset()));
@@ -640,22 +693,31 @@ class SearchFilter : public QSortFilterProxyModel
 
     bool filterAcceptsRow (int source_row, const QModelIndex &source_parent) const {
 
-        if (fileIndex == -1 || searchActive == false) return true; // nothing to do
+        if (fileIndex == -1 || searchActive == false || source_parent.isValid()) return true; // nothing to do
 
-        // lets get the filename
-        QModelIndex source_index = model->index(source_row, fileIndex, source_parent);
-        if (!source_index.isValid()) return true;
+        // a bit for every source row, worked out once for all rows
+        // rather than looking up the filename for each row we're asked about
+        if (dirty) {
+            int rows = model->rowCount();
+            matches = QBitArray(rows);
+            for (int i=0; i<rows; i++) {
+                QString key = model->data(model->index(i, fileIndex), Qt::DisplayRole).toString();
+                if (strings.contains(key)) matches.setBit(i);
+            }
+            dirty = false;
+        }
 
-        QString key = model->data(source_index, Qt::DisplayRole).toString();
-        return strings.contains(key);
+        if (source_row < 0 || source_row >= matches.size()) return true;
+        return matches.testBit(source_row);
     }
 
     public slots:
 
     void setStrings(QStringList list) {
         beginResetModel();
-        strings = list;
+        strings = list.toSet();
         searchActive = true;
+        dirty = true;
         endResetModel();
     }
 
@@ -663,13 +725,31 @@ class SearchFilter : public QSortFilterProxyModel
         beginResetModel();
         strings.clear();
         searchActive = false;
+        dirty = true;
         endResetModel();
     }
 
+    void sourceRowsChanged() {
+        dirty = true;
+    }
+
+    void sourceDataChanged(QModelIndex topLeft, QModelIndex bottomRight) {
+
+        // map each row, they may not be contiguous once filtered
+        for (int i=topLeft.row(); i<=bottomRight.row(); i++) {
+            QModelIndex left = mapFromSource(model->index(i, topLeft.column()));
+            if (left.isValid()) emit dataChanged(left, index(left.row(), bottomRight.column()));
+        }
+    }
+
     private:
         QAbstractItemModel *model;
-        QStringList strings;
+        QSet<QString> strings;
         int fileIndex;
         bool searchActive;
+
+        // rows matching the search, by source row
+        mutable QBitArray matches;
+        mutable bool dirty;
 };
 #endif
@@ -764,12 +764,18 @@ class ElevationGain : public RideMetric {
             return;
         }
 
+        // the whole ride comes from the elevation profile
+        RideFileIterator it(item->ride(), spec);
+        if (!spec.interval() && it.firstIndex() == 0 && it.lastIndex() == item->ride()->dataPoints().count()-1) {
+            setValue(item->ride()->elevation()->gain);
+            return;
+        }
+
         // hysteresis can be configured, we default to 3.0
         double hysteresis = appsettings->value(NULL, GC_ELEVATION_HYSTERESIS).toDouble();
         if (hysteresis <= 0.1) hysteresis = 3.00;
 
         bool first = true;
-        RideFileIterator it(item->ride(), spec);
 
         while (it.hasNext()) {
             struct RideFilePoint *point = it.next();
@@ -832,13 +838,19 @@ class ElevationLoss : public RideMetric {
             return;
         }
 
+        // the whole ride comes from the elevation profile
+        RideFileIterator it(item->ride(), spec);
+        if (!spec.interval() && it.firstIndex() == 0 && it.lastIndex() == item->ride()->dataPoints().count()-1) {
+            setValue(item->ride()->elevation()->loss);
+            return;
+        }
+
         // hysteresis can be configured, we default to 3.0
         double hysteresis = appsettings->value(NULL, GC_ELEVATION_HYSTERESIS).toDouble();
         if (hysteresis <= 0.1) hysteresis = 3.00;
 
         bool first = true;
 
-        RideFileIterator it(item->ride(), spec);
         while (it.hasNext()) {
             struct RideFilePoint *point = it.next();
 
@@ -898,6 +910,15 @@ class TotalWork : public RideMetric {
         joules = 0;
 
         RideFileIterator it(item->ride(), spec);
+
+        // intervals use the running totals, there can be hundreds of them
+        if (spec.interval()) {
+            joules = item->ride()->sums()->sum(RideFile::watts, it.firstIndex(), it.lastIndex())
+                     * item->ride()->recIntSecs();
+            setValue(joules/1000);
+            return;
+        }
+
         while (it.hasNext()) {
             struct RideFilePoint *point = it.next();
 
@@ -1012,6 +1033,16 @@ struct AvgPower : public RideMetric {
         total = count = 0;
     
         RideFileIterator it(item->ride(), spec);
+        if (spec.interval()) {
+            // intervals use the running totals
+            RideFileSums *sums = item->ride()->sums();
+            total = sums->sum(RideFile::watts, it.firstIndex(), it.lastIndex());
+            count = sums->count(RideFile::watts, it.firstIndex(), it.lastIndex());
+            setValue(count > 0 ? total / count : 0);
+            setCount(count);
+            return;
+        }
+
         while (it.hasNext()) {
             struct RideFilePoint *point = it.next();
 
@@ -1288,6 +1319,16 @@ struct AvgHeartRate : public RideMetric {
 
         total = count = 0;
         RideFileIterator it(item->ride(), spec);
+        if (spec.interval()) {
+            // intervals use the running totals
+            RideFileSums *sums = item->ride()->sums();
+            total = sums->sum(RideFile::hr, it.firstIndex(), it.lastIndex());
+            count = sums->count(RideFile::hr, it.firstIndex(), it.lastIndex());
+            setValue(count > 0 ? total / count : 0);
+            setCount(count);
+            return;
+        }
+
         while (it.hasNext()) {
             struct RideFilePoint *point = it.next();
             if (point->hr > 0) {
@@ -1697,6 +1738,16 @@ struct AvgCadence : public RideMetric {
         total = count = 0;
 
         RideFileIterator it(item->ride(), spec);
+        if (spec.interval()) {
+            // intervals use the running totals
+            RideFileSums *sums = item->ride()->sums();
+            total = sums->sum(RideFile::cad, it.firstIndex(), it.lastIndex());
+            count = sums->count(RideFile::cad, it.firstIndex(), it.lastIndex());
+            setValue(count > 0 ? total / count : count);
+            setCount(count);
+            return;
+        }
+
         while (it.hasNext()) {
             struct RideFilePoint *point = it.next();
             if (point->cad > 0) {
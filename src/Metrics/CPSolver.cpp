@@ -20,6 +20,30 @@
 #include "CPSolver.h"
 #include <ctime>
 
+#include <QtConcurrent>
+
+#ifndef CPSOLVER_DEBUG
+#define CPSOLVER_DEBUG false
+#endif
+#ifdef Q_CC_MSVC
+#define printd(fmt, ...) do {                                                \
+    if (CPSOLVER_DEBUG) {                                 \
+        printf("[%s:%d %s] " fmt , __FILE__, __LINE__,        \
+               __FUNCTION__, __VA_ARGS__);                    \
+        fflush(stdout);                                       \
+    }                                                         \
+} while(0)
+#else
+#define printd(fmt, args...)                                            \
+    do {                                                                \
+        if (CPSOLVER_DEBUG) {                                       \
+            printf("[%s:%d %s] " fmt , __FILE__, __LINE__,              \
+                   __FUNCTION__, ##args);                               \
+            fflush(stdout);                                             \
+        }                                                               \
+    } while(0)
+#endif
+
 CPSolver::CPSolver(Context *context)
    : context(context)
 {
@@ -40,6 +64,9 @@ CPSolver::setData(CPSolverConstraints constraints, QList<RideItem*> rides)
         // we don't do null well
         if (!item || !item->ride()) continue;
 
+        // resampled once for all the exhaustion points in the ride
+        RideFile *f = NULL;
+
         // each reference gets a separate data series
         foreach(RideFilePoint *rp, item->ride()->referencePoints()) {
 
@@ -49,75 +76,111 @@ CPSolver::setData(CPSolverConstraints constraints, QList<RideItem*> rides)
             // ok, now we have a point we need to get the power data
             // from the start to the point of exhaustion into a
             // 1 second sample array
-            data << power1s(item->ride(), rp->secs);
+            if (f == NULL) f = item->ride()->resample(1, 0);
+            if (f == NULL) break;
+
+            CPSolverSegment add;
+            add.offset = samples.count();
+            foreach(RideFilePoint *p, f->dataPoints()) {
+                if (p->secs < rp->secs) samples << int(p->watts);
+                else break;
+            }
+            add.count = samples.count() - add.offset;
+            segments << add;
         }
+        delete f;
     }
 }
 
-// get a 1s array to the point secs
-QVector<int>
-CPSolver::power1s(RideFile *f, double secs)
+// compute the cost, using the settings passed
+double
+CPSolver::cost(WBParms parms)
 {
-    // its already in 1s samples so just pull it in
-    QVector<int> returning;
-
-    foreach(RideFilePoint *p, f->resample(1, 0)->dataPoints()) {
-        if (p->secs < secs) returning << p->watts;
-        else break;
-    }
-
+    double returning;
+    costs(&parms, 1, &returning);
     return returning;
 }
 
-// compute the cost, using the settings passed
-double
-CPSolver::cost(WBParms parms)
+void
+CPSolver::costs(const WBParms *candidates, int n, double *costs)
 {
-    // returning sum(W'bal ^ 2)
+    // returning sum(W'bal ^ 2) for each candidate
+    for(int i=0; i<segments.count(); i++) {
+        segments[i].samples = samples.constData();
+        segments[i].candidates = candidates;
+        segments[i].ncandidates = n;
+        segments[i].integral = integral;
+    }
 
-    // loop through each ride for now, but avoid foreach()
-    // since it will make a copy of the contents which has
-    // a significant performance impact
-    double sumwb2=0;
-    for(int i=0; i<data.count();i++)  sumwb2 += pow(compute(data[i], parms),2);
+    // each segment on its own thread, they are long enough
+    // for it to be worth the overhead (hours of 1s samples)
+    if (segments.count() > 1) QtConcurrent::blockingMap(segments, CPSolver::compute);
+    else if (segments.count()) compute(segments[0]);
 
-    //qDebug()<<"cost="<<QString("%1").arg(sumwb2, 0, 'g', 7);
+    for(int c=0; c<n; c++) {
 
-    // what we got - normalise to number of fits
-    return (sumwb2/data.count()) /1000.0f;
-}
+        double sumwb2=0;
+        for(int i=0; i<segments.count(); i++) sumwb2 += segments[i].wpbal[c] * segments[i].wpbal[c];
 
-double
-CPSolver::compute(QVector<int> &ride, WBParms parms)
-{
-    // compute w'bal for the ride using the paramters
-    // XXX for now we use the integral model
-    double I=0.00f;
-    int t=0;
-    double wpbal=parms.W;
-    foreach(int watts, ride) {
+        //qDebug()<<"cost="<<QString("%1").arg(sumwb2, 0, 'g', 7);
 
-        if (integral) {
+        // what we got - normalise to number of fits
+        costs[c] = (sumwb2/segments.count()) /1000.0f;
+    }
+}
 
-            // INTEGRAL
-            I += exp(((double)(t) / parms.TAU)) * (watts > parms.CP ? watts-parms.CP : 0);
-            wpbal = parms.W - (exp(-((double)(t) / parms.TAU)) * I);
+void
+CPSolver::compute(CPSolverSegment &segment)
+{
+    // compute w'bal for the ride using the paramters for each
+    // candidate, sample by sample with the candidates innermost
+    const double *watts = segment.samples + segment.offset;
+    const WBParms *parms = segment.candidates;
+    int n = segment.ncandidates;
+
+    double CP[CPSOLVER_CHAINS], W[CPSOLVER_CHAINS], wpbal[CPSOLVER_CHAINS];
+    for(int c=0; c<n; c++) {
+        CP[c] = parms[c].CP;
+        W[c] = parms[c].W;
+        wpbal[c] = parms[c].W;
+    }
 
-        } else {
+    if (segment.integral) {
+
+        // INTEGRAL
+        // we only need the ending W'bal, which is W' less the sum of
+        // the power above CP decayed by exp(-(T-t)/tau), so that can
+        // be accumulated recursively with one multiply per sample
+        // instead of two exp() calls per sample (which also overflow
+        // on long rides with a short tau)
+        double decay[CPSOLVER_CHAINS], I[CPSOLVER_CHAINS];
+        for(int c=0; c<n; c++) {
+            decay[c] = exp(-1.0 / parms[c].TAU);
+            I[c] = 0;
+        }
+        for(int t=0; t<segment.count; t++) {
+            double w = watts[t];
+            for(int c=0; c<n; c++) I[c] = I[c] * decay[c] + (w > CP[c] ? w-CP[c] : 0);
+        }
+        for(int c=0; c<n; c++) wpbal[c] = W[c] - I[c];
 
+    } else {
 
-            // DIFFERENTIAL
-            wpbal  += watts < parms.CP ? ((double(parms.TAU)/100.0f) * (parms.W - wpbal)/parms.W * (parms.CP - watts) ) : (parms.CP-watts);
+        // DIFFERENTIAL
+        double R[CPSOLVER_CHAINS];
+        for(int c=0; c<n; c++) R[c] = double(parms[c].TAU)/100.0f;
+        for(int t=0; t<segment.count; t++) {
+            double w = watts[t];
+            for(int c=0; c<n; c++)
+                wpbal[c] += w < CP[c] ? (R[c] * (W[c] - wpbal[c])/W[c] * (CP[c] - w)) : (CP[c]-w);
         }
-
-        t++;
     }
 
     // we solve for W'bal=500 as it is not possible to completely
     // exhaust W', 500 is the point at which most athletes will
     // fail to continue, on average.
     // See: http://www.ncbi.nlm.nih.gov/pubmed/24509723
-    return wpbal - 500;
+    for(int c=0; c<n; c++) segment.wpbal[c] = wpbal[c] - 500;
 }
 
 // get us a neighbour
@@ -169,14 +232,15 @@ void
 CPSolver::reset()
 {
     rides.clear();
-    data.clear();
+    samples.clear();
+    segments.clear();
 }
 
 void
 CPSolver::start()
 {
     // set starting conditions from first ride
-    if (data.count() == 0 || rides.count() == 0) return;
+    if (segments.count() == 0 || rides.count() == 0) return;
 
     // to flag when to stop
     halt = false;
@@ -189,44 +253,69 @@ CPSolver::start()
     QTime p;
     p.start();
 
-    // initial conditions
-    srand((unsigned int) time (NULL)); // seed ONCE!
-    double E = cost(s0);
-    double Ebest = E;
-    WBParms s = s0;
-    WBParms sbest = s;
+    // initial conditions, the first chain starts from the maximals
+    // the others from random points so we cover more of the space
+    // when debugging we use a fixed seed so runs can be compared
+    srand(CPSOLVER_DEBUG ? 1 : (unsigned int) time (NULL)); // seed ONCE!
+    WBParms s[CPSOLVER_CHAINS], snew[CPSOLVER_CHAINS];
+    double E[CPSOLVER_CHAINS], Enew[CPSOLVER_CHAINS];
+    s[0] = s0;
+    for(int c=1; c<CPSOLVER_CHAINS; c++) {
+        s[c].CP = constraints.cpf + rand() % (1 + constraints.cpto - constraints.cpf);
+        s[c].W = constraints.wf + (int(double(rand()) / double(RAND_MAX) * (constraints.wto - constraints.wf)));
+        s[c].TAU = constraints.tf + rand() % (1 + constraints.tto - constraints.tf);
+    }
+    costs(s, CPSOLVER_CHAINS, E);
+
+    double Ebest = E[0];
+    WBParms sbest = s[0];
+    for(int c=1; c<CPSOLVER_CHAINS; c++) {
+        if (E[c] < Ebest) {
+            Ebest = E[c];
+            sbest = s[c];
+        }
+    }
 
-    // 10,000 iterations at most
+    // 100,000 evaluations at most, shared across the chains
     int k=0;
-    int kmax = 100000;
+    int kmax = 100000 / CPSOLVER_CHAINS;
 
-    // give up when we're on it or run out of loops
-    while (halt == false && k < kmax) {
+    // stop early once the chains stop finding anything better
+    int lastbest = 0;
+    int patience = kmax / 10;
 
-        WBParms snew = neighbour(s, k, kmax);
-        double Enew = cost(snew);
+    // give up when we're on it or run out of loops
+    while (halt == false && k < kmax && (k - lastbest) < patience) {
 
-        // progress update k=0 means stop so we offset by one
-        emit current(k+1, snew,Enew);
+        for(int c=0; c<CPSOLVER_CHAINS; c++) snew[c] = neighbour(s[c], k, kmax);
+        costs(snew, CPSOLVER_CHAINS, Enew);
 
-        // probability - always 1 if better, but randomly accept higher
-        double random = double(rand()%101)/100.00f;
         double temp = temperature(double(k)/double(kmax));
-        double prob = probability(E,Enew,temp);
+        for(int c=0; c<CPSOLVER_CHAINS && halt == false; c++) {
 
-        if (prob > random) {
-            s = snew;
-            E = Enew;
-        }
+            // progress update k=0 means stop so we offset by one
+            int iteration = (k * CPSOLVER_CHAINS) + c + 1;
+            emit current(iteration, snew[c], Enew[c]);
 
-        // is it better than our very best?
-        if (E < Ebest) {
-            Ebest = E;
-            sbest = s;
+            // probability - always 1 if better, but randomly accept higher
+            double random = double(rand()%101)/100.00f;
+            double prob = probability(E[c],Enew[c],temp);
 
-            // k of zero means stop so we offset by one
-            emit newBest(k+1, sbest, Ebest);
-            //qDebug()<<k<<"new best"<<Ebest <<s.CP<<s.W<<s.TAU;
+            if (prob > random) {
+                s[c] = snew[c];
+                E[c] = Enew[c];
+            }
+
+            // is it better than our very best?
+            if (E[c] < Ebest) {
+                Ebest = E[c];
+                sbest = s[c];
+                lastbest = k;
+
+                // k of zero means stop so we offset by one
+                emit newBest(iteration, sbest, Ebest);
+                //qDebug()<<k<<"new best"<<Ebest <<s.CP<<s.W<<s.TAU;
+            }
         }
 
         // don't run forever
@@ -236,7 +325,8 @@ CPSolver::start()
 
     // k of zero means stop
     emit newBest(0, sbest,Ebest);
-    //qDebug()<<"TOOK"<<p.elapsed();
+    printd("%d segments, %d samples, %d evaluations took %d ms, best %f CP=%f W'=%f TAU=%f\n",
+           segments.count(), samples.count(), k * CPSOLVER_CHAINS, p.elapsed(), Ebest, sbest.CP, sbest.W, sbest.TAU);
 }
 
 double
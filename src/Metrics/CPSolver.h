@@ -64,6 +64,26 @@ class CPSolverConstraints {
     }
 };
 
+// number of annealing chains run side by side, their candidates
+// are scored together in a single pass over the exhaustion series
+#define CPSOLVER_CHAINS 4
+
+// power from the start of a ride to the point of exhaustion, held
+// as a range of the solver's contiguous sample array, along with
+// the batch of candidates being scored and the ending W'bal for each
+class CPSolverSegment {
+    public:
+        CPSolverSegment() : samples(NULL), offset(0), count(0), candidates(NULL), ncandidates(0), integral(true) {}
+
+        const double *samples;
+        int offset, count;
+
+        const WBParms *candidates;
+        int ncandidates;
+        bool integral;
+        double wpbal[CPSOLVER_CHAINS];
+};
+
 class CPSolver : public QObject {
 
     Q_OBJECT
@@ -80,16 +100,17 @@ class CPSolver : public QObject {
         // compute the cost, using the settings passed
         double cost(WBParms parms);
 
-        // compute ending W'bal for the exhaustion series
-        double compute(QVector<int> &ride, WBParms parms);
+        // compute the cost for a batch of up to CPSOLVER_CHAINS candidates
+        // in one pass over the exhaustion series, spread across threads
+        void costs(const WBParms *candidates, int n, double *costs);
+
+        // compute ending W'bal for each candidate in the segment
+        static void compute(CPSolverSegment &segment);
 
         WBParms neighbour(WBParms, int k, int kmax);
         double probability(double,double,double);
         double temperature(double);
 
-        // get a 1s power array from the data
-        QVector<int> power1s(RideFile *f, double secs);
-
     signals:
         void newBest(int,WBParms,double);
         void current(int,WBParms,double);
@@ -110,8 +131,10 @@ class CPSolver : public QObject {
         CPSolverConstraints constraints;
         bool integral;
 
-        // an array of power data leading up to each exhaust point
-        QList<QVector<int> > data;
+        // power data leading up to each exhaust point, all the
+        // segments share one array so a pass is a linear scan
+        QVector<double> samples;
+        QVector<CPSolverSegment> segments;
         QList<RideItem*> rides;
 
         // annealling parms
@@ -0,0 +1,380 @@
+/*
+ * Copyright (c) 2020 GoldenCheetah contributors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "EffortSearch.h"
+#include "RideFile.h"
+#include "Zones.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <limits>
+#include <stdio.h>
+
+// maximum of a series over a window, the window may only move
+// forwards (neither end decreases) so each index is added and
+// dropped at most once
+class WindowMax {
+
+    public:
+
+        WindowMax(const QVector<double> &series) : series(series), index(series.count()),
+                                                   head(0), tail(0), next(0) {}
+
+        double max(int from, int to) {
+
+            // add to the back, dropping any they dominate
+            while (next <= to && next < series.count()) {
+                while (tail > head && series[index[tail-1]] <= series[next]) tail--;
+                index[tail++] = next++;
+            }
+
+            // drop from the front those that have left the window
+            while (head < tail && index[head] < from) head++;
+
+            if (head < tail && index[head] <= to) return series[index[head]];
+            return -std::numeric_limits<double>::max();
+        }
+
+    private:
+        const QVector<double> &series;
+        QVector<int> index;
+        int head, tail, next;
+};
+
+EffortSearch::EffortSearch(RideFile *f)
+{
+    if (!f || f->dataPoints().count() == 0 || !f->isDataPresent(RideFile::watts)) return;
+
+    const int SAMPLERATE = 1000; // 1000ms samplerate = 1 second samples
+
+    RideFilePoint sample;        // we reuse this to aggregate all values
+    long time = 0L;              // current time accumulates as we run through data
+    double lastT = 0.0f;         // last sample time seen in seconds
+
+    // set the array size
+    int arraySize = f->dataPoints().last()->secs + f->recIntSecs();
+
+    // anything longer than a day or negative is skipped
+    if (arraySize < 0 || arraySize >= (24*3600)) return;
+
+    integrated.reserve(arraySize);
+    long rtot = 0;
+
+    foreach(RideFilePoint *p, f->dataPoints()) {
+
+        // increment secs by recIntSecs as the time series
+        // always starts at zero, normalized by the file reader
+        double psecs = p->secs + f->recIntSecs();
+
+        // whats the dt in microseconds
+        int dt = (psecs * 1000) - (lastT * 1000);
+        lastT = psecs;
+
+        // ignore time goes backwards
+        if (dt < 0) continue;
+
+        //
+        // AGGREGATE INTO SAMPLES
+        //
+        while (integrated.count() < arraySize && dt) {
+
+            // we keep track of how much time has been aggregated
+            // into sample, so 'need' is whats left to aggregate
+            // for the full sample
+            int need = SAMPLERATE - sample.secs;
+
+            // aggregate
+            if (dt < need) {
+
+                // the entire sample read is less than we need
+                // so aggregate the whole lot and wait fore more
+                // data to be read. If there is no more data then
+                // this will be lost, we don't keep incomplete samples
+                sample.secs += dt;
+                sample.watts += float(dt) * p->watts;
+                dt = 0;
+
+            } else {
+
+                // dt is more than we need to fill and entire sample
+                // so lets just take the fraction we need
+                dt -= need;
+
+                // accumulating time and distance
+                sample.secs = time; time += double(SAMPLERATE) / 1000.0f;
+
+                // averaging sample data
+                sample.watts += float(need) * p->watts;
+                sample.watts /= 1000;
+
+                // integrate
+                rtot += sample.watts;
+                integrated << rtot;
+
+                // reset back to zero so we can aggregate
+                // the next sample
+                sample.secs = 0;
+                sample.watts = 0;
+            }
+        }
+    }
+}
+
+void
+EffortSearch::add(QList<Effort> &candidates, const Effort &x)
+{
+    // if we overlap with the last one and
+    // we are better then replace otherwise skip
+    if (candidates.count()) {
+
+        Effort &last = candidates.last();
+        if ((x.start >= last.start && x.start <= (last.start+last.duration)) ||
+           (x.start+x.duration >= last.start && x.start+x.duration <= (last.start+last.duration))) {
+
+            // we overlap but we are higher quality
+            if (x.quality > last.quality) last = x;
+
+        } else {
+
+            // we don't overlap
+            candidates << x;
+        }
+    } else {
+
+        // we are the first
+        candidates << x;
+    }
+}
+
+void
+EffortSearch::search(double CP, double WPRIME, double PMAX, const Zones *zones, int range,
+                     QList<Effort> candidates[10], QList<Effort> &candidates_sprint) const
+{
+    run(CP, WPRIME, PMAX, zones, range, candidates, candidates_sprint, true);
+}
+
+void
+EffortSearch::scan(double CP, double WPRIME, double PMAX, const Zones *zones, int range,
+                   QList<Effort> candidates[10], QList<Effort> &candidates_sprint) const
+{
+    run(CP, WPRIME, PMAX, zones, range, candidates, candidates_sprint, false);
+}
+
+void
+EffortSearch::run(double CP, double WPRIME, double PMAX, const Zones *zones, int range,
+                  QList<Effort> candidates[10], QList<Effort> &candidates_sprint, bool prune) const
+{
+    const long secs = integrated.count();
+    if (secs == 0 || CP <= 0) return;
+
+    // an effort from i lasting t has tc >= 0.85t when
+    // (integrated[i+t] - 0.85 CP (i+t)) - (integrated[i] - 0.85 CP i) >= W'
+    // and a sprint has average power above the threshold when
+    // (integrated[i+t] - threshold (i+t)) - (integrated[i] - threshold i) > 0
+    // so the maximum of the left term over the window of durations
+    // rules out most starts without searching them. The comparisons
+    // below are given a joule of slack so rounding never rules out a
+    // start the search would have found, it only ever costs a search.
+    const double threshold = 0.5*(PMAX-CP)+CP;
+    QVector<double> tteHeadroom(secs), sprintHeadroom(secs);
+    for (long k=0; k<secs; k++) {
+        tteHeadroom[k] = integrated[k] - 0.85 * CP * k;
+        sprintHeadroom[k] = integrated[k] - threshold * k;
+    }
+    WindowMax tteWindow(tteHeadroom), sprintWindow(sprintHeadroom);
+
+    // now the data is integrated we can look at the
+    // accumulated energy for each ride
+    for (long i=0; i<secs; i++) {
+
+        // start out at 30 minutes and drop back to
+        // 2 minutes, anything shorter and we are done
+        int t = (secs-i-1) > 3600 ? 3600 : secs-i-1;
+
+        // if we find one lets record it
+        bool found = false;
+        bool foundSprint = false;
+        Effort tte;
+        Effort sprint;
+
+        // durations 121 to t, if none can be an effort then the
+        // search below would end with t at 120
+        if (prune && t > 120 && tteWindow.max(i+121, i+t) < tteHeadroom[i] + WPRIME - 1) t = 120;
+
+        while (t > 120) {
+
+            // calculate the TTE for the joules in the interval
+            // starting at i seconds with duration t
+            // This takes the monod equation p(t) = W'/t + CP and
+            // solves for t, but the added complication of also
+            // accounting for the fact it is expressed in joules
+            // So take Joules = (W'/t + CP) * t and solving that
+            // for t gives t = (Joules - W') / CP
+            double tc = ((integrated[i+t]-integrated[i]) - WPRIME) / CP;
+            // NOTE FOR ABOVE: it is looking at accumulation AFTER this point
+            //                 not FROM this point, so we are looking 1s ahead of i
+            //                 which is why the interval is registered as starting
+            //                 at i+1 in the code below
+
+            // the TTE for this interval is greater or equal to
+            // the duration of the interval !
+            if (tc >= (t*0.85f)) {
+
+                if (found == false) {
+
+                    // first one we found
+                    found = true;
+
+                    // register a candidate
+                    tte.start = i + 1; // see NOTE above
+                    tte.duration = t;
+                    tte.joules = integrated[i+t]-integrated[i];
+                    tte.quality = tc / double(t);
+                    tte.zone = zones ? zones->whichZone(range, tte.joules/tte.duration) : 1;
+
+                } else {
+
+                    double thisquality = tc / double(t);
+
+                    // found one with a higher quality
+                    if (tte.quality < thisquality) {
+                        tte.duration = t;
+                        tte.joules = integrated[i+t]-integrated[i];
+                        tte.quality = thisquality;
+                        tte.zone = zones ? zones->whichZone(range, tte.joules/tte.duration) : 1;
+                    }
+
+                }
+
+                // look for smaller
+                t--;
+
+            } else {
+                t = tc;
+                if (t<120)
+                    t=120;
+            }
+        }
+
+        // Search sprint, durations 5 to t
+        if (prune && t >= 5 && sprintWindow.max(i+5, i+t) <= sprintHeadroom[i] - 1) t = 4;
+
+        while (t >= 5) {
+            // On Pmax only
+            // double tc = (integrated[i+t]-integrated[i]) / (PMAX);
+
+            // With the 3 components model
+            // t = W'/(P − CP) + W'/(CP − Pmax)
+            double p = (integrated[i+t]-integrated[i])/t;
+
+            if (p>threshold) {
+                double tc = WPRIME / (p-CP) + WPRIME / ( CP - PMAX);
+
+                if (tc >= (t*0.85f)) {
+
+                    if (foundSprint == false) {
+
+                        // first one we found
+                        foundSprint = true;
+
+                        // register a candidate
+                        sprint.start = i + 1; // see NOTE above
+                        sprint.duration = t;
+                        sprint.joules = integrated[i+t]-integrated[i];
+                        sprint.quality = double(t) + (sprint.joules/sprint.duration/1000.0);
+
+                    } else {
+
+                        double thisquality = double(t) + (integrated[i+t]-integrated[i])/t/1000.0;
+
+                        // found one with a higher quality
+                        if (sprint.quality < thisquality) {
+                            sprint.duration = t;
+                            sprint.joules = integrated[i+t]-integrated[i];
+                            sprint.quality = thisquality;
+                        }
+
+                    }
+                }
+            }
+            // look for smaller
+            t--;
+        }
+
+        // add the best ones we found here
+        if (found && tte.zone >= 0 && tte.zone < 10) add(candidates[tte.zone], tte);
+        if (foundSprint) add(candidates_sprint, sprint);
+    }
+}
+
+static bool
+sameEfforts(const QList<Effort> &a, const QList<Effort> &b)
+{
+    if (a.count() != b.count()) return false;
+    for (int i=0; i<a.count(); i++) {
+        if (a[i].start != b[i].start || a[i].duration != b[i].duration || a[i].joules != b[i].joules ||
+            a[i].zone != b[i].zone || a[i].quality != b[i].quality) return false;
+    }
+    return true;
+}
+
+int
+EffortSearch::selfTest(QString folder)
+{
+    // a weak, a typical and a strong athlete so the same rides find different efforts
+    const double params[][3] = { { 150, 15000, 800 }, { 250, 20000, 1000 }, { 350, 25000, 1400 } };
+
+    int rides=0, failed=0;
+    QDir dir(folder);
+    foreach(QFileInfo info, dir.entryInfoList(QDir::Files, QDir::Name)) {
+
+        // uncompressing needs an athlete for its temp folder
+        QString suffix = info.suffix().toLower();
+        if (suffix == "gz" || suffix == "zip") continue;
+
+        QFile file(info.absoluteFilePath());
+        QStringList errors;
+        RideFile *ride = RideFileFactory::instance().openRideFile(NULL, file, errors);
+        if (!ride) continue;
+
+        EffortSearch search(ride);
+        if (search.seconds()) {
+
+            rides++;
+            for (unsigned int k=0; k<sizeof(params)/sizeof(params[0]); k++) {
+
+                QList<Effort> efforts[10], sprints, scanned[10], scannedSprints;
+                search.search(params[k][0], params[k][1], params[k][2], NULL, 0, efforts, sprints);
+                search.scan(params[k][0], params[k][1], params[k][2], NULL, 0, scanned, scannedSprints);
+
+                bool same = sameEfforts(sprints, scannedSprints);
+                for (int i=0; i<10; i++) same = same && sameEfforts(efforts[i], scanned[i]);
+
+                if (!same) {
+                    failed++;
+                    fprintf(stderr, "FAIL %s CP=%.0f W'=%.0f Pmax=%.0f\n", info.fileName().toUtf8().constData(),
+                            params[k][0], params[k][1], params[k][2]);
+                }
+            }
+        }
+        delete ride;
+    }
+    fprintf(stderr, "effort search: %d rides with power, %d mismatches\n", rides, failed);
+    return failed;
+}
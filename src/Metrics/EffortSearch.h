@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2020 GoldenCheetah contributors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_EffortSearch_h
+#define _GC_EffortSearch_h 1
+
+#include <QList>
+#include <QVector>
+#include <QString>
+
+class RideFile;
+class Zones;
+
+struct Effort {
+    int start, duration, joules;
+    int zone;
+    double quality;
+};
+
+//
+// Finds sustained efforts (above CP for at least 85% of the time to
+// exhaustion predicted by the Monod model) and sprints (the same using the
+// 3 parameter model) in a ride's power data.
+//
+// The power is resampled to 1s and integrated once so the energy over any
+// window is a subtraction. Since an effort starting at i must end where
+// the integral rises faster than 0.85 CP the sliding window maximum of
+// integral - 0.85 CP t tells us in constant time whether there is any
+// effort starting at i; only those starts are searched for the best one.
+// Most of a ride is below CP so the search is close to linear.
+//
+class EffortSearch {
+
+    public:
+
+        EffortSearch(RideFile *ride);
+
+        // how many 1s samples, 0 if the ride was too long or had no power
+        int seconds() const { return integrated.count(); }
+
+        // find the best efforts per zone and sprints, zones may be NULL in
+        // which case all efforts are in zone 1 (index 1)
+        void search(double CP, double WPRIME, double PMAX, const Zones *zones, int range,
+                    QList<Effort> efforts[10], QList<Effort> &sprints) const;
+
+        // the same searching every start, as it was done before, so
+        // search() can be checked against it
+        void scan(double CP, double WPRIME, double PMAX, const Zones *zones, int range,
+                  QList<Effort> efforts[10], QList<Effort> &sprints) const;
+
+        // compare search() with scan() for every ride with power in a
+        // folder (e.g. test/rides), returns the number that differ
+        static int selfTest(QString folder);
+
+    private:
+
+        // running total of 1s power
+        QVector<long> integrated;
+
+        void run(double CP, double WPRIME, double PMAX, const Zones *zones, int range,
+                 QList<Effort> efforts[10], QList<Effort> &sprints, bool prune) const;
+
+        // keep the best of overlapping candidates as they are found
+        static void add(QList<Effort> &candidates, const Effort &candidate);
+};
+
+#endif
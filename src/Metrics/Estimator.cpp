@@ -24,6 +24,8 @@
 #include "RideCacheModel.h"
 #include "Specification.h"
 
+#include <QtConcurrent>
+
 #ifndef ESTIMATOR_DEBUG
 #define ESTIMATOR_DEBUG false
 #endif
@@ -97,6 +99,86 @@ class RollingBests {
         }
 };
 
+// a week of bests and the estimates fitted to them
+struct EstimatorWindow {
+    Context *context;
+    QDate from, to;
+    QVector<float> bests, bestsWPK;
+    QList<PDEstimate> estimates;
+};
+
+// fit all the models to a window, this runs concurrently with the
+// other windows so each call has its own models, they're cheap
+static void estimateWindow(EstimatorWindow &window)
+{
+    // set up the models we support
+    CP2Model p2model(window.context);
+    CP3Model p3model(window.context);
+    WSModel wsmodel(window.context);
+    MultiModel multimodel(window.context);
+    ExtendedModel extmodel(window.context);
+
+    QList <PDModel *> models;
+    models << &p2model;
+    models << &p3model;
+    models << &multimodel;
+    models << &extmodel;
+    models << &wsmodel;
+
+    foreach(PDModel *model, models) {
+
+        PDEstimate add;
+
+        // set the data
+        model->setData(window.bests);
+        model->saveParameters(add.parameters); // save the computed parms
+
+        add.wpk = false;
+        add.from = window.from;
+        add.to = window.to;
+        add.model = model->code();
+        add.WPrime = model->hasWPrime() ? model->WPrime() : 0;
+        add.CP = model->hasCP() ? model->CP() : 0;
+        add.PMax = model->hasPMax() ? model->PMax() : 0;
+        add.FTP = model->hasFTP() ? model->FTP() : 0;
+
+        if (add.CP && add.WPrime) add.EI = add.WPrime / add.CP ;
+
+        // so long as the important model derived values are sensible ...
+        if (add.WPrime > 1000 && add.CP > 100) {
+            printd("Estimates for %s - %s\n", add.from.toString().toStdString().c_str(), add.to.toString().toStdString().c_str());
+            window.estimates << add;
+        }
+
+        //qDebug()<<add.to<<add.from<<model->code()<< "W'="<< model->WPrime() <<"CP="<< model->CP() <<"pMax="<<model->PMax();
+
+        // set the wpk data
+        model->setData(window.bestsWPK);
+        model->saveParameters(add.parameters); // save the computed parms
+
+        add.wpk = true;
+        add.from = window.from;
+        add.to = window.to;
+        add.model = model->code();
+        add.WPrime = model->hasWPrime() ? model->WPrime() : 0;
+        add.CP = model->hasCP() ? model->CP() : 0;
+        add.PMax = model->hasPMax() ? model->PMax() : 0;
+        add.FTP = model->hasFTP() ? model->FTP() : 0;
+        if (add.CP && add.WPrime) add.EI = add.WPrime / add.CP ;
+
+        // so long as the model derived values are sensible ...
+        if ((!model->hasWPrime() || add.WPrime > 10.0f) &&
+            (!model->hasCP() || add.CP > 1.0f) &&
+            (!model->hasPMax() || add.PMax > 1.0f) &&
+            (!model->hasFTP() || add.FTP > 1.0f)) {
+            printd("WPK Estimates for %s - %s\n", add.from.toString().toStdString().c_str(), add.to.toString().toStdString().c_str());
+            window.estimates << add;
+        }
+
+        //qDebug()<<add.from<<model->code()<< "KG W'="<< model->WPrime() <<"CP="<< model->CP() <<"pMax="<<model->PMax();
+    }
+}
+
 Estimator::Estimator(Context *context) : context(context)
 {
     // used to flag when we need to stop
@@ -205,25 +287,17 @@ Estimator::run()
         return;
     }
 
-    // set up the models we support
-    CP2Model p2model(context);
-    CP3Model p3model(context);
-    WSModel wsmodel(context);
-    MultiModel multimodel(context);
-    ExtendedModel extmodel(context);
-
-    QList <PDModel *> models;
-    models << &p2model;
-    models << &p3model;
-    models << &multimodel;
-    models << &extmodel;
-    models << &wsmodel;
-
+    // we aggregate the bests for each week in turn, since that is a
+    // rolling window, but the model fits for each week are independent
+    // so they are run in parallel a batch of weeks at a time (batches
+    // keep the memory used for the aggregates bounded)
+    QVector<EstimatorWindow> batch;
+    int batchsize = QThread::idealThreadCount() * 4;
 
     // from has first ride with Power data / looking at the next 7 days of data with Power
     // calculate Estimates for all data per week including the week of the last Power recording
     QDate date = from;
-    while (date < to) {
+    while (date < to || batch.count()) {
 
         // check if we've been asked to stop
         if (abort == true) {
@@ -232,74 +306,46 @@ Estimator::run()
             return;
         }
 
-        QDate begin = date;
-        QDate end = date.addDays(6);
-
-        printd("Model progress %d/%d\n", date.year(), date.month());
-
-        // months is a rolling 3 months sets of bests
-        QVector<float> wpk; // for getting the wpk values
+        if (date < to) {
 
-        // don't include RUNS ..................................................vvvvv
-        bests.addBests(RideFileCache::meanMaxPowerFor(context, wpk, begin, end, false));
-        bestsWPK.addBests(wpk);
+            QDate begin = date;
+            QDate end = date.addDays(6);
 
-        // we now have the data
-        foreach(PDModel *model, models) {
+            printd("Model progress %d/%d\n", date.year(), date.month());
 
-            PDEstimate add;
+            // months is a rolling 3 months sets of bests
+            QVector<float> wpk; // for getting the wpk values
 
-            // set the data
-            model->setData(bests.aggregate());
-            model->saveParameters(add.parameters); // save the computed parms
+            // don't include RUNS ..................................................vvvvv
+            bests.addBests(RideFileCache::meanMaxPowerFor(context, wpk, begin, end, false));
+            bestsWPK.addBests(wpk);
 
-            add.wpk = false;
+            EstimatorWindow add;
+            add.context = context;
             add.from = begin;
             add.to = end;
-            add.model = model->code();
-            add.WPrime = model->hasWPrime() ? model->WPrime() : 0;
-            add.CP = model->hasCP() ? model->CP() : 0;
-            add.PMax = model->hasPMax() ? model->PMax() : 0;
-            add.FTP = model->hasFTP() ? model->FTP() : 0;
-
-            if (add.CP && add.WPrime) add.EI = add.WPrime / add.CP ;
-
-            // so long as the important model derived values are sensible ...
-            if (add.WPrime > 1000 && add.CP > 100) {
-                printd("Estimates for %s - %s\n", add.from.toString().toStdString().c_str(), add.to.toString().toStdString().c_str());
-                est << add;
-            }
+            add.bests = bests.aggregate();
+            add.bestsWPK = bestsWPK.aggregate();
+            batch << add;
 
-            //qDebug()<<add.to<<add.from<<model->code()<< "W'="<< model->WPrime() <<"CP="<< model->CP() <<"pMax="<<model->PMax();
+            // go forward a week
+            date = date.addDays(7);
+        }
 
-            // set the wpk data
-            model->setData(bestsWPK.aggregate());
-            model->saveParameters(add.parameters); // save the computed parms
+        // fit a batch, or whatever is left at the end
+        if (batch.count() >= batchsize || (date >= to && batch.count())) {
 
-            add.wpk = true;
-            add.from = begin;
-            add.to = end;
-            add.model = model->code();
-            add.WPrime = model->hasWPrime() ? model->WPrime() : 0;
-            add.CP = model->hasCP() ? model->CP() : 0;
-            add.PMax = model->hasPMax() ? model->PMax() : 0;
-            add.FTP = model->hasFTP() ? model->FTP() : 0;
-            if (add.CP && add.WPrime) add.EI = add.WPrime / add.CP ;
-
-            // so long as the model derived values are sensible ...
-            if ((!model->hasWPrime() || add.WPrime > 10.0f) &&
-                (!model->hasCP() || add.CP > 1.0f) &&
-                (!model->hasPMax() || add.PMax > 1.0f) &&
-                (!model->hasFTP() || add.FTP > 1.0f)) {
-                printd("WPK Estimates for %s - %s\n", add.from.toString().toStdString().c_str(), add.to.toString().toStdString().c_str());
-                est << add;
+            QFuture<void> future = QtConcurrent::map(batch, estimateWindow);
+            while (!future.isFinished()) {
+                if (abort == true) future.cancel();
+                msleep(10);
             }
+            future.waitForFinished();
 
-            //qDebug()<<add.from<<model->code()<< "KG W'="<< model->WPrime() <<"CP="<< model->CP() <<"pMax="<<model->PMax();
+            // in date order
+            foreach(const EstimatorWindow &window, batch) est << window.estimates;
+            batch.clear();
         }
-
-        // go forward a week
-        date = date.addDays(7);
     }
 
     // add a dummy entry if we have no estimates to stop constantly trying to refresh
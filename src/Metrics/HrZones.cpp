@@ -426,6 +426,24 @@ bool HrZones::read(QFile &file)
 // end of range
 int HrZones::whichRange(const QDate &date) const
 {
+    // ranges are kept in start date order (see read and addZoneRange)
+    // so binary search for the last one starting on or before the date
+    int lo = 0, hi = ranges.size();
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        const HrZoneRange &range = ranges[mid];
+        if (range.begin.isNull() || range.begin <= date) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo > 0) {
+        const HrZoneRange &range = ranges[lo-1];
+        if (((date >= range.begin) || (range.begin.isNull())) &&
+            ((date < range.end) || (range.end.isNull())))
+            return lo-1;
+    }
+
+    // not found, or the ranges are mid-edit and out of order
+    // so fall back to looking at each of them in turn
     for (int rnum = 0; rnum < ranges.size(); ++rnum) {
         const HrZoneRange &range = ranges[rnum];
         if (((date >= range.begin) || (range.begin.isNull())) &&
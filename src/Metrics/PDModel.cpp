@@ -18,7 +18,9 @@
 
 #include "PDModel.h"
 #include "LTMTrend.h"
-#include "lmcurve.h"
+#include "lmmin.h"
+
+#include <algorithm>
 
 // base class for all models
 PDModel::PDModel(Context *context) :
@@ -125,11 +127,135 @@ PDModel::setIntervals(double sanI1, double sanI2, double anI1, double anI2,
     emit intervalsChanged();
 }
 
-// used to wrap a function call when deriving parameters
-QMutex calllmfit;
-static PDModel *calllmfitmodel = NULL;
-static double calllmfitf(double t, const double *p) {
-    return static_cast<PDModel*>(calllmfitmodel)->f(t, p);
+// carried through lmmin to the evaluate callback, so there is
+// no need for a global to find the model (and a mutex around it)
+struct PDModelFit {
+    PDModel *model;
+    const double *t;
+};
+
+static void
+pdmodelevaluate(const double *par, const int m, const void *data, double *fvec, int *)
+{
+    const PDModelFit *fit = static_cast<const PDModelFit*>(data);
+    for (int i=0; i<m; i++) fvec[i] = fit->model->f(fit->t[i], par);
+}
+
+// solve A.x = b for n <= 3 with partial pivoting, A and b are overwritten
+static bool
+pdmodelsolve(int n, double A[3][3], double *b, double *x)
+{
+    for (int c=0; c<n; c++) {
+        int pivot = c;
+        for (int r=c+1; r<n; r++) if (fabs(A[r][c]) > fabs(A[pivot][c])) pivot = r;
+        if (A[pivot][c] == 0) return false;
+        if (pivot != c) {
+            for (int k=0; k<n; k++) std::swap(A[c][k], A[pivot][k]);
+            std::swap(b[c], b[pivot]);
+        }
+        for (int r=c+1; r<n; r++) {
+            double factor = A[r][c] / A[c][c];
+            for (int k=c; k<n; k++) A[r][k] -= factor * A[c][k];
+            b[r] -= factor * b[c];
+        }
+    }
+    for (int r=n-1; r>=0; r--) {
+        double sum = b[r];
+        for (int k=r+1; k<n; k++) sum -= A[r][k] * x[k];
+        x[r] = sum / A[r][r];
+    }
+    return true;
+}
+
+// Levenberg-Marquardt using the analytic jacobian from df(), the
+// closed form models only have 2 or 3 parameters so the normal
+// equations are tiny and each iteration is a single pass over
+// the data, rather than nparms+1 passes for a difference jacobian
+static bool
+pdmodeljacobianfit(PDModel *model, int n, double *par, int m, const double *t, const double *y)
+{
+    double jac[3];
+    if (n > 3 || m < n || !model->df(t[0], par, jac)) return false;
+
+    double lambda = 0.001;
+    double sse = 0;
+    for (int i=0; i<m; i++) {
+        double r = y[i] - model->f(t[i], par);
+        sse += r*r;
+    }
+
+    for (int iteration=0; iteration < 100*(n+1); iteration++) {
+
+        // normal equations J'J.delta = J'r
+        double JtJ[3][3] = { {0,0,0}, {0,0,0}, {0,0,0} };
+        double Jtr[3] = { 0,0,0 };
+        for (int i=0; i<m; i++) {
+            double r = y[i] - model->f(t[i], par);
+            model->df(t[i], par, jac);
+            for (int j=0; j<n; j++) {
+                Jtr[j] += jac[j] * r;
+                for (int k=0; k<=j; k++) JtJ[j][k] += jac[j] * jac[k];
+            }
+        }
+        for (int j=0; j<n; j++) for (int k=j+1; k<n; k++) JtJ[j][k] = JtJ[k][j];
+
+        // damp until we find a step that reduces the error
+        bool improved = false;
+        double trial[3], delta[3];
+        double trialsse = 0;
+        while (lambda < 1e16) {
+
+            double A[3][3], b[3];
+            for (int j=0; j<n; j++) {
+                for (int k=0; k<n; k++) A[j][k] = JtJ[j][k];
+                A[j][j] += lambda * (JtJ[j][j] > 0 ? JtJ[j][j] : 1);
+                b[j] = Jtr[j];
+            }
+
+            if (pdmodelsolve(n, A, b, delta)) {
+                for (int j=0; j<n; j++) trial[j] = par[j] + delta[j];
+                trialsse = 0;
+                for (int i=0; i<m; i++) {
+                    double r = y[i] - model->f(t[i], trial);
+                    trialsse += r*r;
+                }
+                if (trialsse == trialsse && trialsse < sse) {
+                    improved = true;
+                    break;
+                }
+            }
+            lambda *= 10;
+        }
+        if (!improved) break;
+
+        // accept
+        double relative = (sse - trialsse) / (sse > 0 ? sse : 1);
+        double step = 0, size = 0;
+        for (int j=0; j<n; j++) {
+            step += delta[j] * delta[j];
+            size += trial[j] * trial[j];
+            par[j] = trial[j];
+        }
+        sse = trialsse;
+        lambda = lambda / 10 > 1e-12 ? lambda / 10 : 1e-12;
+
+        // same tolerances as lm_control_double
+        if (relative < 1e-15 || step <= 1e-30 * (size > 0 ? size : 1)) break;
+    }
+    return true;
+}
+
+void
+PDModel::lmfit(double *par, const QVector<double> &t, const QVector<double> &p)
+{
+    // closed form models have an analytic jacobian
+    if (pdmodeljacobianfit(this, nparms(), par, p.count(), t.constData(), p.constData())) return;
+
+    // otherwise lmmin approximates it by forward differences
+    lm_control_struct control = lm_control_double;
+    lm_status_struct status;
+    PDModelFit fit = { this, t.constData() };
+    lmmin(nparms(), par, p.count(), p.constData(), &fit, pdmodelevaluate, &control, &status);
 }
 
 // using the data and intervals from above, derive the
@@ -280,26 +406,8 @@ PDModel::deriveCPParameters(int model)
             t = tdata;
         }
 
-        lm_control_struct control = lm_control_double;
-        lm_status_struct status;
-
-        // use forwarder via global variable, so mutex around this !
-        calllmfit.lock();
-        calllmfitmodel = this;
-
         //fprintf(stderr, "Fitting ...\n" ); fflush(stderr);
-        lmcurve(this->nparms(), par, p.count(), t.constData(), p.constData(), calllmfitf, &control, &status);
-
-        // release for others
-        calllmfit.unlock();
-
-        //fprintf(stderr, "Results:\n" );
-        //fprintf(stderr, "status after %d function evaluations:\n  %s\n",
-        //        status.nfev, lm_infmsg[status.outcome] ); fflush(stderr);
-        //fprintf(stderr,"obtained parameters:\n"); fflush(stderr);
-        //for (int i = 0; i < this->nparms(); ++i)
-        //    fprintf(stderr,"  par[%i] = %12g\n", i, par[i]);
-        //fprintf(stderr,"obtained norm:\n  %12g\n", status.fnorm ); fflush(stderr);
+        lmfit(par, t, p);
 
         // save away the values we fit to.
         this->setParms(par);
@@ -1006,27 +1114,12 @@ ExtendedModel::deriveExtCPParameters()
         par[6]= ecp_dec;
         par[7]= ecp_dec_del;
 
-        lm_control_struct control = lm_control_double;
-        lm_status_struct status;
-
-        // use forwarder via global variable, so mutex around this !
-        calllmfit.lock();
-        calllmfitmodel = this;
-
         fprintf(stderr, "Fitting ...\n" ); fflush(stderr);
-        lmcurve(this->nparms(), par, p.count(), t.constData(), p.constData(), calllmfitf, &control, &status);
-
-        // release for others
-        calllmfit.unlock();
-
-        fprintf(stderr, "Results:\n" );
-        fprintf(stderr, "status after %d function evaluations:\n  %s\n",
-                status.nfev, lm_infmsg[status.outcome] ); fflush(stderr);
+        lmfit(par, t, p);
 
         fprintf(stderr,"obtained parameters:\n"); fflush(stderr);
         for (int i = 0; i < this->nparms(); ++i)
             fprintf(stderr,"  par[%i] = %12g\n", i, par[i]);
-        fprintf(stderr,"obtained norm:\n  %12g\n", status.fnorm ); fflush(stderr);
 
         // save away the values we fit to.
         this->setParms(par);
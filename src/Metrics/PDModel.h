@@ -135,6 +135,15 @@ class PDModel : public QObject, public QwtSyntheticPointData
         virtual double f(double, const double *) { return -1; }
         virtual bool setParms(double *) { return false; }
 
+        // partial derivatives of f for each parameter, models with a
+        // closed form set jac[0..nparms-1] and return true so they can
+        // be fitted with an analytic jacobian instead of differencing
+        virtual bool df(double, const double *, double *) { return false; }
+
+        // least squares fit of f to p(t) starting from par, reentrant
+        // so models can be fitted concurrently on different threads
+        void lmfit(double *par, const QVector<double> &t, const QVector<double> &p);
+
         // we identify peak efforts when modelling
         // lets make these available, currently only
         // available with the extended CP model
@@ -215,6 +224,11 @@ class CP2Model : public PDModel
         double f(double t, const double *parms) {
             return parms[0] + (parms[1]/t);
         }
+        bool df(double t, const double *, double *jac) {
+            jac[0] = 1;
+            jac[1] = 1/t;
+            return true;
+        }
         bool setParms(double *parms) {
 
             // set the model parameters with the values from the fit
@@ -264,6 +278,14 @@ class CP3Model : public PDModel
 
             return cp + (w/(t+k));
         }
+        bool df(double t, const double *parms, double *jac) {
+            double w = parms[1];
+            double k = parms[2];
+            jac[0] = 1;
+            jac[1] = 1/(t+k);
+            jac[2] = -w/((t+k)*(t+k));
+            return true;
+        }
         bool setParms(double *parms) {
             this->cp = parms[0];
             this->tau = parms[1] / (cp * 60.00);
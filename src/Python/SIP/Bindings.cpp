@@ -7,6 +7,8 @@
 #include "PythonChart.h"
 #include "Colors.h"
 #include "RideCache.h"
+#include "RideSimilarity.h"
+#include "RideResidency.h"
 #include "DataFilter.h"
 #include "PMCData.h"
 #include "Season.h"
@@ -16,6 +18,7 @@
 #include "PaceZones.h"
 
 #include "Bindings.h"
+#include "sipAPIgoldencheetah.h" // to return PythonDataSeries in a dict
 
 #include <QWebEngineView>
 #include <QUrl>
@@ -556,21 +559,27 @@ Bindings::series(int type, PyObject* activity) const
     if (item == NULL) item = const_cast<RideItem*>(context->currentRideItem());
     if (item == NULL) return NULL;
 
+    // we run on another thread, don't let it be closed under us
+    RideResidencyPin pin(item);
     RideFile* f = item->ride();
     if (f == NULL) return NULL;
 
-    // count the included points, create data series output and copy data
-    int pCount = 0;
+    // the iterator knows the range of included points, so copy in a single
+    // pass and without holding the GIL since we don't touch python objects
     RideFileIterator it(f, python->contexts.value(threadid()).spec);
-    while (it.hasNext()) { it.next(); pCount++; }
-    PythonDataSeries* ds = new PythonDataSeries(seriesName(type), pCount);
-    it.toFront();
+    int pCount = (it.firstIndex() < 0 || it.lastIndex() < 0) ? 0 : it.lastIndex() - it.firstIndex() + 1;
+    QVector<double> data(pCount);
+
+    Py_BEGIN_ALLOW_THREADS
+    double *values = data.data();
     for(int i=0; i<pCount && it.hasNext(); i++) {
         struct RideFilePoint *point = it.next();
-        ds->data[i] = point->value(static_cast<RideFile::SeriesType>(type));
+        values[i] = point->value(static_cast<RideFile::SeriesType>(type));
     }
+    Py_END_ALLOW_THREADS
 
-    return ds;
+    // hand over without copying
+    return new PythonDataSeries(seriesName(type), data);
 }
 
 // get the wbal series for the currently selected ride
@@ -585,6 +594,8 @@ Bindings::activityWbal(PyObject* activity) const
     if (item == NULL) item = const_cast<RideItem*>(context->currentRideItem());
     if (item == NULL) return NULL;
 
+    // we run on another thread, don't let it be closed under us
+    RideResidencyPin pin(item);
     RideFile* f = item->ride();
     if (f == NULL) return NULL;
 
@@ -634,6 +645,8 @@ Bindings::xdata(QString name, QString series, QString join, PyObject* activity)
     if (item == NULL) item = const_cast<RideItem*>(context->currentRideItem());
     if (item == NULL) return NULL;
 
+    // we run on another thread, don't let it be closed under us
+    RideResidencyPin pin(item);
     RideFile* f = item->ride();
     if (f == NULL) return NULL;
 
@@ -642,12 +655,10 @@ Bindings::xdata(QString name, QString series, QString join, PyObject* activity)
 
     if (!xds->valuename.contains(series)) return NULL; // No such XData name
 
-    // count the included points, create data series output and copy data
-    int pCount = 0;
+    // create data series output and copy data in a single pass
     RideFileIterator it(f, python->contexts.value(threadid()).spec);
-    while (it.hasNext()) { it.next(); pCount++; }
+    int pCount = (it.firstIndex() < 0 || it.lastIndex() < 0) ? 0 : it.lastIndex() - it.firstIndex() + 1;
     PythonDataSeries* ds = new PythonDataSeries(QString("%1_%2").arg(name).arg(series), pCount);
-    it.toFront();
     int idx = 0;
     for(int i=0; i<pCount && it.hasNext(); i++) {
         struct RideFilePoint *point = it.next();
@@ -670,6 +681,8 @@ Bindings::xdataSeries(QString name, QString series, PyObject* activity) const
     if (item == NULL) item = const_cast<RideItem*>(context->currentRideItem());
     if (item == NULL) return NULL;
 
+    // we run on another thread, don't let it be closed under us
+    RideResidencyPin pin(item);
     RideFile* f = item->ride();
     if (f == NULL) return NULL;
 
@@ -719,6 +732,8 @@ Bindings::xdataNames(QString name, PyObject* activity) const
     if (item == NULL) item = const_cast<RideItem*>(context->currentRideItem());
     if (item == NULL) return NULL;
 
+    // we run on another thread, don't let it be closed under us
+    RideResidencyPin pin(item);
     RideFile* f = item->ride();
     if (f == NULL) return NULL;
 
@@ -761,16 +776,21 @@ Bindings::seriesPresent(int type, PyObject* activity) const
     if (item == NULL) item = const_cast<RideItem*>(context->currentRideItem());
     if (item == NULL) return NULL;
 
+    RideResidencyPin pin(item);
     return item->ride()->isDataPresent(static_cast<RideFile::SeriesType>(type));
 }
 
-PythonDataSeries::PythonDataSeries(QString name, Py_ssize_t count) : name(name), count(count), data(NULL)
+PythonDataSeries::PythonDataSeries(QString name, Py_ssize_t count) : name(name), count(count), readonly(false)
 {
-    if (count > 0) data = new double[count];
+    if (count > 0) data.resize(count);
+    else this->count = 0;
 }
 
+// take existing data without copying it
+PythonDataSeries::PythonDataSeries(QString name, QVector<double> data, bool readonly) : name(name), count(data.count()), data(data), readonly(readonly) {}
+
 // default constructor and copy constructor
-PythonDataSeries::PythonDataSeries() : name(QString()), count(0), data(NULL) {}
+PythonDataSeries::PythonDataSeries() : name(QString()), count(0), readonly(false) {}
 PythonDataSeries::PythonDataSeries(PythonDataSeries *clone)
 {
     *this = *clone;
@@ -778,8 +798,6 @@ PythonDataSeries::PythonDataSeries(PythonDataSeries *clone)
 
 PythonDataSeries::~PythonDataSeries()
 {
-    if (data) delete[] data;
-    data=NULL;
 }
 
 PyObject*
@@ -915,7 +933,7 @@ Bindings::activityMetrics(RideItem* item) const
 }
 
 PyObject*
-Bindings::seasonMetrics(bool all, QString filter, bool compare) const
+Bindings::seasonMetrics(bool all, QString filter, bool compare, bool series) const
 {
     Context *context = python->contexts.value(threadid()).context;
     if (context == NULL) return NULL;
@@ -939,7 +957,7 @@ Bindings::seasonMetrics(bool all, QString filter, bool compare) const
                 if (p.isChecked()) {
 
                     // create a tuple (metrics, color)
-                    PyObject* tuple = Py_BuildValue("(Os)", seasonMetrics(all, DateRange(p.start, p.end), filter), p.color.name().toUtf8().constData());
+                    PyObject* tuple = Py_BuildValue("(Os)", seasonMetrics(all, DateRange(p.start, p.end), filter, series), p.color.name().toUtf8().constData());
                     // add to back and move on
                     PyList_SET_ITEM(list, idx++, tuple);
                 }
@@ -954,7 +972,7 @@ Bindings::seasonMetrics(bool all, QString filter, bool compare) const
 
             // create a tuple (metrics, color)
             DateRange range = context->currentDateRange();
-            PyObject* tuple = Py_BuildValue("(Os)", seasonMetrics(all, range, filter), "#FF00FF");
+            PyObject* tuple = Py_BuildValue("(Os)", seasonMetrics(all, range, filter, series), "#FF00FF");
             // add to back and move on
             PyList_SET_ITEM(list, 0, tuple);
 
@@ -965,12 +983,12 @@ Bindings::seasonMetrics(bool all, QString filter, bool compare) const
 
         // just a dict of metrics
         DateRange range = context->currentDateRange();
-        return seasonMetrics(all, range, filter);
+        return seasonMetrics(all, range, filter, series);
     }
 }
 
 PyObject*
-Bindings::seasonMetrics(bool all, DateRange range, QString filter) const
+Bindings::seasonMetrics(bool all, DateRange range, QString filter, bool series) const
 {
     Context *context = python->contexts.value(threadid()).context;
     if (context == NULL || context->athlete == NULL || context->athlete->rideCache == NULL) return NULL;
@@ -994,13 +1012,34 @@ Bindings::seasonMetrics(bool all, DateRange range, QString filter) const
     }
 
     specification.setFilterSet(fs);
+    if (!all) specification.setDateRange(range);
 
-    // we need to count rides that are in range...
-    int rides = 0;
-    foreach(RideItem *ride, context->athlete->rideCache->rides()) {
-        if (!specification.pass(ride)) continue;
-        if (all || range.pass(ride->dateTime.date())) rides++;
+    // collect the rides in range and all the metric columns in one
+    // pass, this doesn't touch any python objects so release the GIL
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+    bool useMetricUnits = context->athlete->useMetricUnits;
+    QVector<RideItem*> items;
+    QVector<QVector<double> > columns(factory.metricCount());
+
+    Py_BEGIN_ALLOW_THREADS
+    RideCache *rideCache = context->athlete->rideCache;
+    QBitArray pass = rideCache->passing(specification);
+    items.reserve(pass.count(true));
+    for (int k=0; k<rideCache->rides().count() && k<pass.size(); k++)
+        if (pass.testBit(k)) items << rideCache->rides()[k];
+
+    for(int i=0; i<factory.metricCount(); i++) {
+        const RideMetric *metric = factory.rideMetric(factory.metricName(i));
+        double factor = useMetricUnits ? 1.0f : metric->conversion();
+        double sum = useMetricUnits ? 0.0f : metric->conversionSum();
+
+        columns[i].resize(items.count());
+        double *column = columns[i].data();
+        for(int k=0; k<items.count(); k++) column[k] = items[k]->metrics()[i] * factor + sum;
     }
+    Py_END_ALLOW_THREADS
+
+    int rides = items.count();
 
     PyObject* dict = PyDict_New();
     if (dict == NULL) return dict;
@@ -1015,35 +1054,31 @@ Bindings::seasonMetrics(bool all, DateRange range, QString filter) const
     PyObject* colorlist = PyList_New(rides);
 
     int idx = 0;
-    foreach(RideItem *ride, context->athlete->rideCache->rides()) {
-        if (!specification.pass(ride)) continue;
-        if (all || range.pass(ride->dateTime.date())) {
+    foreach(RideItem *ride, items) {
+        QDate d = ride->dateTime.date();
+        PyList_SET_ITEM(datelist, idx, PyDate_FromDate(d.year(), d.month(), d.day()));
 
-            QDate d = ride->dateTime.date();
-            PyList_SET_ITEM(datelist, idx, PyDate_FromDate(d.year(), d.month(), d.day()));
+        QTime t = ride->dateTime.time();
+        PyList_SET_ITEM(timelist, idx, PyTime_FromTime(t.hour(), t.minute(), t.second(), t.msec()*10));
 
-            QTime t = ride->dateTime.time();
-            PyList_SET_ITEM(timelist, idx, PyTime_FromTime(t.hour(), t.minute(), t.second(), t.msec()*10));
+        // apply item color, remembering that 1,1,1 means use default (reverse in this case)
+        QString color;
 
-            // apply item color, remembering that 1,1,1 means use default (reverse in this case)
-            QString color;
+        if (ride->color == QColor(1,1,1,1)) {
 
-            if (ride->color == QColor(1,1,1,1)) {
+            // use the inverted color, not plot marker as that hideous
+            QColor col =GCColor::invertColor(GColor(CPLOTBACKGROUND));
 
-                // use the inverted color, not plot marker as that hideous
-                QColor col =GCColor::invertColor(GColor(CPLOTBACKGROUND));
+            // white is jarring on a dark background!
+            if (col==QColor(Qt::white)) col=QColor(127,127,127);
 
-                // white is jarring on a dark background!
-                if (col==QColor(Qt::white)) col=QColor(127,127,127);
+            color = col.name();
+        } else
+            color = ride->color.name();
 
-                color = col.name();
-            } else
-                color = ride->color.name();
+        PyList_SET_ITEM(colorlist, idx, PyUnicode_FromString(color.toUtf8().constData()));
 
-            PyList_SET_ITEM(colorlist, idx, PyUnicode_FromString(color.toUtf8().constData()));
-
-            idx++;
-        }
+        idx++;
     }
 
     PyDict_SetItemString(dict, "date", datelist);
@@ -1053,29 +1088,25 @@ Bindings::seasonMetrics(bool all, DateRange range, QString filter) const
     //
     // METRICS
     //
-    const RideMetricFactory &factory = RideMetricFactory::instance();
-    bool useMetricUnits = context->athlete->useMetricUnits;
     for(int i=0; i<factory.metricCount();i++) {
 
         QString symbol = factory.metricName(i);
-        const RideMetric *metric = factory.rideMetric(symbol);
         QString name = context->specialFields.internalName(factory.rideMetric(symbol)->name());
         name = name.replace(" ","_");
         name = name.replace("'","_");
 
-        // set a list of metric values
-        PyObject* metriclist = PyList_New(rides);
-
-        int idx = 0;
-        foreach(RideItem *item, context->athlete->rideCache->rides()) {
-            if (!specification.pass(item)) continue;
-            if (all || range.pass(item->dateTime.date())) {
-                PyList_SET_ITEM(metriclist, idx++, PyFloat_FromDouble(item->metrics()[i] * (useMetricUnits ? 1.0f : metric->conversion()) + (useMetricUnits ? 0.0f : metric->conversionSum())));
-            }
+        // a list of metric values, or the column itself as a data series
+        PyObject* metriclist;
+        if (series) {
+            metriclist = sipConvertFromNewType(new PythonDataSeries(name, columns[i]), sipType_PythonDataSeries, NULL);
+        } else {
+            metriclist = PyList_New(rides);
+            for(int k=0; k<rides; k++) PyList_SET_ITEM(metriclist, k, PyFloat_FromDouble(columns[i][k]));
         }
 
         // add to the dict
         PyDict_SetItemString(dict, name.toUtf8().constData(), metriclist);
+        Py_DECREF(metriclist);
     }
 
     //
@@ -1091,11 +1122,8 @@ Bindings::seasonMetrics(bool all, DateRange range, QString filter) const
         PyObject* metalist = PyList_New(rides);
 
         int idx = 0;
-        foreach(RideItem *item, context->athlete->rideCache->rides()) {
-            if (!specification.pass(item)) continue;
-            if (all || range.pass(item->dateTime.date())) {
-                PyList_SET_ITEM(metalist, idx++, PyUnicode_FromString(item->getText(field.name, "").toUtf8().constData()));
-            }
+        foreach(RideItem *item, items) {
+            PyList_SET_ITEM(metalist, idx++, PyUnicode_FromString(item->getText(field.name, "").toUtf8().constData()));
         }
 
         // add to the dict
@@ -1391,6 +1419,42 @@ Bindings::activityIntervals(QString type, PyObject* activity) const
     return dict;
 }
 
+PyObject*
+Bindings::activitySimilar(PyObject* activity, int count) const
+{
+    Context *context = python->contexts.value(threadid()).context;
+    if (context == NULL) return NULL;
+
+    RideItem* ride = fromDateTime(activity);
+    if (ride == NULL) ride = python->contexts.value(threadid()).item;
+    if (ride == NULL) ride = const_cast<RideItem*>(context->currentRideItem());
+    if (ride == NULL) return NULL;
+
+    // import datetime if necessary
+    if (PyDateTimeAPI == NULL) PyDateTime_IMPORT;
+
+    // most alike first
+    QVector<double> scores;
+    QList<RideItem*> like = context->athlete->rideCache->similarity()->like(ride, count, &scores);
+
+    PyObject* dict = PyDict_New();
+    if (dict == NULL) return dict;
+
+    PyObject* dates = PyList_New(like.count());
+    PyObject* similarity = PyList_New(like.count());
+    for(int i=0; i<like.count(); i++) {
+        QDate d = like[i]->dateTime.date();
+        QTime t = like[i]->dateTime.time();
+        PyList_SET_ITEM(dates, i, PyDateTime_FromDateAndTime(d.year(), d.month(), d.day(), t.hour(), t.minute(), t.second(), t.msec()*10));
+        PyList_SET_ITEM(similarity, i, PyFloat_FromDouble(scores[i]));
+    }
+
+    PyDict_SetItemString(dict, "activity", dates);
+    PyDict_SetItemString(dict, "similarity", similarity);
+
+    return dict;
+}
+
 PythonDataSeries*
 Bindings::metrics(QString metric, bool all, QString filter) const
 {
@@ -1417,13 +1481,7 @@ Bindings::metrics(QString metric, bool all, QString filter) const
     }
 
     specification.setFilterSet(fs);
-
-    // we need to count rides that are in range...
-    int rides = 0;
-    foreach(RideItem *ride, context->athlete->rideCache->rides()) {
-        if (!specification.pass(ride)) continue;
-        if (all || range.pass(ride->dateTime.date())) rides++;
-    }
+    if (!all) specification.setDateRange(range);
 
     const RideMetricFactory &factory = RideMetricFactory::instance();
     bool useMetricUnits = context->athlete->useMetricUnits;
@@ -1437,19 +1495,22 @@ Bindings::metrics(QString metric, bool all, QString filter) const
 
         if (name == metric) {
 
-            // found, set an array of metric values
-            PythonDataSeries* pds = new PythonDataSeries(name, rides);
-
-            int idx = 0;
-            foreach(RideItem *item, context->athlete->rideCache->rides()) {
-                if (!specification.pass(item)) continue;
-                if (all || range.pass(item->dateTime.date())) {
-                    pds->data[idx++] = item->metrics()[i] * (useMetricUnits ? 1.0f : m->conversion()) + (useMetricUnits ? 0.0f : m->conversionSum());
-                }
+            // found, collect the column without holding the GIL
+            QVector<double> data;
+
+            Py_BEGIN_ALLOW_THREADS
+            RideCache *rideCache = context->athlete->rideCache;
+            QBitArray pass = rideCache->passing(specification);
+            data.reserve(pass.count(true));
+            for (int k=0; k<rideCache->rides().count() && k<pass.size(); k++) {
+                if (!pass.testBit(k)) continue;
+                RideItem *item = rideCache->rides()[k];
+                data << item->metrics()[i] * (useMetricUnits ? 1.0f : m->conversion()) + (useMetricUnits ? 0.0f : m->conversionSum());
             }
+            Py_END_ALLOW_THREADS
 
-            // Done, return the series
-            return pds;
+            // Done, return the series without copying
+            return new PythonDataSeries(name, data);
         }
     }
 
@@ -1458,7 +1519,7 @@ Bindings::metrics(QString metric, bool all, QString filter) const
 }
 
 PyObject*
-Bindings::activityMeanmax(bool compare) const
+Bindings::activityMeanmax(bool compare, bool series) const
 {
     Context *context = python->contexts.value(threadid()).context;
     if (context == NULL) return NULL;
@@ -1480,7 +1541,7 @@ Bindings::activityMeanmax(bool compare) const
                 if (p.isChecked()) {
 
                     // create a tuple (meanmax, color)
-                    PyObject* tuple = Py_BuildValue("(Os)", activityMeanmax(p.rideItem), p.color.name().toUtf8().constData());
+                    PyObject* tuple = Py_BuildValue("(Os)", activityMeanmax(p.rideItem, series), p.color.name().toUtf8().constData());
                     PyList_SET_ITEM(list, idx++, tuple);
                 }
             }
@@ -1492,7 +1553,7 @@ Bindings::activityMeanmax(bool compare) const
             if (context->currentRideItem()==NULL) return NULL;
             PyObject* list = PyList_New(1);
 
-            PyObject* tuple = Py_BuildValue("(Os)", activityMeanmax(context->currentRideItem()), "#FF00FF");
+            PyObject* tuple = Py_BuildValue("(Os)", activityMeanmax(context->currentRideItem(), series), "#FF00FF");
             PyList_SET_ITEM(list, 0, tuple);
 
             return list;
@@ -1502,12 +1563,12 @@ Bindings::activityMeanmax(bool compare) const
         // not compare, so just return a dict
         RideItem *item = python->contexts.value(threadid()).item;
         if (item == NULL) item = const_cast<RideItem*>(context->currentRideItem());
-        return activityMeanmax(item);
+        return activityMeanmax(item, series);
     }
 }
 
 PyObject*
-Bindings::seasonMeanmax(bool all, QString filter, bool compare) const
+Bindings::seasonMeanmax(bool all, QString filter, bool compare, bool series) const
 {
     Context *context = python->contexts.value(threadid()).context;
     if (context == NULL) return NULL;
@@ -1531,7 +1592,7 @@ Bindings::seasonMeanmax(bool all, QString filter, bool compare) const
                 if (p.isChecked()) {
 
                     // create a tuple (meanmax, color)
-                    PyObject* tuple = Py_BuildValue("(Os)", seasonMeanmax(all, DateRange(p.start, p.end), filter), p.color.name().toUtf8().constData());
+                    PyObject* tuple = Py_BuildValue("(Os)", seasonMeanmax(all, DateRange(p.start, p.end), filter, series), p.color.name().toUtf8().constData());
                     // add to back and move on
                     PyList_SET_ITEM(list, idx++, tuple);
                 }
@@ -1546,7 +1607,7 @@ Bindings::seasonMeanmax(bool all, QString filter, bool compare) const
 
             // create a tuple (meanmax, color)
             DateRange range = context->currentDateRange();
-            PyObject* tuple = Py_BuildValue("(Os)", seasonMeanmax(all, range, filter), "#FF00FF");
+            PyObject* tuple = Py_BuildValue("(Os)", seasonMeanmax(all, range, filter, series), "#FF00FF");
             // add to back and move on
             PyList_SET_ITEM(list, 0, tuple);
 
@@ -1558,12 +1619,12 @@ Bindings::seasonMeanmax(bool all, QString filter, bool compare) const
         // just a datafram of meanmax
         DateRange range = context->currentDateRange();
 
-        return seasonMeanmax(all, range, filter);
+        return seasonMeanmax(all, range, filter, series);
     }
 }
 
 PyObject*
-Bindings::seasonMeanmax(bool all, DateRange range, QString filter) const
+Bindings::seasonMeanmax(bool all, DateRange range, QString filter, bool series) const
 {
     Context *context = python->contexts.value(threadid()).context;
     if (context == NULL) return NULL;
@@ -1584,19 +1645,28 @@ Bindings::seasonMeanmax(bool all, DateRange range, QString filter) const
     }
 
     // RideFileCache for a date range with our filters (if any)
-    RideFileCache cache(context, range.from, range.to, filt, filelist, false, NULL);
-
-    return rideFileCacheMeanmax(&cache);
+    // aggregating reads every cpx file so don't hold the GIL
+    RideFileCache *cache;
+    Py_BEGIN_ALLOW_THREADS
+    cache = new RideFileCache(context, range.from, range.to, filt, filelist, false, NULL);
+    Py_END_ALLOW_THREADS
+
+    PyObject *ans = rideFileCacheMeanmax(cache, series);
+    delete cache;
+    return ans;
 }
 
 PyObject*
-Bindings::activityMeanmax(const RideItem* item) const
+Bindings::activityMeanmax(const RideItem* item, bool series) const
 {
-    return rideFileCacheMeanmax(const_cast<RideItem*>(item)->fileCache());
+    // close() deletes the cache, so keep the ride open while we use it
+    RideItem *ride = const_cast<RideItem*>(item);
+    RideResidencyPin pin(ride);
+    return rideFileCacheMeanmax(ride->fileCache(), series);
 }
 
 PyObject*
-Bindings::rideFileCacheMeanmax(RideFileCache* cache) const
+Bindings::rideFileCacheMeanmax(RideFileCache* cache, bool asSeries) const
 {
     if (PyDateTimeAPI == NULL) PyDateTime_IMPORT;// import datetime if necessary
 
@@ -1616,16 +1686,21 @@ Bindings::rideFileCacheMeanmax(RideFileCache* cache) const
         if (series != RideFile::watts && values.count()==0) continue;
 
 
-        // set a list
-        PyObject* list = PyList_New(values.count());
-
+        // set a list, or a read only data series sharing the cache array
         // will have different sizes e.g. when a daterange
         // since longest ride with e.g. power may be different
         // to longest ride with heartrate
-        for(int j=0; j<values.count(); j++) PyList_SET_ITEM(list, j, PyFloat_FromDouble(values[j]));
+        PyObject* list;
+        if (asSeries) {
+            list = sipConvertFromNewType(new PythonDataSeries(RideFile::seriesName(series, true), values, true), sipType_PythonDataSeries, NULL);
+        } else {
+            list = PyList_New(values.count());
+            for(int j=0; j<values.count(); j++) PyList_SET_ITEM(list, j, PyFloat_FromDouble(values[j]));
+        }
 
         // add to the dict
         PyDict_SetItemString(ans, RideFile::seriesName(series, true).toUtf8().constData(), list);
+        Py_DECREF(list);
 
         // if is power add the dates
         if(series == RideFile::watts) {
@@ -1,4 +1,5 @@
 #include <QString>
+#include <QVector>
 #include "RideFile.h"
 #include "RideFileCache.h"
 
@@ -6,17 +7,22 @@
 #include <Python.h>
 
 
+// data is exposed to python via the buffer protocol, when constructed
+// from an existing vector it is shared (not copied), and should be read
+// only if the vector is still shared with something else
 class PythonDataSeries {
 
     public:
         PythonDataSeries(QString name, Py_ssize_t count);
+        PythonDataSeries(QString name, QVector<double> data, bool readonly=false);
         PythonDataSeries(PythonDataSeries*);
         PythonDataSeries();
         ~PythonDataSeries();
 
         QString name;
         Py_ssize_t count;
-        double *data;
+        QVector<double> data;
+        bool readonly;
 };
 
 class Bindings {
@@ -52,33 +58,37 @@ class Bindings {
 
         // working with metrics
         PyObject* activityMetrics(bool compare=false) const;
-        PyObject* seasonMetrics(bool all=false, QString filter=QString(), bool compare=false) const;
+        PyObject* seasonMetrics(bool all=false, QString filter=QString(), bool compare=false, bool series=false) const;
         PythonDataSeries *metrics(QString metric, bool all=false, QString filter=QString()) const;
         PyObject* seasonPmc(bool all=false, QString metric=QString("TSS")) const;
         PyObject* seasonMeasures(bool all=false, QString group=QString("Body")) const;
 
         // working with meanmax data
-        PyObject* activityMeanmax(bool compare=false) const;
-        PyObject* seasonMeanmax(bool all=false, QString filter=QString(), bool compare=false) const;
+        PyObject* activityMeanmax(bool compare=false, bool series=false) const;
+        PyObject* seasonMeanmax(bool all=false, QString filter=QString(), bool compare=false, bool series=false) const;
         PyObject* seasonPeaks(QString series, int duration, bool all=false, QString filter=QString(), bool compare=false) const;
 
         // working with intervals
         PyObject* seasonIntervals(QString type=QString(), bool compare=false) const;
         PyObject* activityIntervals(QString type=QString(), PyObject* activity=NULL) const;
 
+        // finding similar activities
+        PyObject* activitySimilar(PyObject* activity=NULL, int count=10) const;
+
     private:
         // find a RideItem by DateTime
         RideItem* fromDateTime(PyObject* activity=NULL) const;
 
         // get a dict populated with metrics and metadata
         PyObject* activityMetrics(RideItem* item) const;
-        PyObject* seasonMetrics(bool all, DateRange range, QString filter) const;
+        PyObject* seasonMetrics(bool all, DateRange range, QString filter, bool series) const;
         PyObject* seasonIntervals(DateRange range, QString type) const;
 
         // get a dict populated with meanmax data
-        PyObject* activityMeanmax(const RideItem* item) const;
-        PyObject* seasonMeanmax(bool all, DateRange range, QString filter) const;
-        PyObject* rideFileCacheMeanmax(RideFileCache* cache) const;
+        // the values are lists, or data series when series is true
+        PyObject* activityMeanmax(const RideItem* item, bool series) const;
+        PyObject* seasonMeanmax(bool all, DateRange range, QString filter, bool series) const;
+        PyObject* rideFileCacheMeanmax(RideFileCache* cache, bool asSeries) const;
         PyObject* seasonPeaks(bool all, DateRange range, QString filter, QList<RideFile::SeriesType> series, QList<int> durations) const;
 
 };
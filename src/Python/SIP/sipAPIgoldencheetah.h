@@ -109,6 +109,10 @@
 #define sipName_all &sipStrings_goldencheetah[455]
 #define sipNameNr_url 459
 #define sipName_url &sipStrings_goldencheetah[459]
+#define sipNameNr_activitySimilar 463
+#define sipName_activitySimilar &sipStrings_goldencheetah[463]
+#define sipNameNr_count 479
+#define sipName_count &sipStrings_goldencheetah[479]
 
 #define sipMalloc                   sipAPI_goldencheetah->api_malloc
 #define sipFree                     sipAPI_goldencheetah->api_free
@@ -6,7 +6,7 @@
 
 #include "sipAPIgoldencheetah.h"
 
-#line 110 "goldencheetah.sip"
+#line 116 "goldencheetah.sip"
 //#include "Bindings.h"
 #line 12 "./sipgoldencheetahBindings.cpp"
 
@@ -585,19 +585,21 @@ static PyObject *meth_Bindings_seasonMetrics(PyObject *sipSelf, PyObject *sipArg
          ::QString* a1 = &a1def;
         int a1State = 0;
         bool a2 = 0;
+        bool a3 = 0;
          ::Bindings *sipCpp;
 
         static const char *sipKwdList[] = {
             sipName_all,
             sipName_filter,
             sipName_compare,
+            sipName_series,
         };
 
-        if (sipParseKwdArgs(&sipParseErr, sipArgs, sipKwds, sipKwdList, NULL, "B|bJ1b", &sipSelf, sipType_Bindings, &sipCpp, &a0, sipType_QString,&a1, &a1State, &a2))
+        if (sipParseKwdArgs(&sipParseErr, sipArgs, sipKwds, sipKwdList, NULL, "B|bJ1bb", &sipSelf, sipType_Bindings, &sipCpp, &a0, sipType_QString,&a1, &a1State, &a2, &a3))
         {
             PyObject * sipRes;
 
-            sipRes = sipCpp->seasonMetrics(a0,*a1,a2);
+            sipRes = sipCpp->seasonMetrics(a0,*a1,a2,a3);
             sipReleaseType(a1,sipType_QString,a1State);
 
             return sipRes;
@@ -727,17 +729,19 @@ static PyObject *meth_Bindings_activityMeanmax(PyObject *sipSelf, PyObject *sipA
 
     {
         bool a0 = 0;
+        bool a1 = 0;
          ::Bindings *sipCpp;
 
         static const char *sipKwdList[] = {
             sipName_compare,
+            sipName_series,
         };
 
-        if (sipParseKwdArgs(&sipParseErr, sipArgs, sipKwds, sipKwdList, NULL, "B|b", &sipSelf, sipType_Bindings, &sipCpp, &a0))
+        if (sipParseKwdArgs(&sipParseErr, sipArgs, sipKwds, sipKwdList, NULL, "B|bb", &sipSelf, sipType_Bindings, &sipCpp, &a0, &a1))
         {
             PyObject * sipRes;
 
-            sipRes = sipCpp->activityMeanmax(a0);
+            sipRes = sipCpp->activityMeanmax(a0,a1);
 
             return sipRes;
         }
@@ -761,19 +765,21 @@ static PyObject *meth_Bindings_seasonMeanmax(PyObject *sipSelf, PyObject *sipArg
          ::QString* a1 = &a1def;
         int a1State = 0;
         bool a2 = 0;
+        bool a3 = 0;
          ::Bindings *sipCpp;
 
         static const char *sipKwdList[] = {
             sipName_all,
             sipName_filter,
             sipName_compare,
+            sipName_series,
         };
 
-        if (sipParseKwdArgs(&sipParseErr, sipArgs, sipKwds, sipKwdList, NULL, "B|bJ1b", &sipSelf, sipType_Bindings, &sipCpp, &a0, sipType_QString,&a1, &a1State, &a2))
+        if (sipParseKwdArgs(&sipParseErr, sipArgs, sipKwds, sipKwdList, NULL, "B|bJ1bb", &sipSelf, sipType_Bindings, &sipCpp, &a0, sipType_QString,&a1, &a1State, &a2, &a3))
         {
             PyObject * sipRes;
 
-            sipRes = sipCpp->seasonMeanmax(a0,*a1,a2);
+            sipRes = sipCpp->seasonMeanmax(a0,*a1,a2,a3);
             sipReleaseType(a1,sipType_QString,a1State);
 
             return sipRes;
@@ -900,6 +906,38 @@ static PyObject *meth_Bindings_activityIntervals(PyObject *sipSelf, PyObject *si
 }
 
 
+extern "C" {static PyObject *meth_Bindings_activitySimilar(PyObject *, PyObject *, PyObject *);}
+static PyObject *meth_Bindings_activitySimilar(PyObject *sipSelf, PyObject *sipArgs, PyObject *sipKwds)
+{
+    PyObject *sipParseErr = NULL;
+
+    {
+        PyObject * a0 = 0;
+        int a1 = 10;
+         ::Bindings *sipCpp;
+
+        static const char *sipKwdList[] = {
+            sipName_activity,
+            sipName_count,
+        };
+
+        if (sipParseKwdArgs(&sipParseErr, sipArgs, sipKwds, sipKwdList, NULL, "B|P0i", &sipSelf, sipType_Bindings, &sipCpp, &a0, &a1))
+        {
+            PyObject * sipRes;
+
+            sipRes = sipCpp->activitySimilar(a0,a1);
+
+            return sipRes;
+        }
+    }
+
+    /* Raise an exception if the arguments couldn't be parsed. */
+    sipNoMethod(sipParseErr, sipName_Bindings, sipName_activitySimilar, NULL);
+
+    return NULL;
+}
+
+
 /* Call the instance's destructor. */
 extern "C" {static void release_Bindings(void *, int);}
 static void release_Bindings(void *sipCppV, int)
@@ -973,6 +1011,7 @@ static PyMethodDef methods_Bindings[] = {
     {SIP_MLNAME_CAST(sipName_activityIntervals), (PyCFunction)meth_Bindings_activityIntervals, METH_VARARGS|METH_KEYWORDS, NULL},
     {SIP_MLNAME_CAST(sipName_activityMeanmax), (PyCFunction)meth_Bindings_activityMeanmax, METH_VARARGS|METH_KEYWORDS, NULL},
     {SIP_MLNAME_CAST(sipName_activityMetrics), (PyCFunction)meth_Bindings_activityMetrics, METH_VARARGS|METH_KEYWORDS, NULL},
+    {SIP_MLNAME_CAST(sipName_activitySimilar), (PyCFunction)meth_Bindings_activitySimilar, METH_VARARGS|METH_KEYWORDS, NULL},
     {SIP_MLNAME_CAST(sipName_activityWbal), (PyCFunction)meth_Bindings_activityWbal, METH_VARARGS|METH_KEYWORDS, NULL},
     {SIP_MLNAME_CAST(sipName_athlete), meth_Bindings_athlete, METH_VARARGS, NULL},
     {SIP_MLNAME_CAST(sipName_athleteZones), (PyCFunction)meth_Bindings_athleteZones, METH_VARARGS|METH_KEYWORDS, NULL},
@@ -1012,7 +1051,7 @@ sipClassTypeDef sipTypeDef_goldencheetah_Bindings = {
     {
         sipNameNr_Bindings,
         {0, 0, 1},
-        27, methods_Bindings,
+        28, methods_Bindings,
         0, 0,
         0, 0,
         {0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
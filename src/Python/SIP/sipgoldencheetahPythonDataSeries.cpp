@@ -33,10 +33,10 @@ static PyObject *slot_PythonDataSeries___getitem__(PyObject *sipSelf,PyObject *s
             double sipRes = 0;
             sipErrorState sipError = sipErrorNone;
 
-#line 94 "goldencheetah.sip"
+#line 100 "goldencheetah.sip"
         if (a0 < 0) a0 += sipCpp->count;
         if (a0 >= 0 && a0 < sipCpp->count) {
-            sipRes = sipCpp->data[a0];
+            sipRes = sipCpp->data.at(a0);
         } else {
             PyErr_SetString(PyExc_IndexError, "Index out of range");
             sipError = sipErrorFail;
@@ -75,7 +75,7 @@ static SIP_SSIZE_T slot_PythonDataSeries___len__(PyObject *sipSelf)
         {
             SIP_SSIZE_T sipRes = 0;
 
-#line 90 "goldencheetah.sip"
+#line 96 "goldencheetah.sip"
         sipRes = sipCpp->count;
 #line 81 "./sipgoldencheetahPythonDataSeries.cpp"
 
@@ -100,7 +100,7 @@ static PyObject *slot_PythonDataSeries___str__(PyObject *sipSelf)
         {
              ::QString*sipRes = 0;
 
-#line 86 "goldencheetah.sip"
+#line 92 "goldencheetah.sip"
         sipRes = new QString(sipCpp->name);
 #line 106 "./sipgoldencheetahPythonDataSeries.cpp"
 
@@ -122,27 +122,33 @@ static void release_PythonDataSeries(void *sipCppV, int)
 
 #if PY_MAJOR_VERSION >= 3
 extern "C" {static int getbuffer_PythonDataSeries(PyObject *, void *, Py_buffer *, int);}
-static int getbuffer_PythonDataSeries(PyObject *sipSelf, void *sipCppV, Py_buffer *sipBuffer, int )
+static int getbuffer_PythonDataSeries(PyObject *sipSelf, void *sipCppV, Py_buffer *sipBuffer, int sipFlags)
 {
      ::PythonDataSeries *sipCpp = reinterpret_cast< ::PythonDataSeries *>(sipCppV);
     int sipRes;
 
 #line 63 "goldencheetah.sip"
-    sipBuffer->obj = sipSelf;
-    sipBuffer->buf = (void*)sipCpp->data;
-    sipBuffer->len = sipCpp->count * sizeof(double);
-    sipBuffer->readonly = 0;
-    sipBuffer->itemsize = sizeof(double);
-    sipBuffer->format = (char*)"d";  // double
-    sipBuffer->ndim = 1;
-    sipBuffer->shape = &sipCpp->count;  // length-1 sequence of dimensions
-    sipBuffer->strides = &sipBuffer->itemsize;  // for the simple case we can do this
-    sipBuffer->suboffsets = NULL;
-    sipBuffer->internal = NULL;
-
-    Py_INCREF(sipSelf);  // need to increase the reference count
-    sipRes = 0;
-#line 146 "./sipgoldencheetahPythonDataSeries.cpp"
+    if ((sipFlags & PyBUF_WRITABLE) && sipCpp->readonly) {
+        PyErr_SetString(PyExc_BufferError, "data series is read only");
+        sipBuffer->obj = NULL;
+        sipRes = -1;
+    } else {
+        sipBuffer->obj = sipSelf;
+        sipBuffer->buf = sipCpp->readonly ? (void*)sipCpp->data.constData() : (void*)sipCpp->data.data();
+        sipBuffer->len = sipCpp->count * sizeof(double);
+        sipBuffer->readonly = sipCpp->readonly ? 1 : 0;
+        sipBuffer->itemsize = sizeof(double);
+        sipBuffer->format = (char*)"d";  // double
+        sipBuffer->ndim = 1;
+        sipBuffer->shape = &sipCpp->count;  // length-1 sequence of dimensions
+        sipBuffer->strides = &sipBuffer->itemsize;  // for the simple case we can do this
+        sipBuffer->suboffsets = NULL;
+        sipBuffer->internal = NULL;
+
+        Py_INCREF(sipSelf);  // need to increase the reference count
+        sipRes = 0;
+    }
+#line 152 "./sipgoldencheetahPythonDataSeries.cpp"
 
     return sipRes;
 }
@@ -153,9 +159,9 @@ static int getbuffer_PythonDataSeries(PyObject *sipSelf, void *sipCppV, Py_buffe
 extern "C" {static void releasebuffer_PythonDataSeries(PyObject *, void *, Py_buffer *);}
 static void releasebuffer_PythonDataSeries(PyObject *, void *, Py_buffer *)
 {
-#line 80 "goldencheetah.sip"
+#line 86 "goldencheetah.sip"
     // we do not require any special release function
-#line 159 "./sipgoldencheetahPythonDataSeries.cpp"
+#line 165 "./sipgoldencheetahPythonDataSeries.cpp"
 }
 #endif
 
@@ -9,7 +9,7 @@
 #line 59 "goldencheetah.sip"
 #include "Bindings.h"
 #line 12 "./sipgoldencheetahcmodule.cpp"
-#line 110 "goldencheetah.sip"
+#line 116 "goldencheetah.sip"
 //#include "Bindings.h"
 #line 15 "./sipgoldencheetahcmodule.cpp"
 
@@ -63,6 +63,8 @@ const char sipStrings_goldencheetah[] = {
     'd', 'a', 't', 'e', 0,
     'a', 'l', 'l', 0,
     'u', 'r', 'l', 0,
+    'a', 'c', 't', 'i', 'v', 'i', 't', 'y', 'S', 'i', 'm', 'i', 'l', 'a', 'r', 0,
+    'c', 'o', 'u', 'n', 't', 0,
 };
 
 
@@ -21,6 +21,7 @@
 #include "GcUpgrade.h"
 
 #include "RideCache.h"
+#include "RideSimilarity.h"
 #include "RideItem.h"
 #include "IntervalItem.h"
 #include "RideFile.h"
@@ -37,6 +38,8 @@
 #include "HrZones.h"
 #include "PaceZones.h"
 
+#include <cstring>
+
 // Structure used to register routines has changed in v3.4 of R
 //
 // there is no way to support older versions without declaring our
@@ -125,6 +128,7 @@ RTool::RTool()
             { "GC.activity.wbal", (DL_FUNC) &RTool::activityWBal, 0,0 },
             { "GC.activity.xdata", (DL_FUNC) &RTool::activityXData, 0,0 },
             { "GC.activity.intervals", (DL_FUNC) &RTool::activityIntervals, 0,0 },
+            { "GC.activity.similar", (DL_FUNC) &RTool::activitySimilar, 0,0 },
             { "GC.season", (DL_FUNC) &RTool::season, 0,0 },
             { "GC.season.metrics", (DL_FUNC) &RTool::metrics, 0,0 },
             { "GC.season.intervals", (DL_FUNC) &RTool::seasonIntervals, 0,0 },
@@ -149,6 +153,7 @@ RTool::RTool()
             { "GC.activity.wbal", (DL_FUNC) &RTool::activityWBal, 0,0,0 },
             { "GC.activity.xdata", (DL_FUNC) &RTool::activityXData, 0,0,0 },
             { "GC.activity.intervals", (DL_FUNC) &RTool::activityIntervals, 0,0,0 },
+            { "GC.activity.similar", (DL_FUNC) &RTool::activitySimilar, 0,0,0 },
             { "GC.season", (DL_FUNC) &RTool::season, 0,0,0 },
             { "GC.season.metrics", (DL_FUNC) &RTool::metrics, 0,0,0 },
             { "GC.season.intervals", (DL_FUNC) &RTool::seasonIntervals, 0,0,0 },
@@ -180,6 +185,8 @@ RTool::RTool()
             { "GC.activity.xdata", (DL_FUNC) &RTool::activityXData, 2 },
             // type=any, datetime=0
             { "GC.activity.intervals", (DL_FUNC) &RTool::activityIntervals, 2 },
+            // datetime=0, count=10
+            { "GC.activity.similar", (DL_FUNC) &RTool::activitySimilar, 2 },
 
             // all=FALSE, compare=FALSE
             { "GC.season", (DL_FUNC) &RTool::season, 2 },
@@ -271,6 +278,7 @@ RTool::RTool()
                                "GC.activity.wbal <- function(compare=FALSE) { .Call(\"GC.activity.wbal\", compare) }\n"
                                "GC.activity.xdata <- function(name=\"\", compare=FALSE) { .Call(\"GC.activity.xdata\", name, compare) }\n"
                                "GC.activity.intervals <- function(type=NULL, activity=0) { .Call(\"GC.activity.intervals\", type, activity) }\n"
+                               "GC.activity.similar <- function(activity=0, count=10) { .Call(\"GC.activity.similar\", activity, count) }\n"
 
                                // season
                                "GC.season <- function(all=FALSE, compare=FALSE) { .Call(\"GC.season\", all, compare) }\n"
@@ -355,6 +363,9 @@ RTool::configChanged()
     // wait until loaded
     if (starting || failed) return;
 
+    // units and colors may have changed
+    forget();
+
     // update global R appearances
     QString parCommand=QString("par(par.default)\n"
                                "par(bg=\"%1\", "
@@ -1128,34 +1139,21 @@ RTool::dfForRideItem(const RideItem *ri)
     return ans;
 }
 
-SEXP
-RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
+FilterSet
+RTool::globalFilters()
 {
-    const RideMetricFactory &factory = RideMetricFactory::instance();
-    int rides = rtool->context->athlete->rideCache->count();
-    int metrics = factory.metricCount();
-
-    // count the number of meta fields to add
-    int meta = 0;
-    if (rtool->context && rtool->context->athlete->rideMetadata()) {
-
-        // count active fields
-        foreach(FieldDefinition def, rtool->context->athlete->rideMetadata()->getFields()) {
-            if (def.name != "" && def.tab != "" &&
-                !rtool->context->specialFields.isMetric(def.name))
-                meta++;
-        }
-    }
-
-    // how many rides to return if we're limiting to the
-    // currently selected date range ?
-
-    // apply any global filters
-    Specification specification;
     FilterSet fs;
     fs.addFilter(rtool->context->isfiltered, rtool->context->filters);
     fs.addFilter(rtool->context->ishomefiltered, rtool->context->homeFilters);
-    specification.setFilterSet(fs);
+    return fs;
+}
+
+Specification
+RTool::specificationFor(DateRange range, SEXP filter)
+{
+    // apply any global filters
+    Specification specification;
+    FilterSet fs = globalFilters();
 
     // did call contain any filters?
     PROTECT(filter=Rf_coerceVector(filter, STRSXP));
@@ -1171,32 +1169,158 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
             fs.addFilter(true, files);
         }
     }
+    UNPROTECT(1);
+
     specification.setFilterSet(fs);
+    specification.setDateRange(range);
+    return specification;
+}
+
+QVector<RideItem*>
+RTool::ridesFor(Specification specification)
+{
+    // the ride cache compiles the specification to a bitset
+    // once and reuses it, so this is cheap after the first call
+    RideCache *rideCache = rtool->context->athlete->rideCache;
+    QBitArray pass = rideCache->passing(specification);
+
+    QVector<RideItem*> returning;
+    returning.reserve(pass.count(true));
+    for(int i=0; i<rideCache->rides().count() && i<pass.size(); i++)
+        if (pass.testBit(i)) returning << rideCache->rides()[i];
+
+    return returning;
+}
+
+QString
+RTool::memoKey(QString type, DateRange range, SEXP filter)
+{
+    // the filter expressions are part of the key, their results
+    // can only change when the ride cache does (see recall)
+    QString key = QString("%1:%2:%3:%4:%5:%6")
+                  .arg(type)
+                  .arg(rtool->context->athlete->home->root().absolutePath())
+                  .arg(range.from.toString(Qt::ISODate))
+                  .arg(range.to.toString(Qt::ISODate))
+                  .arg(rtool->context->athlete->useMetricUnits)
+                  .arg(globalFilters().count());
+
+    PROTECT(filter=Rf_coerceVector(filter, STRSXP));
+    for(int i=0; i<Rf_length(filter); i++)
+        key += QString(":%1").arg(CHAR(STRING_ELT(filter,i)));
     UNPROTECT(1);
 
-    // we need to count rides that are in range...
-    rides = 0;
-    foreach(RideItem *ride, rtool->context->athlete->rideCache->rides()) {
-        if (!specification.pass(ride)) continue;
-        if (all || range.pass(ride->dateTime.date())) rides++;
+    return key;
+}
+
+SEXP
+RTool::recall(QString key)
+{
+    if (rtool->context == NULL) return R_NilValue;
+
+    unsigned long version = rtool->context->athlete->rideCache->version();
+    FilterSet fs = globalFilters();
+
+    for(int i=0; i<memo.count(); i++) {
+
+        // only look at our own, the context for the others may have gone
+        if (memo[i].context != rtool->context) continue;
+
+        // rides changed since we built it
+        if (memo[i].version != version) {
+            R_ReleaseObject(memo[i].frame);
+            memo.removeAt(i--);
+            continue;
+        }
+
+        if (memo[i].key == key && memo[i].matches == fs.matches()) {
+
+            // most recently used go to the back
+            memo.move(i, memo.count()-1);
+            return memo.last().frame;
+        }
     }
+    return R_NilValue;
+}
+
+void
+RTool::memoize(QString key, SEXP frame)
+{
+    if (rtool->context == NULL) return;
+
+    // the same frame is handed to every caller, so R must
+    // copy it on modify rather than update it in place
+#if defined(MARK_NOT_MUTABLE) || R_VERSION >= R_Version(4,0,0)
+    MARK_NOT_MUTABLE(frame);
+    if (TYPEOF(frame) == VECSXP)
+        for(int i=0; i<Rf_length(frame); i++) MARK_NOT_MUTABLE(VECTOR_ELT(frame, i));
+#else
+    SET_NAMED(frame, 2);
+    if (TYPEOF(frame) == VECSXP)
+        for(int i=0; i<Rf_length(frame); i++) SET_NAMED(VECTOR_ELT(frame, i), 2);
+#endif
+
+    MemoizedFrame add;
+    add.context = rtool->context;
+    add.version = rtool->context->athlete->rideCache->version();
+    add.key = key;
+    add.matches = globalFilters().matches();
+    add.frame = frame;
+    R_PreserveObject(frame);
+
+    // a handful of charts, each with a few seasons is plenty
+    if (memo.count() >= 16) {
+        R_ReleaseObject(memo.first().frame);
+        memo.removeFirst();
+    }
+    memo << add;
+}
+
+void
+RTool::forget()
+{
+    foreach(MemoizedFrame m, memo) R_ReleaseObject(m.frame);
+    memo.clear();
+}
+
+SEXP
+RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
+{
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+    int metrics = factory.metricCount();
+
+    // unchanged since we were last asked ?
+    if (all) range = DateRange();
+    QString key = memoKey("metrics", range, filter);
+    SEXP memoized = recall(key);
+    if (memoized != R_NilValue) return memoized;
+
+    // count the number of meta fields to add
+    QList<FieldDefinition> fields;
+    if (rtool->context && rtool->context->athlete->rideMetadata()) {
+
+        // active fields only
+        foreach(FieldDefinition def, rtool->context->athlete->rideMetadata()->getFields()) {
+            if (def.name != "" && def.tab != "" &&
+                !rtool->context->specialFields.isMetric(def.name))
+                fields << def;
+        }
+    }
+    int meta = fields.count();
+
+    // the rides we return, global filters, any filters in the call
+    // and the date range if we're limiting to the selected season
+    QVector<RideItem*> items = ridesFor(specificationFor(range, filter));
+    int rides = items.count();
 
     // get a listAllocated
     SEXP ans;
     SEXP names; // column names
-    SEXP rownames; // row names (numeric)
 
     // +3 is for date and datetime and color
     PROTECT(ans=Rf_allocVector(VECSXP, metrics+meta+3));
     PROTECT(names = Rf_allocVector(STRSXP, metrics+meta+3));
 
-    // we have to give a name to each row
-    PROTECT(rownames = Rf_allocVector(STRSXP, rides));
-    for(int i=0; i<rides; i++) {
-        QString rownumber=QString("%1").arg(i+1);
-        SET_STRING_ELT(rownames, i, Rf_mkChar(rownumber.toLatin1().constData()));
-    }
-
     // next name
     int next=0;
 
@@ -1204,13 +1328,9 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
     SEXP date;
     PROTECT(date=Rf_allocVector(INTSXP, rides));
 
-    int k=0;
     QDate d1970(1970,01,01);
-    foreach(RideItem *ride, rtool->context->athlete->rideCache->rides()) {
-        if (!specification.pass(ride)) continue;
-        if (all || range.pass(ride->dateTime.date()))
-            INTEGER(date)[k++] = d1970.daysTo(ride->dateTime.date());
-    }
+    int *dates = INTEGER(date);
+    for(int k=0; k<rides; k++) dates[k] = d1970.daysTo(items[k]->dateTime.date());
 
     SEXP dclas;
     PROTECT(dclas=Rf_allocVector(STRSXP, 1));
@@ -1226,12 +1346,8 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
     PROTECT(time=Rf_allocVector(REALSXP, rides));
 
     // fill with values for date and class if its one we need to return
-    k=0;
-    foreach(RideItem *ride, rtool->context->athlete->rideCache->rides()) {
-        if (!specification.pass(ride)) continue;
-        if (all || range.pass(ride->dateTime.date()))
-            REAL(time)[k++] = ride->dateTime.toUTC().toTime_t();
-    }
+    double *times = REAL(time);
+    for(int k=0; k<rides; k++) times[k] = items[k]->dateTime.toUTC().toTime_t();
 
     // POSIXct class
     SEXP clas;
@@ -1253,7 +1369,8 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
     //
     // METRICS
     //
-    for(int i=0; i<factory.metricCount();i++) {
+    bool useMetricUnits = rtool->context->athlete->useMetricUnits;
+    for(int i=0; i<metrics; i++) {
 
         // set a vector
         SEXP m;
@@ -1261,20 +1378,15 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
 
         QString symbol = factory.metricName(i);
         const RideMetric *metric = factory.rideMetric(symbol);
-        QString name = rtool->context->specialFields.internalName(factory.rideMetric(symbol)->name());
+        QString name = rtool->context->specialFields.internalName(metric->name());
         name = name.replace(" ","_");
         name = name.replace("'","_");
 
-        bool useMetricUnits = rtool->context->athlete->useMetricUnits;
-
-        int index=0;
-        foreach(RideItem *item, rtool->context->athlete->rideCache->rides()) {
-            if (!specification.pass(item)) continue;
-            if (all || range.pass(item->dateTime.date())) {
-                REAL(m)[index++] = item->metrics()[i] * (useMetricUnits ? 1.0f : metric->conversion())
-                                                      + (useMetricUnits ? 0.0f : metric->conversionSum());
-            }
-        }
+        // a column at a time straight into the vector
+        double factor = useMetricUnits ? 1.0f : metric->conversion();
+        double sum = useMetricUnits ? 0.0f : metric->conversionSum();
+        double *column = REAL(m);
+        for(int k=0; k<rides; k++) column[k] = items[k]->metrics()[i] * factor + sum;
 
         // add to the list
         SET_VECTOR_ELT(ans, next, m);
@@ -1291,23 +1403,14 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
     //
     // META
     //
-    foreach(FieldDefinition field, rtool->context->athlete->rideMetadata()->getFields()) {
-
-        // don't add incomplete meta definitions or metric override fields
-        if (field.name == "" || field.tab == "" ||
-            rtool->context->specialFields.isMetric(field.name)) continue;
+    foreach(FieldDefinition field, fields) {
 
         // Create a string vector
         SEXP m;
         PROTECT(m=Rf_allocVector(STRSXP, rides));
 
-        int index=0;
-        foreach(RideItem *item, rtool->context->athlete->rideCache->rides()) {
-            if (!specification.pass(item)) continue;
-            if (all || range.pass(item->dateTime.date())) {
-                SET_STRING_ELT(m, index++, Rf_mkChar(item->getText(field.name, "").toLatin1().constData()));
-            }
-        }
+        for(int k=0; k<rides; k++)
+            SET_STRING_ELT(m, k, Rf_mkChar(items[k]->getText(field.name, "").toLatin1().constData()));
 
         // add to the list
         SET_VECTOR_ELT(ans, next, m);
@@ -1325,24 +1428,20 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
     SEXP color;
     PROTECT(color=Rf_allocVector(STRSXP, rides));
 
-    int index=0;
-    foreach(RideItem *item, rtool->context->athlete->rideCache->rides()) {
-        if (!specification.pass(item)) continue;
-        if (all || range.pass(item->dateTime.date())) {
+    // use the inverted color, not plot marker as that hideous
+    QColor col =GCColor::invertColor(GColor(CPLOTBACKGROUND));
 
-            // apply item color, remembering that 1,1,1 means use default (reverse in this case)
-            if (item->color == QColor(1,1,1,1)) {
+    // white is jarring on a dark background!
+    if (col==QColor(Qt::white)) col=QColor(127,127,127);
 
-                // use the inverted color, not plot marker as that hideous
-                QColor col =GCColor::invertColor(GColor(CPLOTBACKGROUND));
+    // default is the same for every ride so only make the CHARSXP once
+    SEXP defaultcolor = PROTECT(Rf_mkChar(col.name().toLatin1().constData()));
 
-                // white is jarring on a dark background!
-                if (col==QColor(Qt::white)) col=QColor(127,127,127);
+    for(int k=0; k<rides; k++) {
 
-                SET_STRING_ELT(color, index++, Rf_mkChar(col.name().toLatin1().constData()));
-            } else
-                SET_STRING_ELT(color, index++, Rf_mkChar(item->color.name().toLatin1().constData()));
-        }
+        // apply item color, remembering that 1,1,1 means use default (reverse in this case)
+        if (items[k]->color == QColor(1,1,1,1)) SET_STRING_ELT(color, k, defaultcolor);
+        else SET_STRING_ELT(color, k, Rf_mkChar(items[k]->color.name().toLatin1().constData()));
     }
 
     // add to the list and name it
@@ -1350,14 +1449,22 @@ RTool::dfForDateRange(bool all, DateRange range, SEXP filter)
     SET_STRING_ELT(names, next, Rf_mkChar("color"));
     next++;
 
-    UNPROTECT(1);
+    UNPROTECT(2);
 
     // turn the list into a data frame + set column names
+    // row names are the compact form c(NA, -rides) that R uses for 1..n
+    SEXP rownames;
+    PROTECT(rownames = Rf_allocVector(INTSXP, 2));
+    INTEGER(rownames)[0] = NA_INTEGER;
+    INTEGER(rownames)[1] = -rides;
     Rf_setAttrib(ans, R_ClassSymbol, Rf_mkString("data.frame"));
     Rf_setAttrib(ans, R_RowNamesSymbol, rownames);
     Rf_namesgets(ans, names);
 
-    // ans + names
+    // remember it for next time
+    memoize(key, ans);
+
+    // ans + names + rownames
     UNPROTECT(3);
 
     // return it
@@ -2185,8 +2292,12 @@ RTool::dfForActivity(RideFile *f, int split, QString join)
         SEXP time = PROTECT(Rf_allocVector(REALSXP, points));
         pcount++;
 
-        // fill with values for date and class
-        for(int k=0; k<points; k++) REAL(time)[k] = f->startTime().addSecs(f->dataPoints()[index+k]->secs).toUTC().toTime_t();
+        // fill with values for date and class, offset from the start
+        // rather than constructing a QDateTime for every sample
+        RideFilePoint * const *samples = f->dataPoints().constData() + index;
+        double start = f->startTime().toUTC().toTime_t();
+        double *times = REAL(time);
+        for(int k=0; k<points; k++) times[k] = start + qint64(samples[k]->secs);
 
         // POSIXct class
         SEXP clas = PROTECT(Rf_allocVector(STRSXP, 2));
@@ -2215,15 +2326,17 @@ RTool::dfForActivity(RideFile *f, int split, QString join)
             SEXP vector = PROTECT(Rf_allocVector(REALSXP, points));
             pcount++;
 
-            for(int j=index; j<stop; j++) {
-                if (f->isDataPresent(series)) {
-                    if (f->dataPoints()[j]->value(series) == 0 && (series == RideFile::lat || series == RideFile::lon))
-                        REAL(vector)[j-index] = NA_REAL;
-                    else
-                        REAL(vector)[j-index] = f->dataPoints()[j]->value(series);
-                } else {
-                    REAL(vector)[j-index] = NA_REAL;
+            // a column at a time, absent series are all NA
+            double *column = REAL(vector);
+            if (!f->isDataPresent(series)) {
+                for(int k=0; k<points; k++) column[k] = NA_REAL;
+            } else if (series == RideFile::lat || series == RideFile::lon) {
+                for(int k=0; k<points; k++) {
+                    double value = samples[k]->value(series);
+                    column[k] = value == 0 ? NA_REAL : value;
                 }
+            } else {
+                for(int k=0; k<points; k++) column[k] = samples[k]->value(series);
             }
 
             // add to the list
@@ -2265,10 +2378,10 @@ RTool::dfForActivity(RideFile *f, int split, QString join)
                 pcount++;
 
                 int idx=0;
-                for(int j=index; j<stop; j++) {
-                    RideFilePoint *p = f->dataPoints()[j];
-                    double val = f->xdataValue(p, idx, it.value()->name, series, xjoin);
-                    REAL(vector)[j-index] = (val == RideFile::NA) ? NA_REAL : val;
+                double *column = REAL(vector);
+                for(int k=0; k<points; k++) {
+                    double val = f->xdataValue(samples[k], idx, it.value()->name, series, xjoin);
+                    column[k] = (val == RideFile::NA) ? NA_REAL : val;
                 }
 
                 // add to the list
@@ -2281,13 +2394,11 @@ RTool::dfForActivity(RideFile *f, int split, QString join)
             }
         }
 
-        // add rownames
-        SEXP rownames = PROTECT(Rf_allocVector(STRSXP, points));
+        // add rownames, compact form c(NA, -points) is 1..points
+        SEXP rownames = PROTECT(Rf_allocVector(INTSXP, 2));
         pcount++;
-        for(int i=0; i<points; i++) {
-            QString rownumber=QString("%1").arg(i+1);
-            SET_STRING_ELT(rownames, i, Rf_mkChar(rownumber.toLatin1().constData()));
-        }
+        INTEGER(rownames)[0] = NA_INTEGER;
+        INTEGER(rownames)[1] = -points;
 
         // turn the list into a data frame + set column names
         Rf_setAttrib(ans, R_RowNamesSymbol, rownames);
@@ -2305,6 +2416,78 @@ RTool::dfForActivity(RideFile *f, int split, QString join)
     return returning;
 }
 
+SEXP
+RTool::activitySimilar(SEXP datetime, SEXP pCount)
+{
+    // p1 - activity (datetime), the current one if not given
+    // p2 - how many to return
+    pCount = Rf_coerceVector(pCount, INTSXP);
+    int count = INTEGER(pCount)[0];
+
+    // get an activity to process
+    RideItem* ride;
+    QList<RideItem*>activities = rtool->activitiesFor(datetime);
+    if (activities.count()) ride = activities[0];
+    else ride = const_cast<RideItem*>(rtool->context->currentRideItem());
+
+    // if no current ride or more than one activity requested, nothing to return
+    if (ride == NULL || activities.count() > 1) return Rf_allocVector(INTSXP, 0);
+
+    // most alike first
+    QVector<double> scores;
+    QList<RideItem*> like = rtool->context->athlete->rideCache->similarity()->like(ride, count, &scores);
+    int rows = like.count();
+
+    SEXP ans;
+    SEXP names; // column names
+    SEXP rownames; // row names (numeric)
+    PROTECT(ans=Rf_allocVector(VECSXP, 2));
+    PROTECT(names = Rf_allocVector(STRSXP, 2));
+
+    // we have to give a name to each row
+    PROTECT(rownames = Rf_allocVector(STRSXP, rows));
+    for(int i=0; i<rows; i++) {
+        QString rownumber=QString("%1").arg(i+1);
+        SET_STRING_ELT(rownames, i, Rf_mkChar(rownumber.toLatin1().constData()));
+    }
+
+    // TIME
+    SEXP time;
+    PROTECT(time=Rf_allocVector(REALSXP, rows));
+    for(int i=0; i<rows; i++) REAL(time)[i] = like[i]->dateTime.toUTC().toTime_t();
+
+    // POSIXct class
+    SEXP clas;
+    PROTECT(clas=Rf_allocVector(STRSXP, 2));
+    SET_STRING_ELT(clas, 0, Rf_mkChar("POSIXct"));
+    SET_STRING_ELT(clas, 1, Rf_mkChar("POSIXt"));
+    Rf_classgets(time,clas);
+
+    // we use "UTC" for all timezone
+    Rf_setAttrib(time, Rf_install("tzone"), Rf_mkString("UTC"));
+
+    SET_VECTOR_ELT(ans, 0, time);
+    SET_STRING_ELT(names, 0, Rf_mkChar("time"));
+
+    // SIMILARITY 0-100
+    SEXP similarity;
+    PROTECT(similarity=Rf_allocVector(REALSXP, rows));
+    for(int i=0; i<rows; i++) REAL(similarity)[i] = scores[i];
+
+    SET_VECTOR_ELT(ans, 1, similarity);
+    SET_STRING_ELT(names, 1, Rf_mkChar("similarity"));
+
+    // turn the list into a data frame + set column names
+    Rf_setAttrib(ans, R_ClassSymbol, Rf_mkString("data.frame"));
+    Rf_setAttrib(ans, R_RowNamesSymbol, rownames);
+    Rf_namesgets(ans, names);
+
+    // ans, names, rownames, time, clas and similarity
+    UNPROTECT(6);
+
+    return ans;
+}
+
 QList<RideItem *>
 RTool::activitiesFor(SEXP datetime)
 {
@@ -2545,6 +2728,11 @@ RTool::dfForDateRangeMeanmax(bool all, DateRange range, SEXP filter)
     // construct the date range and then get a ridefilecache
     if (all) range = DateRange(QDate(1900,01,01), QDate(2100,01,01));
 
+    // aggregating the cpx files is expensive, so reuse if we can
+    QString key = memoKey("meanmax", range, filter);
+    SEXP memoized = recall(key);
+    if (memoized != R_NilValue) return memoized;
+
     // did call contain any filters?
     QStringList filelist;
     bool filt=false;
@@ -2567,10 +2755,11 @@ RTool::dfForDateRangeMeanmax(bool all, DateRange range, SEXP filter)
     // RideFileCache for a date range with our filters (if any)
     RideFileCache cache(rtool->context, range.from, range.to, filt, filelist, false, NULL);
 
-    return dfForRideFileCache(&cache);
+    SEXP ans = PROTECT(dfForRideFileCache(&cache));
+    memoize(key, ans);
+    UNPROTECT(1);
 
-    // nothing to return
-    return Rf_allocVector(INTSXP, 0);
+    return ans;
 }
 
 
@@ -2628,7 +2817,7 @@ RTool::dfForRideFileCache(RideFileCache *cache)
         // will have different sizes e.g. when a daterange
         // since longest ride with e.g. power may be different
         // to longest ride with heartrate
-        for(int j=0; j<values.count(); j++) REAL(vector)[j] = values[j];
+        memcpy(REAL(vector), values.constData(), values.count() * sizeof(double));
 
         // add to the list
         SET_VECTOR_ELT(ans, next, vector);
@@ -2658,7 +2847,9 @@ RTool::dfForRideFileCache(RideFileCache *cache)
             // will have different sizes e.g. when a daterange
             // since longest ride with e.g. power may be different
             // to longest ride with heartrate
-            for(int j=0; j<values.count(); j++) INTEGER(vector)[j] = d1970.daysTo(dates[j]);
+            int *days = INTEGER(vector);
+            for(int j=0; j<values.count() && j<dates.count(); j++) days[j] = d1970.daysTo(dates[j]);
+            for(int j=dates.count(); j<values.count(); j++) days[j] = NA_INTEGER;
 
             // add to the list
             SET_VECTOR_ELT(ans, next, vector);
@@ -2674,13 +2865,11 @@ RTool::dfForRideFileCache(RideFileCache *cache)
         }
     }
 
-    // add rownames
+    // add rownames, compact form c(NA, -size) is 1..size
     SEXP rownames;
-    PROTECT(rownames = Rf_allocVector(STRSXP, size));
-    for(unsigned int i=0; i<size; i++) {
-        QString rownumber=QString("%1").arg(i+1);
-        SET_STRING_ELT(rownames, i, Rf_mkChar(rownumber.toLatin1().constData()));
-    }
+    PROTECT(rownames = Rf_allocVector(INTSXP, 2));
+    INTEGER(rownames)[0] = NA_INTEGER;
+    INTEGER(rownames)[1] = -static_cast<int>(size);
 
     // turn the list into a data frame + set column names
     Rf_setAttrib(ans, R_RowNamesSymbol, rownames);
@@ -2839,6 +3028,15 @@ RTool::seasonPeaks(SEXP pAll, SEXP pFilter, SEXP pCompare, SEXP pSeries, SEXP pD
 SEXP
 RTool::dfForDateRangePeaks(bool all, DateRange range, SEXP filter, QList<RideFile::SeriesType> series, QList<int> durations)
 {
+    // unchanged since we were last asked ?
+    if (all) range = DateRange();
+    QString key = memoKey("peaks", range, filter);
+    foreach(RideFile::SeriesType pseries, series) key += QString(":%1").arg(static_cast<int>(pseries));
+    key += "/";
+    foreach(int pduration, durations) key += QString(":%1").arg(pduration);
+    SEXP memoized = recall(key);
+    if (memoized != R_NilValue) return memoized;
+
     // so how many vectors in the frame ? +1 is the datetime of the peak
     int listsize=series.count() * durations.count() + 1;
     SEXP df;
@@ -2851,56 +3049,17 @@ RTool::dfForDateRangePeaks(bool all, DateRange range, SEXP filter, QList<RideFil
     SET_STRING_ELT(names, 0, Rf_mkChar("time"));
     int next=1;
 
-    // how many rides ?
-    Specification specification;
-    FilterSet fs;
-    fs.addFilter(rtool->context->isfiltered, rtool->context->filters);
-    fs.addFilter(rtool->context->ishomefiltered, rtool->context->homeFilters);
-    specification.setFilterSet(fs);
-
-    // did call contain any filters?
-    PROTECT(filter=Rf_coerceVector(filter, STRSXP));
-    for(int i=0; i<Rf_length(filter); i++) {
-
-        // if not empty write a filter
-        QString f(CHAR(STRING_ELT(filter,i)));
-        if (f != "") {
-
-            DataFilter dataFilter(rtool->canvas, rtool->context);
-            QStringList files;
-            dataFilter.parseFilter(rtool->context, f, &files);
-            fs.addFilter(true, files);
-        }
-    }
-    specification.setFilterSet(fs);
-    UNPROTECT(1);
-
-    // how many pass?
-    int size=0;
-    foreach(RideItem *item, rtool->context->athlete->rideCache->rides()) {
-
-        // apply filters
-        if (!specification.pass(item)) continue;
-
-        // do we want this one ?
-        if (all || range.pass(item->dateTime.date()))  size++;
-    }
-
+    // how many rides pass ?
+    QVector<RideItem*> items = ridesFor(specificationFor(range, filter));
+    int size=items.count();
 
     // dates first
     SEXP dates;
     PROTECT(dates=Rf_allocVector(REALSXP, size));
 
     // fill with values for date and class
-    int i=0;
-    foreach(RideItem *item, rtool->context->athlete->rideCache->rides()) {
-        // apply filters
-        if (!specification.pass(item)) continue;
-
-        if (all || range.pass(item->dateTime.date())) {
-            REAL(dates)[i++] = item->dateTime.toUTC().toTime_t();
-        }
-    }
+    double *times = REAL(dates);
+    for(int i=0; i<size; i++) times[i] = items[i]->dateTime.toUTC().toTime_t();
 
     // POSIXct class
     SEXP clas;
@@ -2912,6 +3071,9 @@ RTool::dfForDateRangePeaks(bool all, DateRange range, SEXP filter, QList<RideFil
 
     SET_VECTOR_ELT(df, dfindex++, dates);
 
+    // allocate all the columns up front so we can visit each
+    // ride (and its cpx file) once, rather than once per column
+    QVector<double*> columns;
     foreach(RideFile::SeriesType pseries, series) {
 
         foreach(int pduration, durations) {
@@ -2924,44 +3086,42 @@ RTool::dfForDateRangePeaks(bool all, DateRange range, SEXP filter, QList<RideFil
             QString name = QString("peak_%1_%2").arg(RideFile::seriesName(pseries, true)).arg(pduration);
             SET_STRING_ELT(names, next++, Rf_mkChar(name.toLatin1().constData()));
 
-            // fill with values
-            // get the value for the series and duration requested, although this is called
-            int index=0;
-            foreach(RideItem *item, rtool->context->athlete->rideCache->rides()) {
-
-                // apply filters
-                if (!specification.pass(item)) continue;
-
-                // do we want this one ?
-                if (all || range.pass(item->dateTime.date())) {
-
-                    // for each series/duration independently its pretty quick since it lseeks to
-                    // the actual value, so /should't/ be too expensive.........
-                    REAL(vector)[index++] = RideFileCache::best(item->context, item->fileName, pseries, pduration);
-                }
-            }
-
-            // add named vector to the list
+            // add named vector to the list, which protects it
             SET_VECTOR_ELT(df, dfindex++, vector);
+            columns << REAL(vector);
 
             UNPROTECT(1);
-
         }
     }
 
-    // set names + data.frame
-    SEXP rownames;
-    PROTECT(rownames = Rf_allocVector(STRSXP, size));
+    // fill with values
     for(int i=0; i<size; i++) {
-        QString rownumber=QString("%1").arg(i+1);
-        SET_STRING_ELT(rownames, i, Rf_mkChar(rownumber.toLatin1().constData()));
+
+        RideItem *item = items[i];
+        int column=0;
+        foreach(RideFile::SeriesType pseries, series) {
+            foreach(int pduration, durations) {
+
+                // best() uses the mapped cpx file so repeat lookups
+                // on the same ride are just an offset into memory
+                columns[column++][i] = RideFileCache::best(item->context, item->fileName, pseries, pduration);
+            }
+        }
     }
 
+    // set names + data.frame, compact row names c(NA, -size) is 1..size
+    SEXP rownames;
+    PROTECT(rownames = Rf_allocVector(INTSXP, 2));
+    INTEGER(rownames)[0] = NA_INTEGER;
+    INTEGER(rownames)[1] = -size;
+
     // turn the list into a data frame + set column names
     Rf_setAttrib(df, R_ClassSymbol, Rf_mkString("data.frame"));
     Rf_setAttrib(df, R_RowNamesSymbol, rownames);
     Rf_namesgets(df, names);
 
+    // remember it for next time
+    memoize(key, df);
 
     // df + names + dates + clas + rownames
     UNPROTECT(5);
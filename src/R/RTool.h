@@ -18,6 +18,7 @@
 
 #include "RChart.h"
 #include "Context.h"
+#include "Specification.h"
 
 #ifndef _GC_RTool_h
 
@@ -59,6 +60,7 @@ class RTool {
         static SEXP activityXData(SEXP name, SEXP compare);
         static SEXP activityMetrics(SEXP compare);
         static SEXP activityIntervals(SEXP type, SEXP datetime);
+        static SEXP activitySimilar(SEXP datetime, SEXP count);
 
         // seasons
         static SEXP season(SEXP all, SEXP compare);
@@ -110,6 +112,28 @@ class RTool {
         SEXP dfForDateRangePeaks(bool all, DateRange range, SEXP filter, QList<RideFile::SeriesType> series, QList<int> durations);
         SEXP dfForRideFileCache(RideFileCache *p);      // returns meanmax for a cache
 
+        // rides passing the global and user filters for a date range
+        Specification specificationFor(DateRange range, SEXP filter);
+        QVector<RideItem*> ridesFor(Specification specification);
+        FilterSet globalFilters();
+
+        // season data frames are memoized; charts repaint far more often
+        // than the rides change, so we recall them until the ride cache
+        // version moves on (or config changes, since units and colors do)
+        struct MemoizedFrame {
+            Context *context;
+            unsigned long version;
+            QString key;
+            QSet<QString> matches;
+            SEXP frame;
+        };
+        QList<MemoizedFrame> memo;
+
+        QString memoKey(QString type, DateRange range, SEXP filter);
+        SEXP recall(QString key);
+        void memoize(QString key, SEXP frame);
+        void forget();
+
 };
 
 // there is a global instance created in main